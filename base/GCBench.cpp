@@ -1,6 +1,13 @@
 // modified by Thatcher Ulrich for testing tu_gc::
 //
 // cl -Ox -DNDEBUG=1 -Zi -GX GCBench.cpp tu_gc_singlethreaded_marksweep.cpp -I.. -D_HAS_EXCEPTIONS=1 -DGC winmm.lib
+//
+// With -DGC_PARALLEL, uses tu_gc::parallel_marksweep instead:
+//
+// g++ -O2 -DNDEBUG=1 GCBench.cpp tu_gc_parallel_marksweep.cpp tu_timer.cpp -I.. -DGC -DGC_PARALLEL -lpthread
+//
+// and "GCBench -threads N" runs the benchmark with 1 to N collector
+// threads, and reports the pause times and the throughput of each.
 
 
 // This is adapted from a benchmark written by John Ellis and Pete Kovac
@@ -42,14 +49,20 @@
 //      commercial Java implementations seriously attempt to minimize GC pause
 //      times.
 
-#include <new.h>
+#include <new>
 #include <stdio.h>
-//#include <sys/time.h>
-#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/time.h>
+#endif
 
 #ifdef GC
 #  include "base/tu_gc_singlethreaded_marksweep.h"
 #  include "base/tu_gc_singlethreaded_refcount.h"
+#  include "base/tu_gc_parallel_marksweep.h"
 #endif
 
 //  These macros were a quick hack for the Macintosh.
@@ -62,19 +75,21 @@
 
 /* Get the current time in milliseconds */
 
-// unsigned
-// stats_rtclock( void )
-// {
-//   struct timeval t;
-//   struct timezone tz;
-
-//   if (gettimeofday( &t, &tz ) == -1)
-//     return 0;
-//   return (t.tv_sec * 1000 + t.tv_usec / 1000);
-// }
+#ifdef _WIN32
 unsigned stats_rtclock() {
 	return timeGetTime();
 }
+#else
+unsigned
+stats_rtclock( void )
+{
+  struct timeval t;
+
+  if (gettimeofday( &t, NULL ) == -1)
+    return 0;
+  return (t.tv_sec * 1000 + t.tv_usec / 1000);
+}
+#endif
 
 static const int kStretchTreeDepth    = 18;      // about 16Mb
 static const int kLongLivedTreeDepth  = 16;  // about 4Mb
@@ -83,8 +98,12 @@ static const int kMinTreeDepth = 4;
 static const int kMaxTreeDepth = 16;
 
 #ifdef GC
+#ifdef GC_PARALLEL
+DECLARE_GC_TYPES(tu_gc::parallel_marksweep);
+#else
 DECLARE_GC_TYPES(tu_gc::singlethreaded_marksweep);
 //DECLARE_GC_TYPES(tu_gc::singlethreaded_refcount);
+#endif
 #define GC_NEW(x)
 struct Node0;
 typedef gc_ptr<Node0> Node;
@@ -100,13 +119,16 @@ struct Node0
         Node left;
         Node right;
         int i, j;
-        Node0(const Node& l, const Node& r) { left = l; right = r; }
-        Node0() { left = 0; right = 0; }
+        Node0(const Node& l, const Node& r) { left = l; right = r; s_count++; }
+        Node0() { left = 0; right = 0; s_count++; }
+        static int s_count;	// nodes allocated, for the throughput
 #       ifndef GC
           ~Node0() { if (left) delete left; if (right) delete right; }
 #	endif
 };
 
+int Node0::s_count = 0;
+
 struct GCBench {
 
         // Nodes used by a tree of a given size
@@ -188,7 +210,7 @@ struct GCBench {
                         tempTree = 0;
                 }
                 tFinish = currentTime();
-		printf("\tTop down construction took %d msec\n", elapsedTime(tFinish - tStart));
+		printf("\tTop down construction took %ld msec\n", elapsedTime(tFinish - tStart));
                      
                 tStart = currentTime();
                 for (int i = 0; i < iNumIters; ++i) {
@@ -199,7 +221,7 @@ struct GCBench {
                         tempTree = 0;
                 }
                 tFinish = currentTime();
-                printf("\tBottom up construction took %d msec\n", elapsedTime(tFinish - tStart));
+                printf("\tBottom up construction took %ld msec\n", elapsedTime(tFinish - tStart));
         }
 
         void main() {
@@ -214,7 +236,7 @@ struct GCBench {
 		//GC_enable_incremental();
 #endif
 		printf("Garbage Collector Test\n");
-                printf(" Live storage will peak at %d bytes.\n\n",
+                printf(" Live storage will peak at %lu bytes.\n\n",
 		       2 * sizeof(Node0) * TreeSize(kLongLivedTreeDepth) +
 		       sizeof(double) * kArraySize);
                 printf(" Stretching memory with a binary tree of depth %d\n", kStretchTreeDepth);
@@ -265,7 +287,7 @@ struct GCBench {
                 tFinish = currentTime();
                 tElapsed = elapsedTime(tFinish-tStart);
                 PrintDiagnostics();
-                printf("Completed in %d msec\n", tElapsed);
+                printf("Completed in %ld msec\n", tElapsed);
 #		ifdef GC
 		//printf("Completed " << GC_gc_no << " collections" <<endl;
 		//printf("Heap size is %d\n", GC_get_heap_size());
@@ -273,7 +295,62 @@ struct GCBench {
         }
 };
 
-main () {
+#ifdef GC_PARALLEL
+
+// Runs the benchmark with 1 to max_threads collector threads.
+void run_threads(int max_threads) {
+	struct result {
+		int threads;
+		long msec;
+		int nodes;
+		gc_collector::stats s;
+	};
+	result* results = new result[max_threads];
+
+	for (int t = 1; t <= max_threads; t++) {
+		printf("\n%d collector threads\n", t);
+		gc_collector::set_thread_count(t);
+		gc_collector::collect_garbage(NULL);
+		gc_collector::reset_pause_stats();
+		Node0::s_count = 0;
+
+		long tStart = currentTime();
+		GCBench x;
+		x.main();
+		gc_collector::collect_garbage(NULL);
+		long tFinish = currentTime();
+
+		result* r = &results[t - 1];
+		r->threads = t;
+		r->msec = elapsedTime(tFinish - tStart);
+		r->nodes = Node0::s_count;
+		gc_collector::get_stats(&r->s);
+	}
+
+	printf("\nthreads  total msec  collections  avg pause  max pause  nodes/msec\n");
+	for (int t = 0; t < max_threads; t++) {
+		const result& r = results[t];
+		printf("%7d  %10ld  %11d  %9.2f  %9.2f  %10.0f\n",
+			r.threads,
+			r.msec,
+			(int) r.s.collections,
+			r.s.collections ? r.s.total_pause_ms / r.s.collections : 0.0,
+			r.s.max_pause_ms,
+			r.msec ? (double) r.nodes / r.msec : 0.0);
+	}
+	delete [] results;
+}
+
+#endif  // GC_PARALLEL
+
+int main(int argc, char** argv) {
+#ifdef GC_PARALLEL
+    if (argc == 3 && strcmp(argv[1], "-threads") == 0) {
+        run_threads(atoi(argv[2]));
+        return 0;
+    }
+#endif
     GCBench x;
     x.main();
+    return 0;
 }
@@ -100,7 +100,7 @@ void	tu_string::resize(int new_size)
 			capacity = (capacity + 15) & ~15;
 			if (capacity != m_union.m_heap.m_capacity)	// @@ TODO should use hysteresis when resizing
 			{
-				m_union.m_heap.m_buffer = (char*) tu_realloc(m_union.m_heap.m_buffer, capacity, m_heap.m_capacity);
+				m_union.m_heap.m_buffer = (char*) tu_realloc(m_union.m_heap.m_buffer, capacity, m_union.m_heap.m_capacity);
 				m_union.m_heap.m_capacity = capacity;
 			}
 			// else we're OK with existing buffer.
@@ -358,11 +358,15 @@ tu_string string_printf(const char* fmt, ...)
 
 // Compile this test case with something like:
 //
-// gcc container.cpp utf8.cpp tu_random.cpp -g -I.. -DCONTAINER_UNIT_TEST -lstdc++ -o container_test
+// gcc container.cpp utf8.cpp tu_random.cpp tu_timer.cpp -O2 -I.. -DCONTAINER_UNIT_TEST -lstdc++ -o container_test
 //
 //    or
 //
-// cl container.cpp utf8.cpp tu_random.cpp dlmalloc.c -Zi -Od -DCONTAINER_UNIT_TEST -DUSE_DL_MALLOC -DWIN32 -I..
+// cl container.cpp utf8.cpp tu_random.cpp tu_timer.cpp dlmalloc.c -Zi -Od -DCONTAINER_UNIT_TEST -DUSE_DL_MALLOC -DWIN32 -I..
+
+
+#include "base/tu_timer.h"
+#include <unordered_map>
 
 
 void	test_hash()
@@ -462,6 +466,7 @@ void	test_hash()
 		h2.erase(it);
 		assert(h2.size() == h2_size);
 		assert(h2.find(key) == h2.end());
+		assert(h.find(key) != h.end() && h.find(key)->second == value);
 		it = next;
 	}}
 
@@ -499,72 +504,600 @@ void	test_hash()
 			h3[j + j * 1024] = j;
 		}
 	}
+
+	// Random adds and erases of keys that share their low bits,
+	// checked against an array.
+	hash<uint32, uint32, identity_hash<uint32> > h4;
+	array<bool>	present;
+	present.resize(4096);
+	for (int i = 0; i < present.size(); i++) {
+		present[i] = false;
+	}
+	int	count = 0;
+	for (int i = 0; i < 200000; i++) {
+		int	k = tu_random::next_random() % present.size();
+		if (present[k]) {
+			h4.erase(k << 16);
+			count--;
+		} else {
+			h4.add(k << 16, k);
+			count++;
+		}
+		present[k] = ! present[k];
+
+		if (i % 10000 == 0) {
+			assert(h4.size() == count);
+			for (int j = 0; j < present.size(); j++) {
+				uint32	val = 0;
+				assert(h4.get(j << 16, &val) == present[j]);
+				assert(present[j] == false || val == (uint32) j);
+			}
+			int	iterated = 0;
+			for (hash<uint32, uint32, identity_hash<uint32> >::iterator it = h4.begin(); it != h4.end(); ++it) {
+				assert(present[it->second]);
+				iterated++;
+			}
+			assert(iterated == count);
+		}
+	}
 }
 
 
-//#include <ext/hash_map>
-//#include <hash_map>
-//#include <map>
+// The hash<> this file had before the control-byte groups: internal
+// chaining, each entry with the index of the next one in its chain.
+// Kept here to compare against; add(), get() and erase() only.
+template<class T, class U, class hash_functor = fixed_size_hash<T> >
+class chained_hash
+{
+public:
+	chained_hash() : m_table(NULL) { }
+	~chained_hash() { clear(); }
 
-void	test_hash_speed()
-// Test function for hash performance of adding keys and doing lookup.
+	void	add(const T& key, const U& value)
+	{
+		assert(find_index(key) == -1);
+
+		check_expand();
+		m_table->m_entry_count++;
+
+		size_t	hash_value = compute_hash(key);
+		int	index = hash_value & m_table->m_size_mask;
+
+		entry*	natural_entry = &(E(index));
+		
+		if (natural_entry->is_empty()) {
+			new (natural_entry) entry(key, value, -1, hash_value);
+		} else if (natural_entry->is_tombstone()) {
+			int next_in_chain = natural_entry->m_next_in_chain;
+			new (natural_entry) entry(key, value, next_in_chain, hash_value);
+		} else {
+			// Find a blank spot.
+			int	blank_index = index;
+			for (;;)
+			{
+				blank_index = (blank_index + 1) & m_table->m_size_mask;
+				if (E(blank_index).is_empty()) break;
+				if (E(blank_index).is_tombstone()) {
+					blank_index = remove_tombstone(blank_index);
+					break;
+				}
+			}
+			entry*	blank_entry = &E(blank_index);
+
+			if (int(natural_entry->m_hash_value & m_table->m_size_mask) == index)
+			{
+				// Collision.  Link into this chain.
+				new (blank_entry) entry(*natural_entry);
+				natural_entry->first = key;
+				natural_entry->second = value;
+				natural_entry->m_next_in_chain = blank_index;
+				natural_entry->m_hash_value = hash_value;
+			}
+			else
+			{
+				// Move the entry that doesn't belong here.
+				int collided_index = (int) (natural_entry->m_hash_value & m_table->m_size_mask);
+				for (;;)
+				{
+					entry*	e = &E(collided_index);
+					if (e->m_next_in_chain == index)
+					{
+						new (blank_entry) entry(*natural_entry);
+						e->m_next_in_chain = blank_index;
+						break;
+					}
+					collided_index = e->m_next_in_chain;
+				}
+				natural_entry->first = key;
+				natural_entry->second = value;
+				natural_entry->m_hash_value = hash_value;
+				natural_entry->m_next_in_chain = -1;
+			}
+		}
+	}
+
+	bool	get(const T& key, U* value) const
+	{
+		int	index = find_index(key);
+		if (index >= 0)
+		{
+			*value = E(index).second;
+			return true;
+		}
+		return false;
+	}
+
+	void	erase(const T& key)
+	{
+		int	index = find_index(key);
+		if (index < 0)
+		{
+			return;
+		}
+
+		entry*	pos = &E(index);
+		int	natural_index = (int) (pos->m_hash_value & m_table->m_size_mask);
+		if (index != natural_index) {
+			// Splice out of the chain.
+			entry* e = &E(natural_index);
+			while (e->m_next_in_chain != index) {
+				e = &E(e->m_next_in_chain);
+			}
+			if (e->is_tombstone() && pos->is_end_of_chain()) {
+				e->m_next_in_chain = -2;
+			} else {
+				e->m_next_in_chain = pos->m_next_in_chain;
+			}
+			pos->clear();
+		} else if (pos->is_end_of_chain() == false) {
+			pos->make_tombstone();
+		} else {
+			pos->clear();
+		}
+		m_table->m_entry_count--;
+	}
+
+	void	clear()
+	{
+		if (m_table)
+		{
+			for (int i = 0, n = m_table->m_size_mask; i <= n; i++)
+			{
+				entry*	e = &E(i);
+				if (e->is_empty() == false && e->is_tombstone() == false)
+				{
+					e->clear();
+				}
+			}
+			tu_free(m_table, sizeof(table) + sizeof(entry) * (m_table->m_size_mask + 1));
+			m_table = NULL;
+		}
+	}
+
+	int	find_index(const T& key) const
+	{
+		if (m_table == NULL) return -1;
+
+		size_t	hash_value = compute_hash(key);
+		int	index = (int) (hash_value & m_table->m_size_mask);
+
+		const entry*	e = &E(index);
+		if (e->is_empty()) return -1;
+		if (e->is_tombstone() == false
+			&& int(e->m_hash_value & m_table->m_size_mask) != index) {
+			// occupied by a collider
+			return -1;
+		}
+
+		for (;;)
+		{
+			if (e->m_hash_value == hash_value && e->first == key)
+			{
+				return index;
+			}
+			index = e->m_next_in_chain;
+			if (index == -1) break;	// end of chain
+			e = &E(index);
+		}
+		return -1;
+	}
+
+private:
+	static const size_t	TOMBSTONE_HASH = (size_t) -1;
+
+	struct entry
+	{
+		int	m_next_in_chain;
+		size_t	m_hash_value;
+		T	first;
+		U	second;
+
+		entry(const entry& e)
+			: m_next_in_chain(e.m_next_in_chain), m_hash_value(e.m_hash_value), first(e.first), second(e.second)
+		{
+		}
+		entry(const T& key, const U& value, int next_in_chain, size_t hash_value)
+			: m_next_in_chain(next_in_chain), m_hash_value(hash_value), first(key), second(value)
+		{
+		}
+		bool is_empty() const { return m_next_in_chain == -2; }
+		bool is_end_of_chain() const { return m_next_in_chain == -1; }
+		bool is_tombstone() const { return m_hash_value == TOMBSTONE_HASH; }
+
+		void	clear()
+		{
+			first.~T();
+			second.~U();
+			m_next_in_chain = -2;
+			m_hash_value = ~TOMBSTONE_HASH;
+		}
+
+		void make_tombstone() {
+			first.~T();
+			second.~U();
+			m_hash_value = TOMBSTONE_HASH;
+		}
+	};
+
+	static size_t compute_hash(const T& key) {
+		size_t hash_value = hash_functor()(key);
+		if (hash_value == TOMBSTONE_HASH) {
+			hash_value ^= 0x8000;
+		}
+		return hash_value;
+	}
+
+	entry&	E(int index) { return *(((entry*) (m_table + 1)) + index); }
+	const entry&	E(int index) const { return *(((entry*) (m_table + 1)) + index); }
+
+	int remove_tombstone(int index) {
+		entry* e = &E(index);
+		int new_blank_index = e->m_next_in_chain;
+		entry* new_blank = &E(new_blank_index);
+		new (e) entry(*new_blank);
+		new_blank->clear();
+		return new_blank_index;
+	}
+
+	void	check_expand()
+	{
+		if (m_table == NULL) {
+			set_raw_capacity(16);
+		} else if (m_table->m_entry_count * 3 > (m_table->m_size_mask + 1) * 2) {
+			set_raw_capacity((m_table->m_size_mask + 1) * 2);
+		}
+	}
+
+	void	set_raw_capacity(int new_size)
+	{
+		chained_hash<T, U, hash_functor>	new_hash;
+		new_hash.m_table = (table*) tu_malloc(sizeof(table) + sizeof(entry) * new_size);
+		new_hash.m_table->m_entry_count = 0;
+		new_hash.m_table->m_size_mask = new_size - 1;
+		for (int i = 0; i < new_size; i++)
+		{
+			new_hash.E(i).m_next_in_chain = -2;	// mark empty
+		}
+
+		if (m_table)
+		{
+			for (int i = 0, n = m_table->m_size_mask; i <= n; i++)
+			{
+				entry*	e = &E(i);
+				if (e->is_empty() == false && e->is_tombstone() == false)
+				{
+					new_hash.add(e->first, e->second);
+					e->clear();
+				}
+			}
+			tu_free(m_table, sizeof(table) + sizeof(entry) * (m_table->m_size_mask + 1));
+		}
+
+		m_table = new_hash.m_table;
+		new_hash.m_table = NULL;
+	}
+
+	struct table
+	{
+		int m_entry_count;
+		int m_size_mask;
+	};
+	table*	m_table;
+};
+
+
+template<class T, class U, class hash_functor>
+class std_hash
+// std::unordered_map with the interface of the two others.
 {
+public:
+	void	add(const T& key, const U& value) { m_map.insert(std::make_pair(key, value)); }
 
-// Hash type, for doing comparative tests.
-//
-// tu_hash tests faster than the map and hash_map included with GCC
-// 3.3 as well as map and hash_map from MSVC7.  In some cases, several
-// times faster.  GCC's hash_map is the closest to tu_hash, but is
-// still 33% slower in my tests.
+	bool	get(const T& key, U* value) const
+	{
+		typename std::unordered_map<T, U, hash_functor>::const_iterator	it = m_map.find(key);
+		if (it != m_map.end())
+		{
+			*value = it->second;
+			return true;
+		}
+		return false;
+	}
 
-// // tu's hash
-#define HASH hash<uint32, uint32 >
-#define HASH_ADD(h, k, v) h.add(k, v)
+	void	erase(const T& key) { m_map.erase(key); }
 
-// STL's hash
-//#define HASH __gnu_cxx::hash_map<uint32, uint32>
-//#define HASH std::hash_map<uint32, uint32>
-//#define HASH_ADD(h, k, v) h[k] = v
+private:
+	std::unordered_map<T, U, hash_functor>	m_map;
+};
 
-// STL's map
-//#define HASH std::map<uint32, uint32>
-//#define HASH_ADD(h, k, v) h[k] = v
 
-//	const int	SIZE = 10000000;
-	const int	SIZE = 1000000;
+static unsigned int	s_found = 0;	// keeps the lookups from being optimized out
 
-	// Make an array of random numbers.
-	array<uint32>	numbers;
-	numbers.resize(SIZE);
 
-	for (int i = 0, n = numbers.size(); i < n; i++)
+template<class table, class T>
+double	time_lookups(const array<T>& keys, const array<T>& probes, int rounds)
+// Milliseconds to fill a table with the keys and look up the probes,
+// rounds times.
+{
+	uint64	start = tu_timer::get_profile_ticks();
+	for (int r = 0; r < rounds; r++)
+	{
+		table	t;
+		for (int i = 0; i < keys.size(); i++)
+		{
+			t.add(keys[i], i);
+		}
+		for (int i = 0; i < probes.size(); i++)
+		{
+			int	value;
+			if (t.get(probes[i], &value))
+			{
+				s_found += value;
+			}
+		}
+	}
+	return tu_timer::profile_ticks_to_milliseconds(tu_timer::get_profile_ticks() - start);
+}
+
+
+template<class table, class T>
+double	time_churn(const array<T>& keys, int rounds)
+// Milliseconds to fill a table, then erase half of the keys, add them
+// back and look up all of them, rounds times.
+{
+	uint64	start = tu_timer::get_profile_ticks();
+	table	t;
+	for (int i = 0; i < keys.size(); i++)
+	{
+		t.add(keys[i], i);
+	}
+	for (int r = 0; r < rounds; r++)
+	{
+		for (int i = r & 1; i < keys.size(); i += 2)
+		{
+			t.erase(keys[i]);
+		}
+		for (int i = r & 1; i < keys.size(); i += 2)
+		{
+			t.add(keys[i], i);
+		}
+		for (int i = 0; i < keys.size(); i++)
+		{
+			int	value;
+			if (t.get(keys[i], &value))
+			{
+				s_found += value;
+			}
+		}
+	}
+	return tu_timer::profile_ticks_to_milliseconds(tu_timer::get_profile_ticks() - start);
+}
+
+
+template<class T, class hash_functor>
+void	compare_lookups(const char* name, const array<T>& keys, const array<T>& probes, int rounds)
+{
+	printf("%-30s hash %8.2f ms, chained_hash %8.2f ms, unordered_map %8.2f ms\n",
+		name,
+		time_lookups<hash<T, int, hash_functor> >(keys, probes, rounds),
+		time_lookups<chained_hash<T, int, hash_functor> >(keys, probes, rounds),
+		time_lookups<std_hash<T, int, hash_functor> >(keys, probes, rounds));
+}
+
+
+template<class T, class hash_functor>
+void	compare_churn(const char* name, const array<T>& keys, int rounds)
+{
+	printf("%-30s hash %8.2f ms, chained_hash %8.2f ms, unordered_map %8.2f ms\n",
+		name,
+		time_churn<hash<T, int, hash_functor> >(keys, rounds),
+		time_churn<chained_hash<T, int, hash_functor> >(keys, rounds),
+		time_churn<std_hash<T, int, hash_functor> >(keys, rounds));
+}
+
+
+void	test_hash_speed()
+// Compares hash<> with the table it replaced and with
+// std::unordered_map, on keys like gameswf's.
+{
+	// Member names: short, case-insensitive, looked up with
+	// another case half of the time, and a quarter misses.
+	static const char*	names[] =
+	{
+		"_x", "_y", "_xscale", "_yscale", "_alpha", "_visible", "_width", "_height",
+		"_rotation", "_name", "_parent", "_root", "this", "length", "prototype",
+		"__proto__", "constructor", "onEnterFrame", "onLoad", "onPress", "gotoAndPlay",
+		"gotoAndStop", "play", "stop", "toString", "valueOf", "push", "addListener",
+	};
+	const int	name_count = sizeof(names) / sizeof(names[0]);
+
+	array<tu_stringi>	few_names;
+	array<tu_stringi>	few_probes;
+	for (int i = 0; i < 12; i++)
+	{
+		few_names.push_back(names[i * 2]);
+	}
+
+	array<tu_stringi>	many_names;
+	array<tu_stringi>	many_probes;
+	for (int i = 0; i < 2000; i++)
 	{
-		numbers[i] = tu_random::next_random();
+		many_names.push_back(string_printf("%s%d", names[i % name_count], i / name_count).c_str());
 	}
 
-	// Uniquify the array.
-	HASH	new_index;
-	int	next_new_index = 0;
-	{for (int i = 0, n = numbers.size(); i < n; i++)
+	for (int i = 0; i < 4000; i++)
 	{
-		HASH::iterator	it = new_index.find(numbers[i]);
-		if (it == new_index.end())
+		const tu_stringi&	key = many_names[(i * 7) % many_names.size()];
+		if (i % 4 == 3)
 		{
-			// First time this number has been seen.
-			HASH_ADD(new_index, numbers[i], next_new_index);
-			next_new_index++;
+			many_probes.push_back(string_printf("missing%d", i).c_str());
+		}
+		else if (i & 1)
+		{
+			tu_string	s = key.to_tu_string().utf8_to_upper();
+			many_probes.push_back(s.c_str());
 		}
 		else
 		{
-			// This number already appears in the list.
-// 			printf("duplicate entry %x, prev new index %d, current array index %d\n",
-// 				   numbers[i],
-// 				   it->second,
-// 				   i);
+			many_probes.push_back(key);
 		}
-	}}
+	}
+	for (int i = 0; i < 48; i++)
+	{
+		few_probes.push_back(i % 4 == 3 ? tu_stringi(names[(2 * i + 1) % name_count]) : few_names[i % few_names.size()]);
+	}
+
+	compare_lookups<tu_stringi, stringi_hash_functor<tu_stringi> >("12 names, 48 lookups x20000", few_names, few_probes, 20000);
+	compare_lookups<tu_stringi, stringi_hash_functor<tu_stringi> >("2000 names, 4000 lookups x50", many_names, many_probes, 50);
+
+	// Pointer keys, like the objects of the heap.
+	array<void*>	blocks;
+	array<void*>	pointers;
+	for (int i = 0; i < 100000; i++)
+	{
+		void*	p = tu_malloc(16 + (i % 5) * 16);
+		blocks.push_back(p);
+	}
+	for (int i = 0; i < blocks.size(); i++)
+	{
+		pointers.push_back(blocks[(i * 7919) % blocks.size()]);
+	}
+
+	compare_lookups<void*, fixed_size_hash<void*> >("100000 pointers x5", pointers, pointers, 5);
+	compare_churn<void*, fixed_size_hash<void*> >("100000 pointers, erase/add x5", pointers, 5);
+
+	for (int i = 0; i < blocks.size(); i++)
+	{
+		tu_free(blocks[i], 16 + (i % 5) * 16);
+	}
+
+	// Random numbers.
+	array<uint32>	numbers;
+	hash<uint32, int>	seen;
+	while (numbers.size() < 1000000)
+	{
+		uint32	n = tu_random::next_random();
+		if (seen.get(n, NULL) == false)
+		{
+			seen.add(n, 0);
+			numbers.push_back(n);
+		}
+	}
+	compare_lookups<uint32, fixed_size_hash<uint32> >("1000000 random uint32", numbers, numbers, 1);
+
+	printf("(%u)\n", s_found);
+}
 
-	printf("next_new_index = %d\n", next_new_index);
+
+// Counts its copies, and knows where it is so a bitwise move
+// would be caught.
+struct tracked
+{
+	static int	s_copies;
+	static int	s_live;
+
+	tracked(int v = 0) : m_value(v), m_self(this) { s_live++; }
+	tracked(const tracked& t) : m_value(t.m_value), m_self(this) { s_live++; s_copies++; }
+	tracked(tracked&& t) : m_value(t.m_value), m_self(this) { t.m_value = -1; s_live++; }
+	~tracked() { assert(m_self == this); s_live--; }
+
+	void	operator=(const tracked& t) { assert(m_self == this); m_value = t.m_value; s_copies++; }
+	void	operator=(tracked&& t) { assert(m_self == this); m_value = t.m_value; t.m_value = -1; }
+
+	enum { is_relocatable = false };
+
+	int	m_value;
+	tracked*	m_self;
+};
+int	tracked::s_copies = 0;
+int	tracked::s_live = 0;
+
+
+void	test_array()
+{
+	assert(tu_is_relocatable<int>::value);
+	assert(tu_is_relocatable<tu_string>::value);
+	assert(!tu_is_relocatable<tracked>::value);
+
+	{
+		array<tracked>	a;
+		for (int i = 0; i < 100; i++)
+		{
+			if (i & 1)
+			{
+				a.push_back(tracked(i));
+			}
+			else
+			{
+				a.emplace_back(i);
+			}
+		}
+		a.insert(0, tracked(-10));
+		a.insert(50, tracked(-20));
+		a.remove(10);
+		a.resize(200);
+		a.resize(20);
+		a.reserve(1000);
+		assert(a.size() == 20);
+		assert(a[0].m_value == -10);
+		assert(a[1].m_value == 0);
+		assert(a[10].m_value == 10);
+		assert(tracked::s_copies == 0);
+
+		array<tracked>	b(std::move(a));
+		assert(a.size() == 0);
+		assert(b.size() == 20 && b[19].m_value == 19);
+		a = std::move(b);
+		assert(b.size() == 0 && a.size() == 20);
+		assert(tracked::s_copies == 0);
+
+		b = a;
+		assert(tracked::s_copies == 20);
+		assert(tracked::s_live == 40);
+	}
+	assert(tracked::s_live == 0);
+
+	{
+		// Relocatable elements: moved bitwise on growth.
+		array<tu_string>	a;
+		a.push_back("a string too long to be held in the small buffer");
+		for (int i = 0; i < 100; i++)
+		{
+			tu_string	s;
+			s += (char) ('a' + i % 26);
+			a.push_back(std::move(s));
+			assert(s.length() == 0);
+		}
+		a.insert(1, tu_string("x"));
+		a.remove(0);
+		assert(a.size() == 101);
+		assert(a[0] == "x");
+		assert(a[1] == "a");
+		assert(a[100] == "v");
+
+		tu_string	s(std::move(a[1]));
+		assert(s == "a" && a[1].length() == 0);
+	}
 }
 
 
@@ -867,6 +1400,7 @@ int	main()
 		assert((a + b).length() == 2 * (i + 1));
 	}
 
+	test_array();
 	test_hash();
 	test_stringi();
 	test_stringi_hash();
@@ -17,6 +17,7 @@
 #include <stdlib.h>
 #include <string.h>	// for strcmp and friends
 #include <new>	// for placement new
+#include <utility>	// for std::move and std::forward
 
 
 // If you prefer STL implementations of array<> (i.e. std::vector) and
@@ -190,13 +191,33 @@ public:
 #endif // _WIN32
 
 
+template<class T, class enable = void>
+struct tu_is_relocatable
+// Tells whether array<> may move a T to another address by bitwise
+// copy (realloc() and memmove()), without calling its move
+// constructor and destructor.  That's true of about everything,
+// plain data, ref-counted pointers, tu_string, so it's the default.
+// A type that can't be moved that way, e.g. because something keeps
+// the address of its objects, declares
+//
+//	enum { is_relocatable = false };
+{
+	enum { value = true };
+};
+
+template<class T>
+struct tu_is_relocatable<T, decltype(void(T::is_relocatable))>
+{
+	enum { value = T::is_relocatable };
+};
 
 
 template<class T>
 class array {
-// Resizable array.  Don't put anything in here that can't be moved
-// around by bitwise copy.  Don't keep the address of an element; the
-// array contents will move around as it gets resized.
+// Resizable array.  The elements are moved around by bitwise copy as
+// the array grows, unless tu_is_relocatable<T> says they can't be.
+// Don't keep the address of an element; the array contents will move
+// around as it gets resized.
 //
 // Default constructor and destructor get called on the elements as
 // they are added or removed from the active part of the array.
@@ -213,6 +234,14 @@ public:
 	{
 		operator=(a);
 	}
+	array(array<T>&& a)
+		:
+		m_buffer(0),
+		m_size(0),
+		m_buffer_size(0)
+	{
+		transfer_members(&a);
+	}
 	~array() {
 		clear();
 	}
@@ -227,13 +256,30 @@ public:
 	{
 		// DO NOT pass elements of your own vector into
 		// push_back()!  Since we're using references,
-		// resize() may munge the element storage!
+		// growing may munge the element storage!
 		// this is irrelevant to MAC OS !!!
 //		assert(&val < &m_buffer[0] || &val > &m_buffer[m_buffer_size]);
 
-		int	new_size = m_size + 1;
-		resize(new_size);
-		(*this)[new_size-1] = val;
+		grow(m_size + 1);
+		new (m_buffer + m_size) T(val);	// placement new, copy ctor
+		m_size++;
+	}
+
+	void	push_back(T&& val)
+	// Move the given element to the end of the array.
+	{
+		grow(m_size + 1);
+		new (m_buffer + m_size) T(std::move(val));
+		m_size++;
+	}
+
+	template<class... Args>
+	void	emplace_back(Args&&... args)
+	// Construct an element at the end of the array, from the args.
+	{
+		grow(m_size + 1);
+		new (m_buffer + m_size) T(std::forward<Args>(args)...);
+		m_size++;
 	}
 
 	void	pop_back()
@@ -266,6 +312,15 @@ public:
 		}
 	}
 
+	void	operator=(array<T>&& a)
+	// Takes the contents of a, which is left empty.
+	{
+		if (this != &a) {
+			clear();
+			transfer_members(&a);
+		}
+	}
+
 
 	void	remove(int index)
 	// Removing an element from the array is an expensive operation!
@@ -277,11 +332,20 @@ public:
 		{
 			clear();
 		}
-		else
+		else if constexpr (tu_is_relocatable<T>::value)
 		{
 			m_buffer[index].~T();	// destructor
 
-			memmove(m_buffer+index, m_buffer+index+1, sizeof(T) * (m_size - 1 - index));
+			memmove((void*) (m_buffer+index), (void*) (m_buffer+index+1), sizeof(T) * (m_size - 1 - index));
+			m_size--;
+		}
+		else
+		{
+			for (int i = index; i < m_size - 1; i++)
+			{
+				m_buffer[i] = std::move(m_buffer[i + 1]);
+			}
+			m_buffer[m_size - 1].~T();
 			m_size--;
 		}
 	}
@@ -290,20 +354,19 @@ public:
 	void	insert(int index, const T& val = T())
 	// Insert the given object at the given index shifting all the elements up.
 	{
-		assert(index >= 0 && index <= m_size);
-
-		resize(m_size + 1);
-
-		if (index < m_size - 1)
-		{
-			// is it safe to use memmove?
-			memmove(m_buffer+index+1, m_buffer+index, sizeof(T) * (m_size - 1 - index));
-		}
+		open_slot(index);
 
 		// Copy-construct into the newly opened slot.
 		new (m_buffer + index) T(val);
 	}
 
+	void	insert(int index, T&& val)
+	// Move the given object to the given index shifting all the elements up.
+	{
+		open_slot(index);
+		new (m_buffer + index) T(std::move(val));
+	}
+
 
 	void	append(const array<T>& other)
 	// Append the given data to our array.
@@ -342,6 +405,9 @@ public:
 		{for (int i = new_size; i < old_size; i++) {
 			(m_buffer + i)->~T();
 		}}
+		if (new_size < old_size) {
+			m_size = new_size;
+		}
 
 		if (new_size == 0) {
 			m_buffer_size = 0;
@@ -363,11 +429,14 @@ public:
 	}
 
 	void	reserve(int rsize)
-	// @@ TODO change this to use ctor, dtor, and operator=
-	// instead of preserving existing elements via binary copy via
-	// realloc?
+	// Resize the buffer, never below size().  The elements are
+	// preserved via realloc, or moved one by one if they aren't
+	// relocatable.
 	{
 		assert(m_size >= 0);
+		if (rsize < m_size) {
+			rsize = m_size;
+		}
 
 		int	old_size = m_buffer_size;
 		old_size = old_size;	// don't warn that this is unused.
@@ -379,15 +448,24 @@ public:
 				tu_free(m_buffer, sizeof(T) * old_size);
 			}
 			m_buffer = 0;
+		} else if (m_buffer == 0) {
+			m_buffer = (T*) tu_malloc(sizeof(T) * m_buffer_size);
+			assert(m_buffer);	// need to throw (or something) on malloc failure!
+			memset((void*) m_buffer, 0, (sizeof(T) * m_buffer_size));
+		} else if constexpr (tu_is_relocatable<T>::value) {
+			m_buffer = (T*) tu_realloc((void*) m_buffer, sizeof(T) * m_buffer_size, sizeof(T) * old_size);
+			assert(m_buffer);	// need to throw (or something) on malloc failure!
 		} else {
-			if (m_buffer) {
-				m_buffer = (T*) tu_realloc(m_buffer, sizeof(T) * m_buffer_size, sizeof(T) * old_size);
-			} else {
-				m_buffer = (T*) tu_malloc(sizeof(T) * m_buffer_size);
-				memset(m_buffer, 0, (sizeof(T) * m_buffer_size));
+			T*	new_buffer = (T*) tu_malloc(sizeof(T) * m_buffer_size);
+			assert(new_buffer);	// need to throw (or something) on malloc failure!
+			memset((void*) new_buffer, 0, (sizeof(T) * m_buffer_size));
+			for (int i = 0; i < m_size; i++) {
+				new (new_buffer + i) T(std::move(m_buffer[i]));
+				(m_buffer + i)->~T();
 			}
-			assert(m_buffer);	// need to throw (or something) on malloc failure!
-		}			
+			tu_free(m_buffer, sizeof(T) * old_size);
+			m_buffer = new_buffer;
+		}
 	}
 
 	void	transfer_members(array<T>* a)
@@ -421,6 +499,42 @@ public:
 	}
 
 private:
+	void	grow(int new_size)
+	// Make room for new_size elements without constructing them.
+	// Unlike resize() it never compacts, so it keeps the room
+	// given to reserve().
+	{
+		if (new_size > m_buffer_size) {
+			reserve(new_size + (new_size >> 1));
+		}
+	}
+
+	void	open_slot(int index)
+	// Make a hole at index, for the caller to construct an element
+	// in, shifting the elements after it up.
+	{
+		assert(index >= 0 && index <= m_size);
+
+		grow(m_size + 1);
+		if (index == m_size)
+		{
+		}
+		else if constexpr (tu_is_relocatable<T>::value)
+		{
+			memmove((void*) (m_buffer+index+1), (void*) (m_buffer+index), sizeof(T) * (m_size - index));
+		}
+		else
+		{
+			new (m_buffer + m_size) T(std::move(m_buffer[m_size - 1]));
+			for (int i = m_size - 1; i > index; i--)
+			{
+				m_buffer[i] = std::move(m_buffer[i - 1]);
+			}
+			(m_buffer + index)->~T();
+		}
+		m_size++;
+	}
+
 	T*	m_buffer;
 	int	m_size;
 	int	m_buffer_size;
@@ -722,14 +836,156 @@ private:
 };
 #endif
 
+// hash<> compares the control bytes of a group of slots at once, with
+// SSE2 or NEON when the compiler has them.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TU_HASH_GROUP_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TU_HASH_GROUP_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+class hash_group
+// The control bytes of SIZE consecutive slots of a hash<>.  The
+// matches come back as a bitmask, go through them with lowest() and
+// clear_lowest().
+{
+public:
+	enum
+	{
+		EMPTY = -128,	// 0x80
+		DELETED = -2,	// 0xFE, a tombstone
+		// A full slot has the low 7 bits of its hash, 0..127.
+
+#if TU_HASH_GROUP_SSE2
+		SIZE = 16,
+		SHIFT = 0	// bit i is slot i
+#else
+		SIZE = 8,
+		SHIFT = 3	// bit 8*i+7 is slot i
+#endif
+	};
+
+	explicit hash_group(const signed char* ctrl)
+	{
+#if TU_HASH_GROUP_SSE2
+		m_ctrl = _mm_loadu_si128((const __m128i*) ctrl);
+#elif TU_HASH_GROUP_NEON
+		m_ctrl = vld1_u8((const uint8_t*) ctrl);
+#else
+		memcpy(&m_ctrl, ctrl, sizeof(m_ctrl));
+#endif
+	}
+
+	uint64	match(int h2) const
+	// The slots whose control byte is h2.  Without SIMD there can be
+	// false positives among the full slots, the caller compares the
+	// keys anyway.
+	{
+#if TU_HASH_GROUP_SSE2
+		return (uint32) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char) h2), m_ctrl));
+#elif TU_HASH_GROUP_NEON
+		uint8x8_t	eq = vceq_u8(m_ctrl, vdup_n_u8((uint8_t) h2));
+		return vget_lane_u64(vreinterpret_u64_u8(eq), 0) & MSBS;
+#else
+		uint64	x = m_ctrl ^ (LSBS * (uint8) h2);
+		return (x - LSBS) & ~x & MSBS;
+#endif
+	}
+
+	uint64	match_empty() const
+	{
+#if TU_HASH_GROUP_SSE2
+		return (uint32) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char) EMPTY), m_ctrl));
+#elif TU_HASH_GROUP_NEON
+		uint8x8_t	eq = vceq_u8(m_ctrl, vdup_n_u8((uint8_t) EMPTY));
+		return vget_lane_u64(vreinterpret_u64_u8(eq), 0) & MSBS;
+#else
+		// EMPTY is the only one with bit 7 set and bit 1 clear.
+		return m_ctrl & ~(m_ctrl << 6) & MSBS;
+#endif
+	}
+
+	uint64	match_empty_or_deleted() const
+	{
+#if TU_HASH_GROUP_SSE2
+		return (uint32) _mm_movemask_epi8(m_ctrl);
+#elif TU_HASH_GROUP_NEON
+		return vget_lane_u64(vreinterpret_u64_u8(m_ctrl), 0) & MSBS;
+#else
+		return m_ctrl & MSBS;
+#endif
+	}
+
+	static int	lowest(uint64 mask)
+	// Index of the first slot in a nonzero mask.
+	{
+		assert(mask);
+#if defined(__GNUC__)
+		return __builtin_ctzll(mask) >> SHIFT;
+#elif defined(_MSC_VER) && defined(_M_X64)
+		unsigned long	bit;
+		_BitScanForward64(&bit, mask);
+		return (int) bit >> SHIFT;
+#elif defined(_MSC_VER)
+		unsigned long	bit;
+		if (_BitScanForward(&bit, (unsigned long) mask) == 0)
+		{
+			_BitScanForward(&bit, (unsigned long) (mask >> 32));
+			bit += 32;
+		}
+		return (int) bit >> SHIFT;
+#else
+		int	bit = 0;
+		while ((mask & 1) == 0)
+		{
+			mask >>= 1;
+			bit++;
+		}
+		return bit >> SHIFT;
+#endif
+	}
+
+	static uint64	clear_lowest(uint64 mask) { return mask & (mask - 1); }
+
+private:
+#if TU_HASH_GROUP_SSE2
+	__m128i	m_ctrl;
+#elif TU_HASH_GROUP_NEON
+	uint8x8_t	m_ctrl;
+	static const uint64	MSBS = 0x8080808080808080ULL;
+#else
+	uint64	m_ctrl;
+	static const uint64	LSBS = 0x0101010101010101ULL;
+	static const uint64	MSBS = 0x8080808080808080ULL;
+#endif
+};
+
+
 template<class T, class U, class hash_functor = fixed_size_hash<T> >
 class hash {
-// Hash table, linear probing, internal chaining.  One
-// interesting/nice thing about this implementation is that the table
-// itself is a flat chunk of memory containing no pointers, only
-// relative indices.  If the key and value types of the hash contain
-// no pointers, then the hash can be serialized using raw IO.  Could
-// come in handy.
+// Hash table, open addressing in the manner of the "Swiss tables".
+// Each slot has a control byte: EMPTY, DELETED, or the low 7 bits of
+// the hash of its key.  A lookup loads the control bytes of a group
+// of slots (see hash_group) and only looks at the keys of the slots
+// whose 7 bits match; it stops at the first group with an empty slot.
+// The entries keep their full hash, which is compared before the key
+// and saves hashing the keys again when the table grows.
+//
+// erase() leaves a tombstone only when the slot has been part of a
+// full group, which a lookup may have probed past; otherwise it just
+// empties the slot.  Entries don't move until the table is resized,
+// so iterators and the indices of find_index() stay valid across
+// erase().
+//
+// The table is a flat chunk of memory: the control bytes, then the
+// entries.
 //
 // Never shrinks, unless you explicitly clear() it.  Expands on
 // demand, though.  For best results, if you know roughly how big your
@@ -764,20 +1020,10 @@ public:
 	U&	operator[](const T& key)
 	{
 		int	index = find_index(key);
-		if (index >= 0)
+		if (index < 0)
 		{
-			return E(index).second;
+			index = insert(key, (U) 0);
 		}
-		add(key, (U) 0);
-		index = find_index(key);
-		if (index >= 0)
-		{
-			return E(index).second;
-		}
-
-		// Doesn't look nice but removes
-		// warning on non-void function not returning.
-		assert(0);
 		return E(index).second;
 	}
 
@@ -792,7 +1038,7 @@ public:
 		}
 
 		// Entry under key doesn't exist.
-		add(key, value);
+		insert(key, value);
 	}
 
 	void	add(const T& key, const U& value)
@@ -800,83 +1046,7 @@ public:
 	// Can invalidate existing iterators.
 	{
 		assert(find_index(key) == -1);
-
-		check_expand();
-		assert(m_table);
-		m_table->m_entry_count++;
-
-		size_t	hash_value = compute_hash(key);
-		int	index = hash_value & m_table->m_size_mask;
-
-		entry*	natural_entry = &(E(index));
-		
-		if (natural_entry->is_empty()) {
-			// Put the new entry in.
-			new (natural_entry) entry(key, value, -1, hash_value);
-		} else if (natural_entry->is_tombstone()) {
-			// Put the new entry in, without disturbing the rest of the chain.
-			int next_in_chain = natural_entry->m_next_in_chain;
-			new (natural_entry) entry(key, value, next_in_chain, hash_value);
-		} else {
-			// Find a blank spot.
-			int	blank_index = index;
-			for (int search_count = 0; ; search_count++)
-			{
-				blank_index = (blank_index + 1) & m_table->m_size_mask;
-				if (E(blank_index).is_empty()) break;	// found it
-				if (E(blank_index).is_tombstone()) {
-					blank_index = remove_tombstone(blank_index);
-					break;
-				}
-				assert(search_count < m_table->m_size_mask);
-			}
-			entry*	blank_entry = &E(blank_index);
-
-			if (int(natural_entry->m_hash_value & m_table->m_size_mask) == index)
-			{
-				// Collision.  Link into this chain.
-
-				// Move existing list head.
-				// @@ this could invalidate an existing iterator
-				new (blank_entry) entry(*natural_entry);	// placement new, copy ctor
-
-				// Put the new info in the natural entry.
-				natural_entry->first = key;
-				natural_entry->second = value;
-				natural_entry->m_next_in_chain = blank_index;
-				natural_entry->m_hash_value = hash_value;
-			}
-			else
-			{
-				// Existing entry does not naturally
-				// belong in this slot.  Existing
-				// entry must be moved.
-
-				// Find natural location of collided element (i.e. root of chain)
-				int collided_index = (int) (natural_entry->m_hash_value & m_table->m_size_mask);
-				for (int search_count = 0; ; search_count++)
-				{
-					entry*	e = &E(collided_index);
-					if (e->m_next_in_chain == index)
-					{
-						// Here's where we need to splice.
-						// @@ this could invalidate an existing iterator
-						new (blank_entry) entry(*natural_entry);
-						e->m_next_in_chain = blank_index;
-						break;
-					}
-					collided_index = e->m_next_in_chain;
-					assert(collided_index >= 0 && collided_index <= m_table->m_size_mask);
-					assert(search_count <= m_table->m_size_mask);
-				}
-
-				// Put the new data in the natural entry.
-				natural_entry->first = key;
-				natural_entry->second = value;
-				natural_entry->m_hash_value = hash_value;
-				natural_entry->m_next_in_chain = -1;
-			}
-		}
+		insert(key, value);
 	}
 
 	void	clear()
@@ -887,13 +1057,12 @@ public:
 			// Delete the entries.
 			for (int i = 0, n = m_table->m_size_mask; i <= n; i++)
 			{
-				entry*	e = &E(i);
-				if (e->is_empty() == false && e->is_tombstone() == false)
+				if (is_full(i))
 				{
-					e->clear();
+					E(i).~entry();
 				}
 			}
-			tu_free(m_table, sizeof(table) + sizeof(entry) * (m_table->m_size_mask + 1));
+			tu_free(m_table, get_table_bytes(m_table->m_size_mask + 1));
 			m_table = NULL;
 		}
 	}
@@ -942,9 +1111,8 @@ public:
 		if (m_table == NULL) {
 			// Initial creation of table.  Make a minimum-sized table.
 			set_raw_capacity(16);
-		} else if (m_table->m_entry_count * 3 > (m_table->m_size_mask + 1) * 2) {
-			// Table is more than 2/3rds full.  Expand.
-			set_raw_capacity((m_table->m_size_mask + 1) * 2);
+		} else if (m_table->m_growth_left == 0) {
+			grow();
 		}
 	}
 
@@ -981,44 +1149,21 @@ public:
 			// contain existing elements!
 			new_size = size();
 		}
-		int	new_raw_size = (new_size * 3) / 2;
+		int	new_raw_size = new_size + new_size / 7 + 1;	// at most 7/8 full
 		set_raw_capacity(new_raw_size);
 	}
 
 	// Behaves much like std::pair
 	struct entry
 	{
-		int	m_next_in_chain;	// internal chaining for collisions
-		size_t	m_hash_value;		// avoids recomputing.  Worthwhile?
+		size_t	m_hash_value;	// see compute_hash()
 		T	first;
 		U	second;
 
-		entry() : m_next_in_chain(-2) {}
-		entry(const entry& e)
-			: m_next_in_chain(e.m_next_in_chain), m_hash_value(e.m_hash_value), first(e.first), second(e.second)
+		entry(const T& key, const U& value, size_t hash_value)
+			: m_hash_value(hash_value), first(key), second(value)
 		{
 		}
-		entry(const T& key, const U& value, int next_in_chain, size_t hash_value)
-			: m_next_in_chain(next_in_chain), m_hash_value(hash_value), first(key), second(value)
-		{
-		}
-		bool is_empty() const { return m_next_in_chain == -2; }
-		bool is_end_of_chain() const { return m_next_in_chain == -1; }
-		bool is_tombstone() const { return m_hash_value == TOMBSTONE_HASH; }
-
-		void	clear()
-		{
-			first.~T();	// placement delete
-			second.~U();	// placement delete
-			m_next_in_chain = -2;
-			m_hash_value = ~TOMBSTONE_HASH;
-		}
-
-		void make_tombstone() {
-			first.~T();
-			second.~U();
-			m_hash_value = TOMBSTONE_HASH;
-		}
 	};
 	
 	// Iterator API, like STL.
@@ -1031,8 +1176,7 @@ public:
 
 		const entry&	operator*() const
 		{
-			assert(is_end() == false && m_hash->E(m_index).is_empty() == false);
-			assert(m_hash->E(m_index).is_tombstone() == false);
+			assert(is_end() == false && m_hash->is_full(m_index));
 			return m_hash->E(m_index);
 		}
 		const entry*	operator->() const { return &(operator*()); }
@@ -1041,12 +1185,12 @@ public:
 		{
 			assert(m_hash);
 
-			// Find next non-empty entry.
+			// Find next full entry.
 			if (m_index <= m_hash->m_table->m_size_mask)
 			{
 				m_index++;
 				while (m_index <= m_hash->m_table->m_size_mask
-					   && (m_hash->E(m_index).is_empty() || m_hash->E(m_index).is_tombstone()))
+					   && m_hash->is_full(m_index) == false)
 				{
 					m_index++;
 				}
@@ -1117,7 +1261,7 @@ public:
 	friend class iterator;
 
 	void erase(const iterator& pos)
-	// Removes the element at pos.
+	// Removes the element at pos.  The other iterators stay valid.
 	{
 		if (pos.is_end() || pos.m_hash != this) {
 			// Invalid iterator.
@@ -1125,49 +1269,37 @@ public:
 		}
 		assert(m_table);
 
-		int natural_index = (int) (pos->m_hash_value & m_table->m_size_mask);
-
-		if (pos.m_index != natural_index) {
-			// We're not the head of our chain, so we can
-			// be spliced out of it.
-			
-			// Iterate up the chain, and splice out when
-			// we get to m_index.
-			entry* e = &E(natural_index);
-			while (e->m_next_in_chain != pos.m_index) {
-				assert(e->is_end_of_chain() == false);
-				e = &E(e->m_next_in_chain);
-			}
-			if (e->is_tombstone() && pos->is_end_of_chain()) {
-				// Tombstone has nothing else to point
-				// to, so mark it empty.
-				e->m_next_in_chain = -2;
-			} else {
-				e->m_next_in_chain = pos->m_next_in_chain;
-			}
-			pos->clear();
-		} else if (pos->is_end_of_chain() == false) {
-			// We're the head of our chain, and there are
-			// additional elements.
-			//
-			// We need to put a tombstone here.
-			//
-			// We can't clear the element, because the
-			// rest of the elements in the chain must be
-			// linked to this position.
-			//
-			// We can't move any of the succeeding
-			// elements in the chain (i.e. to fill this
-			// entry), because we don't want to invalidate
-			// any other existing iterators.
-			pos->make_tombstone();
-		} else {
-			// We're the head of the chain, but we're the
-			// only member of the chain.
-			pos->clear();
+		int	index = pos.m_index;
+		assert(is_full(index));
+		E(index).~entry();
+		m_table->m_entry_count--;
+
+		// If each group of slots around this one has an empty
+		// slot, no lookup went past it and it can be emptied.
+		// Otherwise keys further along may have probed through
+		// it, so it becomes a tombstone.
+		int	mask = m_table->m_size_mask;
+		const signed char*	ctrl = get_ctrl();
+		int	full_after = 0;	// counting this one
+		while (full_after < hash_group::SIZE && ctrl[(index + full_after) & mask] != hash_group::EMPTY)
+		{
+			full_after++;
+		}
+		int	full_before = 0;
+		while (full_before < hash_group::SIZE && ctrl[(index - 1 - full_before) & mask] != hash_group::EMPTY)
+		{
+			full_before++;
 		}
 
-		m_table->m_entry_count--;
+		if (full_before + full_after < hash_group::SIZE)
+		{
+			set_ctrl(index, hash_group::EMPTY);
+			m_table->m_growth_left++;
+		}
+		else
+		{
+			set_ctrl(index, hash_group::DELETED);
+		}
 	}
 
 	void erase(const T& key)
@@ -1185,8 +1317,7 @@ public:
 
 		// Scan til we hit the first valid entry.
 		int	i0 = 0;
-		while (i0 <= m_table->m_size_mask
-			&& (E(i0).is_empty() || E(i0).is_tombstone()))
+		while (i0 <= m_table->m_size_mask && is_full(i0) == false)
 		{
 			i0++;
 		}
@@ -1209,86 +1340,169 @@ public:
 
 	const_iterator	find(const T& key) const { return const_cast<hash*>(this)->find(key); }
 
-private:
-	// A value of m_hash_value that marks an entry as a
-	// "tombstone" -- i.e. a placeholder entry.
-	static constexpr size_t TOMBSTONE_HASH = static_cast<size_t>(-1);
-	
 	int	find_index(const T& key) const
 	// Find the index of the matching entry.  If no match, then return -1.
+	// The index stays valid until the next add() or clear().
 	{
 		if (m_table == NULL) return -1;
 
 		size_t	hash_value = compute_hash(key);
-		int	index = (int) (hash_value & m_table->m_size_mask);
+		int	h2 = get_h2(hash_value);
+		int	mask = m_table->m_size_mask;
+		const signed char*	ctrl = get_ctrl();
+		int	pos = get_h1(hash_value) & mask;
+		for (int step = hash_group::SIZE; ; step += hash_group::SIZE)
+		{
+			hash_group	g(ctrl + pos);
+			for (uint64 match = g.match(h2); match; match = hash_group::clear_lowest(match))
+			{
+				int	index = (pos + hash_group::lowest(match)) & mask;
+				const entry&	e = E(index);
+				if (e.m_hash_value == hash_value && e.first == key)
+				{
+					// Found it.
+					return index;
+				}
+			}
+			if (g.match_empty())
+			{
+				return -1;
+			}
 
-		const entry*	e = &E(index);
-		if (e->is_empty()) return -1;
-		if (e->is_tombstone() == false
-			&& int(e->m_hash_value & m_table->m_size_mask) != index) {
-			// occupied by a collider
-			return -1;
+			// Probe the next group; the steps grow by a group
+			// each time, which visits every group of the table.
+			assert(step <= mask + 1);
+			pos = (pos + step) & mask;
 		}
+	}
 
-		for (;;)
-		{
-			assert(e->is_tombstone()
-				   || (e->m_hash_value & m_table->m_size_mask) == (hash_value & m_table->m_size_mask));
+	U&	value_at(int index)
+	// Access the value of the entry at an index from find_index().
+	{
+		return E(index).second;
+	}
 
-			if (e->m_hash_value == hash_value && e->first == key)
-			{
-				// Found it.
-				return index;
-			}
-			assert(e->is_tombstone() || ! (e->first == key));	// keys are equal, but hash differs!
+private:
+	static size_t	compute_hash(const T& key)
+	// The functors give 32 bits, weak in the low ones for
+	// pointers and identity_hash; mix them so that both the
+	// position and the 7 bits in the control byte vary.
+	{
+		uint64	h = (uint64) hash_functor()(key) * 0x9E3779B97F4A7C15ULL;
+		return (size_t) (h ^ (h >> 32));
+	}
 
-			// Keep looking through the chain.
-			index = e->m_next_in_chain;
-			if (index == -1) break;	// end of chain
+	static int	get_h1(size_t hash_value) { return (int) (hash_value >> 7); }
+	static int	get_h2(size_t hash_value) { return (int) (hash_value & 0x7F); }
 
-			assert(index >= 0 && index <= m_table->m_size_mask);
-			e = &E(index);
+	// Helpers.
+	signed char*	get_ctrl() { return (signed char*) (m_table + 1); }
+	const signed char*	get_ctrl() const { return (const signed char*) (m_table + 1); }
 
-			assert(e->is_empty() == false || e->is_tombstone());
-		}
-		return -1;
+	bool	is_full(int index) const
+	{
+		assert(m_table);
+		assert(index >= 0 && index <= m_table->m_size_mask);
+		return get_ctrl()[index] >= 0;
 	}
 
-	size_t compute_hash(const T& key) const {
-		size_t hash_value = hash_functor()(key);
-		if (hash_value == TOMBSTONE_HASH) {
-			hash_value ^= 0x8000;
+	void	set_ctrl(int index, int c)
+	// The first group is repeated after the last slot, so that
+	// a group can be loaded from any slot.
+	{
+		signed char*	ctrl = get_ctrl();
+		ctrl[index] = (signed char) c;
+		if (index < hash_group::SIZE)
+		{
+			ctrl[m_table->m_size_mask + 1 + index] = (signed char) c;
 		}
-		return hash_value;
 	}
 
-	// Helpers.
 	entry&	E(int index)
 	{
 		assert(m_table);
 		assert(index >= 0 && index <= m_table->m_size_mask);
-		return *(((entry*) (m_table + 1)) + index);
+		return *(((entry*) ((char*) m_table + get_entries_offset(m_table->m_size_mask + 1))) + index);
 	}
 	const entry&	E(int index) const
 	{
 		assert(m_table);
 		assert(index >= 0 && index <= m_table->m_size_mask);
-		return *(((entry*) (m_table + 1)) + index);
+		return *(((const entry*) ((const char*) m_table + get_entries_offset(m_table->m_size_mask + 1))) + index);
 	}
 
-	// Return the index of the newly cleared element.
-	int remove_tombstone(int index) {
-		entry* e = &E(index);
-		assert(e->is_tombstone());
-		assert(!e->is_end_of_chain());
+	static int	get_entries_offset(int capacity)
+	{
+		int	offset = sizeof(table) + capacity + hash_group::SIZE;
+		return (offset + alignof(entry) - 1) & ~(int(alignof(entry)) - 1);
+	}
+
+	static int	get_table_bytes(int capacity)
+	{
+		return get_entries_offset(capacity) + sizeof(entry) * capacity;
+	}
+
+	int	find_free(size_t hash_value) const
+	// The first empty or deleted slot on the probe sequence of the
+	// hash.
+	{
+		int	mask = m_table->m_size_mask;
+		const signed char*	ctrl = get_ctrl();
+		int	pos = get_h1(hash_value) & mask;
+		for (int step = hash_group::SIZE; ; step += hash_group::SIZE)
+		{
+			uint64	match = hash_group(ctrl + pos).match_empty_or_deleted();
+			if (match)
+			{
+				return (pos + hash_group::lowest(match)) & mask;
+			}
+			assert(step <= mask + 1);
+			pos = (pos + step) & mask;
+		}
+	}
+
+	int	insert(const T& key, const U& value)
+	// Adds an entry for a key that's not in the table, returns its
+	// index.
+	{
+		if (m_table == NULL)
+		{
+			set_raw_capacity(16);
+		}
+
+		size_t	hash_value = compute_hash(key);
+		int	index = find_free(hash_value);
+		if (get_ctrl()[index] == hash_group::EMPTY)
+		{
+			// Tombstones are reused for free, an empty slot
+			// takes from the growth left.
+			if (m_table->m_growth_left == 0)
+			{
+				grow();
+				index = find_free(hash_value);
+			}
+			m_table->m_growth_left--;
+		}
+
+		set_ctrl(index, get_h2(hash_value));
+		new (&E(index)) entry(key, value, hash_value);	// placement new
+		m_table->m_entry_count++;
+		return index;
+	}
 
-		// Move the next element of the chain into the
-		// tombstone slot, and return the vacated element.
-		int new_blank_index = e->m_next_in_chain;
-		entry* new_blank = &E(new_blank_index);
-		new (e) entry(*new_blank);
-		new_blank->clear();
-		return new_blank_index;
+	void	grow()
+	// No room left: make a table twice as big, or if the room went
+	// to tombstones, clean them out.
+	{
+		int	capacity = m_table->m_size_mask + 1;
+		if (size() * 16 <= capacity * 7)
+		{
+			rehash(capacity);
+		}
+		else
+		{
+			rehash(capacity * 2);
+		}
 	}
 
 	void	set_raw_capacity(int new_size)
@@ -1321,33 +1535,46 @@ private:
 			return;
 		}
 
+		rehash(new_size);
+	}
+
+	void	rehash(int new_size)
+	// Moves the entries to a new table of new_size slots, a power
+	// of two.
+	{
+		assert(new_size >= 16 && (new_size & (new_size - 1)) == 0);
+
 		hash<T, U, hash_functor>	new_hash;
-		new_hash.m_table = (table*) tu_malloc(sizeof(table) + sizeof(entry) * new_size);
+		new_hash.m_table = (table*) tu_malloc(get_table_bytes(new_size));
 		assert(new_hash.m_table);	// @@ need to throw (or something) on malloc failure!
 
 		new_hash.m_table->m_entry_count = 0;
 		new_hash.m_table->m_size_mask = new_size - 1;
-		{for (int i = 0; i < new_size; i++)
-		{
-			new_hash.E(i).m_next_in_chain = -2;	// mark empty
-		}}
-		
+		new_hash.m_table->m_growth_left = new_size - new_size / 8;
+		memset(new_hash.get_ctrl(), hash_group::EMPTY, new_size + hash_group::SIZE);
+
 		// Copy stuff to new_hash
 		if (m_table)
 		{
+			assert(size() <= new_hash.m_table->m_growth_left);
 			for (int i = 0, n = m_table->m_size_mask; i <= n; i++)
 			{
-				entry*	e = &E(i);
-				if (e->is_empty() == false && e->is_tombstone() == false)
+				if (is_full(i))
 				{
-					// Insert old entry into new hash.
-					new_hash.add(e->first, e->second);
-					e->clear();	// placement delete of old element
+					// Insert old entry into new hash, the
+					// hash is kept.
+					entry*	e = &E(i);
+					int	index = new_hash.find_free(e->m_hash_value);
+					new_hash.set_ctrl(index, get_h2(e->m_hash_value));
+					new (&new_hash.E(index)) entry(*e);	// placement new, copy ctor
+					new_hash.m_table->m_entry_count++;
+					new_hash.m_table->m_growth_left--;
+					e->~entry();	// placement delete of old element
 				}
 			}
 
 			// Delete our old data buffer.
-			tu_free(m_table, sizeof(table) + sizeof(entry) * (m_table->m_size_mask + 1));
+			tu_free(m_table, get_table_bytes(m_table->m_size_mask + 1));
 		}
 
 		// Steal new_hash's data.
@@ -1359,7 +1586,8 @@ private:
 	{
 		int m_entry_count;
 		int m_size_mask;
-		// entry array goes here!
+		int m_growth_left;	// empty slots that can still be filled
+		// control bytes, then the entry array go here!
 	};
 	table*	m_table;
 };
@@ -1433,6 +1661,13 @@ public:
 		resize(str.size());
 		memcpy(get_buffer(), str.get_buffer(), size() + 1);
 	}
+	tu_string(tu_string&& str)
+	// Takes str's buffer, str is left empty.
+	{
+		memcpy(&m_union, &str.m_union, sizeof(m_union));
+		str.m_union.m_local.m_bufsize_minus_length = sizeof(str.m_union.m_local.m_buffer);
+		str.m_union.m_local.m_buffer[0] = 0;
+	}
 	tu_string(const uint32* wide_char_str)
 	{
 		m_union.m_local.m_bufsize_minus_length = sizeof(m_union.m_local.m_buffer);
@@ -1452,7 +1687,7 @@ public:
 	{
 		if (using_heap())
 		{
-			tu_free(m_union.m_heap.m_buffer, m_heap.m_capacity);
+			tu_free(m_union.m_heap.m_buffer, m_union.m_heap.m_capacity);
 		}
 	}
 
@@ -1491,6 +1726,18 @@ public:
 		}
 	}
 
+	exported_module void	operator=(tu_string&& str)
+	{
+		if (this != &str) {
+			if (using_heap()) {
+				tu_free(m_union.m_heap.m_buffer, m_union.m_heap.m_capacity);
+			}
+			memcpy(&m_union, &str.m_union, sizeof(m_union));
+			str.m_union.m_local.m_bufsize_minus_length = sizeof(str.m_union.m_local.m_buffer);
+			str.m_union.m_local.m_buffer[0] = 0;
+		}
+	}
+
 	exported_module bool	operator==(const char* str) const
 	{
 		return strcmp(*this, str) == 0;
@@ -1772,6 +2019,7 @@ public:
 	tu_stringi(const char* str) : m_string(str) {}
 	tu_stringi(const tu_string& str) : m_string(str) {}
 	tu_stringi(const tu_stringi& stri) : m_string(stri.c_str()) {}
+	tu_stringi(tu_stringi&& stri) : m_string(std::move(stri.m_string)) {}
 
 	~tu_stringi() {}
 
@@ -1780,6 +2028,7 @@ public:
 	void	operator=(const char* str) { m_string = str; }
 	void	operator=(const tu_string& str) { m_string = str; }
 	void	operator=(const tu_stringi& str) { m_string = str.m_string; }
+	void	operator=(tu_stringi&& str) { m_string = std::move(str.m_string); }
 	int	length() const { return m_string.length(); }
 	int	size() const { return length(); }
 	char&	operator[](int index) { return m_string[index]; }
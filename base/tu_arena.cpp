@@ -0,0 +1,171 @@
+// tu_arena.cpp
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// Bump allocator and size-class freelists.
+
+
+#include "base/tu_arena.h"
+
+
+static int	align_up(int size)
+{
+	return (size + tu_arena::ALIGNMENT - 1) & ~(tu_arena::ALIGNMENT - 1);
+}
+
+
+tu_arena::tu_arena(int chunk_size) :
+	m_chunk_size(align_up(chunk_size)),
+	m_current(0),
+	m_used(0)
+{
+	assert(chunk_size > 0);
+}
+
+
+tu_arena::~tu_arena()
+{
+	free_chunks();
+}
+
+
+void*	tu_arena::alloc(int size)
+{
+	assert(size >= 0);
+	size = align_up(size);
+
+	// Move on to the next chunk that has room, the chunks past
+	// m_current are free.  A chunk that's too small is skipped,
+	// it gets used again after the next clear() or release().
+	while (m_current >= m_chunks.size() || m_used + size > m_chunks[m_current].m_size)
+	{
+		if (m_current < m_chunks.size() && m_used > 0)
+		{
+			m_current++;
+			m_used = 0;
+			continue;
+		}
+		if (m_current < m_chunks.size() && m_chunks[m_current].m_size >= size)
+		{
+			break;
+		}
+
+		// Insert a new chunk here.
+		chunk	c;
+		c.m_size = imax(m_chunk_size, size);
+		c.m_data = (char*) tu_malloc(c.m_size);
+		m_chunks.resize(m_chunks.size() + 1);
+		for (int i = m_chunks.size() - 1; i > m_current; i--)
+		{
+			m_chunks[i] = m_chunks[i - 1];
+		}
+		m_chunks[m_current] = c;
+		m_used = 0;
+	}
+
+	void*	p = m_chunks[m_current].m_data + m_used;
+	m_used += size;
+	return p;
+}
+
+
+tu_arena::mark	tu_arena::get_mark() const
+{
+	mark	m;
+	m.m_chunk = m_current;
+	m.m_used = m_used;
+	return m;
+}
+
+
+void	tu_arena::release(const mark& m)
+{
+	assert(m.m_chunk < m_current || (m.m_chunk == m_current && m.m_used <= m_used));
+	m_current = m.m_chunk;
+	m_used = m.m_used;
+}
+
+
+void	tu_arena::free_chunks()
+{
+	for (int i = 0; i < m_chunks.size(); i++)
+	{
+		tu_free(m_chunks[i].m_data, m_chunks[i].m_size);
+	}
+	m_chunks.resize(0);
+	clear();
+}
+
+
+int	tu_arena::get_chunk_bytes() const
+{
+	int	bytes = 0;
+	for (int i = 0; i < m_chunks.size(); i++)
+	{
+		bytes += m_chunks[i].m_size;
+	}
+	return bytes;
+}
+
+
+int	tu_arena::get_used_bytes() const
+{
+	int	bytes = m_used;
+	for (int i = 0; i < m_current && i < m_chunks.size(); i++)
+	{
+		bytes += m_chunks[i].m_size;
+	}
+	return bytes;
+}
+
+
+tu_freelist::tu_freelist(int chunk_size) :
+	m_arena(chunk_size)
+{
+	for (int i = 0; i < CLASS_COUNT; i++)
+	{
+		m_free[i] = NULL;
+	}
+}
+
+
+void*	tu_freelist::alloc(int size)
+{
+	m_stats.m_allocs++;
+	if (size > MAX_SIZE)
+	{
+		m_stats.m_large++;
+		return tu_malloc(size);
+	}
+
+	int	c = get_class(imax(size, 1));
+	free_block*	block = m_free[c];
+	if (block)
+	{
+		m_free[c] = block->m_next;
+		m_stats.m_reused++;
+		return block;
+	}
+	return m_arena.alloc((c + 1) * GRANULARITY);
+}
+
+
+void	tu_freelist::dealloc(void* p, int size)
+{
+	if (p == NULL)
+	{
+		return;
+	}
+	m_stats.m_frees++;
+	if (size > MAX_SIZE)
+	{
+		tu_free(p, size);
+		return;
+	}
+
+	int	c = get_class(imax(size, 1));
+	free_block*	block = (free_block*) p;
+	block->m_next = m_free[c];
+	m_free[c] = block;
+}
@@ -0,0 +1,129 @@
+// tu_arena.h
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// Allocators for lots of small blocks that come and go quickly.
+//
+// tu_arena is a bump allocator: it hands out the blocks one after
+// the other from big chunks, and frees them all at once, with
+// clear() or back to a mark with release().  The chunks are kept
+// for the next blocks.
+//
+// tu_freelist keeps the blocks given back to it in a list per size
+// class, and hands them out again before it takes more memory from
+// its arena.  Blocks bigger than MAX_SIZE come from tu_malloc().
+//
+// Neither of them is thread-safe.
+
+
+#ifndef TU_ARENA_H
+#define TU_ARENA_H
+
+#include "base/tu_config.h"
+#include "base/container.h"
+
+
+struct tu_arena
+{
+	enum
+	{
+		ALIGNMENT = 16,
+		DEFAULT_CHUNK_SIZE = 64 * 1024
+	};
+
+	// Where the arena was, see release().
+	struct mark
+	{
+		int	m_chunk;
+		int	m_used;
+	};
+
+	tu_arena(int chunk_size = DEFAULT_CHUNK_SIZE);
+	~tu_arena();
+
+	// Returns a block of size bytes.  The sizes are rounded up to
+	// ALIGNMENT, so the blocks are aligned like those of
+	// tu_malloc().  A block bigger than the chunk size gets a chunk
+	// of its own.
+	void*	alloc(int size);
+
+	// Frees the blocks allocated since get_mark() returned m.
+	mark	get_mark() const;
+	void	release(const mark& m);
+
+	// Frees all the blocks.
+	void	clear() { m_current = 0; m_used = 0; }
+
+	// Gives the chunks back to tu_free().
+	void	free_chunks();
+
+	// Bytes taken by the chunks, and bytes handed out from them.
+	int	get_chunk_bytes() const;
+	int	get_used_bytes() const;
+
+private:
+	struct chunk
+	{
+		char*	m_data;
+		int	m_size;
+	};
+
+	array<chunk>	m_chunks;
+	int	m_chunk_size;
+	int	m_current;	// chunk the blocks come from
+	int	m_used;	// bytes handed out from m_chunks[m_current]
+};
+
+
+// What a tu_freelist did.
+struct tu_freelist_stats
+{
+	tu_freelist_stats() :
+		m_allocs(0),
+		m_frees(0),
+		m_reused(0),
+		m_large(0)
+	{
+	}
+
+	int	m_allocs;
+	int	m_frees;
+	int	m_reused;	// allocs served from a list
+	int	m_large;	// allocs passed on to tu_malloc()
+};
+
+
+struct tu_freelist
+{
+	enum
+	{
+		GRANULARITY = 16,
+		MAX_SIZE = 256,
+		CLASS_COUNT = MAX_SIZE / GRANULARITY
+	};
+
+	tu_freelist(int chunk_size = tu_arena::DEFAULT_CHUNK_SIZE);
+
+	// dealloc() must be given the size alloc() was.
+	void*	alloc(int size);
+	void	dealloc(void* p, int size);
+
+	const tu_freelist_stats&	get_stats() const { return m_stats; }
+	const tu_arena&	get_arena() const { return m_arena; }
+
+private:
+	static int	get_class(int size) { return (size + GRANULARITY - 1) / GRANULARITY - 1; }
+
+	struct free_block
+	{
+		free_block*	m_next;
+	};
+
+	tu_arena	m_arena;
+	free_block*	m_free[CLASS_COUNT];
+	tu_freelist_stats	m_stats;
+};
+
+
+#endif // TU_ARENA_H
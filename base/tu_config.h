@@ -16,6 +16,19 @@
 
 #include "base/dlmalloc.h"
 
+// Define TU_MEMDEBUG_COUNT_ALLOCS to 1 to count the calls of
+// tu_malloc(), tu_realloc(), tu_free() and new/delete.  The counting
+// functions are in tu_memdebug.h, which the program must include.
+#if TU_MEMDEBUG_COUNT_ALLOCS
+#include <stddef.h>
+void*	tu_memdebug_malloc(size_t size);
+void*	tu_memdebug_realloc(void* old_ptr, size_t new_size, size_t old_size);
+void	tu_memdebug_free(void* old_ptr, size_t old_size);
+#define tu_malloc(size) tu_memdebug_malloc(size)
+#define tu_realloc(old_ptr, new_size, old_size) tu_memdebug_realloc(old_ptr, new_size, old_size)
+#define tu_free(old_ptr, old_size) tu_memdebug_free(old_ptr, old_size)
+#endif
+
 // #define these in compatibility_include.h if you want something different.
 #ifndef tu_malloc
 #define tu_malloc(size) dlmalloc(size)
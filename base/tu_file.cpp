@@ -149,6 +149,7 @@ struct filebuf
 	}
 
 	unsigned char*	get_cursor() { return ((unsigned char*) m_.data()) + m_position; }
+	const unsigned char*	get_read_cursor() const { return ((const unsigned char*) m_.data()) + m_position; }
 };
 
 
@@ -165,7 +166,7 @@ static int mem_read_func(void* dst, int bytes, void* appdata)
 	int	bytes_to_read = imin(bytes, buf->m_.size() - buf->m_position);
 	if (bytes_to_read)
 	{
-		memcpy(dst, buf->get_cursor(), bytes_to_read);
+		memcpy(dst, buf->get_read_cursor(), bytes_to_read);
 	}
 	buf->m_position += bytes_to_read;
 
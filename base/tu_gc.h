@@ -163,6 +163,15 @@ namespace tu_gc {
 			garbage_collector::construct_pointer(this);
 			reset((T*) p.m_ptr);
 		}
+		// Takes p's reference, p is left null.
+		gc_ptr(gc_ptr&& p) : m_ptr(0) {
+			garbage_collector::construct_pointer(this);
+			garbage_collector::move_pointer(this, &p);
+		}
+
+		// Whether array<> can move it by bitwise copy; see
+		// tu_is_relocatable in container.h.
+		enum { is_relocatable = garbage_collector::RELOCATABLE_POINTERS };
 
 		~gc_ptr() {
 			reset(0);
@@ -181,6 +190,10 @@ namespace tu_gc {
 			reset(p.get());
 		}
 
+		void operator=(gc_ptr&& p) {
+			garbage_collector::move_pointer(this, &p);
+		}
+
 		void operator=(T* p) {
 			reset(p);
 		}
@@ -391,7 +404,9 @@ namespace tu_gc {
 
 	// TODO: incremental generational gc
 
-	// TODO: multithreaded variants
+	// TODO: multithreaded variants.  parallel_marksweep collects
+	// on several threads, but the gc_ptr's must still be used by
+	// one thread at a time.
 
 }  // tu_gc
 
@@ -0,0 +1,763 @@
+// tu_gc_parallel_marksweep.cpp
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// Mark-sweep collector with parallel marking and sweeping.
+
+
+#include "base/tu_gc_parallel_marksweep.h"
+#include "base/tu_timer.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace tu_gc {
+
+	// In front of each heap block.
+	struct block_header {
+		std::atomic<bool> mark;
+		// Found dead by the last sweep, waiting to be
+		// destroyed.
+		bool dead;
+		// size of the object memory block
+		size_t sz;
+		// The gc object inside the block, see
+		// singlethreaded_marksweep.
+		gc_object_generic_base* obj;
+
+		block_header(size_t sz_in) : mark(false), dead(false), sz(sz_in), obj(0) {
+		}
+
+		void* p();
+		void* end();
+		bool is_address_inside(const void* ptr);
+		static block_header* from_p(void* p);
+	};
+
+	// Keeps the blocks aligned like operator new does.
+	static const size_t BLOCK_HEADER_SIZE = (sizeof(block_header) + 15) & ~15;
+
+	inline void* block_header::p() {
+		return reinterpret_cast<char*>(this) + BLOCK_HEADER_SIZE;
+	}
+
+	inline void* block_header::end() {
+		return static_cast<char*>(p()) + sz;
+	}
+
+	inline bool block_header::is_address_inside(const void* ptr) {
+		return (ptr >= p() && ptr < end());
+	}
+
+	inline block_header* block_header::from_p(void* p) {
+		return reinterpret_cast<block_header*>(static_cast<char*>(p) - BLOCK_HEADER_SIZE);
+	}
+
+	// The blocks one collector thread has to mark.  The owner
+	// works at the back, the other threads steal from the front.
+	struct mark_deque {
+		std::mutex m_lock;
+		std::deque<block_header*> m_blocks;
+		// For the thieves to skip empty deques without
+		// locking them.
+		std::atomic<size_t> m_size;
+
+		mark_deque() : m_size(0) {
+		}
+
+		void push(block_header* b) {
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_blocks.push_back(b);
+			m_size.store(m_blocks.size(), std::memory_order_relaxed);
+		}
+
+		block_header* pop() {
+			std::lock_guard<std::mutex> lock(m_lock);
+			if (m_blocks.empty()) {
+				return NULL;
+			}
+			block_header* b = m_blocks.back();
+			m_blocks.pop_back();
+			m_size.store(m_blocks.size(), std::memory_order_relaxed);
+			return b;
+		}
+
+		block_header* steal() {
+			std::lock_guard<std::mutex> lock(m_lock);
+			if (m_blocks.empty()) {
+				return NULL;
+			}
+			block_header* b = m_blocks.front();
+			m_blocks.pop_front();
+			m_size.store(m_blocks.size(), std::memory_order_relaxed);
+			return b;
+		}
+	};
+
+	// One collector thread's part of the sweep.
+	struct sweep_chunk {
+		size_t begin;
+		size_t live_end;
+		size_t live_bytes;
+		std::vector<block_header*> dead;
+	};
+
+	// Dead blocks destroyed by an allocation, see
+	// parallel_marksweep_state::allocate().  Destroying them in
+	// batches keeps the pointer maps in the cache: one block per
+	// allocation made GCBench several times slower.
+	static const size_t LAZY_SWEEP_BYTES = 1 << 16;
+
+	// The deque of the collector thread we're on.
+	static thread_local mark_deque* s_deque = NULL;
+
+	struct parallel_marksweep_state : public collector_access {
+		typedef std::map<void*, gc_object_generic_base*>::iterator ptr_iterator;
+		typedef std::map<void*, block_header*>::iterator heap_block_iterator;
+		typedef std::set<parallel_marksweep::gc_container_base*>::iterator container_iterator;
+
+		// roots
+		std::map<void*, gc_object_generic_base*> m_roots;
+
+		// Blocks that are not yet under the control of a gc_ptr,
+		// see singlethreaded_marksweep.  There are only a few
+		// of them at a time, the most recent at the back.
+		std::vector<block_header*> m_floating_blocks;
+
+		// non-roots
+		std::map<void*, gc_object_generic_base*> m_heap_ptrs;
+
+		// heap blocks, by address and in the order the sweep
+		// goes through them
+		std::map<void*, block_header*> m_heap_blocks;
+		std::vector<block_header*> m_blocks;
+
+		// Found dead by the last sweep.
+		std::vector<block_header*> m_dead;
+		size_t m_dead_bytes;
+
+		// containers
+		std::set<parallel_marksweep::gc_container_base*> m_root_containers;
+		std::set<parallel_marksweep::gc_container_base*> m_containers;
+
+		// Collector threads.  Thread 0 is the one that calls
+		// collect_garbage(), the others wait for run_parallel().
+		int m_thread_count;
+		mark_deque* m_deques;
+		sweep_chunk* m_chunks;
+		std::vector<std::thread> m_threads;
+		std::mutex m_pool_lock;
+		std::condition_variable m_pool_wake;
+		std::condition_variable m_pool_done;
+		void (parallel_marksweep_state::*m_task)(int thread_index);
+		int m_job;
+		int m_running;
+		bool m_quit;
+
+		// Threads that found nothing to mark.
+		std::atomic<int> m_idle;
+
+		// Stats & control values.
+		int m_percent_growth;
+		size_t m_current_heap_bytes;
+		size_t m_next_collection_heap_size;
+		size_t m_last_collection_heap_size;
+		bool m_collecting;
+		size_t m_collections;
+		double m_total_pause_ms;
+		double m_max_pause_ms;
+
+		parallel_marksweep_state() :
+			m_dead_bytes(0),
+			m_thread_count(0),
+			m_deques(NULL),
+			m_chunks(NULL),
+			m_task(NULL),
+			m_job(0),
+			m_running(0),
+			m_quit(false),
+			m_idle(0),
+			m_percent_growth(100),
+			m_current_heap_bytes(0),
+			m_next_collection_heap_size(1 << 16),
+			m_last_collection_heap_size(1 << 16),
+			m_collecting(false),
+			m_collections(0),
+			m_total_pause_ms(0),
+			m_max_pause_ms(0) {
+			int n = std::thread::hardware_concurrency();
+			set_thread_count(n > 0 ? n : 1);
+		}
+
+		~parallel_marksweep_state() {
+			stop_threads();
+			delete [] m_deques;
+			delete [] m_chunks;
+		}
+
+		void set_collection_rate(int percent) {
+			m_percent_growth = percent;
+			size_t a = m_last_collection_heap_size;
+			double b = m_percent_growth / 100.0;
+			double c = a * (1 + b);
+			m_next_collection_heap_size = static_cast<size_t>(c);
+		}
+
+		void set_thread_count(int thread_count) {
+			assert(thread_count >= 1);
+			assert(m_collecting == false);
+			stop_threads();
+			delete [] m_deques;
+			delete [] m_chunks;
+			m_thread_count = thread_count;
+			m_deques = new mark_deque[thread_count];
+			m_chunks = new sweep_chunk[thread_count];
+		}
+
+		// Threads
+
+		void start_threads() {
+			m_quit = false;
+			for (int i = 1; i < m_thread_count; i++) {
+				m_threads.push_back(std::thread(&parallel_marksweep_state::thread_main, this, i, m_job));
+			}
+		}
+
+		void stop_threads() {
+			{
+				std::lock_guard<std::mutex> lock(m_pool_lock);
+				m_quit = true;
+			}
+			m_pool_wake.notify_all();
+			for (size_t i = 0; i < m_threads.size(); i++) {
+				m_threads[i].join();
+			}
+			m_threads.clear();
+		}
+
+		// Waits for the jobs after the given one.
+		void thread_main(int thread_index, int job) {
+			for (;;) {
+				void (parallel_marksweep_state::*task)(int);
+				{
+					std::unique_lock<std::mutex> lock(m_pool_lock);
+					while (m_quit == false && m_job == job) {
+						m_pool_wake.wait(lock);
+					}
+					if (m_quit) {
+						return;
+					}
+					job = m_job;
+					task = m_task;
+				}
+
+				(this->*task)(thread_index);
+
+				std::lock_guard<std::mutex> lock(m_pool_lock);
+				if (--m_running == 0) {
+					m_pool_done.notify_one();
+				}
+			}
+		}
+
+		// Runs task on all the collector threads, and returns
+		// when they are all done.
+		void run_parallel(void (parallel_marksweep_state::*task)(int)) {
+			if (m_thread_count > 1) {
+				if (m_threads.size() == 0) {
+					// Started on the first collection,
+					// programs that never collect don't
+					// need them.
+					start_threads();
+				}
+				{
+					std::lock_guard<std::mutex> lock(m_pool_lock);
+					m_task = task;
+					m_running = m_thread_count - 1;
+					m_job++;
+				}
+				m_pool_wake.notify_all();
+			}
+
+			(this->*task)(0);
+
+			if (m_thread_count > 1) {
+				std::unique_lock<std::mutex> lock(m_pool_lock);
+				while (m_running > 0) {
+					m_pool_done.wait(lock);
+				}
+			}
+		}
+
+		// Allocation
+
+		void* allocate(size_t sz, block_construction_locker_base* lock) {
+			assert(sz > 0);
+			assert(lock);
+
+			if (m_current_heap_bytes >= m_next_collection_heap_size && m_collecting == false) {
+				// It's time to collect.
+				collect();
+			} else if (m_dead.size()) {
+				destroy_dead_blocks(LAZY_SWEEP_BYTES);
+			}
+
+			block_header* b = new (operator new(BLOCK_HEADER_SIZE + sz)) block_header(sz);
+			void* block = b->p();
+			m_heap_blocks.insert(std::make_pair(block, b));
+			m_blocks.push_back(b);
+			m_current_heap_bytes += sz;
+
+			// Keep this block from being collected during
+			// construction, before it has a chance to be
+			// assigned to a gc_ptr.
+			m_floating_blocks.push_back(b);
+			block_ref(lock) = block;
+
+			return block;
+		}
+
+		void deallocate(void* p) {
+			block_header* b = block_header::from_p(p);
+			m_heap_blocks.erase(p);
+			if (b->dead == false) {
+				// The constructor threw; the sweep doesn't
+				// know it's gone.
+				for (size_t i = 0; i < m_floating_blocks.size(); i++) {
+					if (m_floating_blocks[i] == b) {
+						m_floating_blocks.erase(m_floating_blocks.begin() + i);
+						break;
+					}
+				}
+				for (size_t i = 0; i < m_blocks.size(); i++) {
+					if (m_blocks[i] == b) {
+						m_blocks.erase(m_blocks.begin() + i);
+						m_current_heap_bytes -= b->sz;
+						break;
+					}
+				}
+			}
+			b->~block_header();
+			operator delete(b);
+		}
+
+		// Destroys dead blocks until at least the given number
+		// of bytes have been freed.
+		void destroy_dead_blocks(size_t bytes) {
+			size_t freed = 0;
+			while (m_dead.size() && freed < bytes) {
+				block_header* b = m_dead.back();
+				m_dead.pop_back();
+				freed += b->sz;
+				m_dead_bytes -= b->sz;
+
+				gc_object_generic_base* obj = b->obj;
+				assert(obj);
+				delete obj;
+			}
+		}
+
+		void block_construction_finished(void* block) {
+			// Not found if the constructor threw, see
+			// deallocate().
+			for (int i = (int) m_floating_blocks.size() - 1; i >= 0; i--) {
+				if (m_floating_blocks[i]->p() == block) {
+					m_floating_blocks.erase(m_floating_blocks.begin() + i);
+					return;
+				}
+			}
+		}
+
+		void constructing_gc_object_base(gc_object_generic_base* obj) {
+			// gc_objects must be constructed on the heap, by
+			// the innermost new expression.
+			for (int i = (int) m_floating_blocks.size() - 1; i >= 0; i--) {
+				block_header* b = m_floating_blocks[i];
+				if (b->is_address_inside(obj)) {
+					assert(b->obj == NULL);
+					b->obj = obj;
+					static_cast<parallel_marksweep::gc_object_collector_base*>(obj)->m_gc_block = b;
+					return;
+				}
+			}
+			assert(0);
+		}
+
+		static block_header* get_block(const gc_object_generic_base* obj) {
+			return static_cast<block_header*>(
+				static_cast<const parallel_marksweep::gc_object_collector_base*>(obj)->m_gc_block);
+		}
+
+		void get_stats(parallel_marksweep::stats* s) {
+			assert(s);
+			s->live_heap_bytes = m_current_heap_bytes;
+			s->garbage_bytes = m_dead_bytes;
+			s->root_pointers = m_roots.size();
+			s->live_pointers = s->root_pointers + m_heap_ptrs.size();
+			s->root_containers = m_root_containers.size();
+			s->collections = m_collections;
+			s->total_pause_ms = m_total_pause_ms;
+			s->max_pause_ms = m_max_pause_ms;
+		}
+
+		void reset_pause_stats() {
+			m_collections = 0;
+			m_total_pause_ms = 0;
+			m_max_pause_ms = 0;
+		}
+
+		// An explicit collection leaves no garbage behind.
+		void collect_garbage(parallel_marksweep::stats* s) {
+			collect();
+			size_t garbage_bytes = m_dead_bytes;
+			destroy_dead_blocks(m_dead_bytes);
+			if (s) {
+				get_stats(s);
+				s->garbage_bytes = garbage_bytes;
+			}
+		}
+
+		void collect() {
+			assert(m_collecting == false);
+			m_collecting = true;
+			uint64 start = tu_timer::get_profile_ticks();
+
+			// What the last sweep left.
+			destroy_dead_blocks(m_dead_bytes);
+			assert(m_dead.size() == 0);
+
+			mark_live_objects();
+			sweep_dead_objects();
+
+			double pause_ms = tu_timer::profile_ticks_to_milliseconds(tu_timer::get_profile_ticks() - start);
+			m_collections++;
+			m_total_pause_ms += pause_ms;
+			if (pause_ms > m_max_pause_ms) {
+				m_max_pause_ms = pause_ms;
+			}
+
+			m_last_collection_heap_size = m_current_heap_bytes;
+			set_collection_rate(m_percent_growth);
+			m_collecting = false;
+		}
+
+		// Mark
+
+		void mark_live_objects() {
+			m_idle = 0;
+
+			// Spread the roots over the deques; the threads
+			// steal from each other anyway, this only gets
+			// them going sooner.
+			int i = 0;
+			for (ptr_iterator it = m_roots.begin();
+			     it != m_roots.end();
+			     ++it) {
+				gc_object_generic_base* p = it->second;
+				assert(p);
+				m_deques[i++ % m_thread_count].push(get_block(p));
+			}
+			for (size_t j = 0; j < m_floating_blocks.size(); j++) {
+				m_deques[i++ % m_thread_count].push(m_floating_blocks[j]);
+			}
+
+			// Root containers go to the first deque.
+			s_deque = &m_deques[0];
+			for (container_iterator it_cnt = m_root_containers.begin();
+			     it_cnt != m_root_containers.end();
+			     ++it_cnt) {
+				(*it_cnt)->visit_contained_ptrs();
+			}
+
+			run_parallel(&parallel_marksweep_state::mark_task);
+		}
+
+		void mark_task(int thread_index) {
+			mark_deque* deque = &m_deques[thread_index];
+			s_deque = deque;
+			for (;;) {
+				block_header* b = deque->pop();
+				if (b == NULL) {
+					b = steal(thread_index);
+				}
+				if (b) {
+					mark_block(b);
+				} else if (wait_for_work()) {
+					break;
+				}
+			}
+			s_deque = NULL;
+		}
+
+		block_header* steal(int thread_index) {
+			for (int i = 1; i < m_thread_count; i++) {
+				mark_deque* victim = &m_deques[(thread_index + i) % m_thread_count];
+				if (victim->m_size.load(std::memory_order_relaxed) > 0) {
+					block_header* b = victim->steal();
+					if (b) {
+						return b;
+					}
+				}
+			}
+			return NULL;
+		}
+
+		// Called when a thread has nothing to mark.  Returns
+		// true when the mark is done, i.e. all the threads are
+		// idle: only a busy thread can push blocks, and it only
+		// becomes idle with an empty deque.  Returns false when
+		// there are blocks to steal again.
+		bool wait_for_work() {
+			m_idle++;
+			for (;;) {
+				if (m_idle.load() == m_thread_count) {
+					return true;
+				}
+				for (int i = 0; i < m_thread_count; i++) {
+					if (m_deques[i].m_size.load(std::memory_order_relaxed) > 0) {
+						m_idle--;
+						return false;
+					}
+				}
+				std::this_thread::yield();
+			}
+		}
+
+		static bool is_marked(const block_header* b) {
+			return b->mark.load(std::memory_order_relaxed);
+		}
+
+		void mark_block(block_header* b) {
+			if (is_marked(b) || b->mark.exchange(true)) {
+				// Marked already, maybe by another thread.
+				return;
+			}
+
+			// The maps are not changed while marking, so the
+			// threads can all search them.
+
+			// Find all gc pointers that are inside this heap block.
+			// Mark the blocks that they point to.
+			void* block_end = b->end();
+			ptr_iterator it_ptr = m_heap_ptrs.lower_bound(b->p());
+			while (it_ptr != m_heap_ptrs.end() && it_ptr->first < block_end) {
+				gc_object_generic_base* p = it_ptr->second;
+				assert(p);
+				block_header* pb = get_block(p);
+				if (is_marked(pb) == false) {
+					s_deque->push(pb);
+				}
+				++it_ptr;
+			}
+
+			// Find all gc containers that are inside this heap block.
+			container_iterator it_cnt = m_containers.lower_bound((parallel_marksweep::gc_container_base*) b->p());
+			while (it_cnt != m_containers.end() && (void*) *it_cnt < block_end) {
+				(*it_cnt)->visit_contained_ptrs();
+				++it_cnt;
+			}
+		}
+
+		void visit_contained_ptr(const gc_object_generic_base* obj) {
+			assert(s_deque);
+			if (obj) {
+				block_header* b = get_block(obj);
+				if (is_marked(b) == false) {
+					s_deque->push(b);
+				}
+			}
+		}
+
+		// Sweep.  Each thread goes through its part of m_blocks,
+		// keeps the live blocks at the start of it and clears
+		// their marks.  The parts are then put back together,
+		// and the dead blocks are left for
+		// destroy_dead_blocks().
+
+		void sweep_dead_objects() {
+			run_parallel(&parallel_marksweep_state::sweep_task);
+
+			size_t live = 0;
+			size_t heap_bytes = 0;
+			for (int i = 0; i < m_thread_count; i++) {
+				sweep_chunk* c = &m_chunks[i];
+				for (size_t j = c->begin; j < c->live_end; j++) {
+					m_blocks[live++] = m_blocks[j];
+				}
+				heap_bytes += c->live_bytes;
+				for (size_t j = 0; j < c->dead.size(); j++) {
+					m_dead.push_back(c->dead[j]);
+					m_dead_bytes += c->dead[j]->sz;
+				}
+				c->dead.resize(0);
+			}
+			m_blocks.resize(live);
+
+			m_current_heap_bytes = heap_bytes;
+		}
+
+		void sweep_task(int thread_index) {
+			sweep_chunk* c = &m_chunks[thread_index];
+			size_t n = m_blocks.size();
+			size_t end = n * (thread_index + 1) / m_thread_count;
+			c->begin = n * thread_index / m_thread_count;
+			c->live_end = c->begin;
+			c->live_bytes = 0;
+			for (size_t i = c->begin; i < end; i++) {
+				block_header* b = m_blocks[i];
+				if (is_marked(b)) {
+					// Ham.
+					b->mark.store(false, std::memory_order_relaxed);
+					c->live_bytes += b->sz;
+					m_blocks[c->live_end++] = b;
+				} else {
+					// Spam.
+					b->dead = true;
+					c->dead.push_back(b);
+				}
+			}
+		}
+
+		// Pointers & containers, as in singlethreaded_marksweep.
+
+		void clearing_pointer(void* address_of_gc_ptr) {
+			assert(address_of_gc_ptr);
+			ptr_iterator it = m_heap_ptrs.find(address_of_gc_ptr);
+			if (it != m_heap_ptrs.end()) {
+				m_heap_ptrs.erase(it);
+			} else {
+				it = m_roots.find(address_of_gc_ptr);
+				assert(it != m_roots.end());
+				m_roots.erase(it);
+			}
+		}
+
+		// Return true if p is inside a heap block.
+		bool inside_heap_block(void* p) {
+			heap_block_iterator it(m_heap_blocks.upper_bound(p));
+			if (it != m_heap_blocks.begin()) {
+				--it;
+				return it->second->is_address_inside(p);
+			}
+			return false;
+		}
+
+		void initing_pointer(void* address_of_gc_ptr, gc_object_generic_base* object_pointed_to) {
+			assert(address_of_gc_ptr);
+			assert(object_pointed_to);
+			assert(m_roots.find(address_of_gc_ptr) == m_roots.end());
+			assert(m_heap_ptrs.find(address_of_gc_ptr) == m_heap_ptrs.end());
+
+			if (inside_heap_block(address_of_gc_ptr)) {
+				m_heap_ptrs.insert(std::make_pair(address_of_gc_ptr, object_pointed_to));
+			} else {
+				m_roots.insert(std::make_pair(address_of_gc_ptr, object_pointed_to));
+			}
+		}
+
+		void changing_pointer(void* address_of_gc_ptr, gc_object_generic_base* object_pointed_to) {
+			assert(address_of_gc_ptr);
+			ptr_iterator it = m_heap_ptrs.find(address_of_gc_ptr);
+			if (it != m_heap_ptrs.end()) {
+				it->second = object_pointed_to;
+			} else {
+				it = m_roots.find(address_of_gc_ptr);
+				assert(it != m_roots.end());
+				it->second = object_pointed_to;
+			}
+		}
+
+		void construct_container(parallel_marksweep::gc_container_base* c) {
+			if (inside_heap_block(c)) {
+				m_containers.insert(c);
+			} else {
+				m_root_containers.insert(c);
+			}
+		}
+
+		void destruct_container(parallel_marksweep::gc_container_base* c) {
+			container_iterator it = m_containers.find(c);
+			if (it != m_containers.end()) {
+				m_containers.erase(it);
+			} else {
+				it = m_root_containers.find(c);
+				assert(it != m_root_containers.end());
+				m_root_containers.erase(it);
+			}
+		}
+
+	} pm_state;
+
+	/*static*/ void parallel_marksweep::get_stats(parallel_marksweep::stats* s) {
+		pm_state.get_stats(s);
+	}
+
+	/*static*/ void parallel_marksweep::reset_pause_stats() {
+		pm_state.reset_pause_stats();
+	}
+
+	/*static*/ void parallel_marksweep::collect_garbage(parallel_marksweep::stats* s) {
+		pm_state.collect_garbage(s);
+	}
+
+	/*static*/ void parallel_marksweep::set_collection_rate(
+		int percent_growth_before_next_collection) {
+		pm_state.set_collection_rate(percent_growth_before_next_collection);
+	}
+
+	/*static*/ void parallel_marksweep::set_thread_count(int thread_count) {
+		pm_state.set_thread_count(thread_count);
+	}
+
+	/*static*/ int parallel_marksweep::get_thread_count() {
+		return pm_state.m_thread_count;
+	}
+
+	/*static*/ void* parallel_marksweep::allocate(size_t sz, block_construction_locker_base* lock) {
+		return pm_state.allocate(sz, lock);
+	}
+
+	/*static*/ void parallel_marksweep::deallocate(void* p) {
+		pm_state.deallocate(p);
+	}
+
+	/*static*/ void parallel_marksweep::block_construction_finished(void* block) {
+		pm_state.block_construction_finished(block);
+	}
+
+	/*static*/ void parallel_marksweep::constructing_gc_object_base(gc_object_generic_base* obj) {
+		pm_state.constructing_gc_object_base(obj);
+	}
+
+	/*static*/ void parallel_marksweep::clearing_pointer(void* address_of_gc_ptr) {
+		pm_state.clearing_pointer(address_of_gc_ptr);
+	}
+
+	/*static*/ void parallel_marksweep::initing_pointer(void* address_of_gc_ptr, gc_object_generic_base* object_pointed_to) {
+		pm_state.initing_pointer(address_of_gc_ptr, object_pointed_to);
+	}
+
+	/*static*/ void parallel_marksweep::changing_pointer(void* address_of_gc_ptr, gc_object_generic_base* object_pointed_to) {
+		pm_state.changing_pointer(address_of_gc_ptr, object_pointed_to);
+	}
+
+	/*static*/ void parallel_marksweep::construct_container(gc_container_base* c) {
+		pm_state.construct_container(c);
+	}
+
+	/*static*/ void parallel_marksweep::destruct_container(gc_container_base* c) {
+		pm_state.destruct_container(c);
+	}
+
+	/*static*/ void parallel_marksweep::visit_contained_ptr(const gc_object_generic_base* obj) {
+		pm_state.visit_contained_ptr(obj);
+	}
+
+}  // tu_gc
+
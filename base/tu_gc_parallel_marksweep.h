@@ -0,0 +1,213 @@
+// tu_gc_parallel_marksweep.h
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// A mark/sweep garbage collector that does its collections on
+// several threads, for use with tu_gc::gc_ptr<>.  It is a drop-in
+// replacement for singlethreaded_marksweep:
+//
+//   DECLARE_GC_TYPES(tu_gc::parallel_marksweep);
+//
+// Only the collections are parallel.  Like singlethreaded_marksweep,
+// the gc_ptr's and the allocations must be used by one thread at a
+// time; the collector threads run while that thread is inside
+// collect_garbage() or an allocation that triggers a collection.
+//
+// Marking: each collector thread marks from its own deque of blocks
+// and steals from the others when it runs out, so a big data
+// structure reached from a single root is still shared by all the
+// threads.  The mark bits are in a header in front of each block.
+//
+// Sweeping: the threads split the heap and find the dead blocks.
+// After an automatic collection, the dead blocks are destroyed
+// lazily, a few at each allocation, so most of the destructors run
+// outside of the pause.  Those that remain are run at the start of
+// the next collection.
+//
+// See GCBench.cpp -threads for pause times and throughput with
+// various thread counts.
+
+
+#ifndef TU_GC_PARALLEL_MARKSWEEP_H
+#define TU_GC_PARALLEL_MARKSWEEP_H
+
+#include "base/tu_gc.h"
+
+namespace tu_gc {
+
+	struct parallel_marksweep_state;
+
+	class parallel_marksweep {
+	public:
+		typedef parallel_marksweep this_class;
+
+		// Gives the collector the object's block, so marking
+		// doesn't have to search for it.
+		class gc_object_collector_base : public tu_gc::gc_object_generic_base {
+		public:
+			gc_object_collector_base() : m_gc_block(0) {
+			}
+		private:
+			friend struct parallel_marksweep_state;
+			void* m_gc_block;
+		};
+
+		// Client interfaces.
+		struct stats {
+			size_t live_heap_bytes;
+			size_t garbage_bytes;
+			size_t root_pointers;
+			size_t live_pointers;
+			size_t root_containers;
+
+			// Since reset_pause_stats().
+			size_t collections;
+			double total_pause_ms;
+			double max_pause_ms;
+		};
+		// Gets basic stats.  garbage_bytes is the size of the
+		// dead blocks that have not been destroyed yet;
+		// live_heap_bytes also includes the garbage made since
+		// the last collection.
+		static void get_stats(stats* s);
+		static void reset_pause_stats();
+
+		// Collects all garbage.  Unlike the collections
+		// triggered by the allocations, it destroys the dead
+		// blocks before returning.
+		//
+		// If s is not NULL, fills it with interesting
+		// statistics.
+		static void collect_garbage(stats* s);
+
+		// Same as singlethreaded_marksweep::set_collection_rate().
+		static void set_collection_rate(int percent_growth_before_next_collection);
+
+		// Number of threads that do the collections, including
+		// the calling one.  The default is the number of
+		// processors.
+		static void set_thread_count(int thread_count);
+		static int get_thread_count();
+
+		// Semi-private interfaces.  See
+		// singlethreaded_marksweep.
+		static void block_construction_finished(void* block);
+		static void constructing_gc_object_base(gc_object_generic_base* obj);
+
+		template<class T>
+		static void construct_pointer(gc_ptr<T, this_class>* gc_ptr_p) {}
+
+		template<class T>
+		static void destruct_pointer(gc_ptr<T, this_class>* gc_ptr_p) {}
+
+		template<class T>
+		static void write_barrier(gc_ptr<T, this_class>* gc_ptr_p, T* new_val_p) {
+			assert(gc_ptr_p);
+			if (new_val_p == gc_ptr_p->get()) {
+				return;
+			}
+			if (gc_ptr_p->get()) {
+				if (!new_val_p) {
+					clearing_pointer(gc_ptr_p);
+				} else {
+					changing_pointer(gc_ptr_p, new_val_p);
+				}
+			} else if (new_val_p) {
+				initing_pointer(gc_ptr_p, new_val_p);
+			}
+			gc_ptr_p->raw_set_ptr_gc_access_only(new_val_p);
+		}
+
+		// Used by the smart ptr's move constructor and
+		// assignment.  The collector keeps the addresses of the
+		// pointers, so the reference is set at *to and cleared
+		// at *from, and array<> can't move them bitwise.
+		template<class T>
+		static void move_pointer(gc_ptr<T, this_class>* to, gc_ptr<T, this_class>* from) {
+			if (to != from) {
+				write_barrier(to, from->get());
+				write_barrier(from, (T*) 0);
+			}
+		}
+		enum { RELOCATABLE_POINTERS = false };
+
+		// Containers
+
+		template<class T>
+		static void contained_pointer_write_barrier(contained_gc_ptr<T, this_class>* gc_ptr_p, T* new_val_p) {
+			gc_ptr_p->raw_set_ptr_gc_access_only(new_val_p);
+		}
+
+		template<class T>
+		static void construct_contained_pointer(contained_gc_ptr<T, this_class>* gc_ptr_p) {}
+		template<class T>
+		static void destruct_contained_pointer(contained_gc_ptr<T, this_class>* gc_ptr_p) {}
+
+		class gc_container_base {
+		    public:
+			gc_container_base() {
+				construct_container(this);
+			}
+			virtual ~gc_container_base() {
+				destruct_container(this);
+			}
+
+			// Called by the collector threads, concurrently
+			// for different containers.
+			virtual void visit_contained_ptrs() = 0;
+		};
+
+		template<class container_type>
+		class gc_container : public gc_container_base, public container_type {
+		public:
+			virtual void visit_contained_ptrs() {
+				for (typename container_type::const_iterator it = this->begin();
+				     it != this->end();
+				     ++it) {
+					visit_contained_ptr(it->get());
+				}
+			}
+		};
+
+		template<class container_type>
+		class gc_pair_container : public gc_container_base, public container_type {
+		public:
+			virtual void visit_contained_ptrs() {
+				for (typename container_type::const_iterator it = this->begin();
+				     it != this->end();
+				     ++it) {
+					visit_contained_value(it->first);
+					visit_contained_value(it->second);
+				}
+			}
+		};
+
+	private:
+		friend class gc_object_base<parallel_marksweep>;
+
+		static void* allocate(size_t sz, block_construction_locker_base* lock);
+		static void deallocate(void* p);
+
+		static void clearing_pointer(void* address_of_gc_ptr);
+		static void initing_pointer(void* address_of_gc_ptr, gc_object_generic_base* object_pointed_to);
+		static void changing_pointer(void* address_of_gc_ptr, gc_object_generic_base* object_pointed_to);
+
+		static void construct_container(gc_container_base* c);
+		static void destruct_container(gc_container_base* c);
+
+		// Pushes obj on the deque of the calling collector
+		// thread.
+		static void visit_contained_ptr(const gc_object_generic_base* obj);
+
+		template<class T>
+		static void visit_contained_value(T val) {
+		}
+		template<typename T>
+		static void visit_contained_value(const contained_gc_ptr<T, this_class>& val) {
+			visit_contained_ptr(val.get());
+		}
+	};
+}  // tu_gc
+
+#endif  // TU_GC_PARALLEL_MARKSWEEP_H
@@ -132,6 +132,19 @@ namespace tu_gc {
 			gc_ptr_p->raw_set_ptr_gc_access_only(new_val_p);
 		}
 
+		// Used by the smart ptr's move constructor and
+		// assignment.  The collector keeps the addresses of the
+		// pointers, so the reference is set at *to and cleared
+		// at *from, and array<> can't move them bitwise.
+		template<class T>
+		static void move_pointer(gc_ptr<T, this_class>* to, gc_ptr<T, this_class>* from) {
+			if (to != from) {
+				write_barrier(to, from->get());
+				write_barrier(from, (T*) 0);
+			}
+		}
+		enum { RELOCATABLE_POINTERS = false };
+
 		// Containers
 		
 		template<class T>
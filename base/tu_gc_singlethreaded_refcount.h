@@ -125,6 +125,24 @@ namespace tu_gc {
 			gc_ptr_p->raw_set_ptr_gc_access_only(new_val_p);
 		}
 
+		// Used by the smart ptr's move constructor and
+		// assignment: *from's reference becomes *to's, the
+		// count doesn't change.  Only the values count, so
+		// array<> can also move the pointers bitwise.
+		template<class T>
+		static void move_pointer(gc_ptr<T, this_class>* to, gc_ptr<T, this_class>* from) {
+			if (to == from) {
+				return;
+			}
+			T* old_val_p = to->get();
+			to->raw_set_ptr_gc_access_only(from->get());
+			from->raw_set_ptr_gc_access_only(0);
+			if (old_val_p) {
+				decrement_ref(old_val_p);
+			}
+		}
+		enum { RELOCATABLE_POINTERS = true };
+
 		template<class T>
 		static void contained_pointer_write_barrier(contained_gc_ptr<T, this_class>* gc_ptr_p, T* new_val_p) {
 			// TODO de-dupe; this is same as write_barrier()
@@ -5,13 +5,14 @@
 
 // Some test code for garbage collectors.
 //
-// cl -Zi -GX -GR tu_gc_test.cpp tu_gc_singlethreaded_marksweep.cpp container.cpp utf8.cpp -I.. -DTEST_GC
+// cl -Zi -GX -GR tu_gc_test.cpp tu_gc_singlethreaded_marksweep.cpp tu_gc_parallel_marksweep.cpp tu_timer.cpp container.cpp utf8.cpp -I.. -DTEST_GC
 
 
 #ifdef TEST_GC
 
 #include "base/tu_gc_singlethreaded_marksweep.h"
 #include "base/tu_gc_singlethreaded_refcount.h"
+#include "base/tu_gc_parallel_marksweep.h"
 #include <map>
 #include <stdio.h>
 #include <set>
@@ -24,6 +25,12 @@ namespace test_ms {
 #undef GC_COLLECTOR
 }  // test_ms
 
+namespace test_pm {
+#define GC_COLLECTOR tu_gc::parallel_marksweep
+#include "base/tu_gc_test_impl.h"
+#undef GC_COLLECTOR
+}  // test_pm
+
 namespace test_rc {
 #define GC_COLLECTOR tu_gc::singlethreaded_refcount
 #include "base/tu_gc_test_impl.h"
@@ -34,6 +41,9 @@ int main() {
 	printf("\nmark-sweep:\n\n");
 	test_ms::run_tests();
 
+	printf("\nparallel mark-sweep:\n\n");
+	test_pm::run_tests();
+
 	printf("\nref-counting:\n\n");
 	test_rc::run_tests();
 
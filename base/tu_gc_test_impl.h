@@ -303,6 +303,41 @@ void test_weak_ptr() {
 	}
 }
 
+void test_move() {
+	printf("\nmove\n");
+
+	gc_ptr<cons> a = new cons(1, NULL);
+	gc_ptr<cons> b(std::move(a));
+	assert(a == NULL);
+	assert(b->value == 1);
+	a = std::move(b);
+	assert(b == NULL);
+	assert(a->value == 1);
+	a = std::move(a);
+	assert(a->value == 1);
+
+	// Growing, inserting and removing move the pointers, bitwise
+	// or not depending on the collector.
+	{
+		array<gc_ptr<cons> > list;
+		for (int i = 0; i < 100; i++) {
+			list.push_back(new cons(i, NULL));
+		}
+		list.insert(0, std::move(a));
+		assert(a == NULL);
+		list.remove(50);
+		assert(list.size() == 100);
+		gc_collector::collect_garbage(NULL);
+		assert(list[0]->value == 1);
+		assert(list[1]->value == 0);
+		assert(list[99]->value == 99);
+		a = std::move(list[0]);
+	}
+	gc_collector::collect_garbage(NULL);
+	assert(a->value == 1);
+	collect_and_dump_stats();
+}
+
 void run_tests() {
 	test_basic_stuff();
 	test_multiple_inheritance();
@@ -313,4 +348,5 @@ void run_tests() {
 	test_gc_map_container2<pairbag3>();
 	test_gc_map_container_root();
 	test_weak_ptr();
+	test_move();
 }
@@ -65,5 +65,108 @@ namespace tu_memdebug
 
 #endif
 
+// Allocation counts, to see what a frame allocates:
+//
+//	tu_memdebug::begin_frame();
+//	... advance the movie ...
+//	tu_memdebug::alloc_counts	frame;
+//	tu_memdebug::end_frame(&frame);
+//
+// The counts stay at zero unless everything is built with
+// TU_MEMDEBUG_COUNT_ALLOCS defined to 1, see tu_config.h.  They are
+// not exact while other threads allocate.
+
+#include <stdlib.h>
+#include <new>
+
+namespace tu_memdebug
+{
+	struct alloc_counts
+	{
+		int	m_allocs;	// tu_malloc() and new
+		int	m_reallocs;
+		int	m_frees;	// tu_free() and delete
+		size_t	m_bytes;	// asked by the allocs and reallocs
+	};
+
+	static alloc_counts	s_counts;
+	static alloc_counts	s_frame_start;
+
+	void get_counts(alloc_counts* counts)
+	{
+		*counts = s_counts;
+	}
+
+	void begin_frame()
+	{
+		s_frame_start = s_counts;
+	}
+
+	// Gives what was allocated since begin_frame().
+	void end_frame(alloc_counts* frame)
+	{
+		frame->m_allocs = s_counts.m_allocs - s_frame_start.m_allocs;
+		frame->m_reallocs = s_counts.m_reallocs - s_frame_start.m_reallocs;
+		frame->m_frees = s_counts.m_frees - s_frame_start.m_frees;
+		frame->m_bytes = s_counts.m_bytes - s_frame_start.m_bytes;
+	}
+}
+
+#if TU_MEMDEBUG_COUNT_ALLOCS
+
+#ifdef USE_DL_MALLOC
+#error TU_MEMDEBUG_COUNT_ALLOCS replaces new and delete, it cannot be used with USE_DL_MALLOC
+#endif
+
+void*	tu_memdebug_malloc(size_t size)
+{
+	tu_memdebug::s_counts.m_allocs++;
+	tu_memdebug::s_counts.m_bytes += size;
+	return malloc(size);
+}
+
+void*	tu_memdebug_realloc(void* old_ptr, size_t new_size, size_t old_size)
+{
+	tu_memdebug::s_counts.m_reallocs++;
+	tu_memdebug::s_counts.m_bytes += new_size;
+	return realloc(old_ptr, new_size);
+}
+
+void	tu_memdebug_free(void* old_ptr, size_t old_size)
+{
+	if (old_ptr)
+	{
+		tu_memdebug::s_counts.m_frees++;
+	}
+	free(old_ptr);
+}
+
+void*	operator new(size_t size)
+{
+	void*	p = tu_memdebug_malloc(size > 0 ? size : 1);
+	if (p == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void	operator delete(void* ptr) throw()
+{
+	tu_memdebug_free(ptr, 0);
+}
+
+void*	operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void	operator delete[](void* ptr) throw()
+{
+	tu_memdebug_free(ptr, 0);
+}
+
+#endif	// TU_MEMDEBUG_COUNT_ALLOCS
+
 #endif	// TU_MEMDEBUG_H
 
@@ -70,6 +70,7 @@ namespace gameswf
 	struct as_s_function;
 	struct as_object;
 	struct movie_definition;
+	struct memory_stats;
 
 	//
 	// Log & error reporting control.
@@ -85,6 +86,52 @@ namespace gameswf
 	exported_module void	set_verbose_action(bool verbose);
 	exported_module void	set_verbose_parse(bool verbose);
 
+	// Control the JIT compiler.  Only builds with
+	// __GAMESWF_ENABLE_JIT__ have one.  A function (or a frame's
+	// actions) is compiled after it has been called threshold
+	// times.  Turning the JIT off makes the player interpret
+	// everything again; compiled code is kept.
+	exported_module bool get_use_jit();
+	exported_module void	set_use_jit(bool use_jit);
+	exported_module int get_jit_threshold();
+	exported_module void	set_jit_threshold(int calls);
+
+	// Control the ActionScript (AVM1) optimizer, off by default.
+	// When it's on, the actions of a frame or a function are
+	// optimized the first time they run (constants folded, runs of
+	// actions fused...), see gameswf_action_optimizer.cpp.  The
+	// flag is read only then: actions that already ran keep the
+	// program they were given, optimized or not.  What was done to
+	// the actions of a movie is counted in
+	// movie_def_impl::m_optimizer_stats.
+	exported_module bool get_optimize_actions();
+	exported_module void	set_optimize_actions(bool optimize);
+
+	// Memory budget, in bytes, of the data that is built again
+	// when it's needed: the meshes of the shapes and the glyph
+	// bitmaps of the device fonts.  Over it, the least recently
+	// used are dropped at the end of root::display().  0, the
+	// default, means no budget.  See gameswf_memory.h.
+	exported_module int	get_memory_budget();
+	exported_module void	set_memory_budget(int bytes);
+
+	// ActionScript profiler.  While it's on, the time spent in
+	// frame scripts, event handlers and functions is booked under
+	// the call stack it ran in: movie, sprite path, then the
+	// frame number, event or function (with its offset in the
+	// action buffer).  Turning it on starts a new profile.
+	//
+	// write_profile() writes the stacks in the "collapsed" format
+	// read by flamegraph.pl (one "a;b;c microseconds" line per
+	// stack).  write_profile_summary() writes a line per frame
+	// with the time spent in ActionScript and the slowest script
+	// of the frame (frames over the movie's frame time are
+	// marked), then the self time and call count of every stack.
+	exported_module void	set_profiling(bool profiling);
+	exported_module bool	get_profiling();
+	exported_module bool	write_profile(const char* filename);
+	exported_module bool	write_profile_summary(const char* filename);
+
 	// Get and set the render handler.  This is one of the first
 	// things you should do to initialise the player (assuming you
 	// want to display anything).
@@ -164,6 +211,7 @@ namespace gameswf
 		AS_MOVIE_DEF_SUB,
 		AS_CHARACTER_DEF,
 		AS_SPRITE_DEF,
+		AS_SHAPE_DEF,
 		AS_VIDEO_DEF,
 		AS_SOUND_SAMPLE,
 		AS_VIDEO_INST,
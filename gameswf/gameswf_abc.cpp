@@ -9,6 +9,8 @@
 #include "gameswf/gameswf_stream.h"
 #include "gameswf/gameswf_log.h"
 #include "gameswf/gameswf_movie_def.h"
+#include "gameswf/gameswf_action.h"
+#include "base/tu_file.h"
 
 namespace gameswf
 {
@@ -18,6 +20,65 @@ namespace gameswf
 		assert(0&&"todo");
 	}
 
+	void traits_index::build(const gc_array<gc_ptr<traits_info> >& traits, const abc_def* abc)
+	{
+		for (int i = 0; i < traits.size(); i++)
+		{
+			const traits_info* ti = traits[i].get();
+
+			// A getter and a setter may share their name.
+			tu_stringi name = abc->get_multiname(ti->m_name);
+			if (m_name.get(name, NULL) == false)
+			{
+				m_name.add(name, i);
+			}
+
+			int slot_id = 0;
+			switch (ti->m_kind)
+			{
+				case traits_info::Trait_Slot:
+				case traits_info::Trait_Const:
+					slot_id = ti->trait_slot.m_slot_id;
+					break;
+				case traits_info::Trait_Class:
+					slot_id = ti->trait_class.m_slot_id;
+					break;
+				case traits_info::Trait_Function:
+					slot_id = ti->trait_function.m_slot_id;
+					break;
+				default:
+					break;
+			}
+
+			// Zero lets the AVM2 pick the slot, the code can't
+			// refer to it by id then.
+			if (slot_id > 0)
+			{
+				m_slot.set(slot_id, i);
+			}
+		}
+	}
+
+	int traits_index::find(const tu_stringi& name) const
+	{
+		int index;
+		if (m_name.get(name, &index))
+		{
+			return index;
+		}
+		return -1;
+	}
+
+	int traits_index::find_slot(int slot_id) const
+	{
+		int index;
+		if (m_slot.get(slot_id, &index))
+		{
+			return index;
+		}
+		return -1;
+	}
+
 	//	traits_info
 	//	{
 	//		u30 name
@@ -99,6 +160,39 @@ namespace gameswf
 		}
 	}
 
+	void traits_info::skip(stream* in)
+	// Same layout as read().
+	{
+		in->read_vu30();	// name
+		Uint8 b = in->read_u8();
+		switch (b & 0x0F)
+		{
+			case Trait_Slot :
+			case Trait_Const :
+				in->read_vu30();	// slot_id
+				in->read_vu30();	// type_name
+				if (in->read_vu30() != 0)	// vindex
+				{
+					in->read_u8();	// vkind
+				}
+				break;
+
+			default:
+				in->read_vu30();	// slot_id or disp_id
+				in->read_vu30();	// classi, function or method
+				break;
+		}
+
+		if ((b >> 4) & ATTR_Metadata)
+		{
+			int n = in->read_vu30();
+			for (int i = 0; i < n; i++)
+			{
+				in->read_vu30();
+			}
+		}
+	}
+
 	//	instance_info
 	//		{
 	//		u30 name
@@ -145,6 +239,7 @@ namespace gameswf
 			trait->read(in, abc);
 			m_trait[i] = trait;
 		}
+		m_traits.build(m_trait, abc);
 	}
 
 	void class_info::read(stream* in, abc_def* abc)
@@ -162,6 +257,7 @@ namespace gameswf
 			trait->read(in, abc);
 			m_trait[i] = trait;
 		}
+		m_traits.build(m_trait, abc);
 	}
 
 	void script_info::read(stream* in, abc_def* abc)
@@ -197,7 +293,8 @@ namespace gameswf
 		m_var_name = in->read_vu30();
 	}
 
-	abc_def::abc_def(player* player)
+	abc_def::abc_def(player* player) :
+		m_multinames_resolved(false)
 	{
 	}
 
@@ -300,19 +397,49 @@ namespace gameswf
 			script_info* info = new script_info();
 			info->read(in, this);
 			m_script[i] = info;
+
+			for (int j = 0; j < info->m_trait.size(); j++)
+			{
+				const traits_info* ti = info->m_trait[j].get();
+				tu_string name = get_multiname(ti->m_name);
+				if (ti->m_kind == traits_info::Trait_Class && m_script_class.get(name, NULL) == false)
+				{
+					m_script_class.add(name, i);
+				}
+			}
 		}
 
 		assert(in->get_position() < eof);
 
-		// read body_info
-		n = in->read_vu30();
+		// read body_info.  Most methods of a big movie never run,
+		// the bodies are only found here and kept as they are.
+		// as_3_function::read_body() decodes one when its method
+		// is first called.
+		int size = eof - in->get_position();
+		m_body_data.resize(size);
+		in->get_underlying_stream()->read_bytes(m_body_data.data(), size);
+
+		bool decode_now = false;
+		IF_VERBOSE_PARSE(decode_now = true);	// for the disassembly
+
+		tu_file body_file(tu_file::memory_buffer, size, m_body_data.data());
+		stream body_in(&body_file);
+		n = body_in.read_vu30();
 		for (i = 0; i < n; i++)
 		{
-			int method_index = in->read_vu30();
-			m_method[method_index]->read_body(in);
+			int method_index = body_in.read_vu30();
+			as_3_function* func = m_method[method_index].get();
+			func->m_body_pos = body_in.get_position();
+			as_3_function::skip_body(&body_in);
+			func->m_body_size = body_in.get_position() - func->m_body_pos;
+			if (decode_now)
+			{
+				func->read_body();
+			}
 		}
 
-		assert(in->get_position() == eof);
+		assert(body_in.get_position() == size);
+		IF_VERBOSE_PARSE(log_msg("body_info count: %d, %d bytes\n", n, size));
 
 	}
 
@@ -541,6 +668,46 @@ namespace gameswf
 
 	}
 
+	void abc_def::resolve_multinames(atom_table* atoms)
+	// Intern the names of the multinames, so the interpreter can look
+	// them up without building strings.  It's done before the first
+	// method runs rather than by read(), the atom table isn't ours
+	// to use from the loader thread.
+	{
+		if (m_multinames_resolved)
+		{
+			return;
+		}
+		m_multinames_resolved = true;
+
+		for (int i = 1; i < m_multiname.size(); i++)
+		{
+			multiname& mn = m_multiname[i];
+			if (mn.m_name >= 0)
+			{
+				mn.m_atom = atoms->intern(get_multiname(i));
+			}
+		}
+	}
+
+	void	abc_def::get_body_stats(abc_body_stats* stats) const
+	{
+		for (int i = 0; i < m_method.size(); i++)
+		{
+			const as_3_function* func = m_method[i].get();
+			if (func->m_body_size > 0)
+			{
+				stats->m_bodies++;
+				stats->m_bytes += func->m_body_size;
+				if (func->m_body_pos < 0)
+				{
+					stats->m_decoded++;
+					stats->m_decoded_bytes += func->m_body_size;
+				}
+			}
+		}
+	}
+
 	const char * abc_def::get_class_from_constructor( int method )
 	{
 		for( int instance_index = 0; instance_index < m_instance.size(); ++instance_index )
@@ -632,16 +799,10 @@ namespace gameswf
 			return m_method[ m_script.back()->m_init ].get();
 		else
 		{
-			for( int script_index = 0; script_index < m_script.size(); ++script_index )
+			int script_index;
+			if( m_script_class.get( name, &script_index ) )
 			{
-				const script_info & info = *m_script[ script_index ].get();
-				for( int trait_index = 0; trait_index < info.m_trait.size(); ++trait_index )
-				{
-					if( m_string[ m_multiname[info.m_trait[ trait_index ]->m_name].m_name ] == name && info.m_trait[ trait_index ]->m_kind == traits_info::Trait_Class )
-					{
-						return m_method[ info.m_init ].get();
-					}
-				}
+				return m_method[ m_script[ script_index ]->m_init ].get();
 			}
 		}
 
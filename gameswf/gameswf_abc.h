@@ -18,6 +18,7 @@ namespace gameswf
 	struct abc_def;
 	struct as_function;
 	struct movie_definition_sub;
+	struct atom_table;
 
 	struct multiname
 	{
@@ -41,12 +42,14 @@ namespace gameswf
 		int m_ns;
 		int m_ns_set;
 		int m_name;
+		int m_atom;	// m_name interned in the player's atom_table, -1 for runtime names
 
 		multiname() :
 			m_kind(CONSTANT_UNDEFINED),
 			m_flags(0),
 			m_ns(0),
-			m_name(0)
+			m_name(0),
+			m_atom(-1)
 		{
 		}
 
@@ -86,6 +89,21 @@ namespace gameswf
 		void	read(stream* in, abc_def* abc);
 	};
 
+	// Finds the traits of an instance or a class by name, or by
+	// the slot id they declare.
+	struct traits_index
+	{
+		void	build(const gc_array<gc_ptr<traits_info> >& traits, const abc_def* abc);
+
+		// Return the index of the first such trait, or -1.
+		int	find(const tu_stringi& name) const;
+		int	find_slot(int slot_id) const;
+
+	private:
+		stringi_hash<int>	m_name;
+		hash<int, int>	m_slot;
+	};
+
 
 	//
 	// instance_info
@@ -108,6 +126,7 @@ namespace gameswf
 		array<int> m_interface;
 		int m_iinit;
 		gc_array<gc_ptr<traits_info> > m_trait;
+		traits_index m_traits;
 		weak_ptr<abc_def> m_abc;
 
 		instance_info() :
@@ -127,6 +146,7 @@ namespace gameswf
 		weak_ptr<abc_def> m_abc;
 		int m_cinit;
 		gc_array<gc_ptr<traits_info> > m_trait;
+		traits_index m_traits;
 
 		void	read(stream* in, abc_def* abc);
 	};
@@ -139,6 +159,25 @@ namespace gameswf
 		void	read(stream* in, abc_def* abc);
 	};
 
+	// How much of the method bodies of an abc_def have been
+	// decoded.  They are left raw at load and decoded when their
+	// method first runs.
+	struct abc_body_stats
+	{
+		abc_body_stats() :
+			m_bodies(0),
+			m_bytes(0),
+			m_decoded(0),
+			m_decoded_bytes(0)
+		{
+		}
+
+		int	m_bodies;
+		int	m_bytes;
+		int	m_decoded;
+		int	m_decoded_bytes;
+	};
+
 	struct abc_def : public ref_counted
 	{
 		// constant pool
@@ -157,6 +196,16 @@ namespace gameswf
 		gc_array<gc_ptr<class_info> > m_class;
 		gc_array<gc_ptr<script_info> > m_script;
 
+		// class name --> index in m_script of the script that
+		// defines it
+		string_hash<int> m_script_class;
+
+		bool m_multinames_resolved;
+
+		// The method_body_info of all the methods as they are in
+		// the tag, see as_3_function::read_body().
+		membuf m_body_data;
+
 		inline const char* get_string(int index) const
 		{
 			return m_string[index].c_str(); 
@@ -167,6 +216,11 @@ namespace gameswf
 			return m_integer[index]; 
 		}
 
+		inline Uint32 get_uinteger(int index) const
+		{
+			return m_uinteger[index]; 
+		}
+
 		inline double get_double(int index) const
 		{
 			return m_double[index]; 
@@ -182,6 +236,16 @@ namespace gameswf
 			return get_string(m_multiname[index].m_name); 
 		}
 
+		inline const tu_string& get_multiname_string(int index) const
+		{
+			return m_string[m_multiname[index].m_name];
+		}
+
+		inline int get_multiname_atom(int index) const
+		{
+			return m_multiname[index].m_atom;
+		}
+
 		inline multiname::kind get_multiname_type(int index) const
 		{
 			return (multiname::kind)m_multiname[index].m_kind; 
@@ -216,6 +280,8 @@ namespace gameswf
 
 		void	read(stream* in, movie_definition_sub* m);
 		void	read_cpool(stream* in);
+		void	resolve_multinames(atom_table* atoms);
+		void	get_body_stats(abc_body_stats* stats) const;
 
 		inline const char * get_super_class(tu_string& name) const
 		{
@@ -16,6 +16,7 @@
 #include "gameswf/gameswf_freetype.h"
 #include "gameswf/gameswf_player.h"
 #include "gameswf/gameswf_disasm.h"
+#include "gameswf/gameswf_script_budget.h"
 #include "base/tu_random.h"
 #include "base/tu_timer.h"
 #include "base/tu_loadlib.h"
@@ -337,6 +338,613 @@ namespace gameswf
 		m->add_init_action(sprite_character_id, da);
 	}
 
+	//
+	// action_program
+	//
+
+	static void	intern_string(atom_table* atoms, as_value* val)
+	// Give a string constant its atom.  Long strings are text
+	// rather than identifiers, so don't bloat the table with them.
+	{
+		assert(val->is_string());
+		if (atoms && val->to_tu_string().size() < 64)
+		{
+			val->set_atom(atoms->intern(val->to_tu_string()));
+		}
+	}
+
+	action_program::~action_program()
+	{
+		clear();
+	}
+
+	void	action_program::clear()
+	{
+		m_instructions.resize(0);
+		m_index.resize(0);
+		m_push_items.resize(0);
+		m_functions.resize(0);
+		m_optimized.clear();
+
+		for (int i = 0; i < m_member_caches.size(); i++)
+		{
+			delete m_member_caches[i];
+		}
+		m_member_caches.resize(0);
+
+#ifdef __GAMESWF_ENABLE_JIT__
+		for (hash<int, action_jit_region*>::iterator it = m_jit_regions.begin();
+			it != m_jit_regions.end(); ++it)
+		{
+			delete it->second;
+		}
+		m_jit_regions.clear();
+#endif
+	}
+
+	int	action_program::new_member_cache()
+	{
+		m_member_caches.push_back(new as_member_cache());
+		return m_member_caches.size() - 1;
+	}
+
+	int	action_program::get_index(const membuf& buffer, int pc, atom_table* atoms)
+	{
+		// action_buffer::read() may have appended more actions
+		// since we were built; start over in that case.
+		if (m_index.size() != buffer.size())
+		{
+			clear();
+			m_index.resize(buffer.size());
+			for (int i = 0; i < m_index.size(); i++)
+			{
+				m_index[i] = -1;
+			}
+		}
+
+		assert(pc >= 0 && pc < m_index.size());
+		if (m_index[pc] == -1)
+		{
+			decode_run(buffer, pc, atoms);
+		}
+		return m_index[pc];
+	}
+
+	void	action_program::decode_run(const membuf& buffer, int pc, atom_table* atoms)
+	// Decode actions starting at pc until we hit the end of the
+	// buffer, an end action, or an action that's already decoded.
+	{
+		int	size = buffer.size();
+		while (pc < size && m_index[pc] == -1)
+		{
+			int	index = m_instructions.size();
+			m_instructions.resize(index + 1);
+			action_instruction&	ins = m_instructions[index];
+			m_index[pc] = index;
+
+			int	action_id = buffer[pc];
+			ins.m_action_id = (Uint8) action_id;
+			ins.m_count = 0;
+			ins.m_pc = pc;
+			ins.m_next_pc = pc + 1;
+			ins.m_arg = 0;
+
+			if (action_id == 0x1C	// get variable
+				|| action_id == 0x4E	// get member
+				|| action_id == 0x4F)	// set member
+			{
+				ins.m_arg = new_member_cache();
+			}
+			else if (action_id & 0x80)
+			{
+				int	length = pc + 2 < size ? buffer[pc + 1] | (buffer[pc + 2] << 8) : size;
+				ins.m_next_pc = pc + length + 3;
+				if (ins.m_next_pc > size)
+				{
+					log_error("error: action 0x%02X at %d runs past the end of the action buffer\n",
+						action_id, pc);
+					ins.m_action_id = 0;
+					ins.m_next_pc = size;
+					break;
+				}
+
+				switch (action_id)
+				{
+				default:
+					break;
+
+				case 0x81:	// goto frame
+				case 0x94:	// with
+					ins.m_arg = buffer[pc + 3] | (buffer[pc + 4] << 8);
+					break;
+
+				case 0x87:	// store_register
+				case 0x9A:	// get url2
+				case 0x9F:	// goto frame expression
+					ins.m_arg = buffer[pc + 3];
+					break;
+
+				case 0x96:	// push_data
+					decode_push(buffer, &ins, atoms);
+					break;
+
+				case 0x99:	// branch always
+				case 0x9D:	// branch if true
+				{
+					Sint16	offset = buffer[pc + 3] | (buffer[pc + 4] << 8);
+					ins.m_arg = ins.m_next_pc + offset;
+					break;
+				}
+
+				case 0x8E:	// function2
+					decode_function(buffer, &ins, true);
+					break;
+
+				case 0x9B:	// declare function
+					decode_function(buffer, &ins, false);
+					break;
+				}
+			}
+
+			if (action_id == 0)
+			{
+				break;
+			}
+			pc = ins.m_next_pc;
+		}
+	}
+
+	void	action_program::decode_push(const membuf& buffer, action_instruction* ins, atom_table* atoms)
+	{
+		ins->m_arg = m_push_items.size();
+
+		int	i = ins->m_pc + 3;
+		while (i < ins->m_next_pc)
+		{
+			m_push_items.resize(m_push_items.size() + 1);
+			action_push_item&	item = m_push_items.back();
+			item.m_type = action_push_item::PUSH_VALUE;
+			item.m_index = 0;
+
+			int	type = buffer[i];
+			i++;
+			if (type == 0)
+			{
+				// string
+				const char*	str = (const char*) &buffer[i];
+				i += int(strlen(str)) + 1;
+				item.m_value.set_string(str);
+				intern_string(atoms, &item.m_value);
+			}
+			else if (type == 1)
+			{
+				// float (little-endian)
+				union {
+					float	f;
+					Uint32	i;
+				} u;
+				compiler_assert(sizeof(u) == sizeof(u.i));
+
+				memcpy(&u.i, &buffer[i], 4);
+				u.i = swap_le32(u.i);
+				i += 4;
+
+				item.m_value.set_double(u.f);
+			}
+			else if (type == 2)
+			{
+				item.m_value.set_null();
+			}
+			else if (type == 3)
+			{
+				item.m_value.set_undefined();
+			}
+			else if (type == 4)
+			{
+				// contents of register
+				item.m_type = action_push_item::PUSH_REGISTER;
+				item.m_index = buffer[i];
+				i++;
+			}
+			else if (type == 5)
+			{
+				item.m_value.set_bool(buffer[i] ? true : false);
+				i++;
+			}
+			else if (type == 6)
+			{
+				// double
+				// wacky format: 45670123
+				union {
+					double	d;
+					Uint64	i;
+					struct {
+						Uint32	lo;
+						Uint32	hi;
+					} sub;
+				} u;
+				compiler_assert(sizeof(u) == sizeof(u.i));
+
+				memcpy(&u.sub.hi, &buffer[i], 4);
+				memcpy(&u.sub.lo, &buffer[i + 4], 4);
+				u.i = swap_le64(u.i);
+				i += 8;
+
+				item.m_value.set_double(u.d);
+			}
+			else if (type == 7)
+			{
+				// int32
+				Sint32	val = buffer[i]
+					| (buffer[i + 1] << 8)
+					| (buffer[i + 2] << 16)
+					| (buffer[i + 3] << 24);
+				i += 4;
+
+				item.m_value.set_int(val);
+			}
+			else if (type == 8)
+			{
+				item.m_type = action_push_item::PUSH_DICTIONARY;
+				item.m_index = buffer[i];
+				i++;
+			}
+			else if (type == 9)
+			{
+				item.m_type = action_push_item::PUSH_DICTIONARY;
+				item.m_index = buffer[i] | (buffer[i + 1] << 8);
+				i += 2;
+			}
+			else
+			{
+				// Unknown type; push nothing.
+				m_push_items.resize(m_push_items.size() - 1);
+			}
+		}
+
+		ins->m_count = (Uint16) (m_push_items.size() - ins->m_arg);
+	}
+
+	void	action_program::decode_function(const membuf& buffer, action_instruction* ins, bool is_function2)
+	{
+		ins->m_arg = m_functions.size();
+		m_functions.resize(m_functions.size() + 1);
+		action_function_def&	def = m_functions.back();
+
+		int	i = ins->m_pc + 3;
+
+		// Extract name.
+		// @@ security: watch out for possible missing terminator here!
+		def.m_name = (const char*) &buffer[i];
+		i += def.m_name.length() + 1;
+
+		// Get number of arguments.
+		int	nargs = buffer[i] | (buffer[i + 1] << 8);
+		i += 2;
+
+		def.m_is_function2 = is_function2;
+		def.m_local_register_count = 0;
+		def.m_function2_flags = 0;
+		def.m_local_slots_mapped = false;
+		if (is_function2)
+		{
+			// Get the count of local registers used by this function.
+			def.m_local_register_count = buffer[i];
+			i += 1;
+
+			// Flags, for controlling register assignment of implicit args.
+			def.m_function2_flags = buffer[i] | (buffer[i + 1] << 8);
+			i += 2;
+		}
+
+		// Get the register assignments and names of the arguments.
+		def.m_args.resize(nargs);
+		for (int n = 0; n < nargs; n++)
+		{
+			def.m_args[n].m_register = 0;
+			if (is_function2)
+			{
+				def.m_args[n].m_register = buffer[i];
+				i++;
+			}
+
+			// @@ security: watch out for possible missing terminator here!
+			def.m_args[n].m_name = (const char*) &buffer[i];
+			i += def.m_args[n].m_name.length() + 1;
+		}
+
+		// Get the length of the actual function code.
+		def.m_length = buffer[i] | (buffer[i + 1] << 8);
+	}
+
+	const array<local_slot>&	action_program::get_local_slots(const membuf& buffer, int def_index, int start_pc,
+		const array<as_value>& dictionary, atom_table* atoms)
+	{
+		if (m_functions[def_index].m_local_slots_mapped == false)
+		{
+			map_local_slots(buffer, def_index, start_pc, dictionary, atoms);
+		}
+		return m_functions[def_index].m_local_slots;
+	}
+
+	// An action of a function body that names a var.
+	struct local_slot_site
+	{
+		int	m_index;	// of the instruction
+		tu_string	m_name;
+	};
+
+	static tu_string	pop_name(array<tu_string>* stack)
+	{
+		tu_string	name;
+		if (stack->size() > 0)
+		{
+			name = stack->back();
+			stack->resize(stack->size() - 1);
+		}
+		return name;
+	}
+
+	static int	get_stack_effect(int action_id, int* pushes)
+	// Returns the number of values the action pops, -1 for the
+	// actions map_local_slots() doesn't follow (calls, branches...).
+	{
+		*pushes = 1;
+		switch (action_id)
+		{
+			case 0x0A: case 0x0B: case 0x0C: case 0x0D:	// arithmetic
+			case 0x0E: case 0x0F: case 0x10: case 0x11:	// comparisons, logical
+			case 0x13: case 0x21: case 0x29:	// string equal, concat, less
+			case 0x3F: case 0x47: case 0x48: case 0x49:	// modulo, add_t, less_t, equal_t
+			case 0x4E:	// get member
+			case 0x60: case 0x61: case 0x62: case 0x63: case 0x64:	// bitwise
+			case 0x65: case 0x66: case 0x67: case 0x68:
+				return 2;
+
+			case 0x12: case 0x14: case 0x18:	// not, string length, int
+			case 0x44: case 0x4A: case 0x4B:	// typeof, to number, to string
+			case 0x50: case 0x51:	// increment, decrement
+				return 1;
+
+			case 0x17:	// pop
+				*pushes = 0;
+				return 1;
+
+			case 0x4F:	// set member
+				*pushes = 0;
+				return 3;
+
+			case 0x87:	// store register
+				*pushes = 0;
+				return 0;
+		}
+		return -1;
+	}
+
+	void	action_program::map_local_slots(const membuf& buffer, int def_index, int start_pc,
+		const array<as_value>& dictionary, atom_table* atoms)
+	// The args and the vars a function declares are found by name
+	// in the topmost frame, so as long as they're in the frame
+	// the result of the lookup only depends on the name.  Here
+	// each of them gets its slot, and the actions of the body
+	// which name them with a constant get that slot; the
+	// interpreter checks that the name is the expected one and
+	// that there's no "with" block before using it, anything
+	// else (eval, computed names) is looked up by name.
+	{
+		m_functions[def_index].m_local_slots_mapped = true;
+		if (atoms == NULL)
+		{
+			return;
+		}
+
+		// Follow the constant names pushed through straight runs
+		// of actions.  Nested function bodies are skipped, they
+		// are mapped on their own.
+		array<local_slot_site>	sites;
+		string_hash<bool>	declared;
+		array<tu_string>	stack;
+		int	stop_pc = imin(start_pc + m_functions[def_index].m_length, buffer.size());
+		int	pc = start_pc;
+		while (pc < stop_pc)
+		{
+			int	index = get_index(buffer, pc, atoms);
+			const action_instruction	ins = m_instructions[index];
+			pc = ins.m_next_pc;
+
+			local_slot_site	site;
+			site.m_index = index;
+			switch (ins.m_action_id)
+			{
+				case 0x00:	// end of actions
+					pc = stop_pc;
+					break;
+
+				case 0x96:	// push_data
+					for (int i = 0; i < ins.m_count; i++)
+					{
+						const action_push_item&	item = m_push_items[ins.m_arg + i];
+						tu_string	name;
+						if (item.m_type == action_push_item::PUSH_VALUE && item.m_value.is_string())
+						{
+							name = item.m_value.to_tu_string();
+						}
+						else if (item.m_type == action_push_item::PUSH_DICTIONARY
+							&& item.m_index < dictionary.size() && dictionary[item.m_index].is_string())
+						{
+							name = dictionary[item.m_index].to_tu_string();
+						}
+						stack.push_back(name);
+					}
+					break;
+
+				case 0x1C:	// get variable
+					site.m_name = pop_name(&stack);
+					sites.push_back(site);
+					stack.push_back(tu_string());
+					break;
+
+				case 0x1D:	// set variable
+				case 0x3C:	// set local
+					pop_name(&stack);
+					site.m_name = pop_name(&stack);
+					sites.push_back(site);
+					if (ins.m_action_id == 0x3C && site.m_name.length() > 0)
+					{
+						declared.set(site.m_name, true);
+					}
+					break;
+
+				case 0x41:	// declare local
+					site.m_name = pop_name(&stack);
+					sites.push_back(site);
+					if (site.m_name.length() > 0)
+					{
+						declared.set(site.m_name, true);
+					}
+					break;
+
+				case 0x4C:	// dup
+				{
+					tu_string	top = stack.size() > 0 ? stack.back() : tu_string();
+					stack.push_back(top);
+					break;
+				}
+
+				case 0x4D:	// swap
+					if (stack.size() >= 2)
+					{
+						tu_string	top = stack[stack.size() - 1];
+						stack[stack.size() - 1] = stack[stack.size() - 2];
+						stack[stack.size() - 2] = top;
+					}
+					else
+					{
+						stack.resize(0);
+					}
+					break;
+
+				case 0x8E:	// function2
+				case 0x9B:	// declare function
+					pc += m_functions[ins.m_arg].m_length;
+					stack.resize(0);
+					break;
+
+				default:
+				{
+					int	pushes;
+					int	pops = get_stack_effect(ins.m_action_id, &pushes);
+					if (pops < 0)
+					{
+						stack.resize(0);
+						break;
+					}
+					for (int i = 0; i < pops; i++)
+					{
+						pop_name(&stack);
+					}
+					for (int i = 0; i < pushes; i++)
+					{
+						stack.push_back(tu_string());
+					}
+					break;
+				}
+			}
+		}
+
+		// The names as_s_function::operator() puts in the frame.
+		// Those added twice (an arg named like another one or
+		// like an implicit arg) are left to the lookup by name.
+		const action_function_def&	def = m_functions[def_index];
+		array<tu_string>	candidates;
+		string_hash<int>	added;
+		for (int i = 0; i < def.m_args.size(); i++)
+		{
+			if (def.m_args[i].m_register == 0)
+			{
+				candidates.push_back(def.m_args[i].m_name);
+			}
+		}
+		if (def.m_is_function2)
+		{
+			if ((def.m_function2_flags & 0x02) == 0)
+			{
+				candidates.push_back("this");
+			}
+			if ((def.m_function2_flags & 0x08) == 0)
+			{
+				candidates.push_back("arguments");
+			}
+			if ((def.m_function2_flags & 0x20) == 0)
+			{
+				candidates.push_back("super");
+			}
+		}
+		else
+		{
+			candidates.push_back("super");
+		}
+		for (int i = 0; i < candidates.size(); i++)
+		{
+			int	count = 0;
+			added.get(candidates[i], &count);
+			added.set(candidates[i], count + 1);
+		}
+
+		// 'this' is set, not added, by a conventional function.
+		if (def.m_is_function2 == false)
+		{
+			candidates.push_back("this");
+		}
+		for (string_hash<bool>::iterator it = declared.begin(); it != declared.end(); ++it)
+		{
+			candidates.push_back(it->first);
+		}
+
+		// Only the names the body uses get a slot.
+		string_hash<bool>	used;
+		for (int i = 0; i < sites.size(); i++)
+		{
+			if (sites[i].m_name.length() > 0)
+			{
+				used.set(sites[i].m_name, true);
+			}
+		}
+
+		array<local_slot>	slots;
+		string_hash<int>	slot_index;
+		for (int i = 0; i < candidates.size() && slots.size() < 0xFFFF; i++)
+		{
+			const tu_string&	name = candidates[i];
+			int	count = 0;
+			tu_string	path, var;
+			if (name.length() == 0 || name.size() >= 64
+				|| used.get(name, NULL) == false
+				|| slot_index.get(name, NULL)
+				|| (added.get(name, &count) && count > 1)
+				|| as_environment::parse_path(name, &path, &var))
+			{
+				continue;
+			}
+
+			slot_index.set(name, slots.size());
+			slots.resize(slots.size() + 1);
+			slots.back().m_name = name;
+			slots.back().m_atom = atoms->intern(name);
+		}
+
+		for (int i = 0; i < sites.size(); i++)
+		{
+			int	slot;
+			if (slot_index.get(sites[i].m_name, &slot))
+			{
+				m_instructions[sites[i].m_index].m_count = (Uint16) (slot + 1);
+			}
+		}
+
+		m_functions[def_index].m_local_slots = slots;
+	}
+
 	//
 	// action_buffer
 	//
@@ -385,7 +993,7 @@ namespace gameswf
 	}
 
 
-	void	action_buffer::process_decl_dict(int start_pc, int stop_pc)
+	void	action_buffer::process_decl_dict(int start_pc, int stop_pc, atom_table* atoms)
 	// Interpret the decl_dict opcode.  Don't read stop_pc or
 	// later.  A dictionary is some static strings embedded in the
 	// action buffer; there should only be one dictionary per
@@ -449,7 +1057,7 @@ namespace gameswf
 		for (int ct = 0; ct < count; ct++)
 		{
 			// Point into the current action buffer.
-			m_dictionary[ct] = (const char*) &buffer[3 + i];
+			m_dictionary[ct].set_string((const char*) &buffer[3 + i]);
 
 			while (buffer[3 + i])
 			{
@@ -461,7 +1069,7 @@ namespace gameswf
 					// Jam something into the remaining (invalid) entries.
 					while (ct < count)
 					{
-						m_dictionary[ct] = "<invalid>";
+						m_dictionary[ct].set_string("<invalid>");
 						ct++;
 					}
 					return;
@@ -469,6 +1077,7 @@ namespace gameswf
 				i++;
 			}
 			i++;
+			intern_string(atoms, &m_dictionary[ct]);
 		}
 	}
 
@@ -554,33 +1163,209 @@ namespace gameswf
 		m_decl_dict_processed_at = ab.m_decl_dict_processed_at;
 	}
 
+	void	action_buffer::define_function(as_environment* env, const action_instruction& ins,
+		const array<with_stack_entry>& with_stack, bool is_function2) const
+	// Interpret a define_function or define_function2 action whose
+	// header has been decoded into the action_program.
+	{
+		action_program&	program = m_buffer->m_program;
+		int	def_index = ins.m_arg;
+		int	start_pc = ins.m_next_pc;
+
+		// Copy the name, get_member() may run getters which can
+		// grow the program.
+		tu_string	name = program.m_functions[def_index].m_name;
+
+		if (name.length() > 0)
+		{
+			as_value value;
+			env->get_member(name, &value);
+			as_s_function* existing_function = cast_to<as_s_function>(value.to_object());
+
+			if (existing_function)
+			{
+				if (existing_function->m_action_buffer.m_buffer == m_buffer
+					&& existing_function->m_start_pc == start_pc )
+				{ 
+					return;
+				}
+			}
+		}
+
+		// Decodes the body the first time.
+		program.get_local_slots(*m_buffer, def_index, start_pc, m_dictionary,
+			env->get_player() ? env->get_player()->get_atoms() : NULL);
+
+		const action_function_def&	def = program.m_functions[def_index];
+
+		as_s_function*	func = new as_s_function(env->get_player(), this, start_pc, with_stack);
+		func->set_target(env->get_target());
+		func->m_name = name;
+		if (is_function2)
+		{
+			func->set_is_function2();
+			func->set_local_register_count(def.m_local_register_count);
+			func->set_function2_flags(def.m_function2_flags);
+		}
+
+		for (int n = 0; n < def.m_args.size(); n++)
+		{
+			func->add_arg(def.m_args[n].m_register, def.m_args[n].m_name);
+		}
+		func->set_length(def.m_length);
+		func->set_local_slots(def.m_local_slots);
+
+		// ActionDefineFunction can be used in the following ways:
+		// Usage #1. Pushes an anonymous function on the stack that does not persist.
+		// Usage #2. Sets a variable with a given FunctionName and a given function definition.
+		// Thanks to Julien Hamaide
+		as_value	function_value(func);
+		if (name.length() > 0)
+		{
+			// @@ NOTE: should this be m_target->set_variable()???
+			// Usage #2. If we have a name, then save the function in this
+			// environment under that name.
+			env->set_member(name, function_value);
+		}
+		else
+		{
+			// Usage #1. Leave it on the stack
+			env->push(function_value);
+		}
+	}
+
+	void	action_buffer::push_data(as_environment* env, const action_instruction& ins, bool is_function2) const
+	// Push the values of a decoded push_data action.
+	{
+		const action_program&	program = m_buffer->m_program;
+		for (int k = ins.m_arg, end = ins.m_arg + ins.m_count; k < end; k++)
+		{
+			const action_push_item&	item = program.m_push_items[k];
+			if (item.m_type == action_push_item::PUSH_VALUE)
+			{
+				env->push(item.m_value);
+
+				IF_VERBOSE_ACTION(log_msg("-------------- pushed '%s'\n", item.m_value.to_string()));
+			}
+			else if (item.m_type == action_push_item::PUSH_REGISTER)
+			{
+				// contents of register
+				int	reg = item.m_index;
+				if (is_function2)
+				{
+					env->push(*env->get_register(reg));
+					IF_VERBOSE_ACTION(
+						log_msg("-------------- pushed local register[%d] = '%s'\n",
+							reg,
+							env->top(0).to_string()));
+				}
+				else if (reg < 0 || reg >= 4)
+				{
+					env->push(as_value());
+					log_error("push register[%d] -- register out of bounds!\n", reg);
+				}
+				else
+				{
+					env->push(env->m_global_register[reg]);
+					IF_VERBOSE_ACTION(
+						log_msg("-------------- pushed global register[%d], '%s', 0x%p\n",
+							reg,
+							env->top(0).to_string(),
+							env->top(0).to_object()));
+				}
+			}
+			else
+			{
+				int	id = item.m_index;
+				if (id < m_dictionary.size())
+				{
+					env->push(m_dictionary[id]);
+
+					IF_VERBOSE_ACTION(log_msg("-------------- pushed '%s'\n", m_dictionary[id].to_string()));
+				}
+				else
+				{
+					log_error("error: dict_lookup(%d) is out of bounds!\n", id);
+					env->push(0);
+					IF_VERBOSE_ACTION(log_msg("-------------- pushed 0\n"));
+				}
+			}
+		}
+	}
+
+	static array<with_stack_entry>&	writable_with_stack(const array<with_stack_entry>** with_stack, array<with_stack_entry>* own)
+	// Makes *with_stack our own copy the first time it changes.
+	{
+		if (*with_stack != own)
+		{
+			*own = **with_stack;
+			*with_stack = own;
+		}
+		return *own;
+	}
+
 	void	action_buffer::execute(
 		as_environment* env,
 		int start_pc,
 		int exec_bytes,
 		as_value* retval,
 		const array<with_stack_entry>& initial_with_stack,
-		bool is_function2) const
+		bool is_function2,
+		int local_slots) const
 	// Interpret the specified subset of the actions in our
 	// buffer.  Caller is responsible for cleaning up our local
 	// stack frame (it may have passed its arguments in via the
 	// local stack frame).
 	// 
 	// The is_function2 flag determines whether to use global or local registers.
+	//
+	// local_slots is where the fixed local slots of the function
+	// being run start in env's local frames (see
+	// as_environment::add_local_slots()), -1 if we're not
+	// running a function body.
 	{
 		// for debugging action script
 		// keep the latest var name(to log it if call_method failure)
 		tu_string last_varname;
 
 		assert(env);
-		array<with_stack_entry>	with_stack(initial_with_stack);
+		// The "with" blocks: the caller's, copied only if one starts or
+		// ends here.
+		const array<with_stack_entry>*	with_stack = &initial_with_stack;
+		array<with_stack_entry>	own_with_stack;
 	
 		character*	original_target = env->get_target();
 		membuf & buffer = *m_buffer.get_ptr();
+		action_program&	program = m_buffer->m_program;
+		atom_table*	atoms = env->get_player() ? env->get_player()->get_atoms() : NULL;
 
 		int stop_pc = start_pc + exec_bytes;
 		bool found_error = false;
 		tu_string error_detail;
+		script_budget_counter	budget;
+
+		// Optimize the actions the first time they run, and make
+		// room on the stack for them.  Like the JIT, the optimizer
+		// isn't used while actions are logged.
+		if (get_optimize_actions() && get_verbose_action() == false)
+		{
+			int	stack_depth = program.optimize(buffer, start_pc, stop_pc, atoms, original_target);
+			if (stack_depth > 0)
+			{
+				env->reserve(stack_depth);
+			}
+		}
+
+#ifdef __GAMESWF_ENABLE_JIT__
+		// Compiled code, if this part of the buffer is hot.
+		action_jit_region*	jit = NULL;
+		if (get_use_jit() && get_verbose_action() == false)
+		{
+			jit = program.get_jit_region(buffer, start_pc, stop_pc, is_function2, atoms);
+		}
+		action_jit_context	jit_context = { env, &program, &m_dictionary, with_stack, &last_varname, is_function2, local_slots, &budget };
+		int	jit_exit_pc = -1;	// the interpreter executes the action the code returned at
+#endif
 
 // Error out if there are fewer than n elements on the stack.
 #define CHECK_STACK(n)							\
@@ -593,12 +1378,19 @@ namespace gameswf
 
 		for (int pc = start_pc; pc < stop_pc && !found_error; )
 		{
+			if (budget.tick())
+			{
+				// Over the script budget, it has been logged.
+				break;
+			}
+
 			// Cleanup any expired "with" blocks.
-			while (with_stack.size() > 0
-				   && pc >= with_stack.back().m_block_end_pc)
+			while (with_stack->size() > 0
+				   && pc >= with_stack->back().m_block_end_pc)
 			{
 				// Drop this stack element
-				with_stack.resize(with_stack.size() - 1);
+				array<with_stack_entry>&	writable = writable_with_stack(&with_stack, &own_with_stack);
+				writable.resize(writable.size() - 1);
 			}
 			
 #if ACTION_BUFFER_PROFILING
@@ -606,8 +1398,48 @@ namespace gameswf
 			start_time = tu_timer::get_profile_ticks();
 #endif
 
-			// Get the opcode.
-			int	action_id = buffer[pc];
+			if (pc >= buffer.size())
+			{
+				log_error("error: pc %d is past the end of the action buffer\n", pc);
+				break;
+			}
+
+#ifdef __GAMESWF_ENABLE_JIT__
+			// The compiled code doesn't know "with" blocks.
+			if (jit && with_stack->size() == 0 && pc != jit_exit_pc && jit->has_entry(pc))
+			{
+				jit_context.m_with_stack = with_stack;
+				pc = jit_exit_pc = jit->run(pc, &jit_context);
+				continue;
+			}
+#endif
+
+			// Get the decoded action.  Take a copy, the program
+			// may grow while we execute it (nested calls decode
+			// more actions on demand).
+			int	index = program.get_index(buffer, pc, atoms);
+			if (program.m_instructions[index].m_action_id == ACTION_PUSH_THEN)
+			{
+				// Push, then go on with the next action without
+				// another trip through the loop.  It counts for
+				// the budget all the same.
+				push_data(env, program.m_instructions[index], is_function2);
+				pc = program.m_instructions[index].m_next_pc;
+				if (pc >= stop_pc || pc >= buffer.size()
+					|| (with_stack->size() > 0 && pc >= with_stack->back().m_block_end_pc))
+				{
+					// The loop ends the run or the "with"
+					// block, or logs the error.
+					continue;
+				}
+				if (budget.tick())
+				{
+					break;
+				}
+				index = program.get_index(buffer, pc, atoms);
+			}
+			const action_instruction	ins = program.m_instructions[index];
+			int	action_id = ins.m_action_id;
 			if ((action_id & 0x80) == 0)
 			{
 				IF_VERBOSE_ACTION(log_msg("EX:\t"); log_disasm(&buffer[pc]));
@@ -765,12 +1597,24 @@ namespace gameswf
 				}
 				case 0x1C:	// get variable
 				{
+					if (ins.m_count > 0 && with_stack->size() == 0)
+					{
+						last_varname = env->top(0).to_tu_string();
+						if (env->get_local_slot(local_slots, ins.m_count - 1, &env->top(0)))
+						{
+							IF_VERBOSE_ACTION(log_msg("-------------- get local: %s=%s\n",
+								last_varname.c_str(), env->top(0).to_string()));
+							break;
+						}
+					}
+
 					const tu_string var_string = env->top(0).to_tu_string();
 					
 					// keep the latest var name(to log it if call_method failure)
 					last_varname = var_string;
 
-					as_value variable = env->get_variable(var_string, with_stack);
+					as_value variable = env->get_variable(var_string, *with_stack,
+						program.m_member_caches[ins.m_arg], env->top(0).get_atom());
 					env->top(0) = variable;
 
 					if (variable.to_object() == NULL) 
@@ -789,7 +1633,16 @@ namespace gameswf
 				}
 				case 0x1D:	// set variable
 				{
-					env->set_variable(env->top(1).to_tu_string(), env->top(0), with_stack);
+					if (ins.m_count > 0 && with_stack->size() == 0
+						&& env->set_variable_slot(local_slots, ins.m_count - 1, env->top(1), env->top(0)))
+					{
+						IF_VERBOSE_ACTION(log_msg("-------------- set local: %s \n",
+							env->top(1).to_tu_string().c_str()));
+						env->drop(2);
+						break;
+					}
+
+					env->set_variable(env->top(1).to_tu_string(), env->top(0), *with_stack);
 					IF_VERBOSE_ACTION(log_msg("-------------- set var: %s \n",
 								  env->top(1).to_tu_string().c_str()));
 
@@ -807,10 +1660,8 @@ namespace gameswf
 				}
 				case 0x21:	// string concat
 				{
-					tu_string str = env->top(1).to_tu_string();
-					str += env->top(0).to_tu_string();
+					env->top(1).concat(env->top(0));
 					env->drop(1);
-					env->top(0).set_tu_string(str);
 					break;
 				}
 				case 0x22:	// get property
@@ -850,7 +1701,7 @@ namespace gameswf
 					// try string
 					if (target == NULL)
 					{
-						as_value val = env->get_variable(env->top(2).to_string(), with_stack);
+						as_value val = env->get_variable(env->top(2).to_string(), *with_stack);
 						target = cast_to<character>(val.to_object());
 					}
 
@@ -1052,7 +1903,7 @@ namespace gameswf
 				case 0x3B:	// delete2
 				{
 					tu_string varname(env->top(0).to_tu_string());
-					as_value obj(env->get_variable_raw(varname, with_stack));
+					as_value obj(env->get_variable_raw(varname, *with_stack));
 
 					if (obj.is_undefined() == false)
 					{
@@ -1090,7 +1941,11 @@ namespace gameswf
 
 				case 0x3C:	// set local
 				{
-					env->set_local(env->top(1).to_tu_string(), env->top(0));
+					if (ins.m_count == 0
+						|| env->set_local_slot(local_slots, ins.m_count - 1, env->top(1), env->top(0)) == false)
+					{
+						env->set_local(env->top(1).to_tu_string(), env->top(0));
+					}
 					env->drop(2);
 					break;
 				}
@@ -1102,7 +1957,7 @@ namespace gameswf
 					{
 						// Function is a string; lookup the function.
 						const tu_string&	function_name = env->top(0).to_tu_string();
-						function = env->get_variable(function_name, with_stack);
+						function = env->get_variable(function_name, *with_stack);
 
 						// super constructor, Flash 6 
 						if (function.is_object())
@@ -1165,7 +2020,7 @@ namespace gameswf
 					IF_VERBOSE_ACTION(log_msg("-------------- new object: %s\n",
 								  classname.to_tu_string().c_str()));
 					int	nargs = env->pop().to_int();
-					as_value constructor = env->get_variable(classname.to_tu_string(), with_stack);
+					as_value constructor = env->get_variable(classname.to_tu_string(), *with_stack);
 					as_value new_obj;
 
 					if (as_c_function* c_constructor = cast_to<as_c_function>(constructor.to_object()))
@@ -1224,8 +2079,12 @@ namespace gameswf
 				}
 				case 0x41:	// declare local
 				{
-					const tu_string&	varname = env->top(0).to_tu_string();
-					env->declare_local(varname);
+					if (ins.m_count == 0
+						|| env->declare_local_slot(local_slots, ins.m_count - 1, env->top(0)) == false)
+					{
+						const tu_string&	varname = env->top(0).to_tu_string();
+						env->declare_local(varname);
+					}
 					env->drop(1);
 					break;
 				}
@@ -1239,11 +2098,11 @@ namespace gameswf
 				}
 				case 0x43:	// declare object
 				{
-				// Pops elems off of the stack. Pops [value1, name1, , valueN, nameN] off the stack.
+				// Pops elems off of the stack. Pops [value1, name1, �, valueN, nameN] off the stack.
 				// It does the following:
 				// 1 Pops the number of initial properties from the stack.
 				// 2 Initializes the object as a ScriptObject.
-				// 3 Sets the object type to Object.
+				// 3 Sets the object type to �Object�.
 				// 4 Pops each initial property off the stack. For each initial property, the value of the property is
 				// popped off the stack, then the name of the property is popped off the stack. The name of the
 				// property is converted to a string. The value may be of any type.				{
@@ -1277,7 +2136,7 @@ namespace gameswf
 				}
 				case 0x46:	// enumerate
 				{
-					as_value variable = env->get_variable(env->top(0).to_tu_string(), with_stack);
+					as_value variable = env->get_variable(env->top(0).to_tu_string(), *with_stack);
 					enumerate(env, variable.to_object());
 					env->drop(1);
 					break;
@@ -1286,9 +2145,7 @@ namespace gameswf
 				{
 					if (env->top(0).is_string() || env->top(1).is_string())
 					{
-						tu_string str = env->top(1).to_string();
-						str += env->top(0).to_string();
-						env->top(1).set_tu_string(str);
+						env->top(1).concat(env->top(0));
 					}
 					else
 					{
@@ -1368,7 +2225,9 @@ namespace gameswf
 						last_varname = env->top(0).to_tu_string();
 
 						env->top(1).set_undefined();
-						if (obj->get_member(env->top(0).to_tu_string(), &(env->top(1))) == false)
+						as_member_cache*	cache = program.m_member_caches[ins.m_arg];
+						if (cache->get_member(obj.get_ptr(), env->top(0).to_tu_string(),
+							env->top(0).get_atom(), &(env->top(1))) == false)
 						{
 							// try '__resolve' property
 							as_value val;
@@ -1407,7 +2266,8 @@ namespace gameswf
 					as_object*	obj = env->top(2).to_object();
 					if (obj)
 					{
-						obj->set_member(env->top(1).to_tu_string(), env->top(0));
+						program.m_member_caches[ins.m_arg]->set_member(obj, env->top(1).to_tu_string(),
+							env->top(1).get_atom(), env->top(0));
 						IF_VERBOSE_ACTION(
 							log_msg("-------------- set_member [%p].%s=%s\n",
 //								env->top(2).to_tu_string().c_str(),
@@ -1537,9 +2397,9 @@ namespace gameswf
 				// 4 Executes the method call.
 				// 5 Pushes the newly constructed object to the stack. 
 				// Note, if there is no appropriate return value (i.e: the function does not have
-				// a return statement), a push undefined is generated by the
+				// a �return� statement), a �push undefined� is generated by the
 				// compiler and is pushed to the stack. 
-				// The undefined return value should be popped off the stack.
+				// The �undefined� return value should be popped off the stack.
 
 					as_value	constructor = env->pop();
 					as_object*	obj = env->pop().to_object();
@@ -1703,15 +2563,14 @@ namespace gameswf
 					break;
 
 				}
-				pc++;	// advance to next action.
+				pc = ins.m_next_pc;	// advance to next action.
 			}
 			else
 			{
 				IF_VERBOSE_ACTION(log_msg("EX:\t"); log_disasm(&buffer[pc]));
 
 				// Action containing extra data.
-				int	length = buffer[pc + 1] | (buffer[pc + 2] << 8);
-				int	next_pc = pc + length + 3;
+				int	next_pc = ins.m_next_pc;
 
 				switch (action_id)
 				{
@@ -1720,7 +2579,7 @@ namespace gameswf
 
 				case 0x81:	// goto frame
 				{
-					int	frame = buffer[pc + 3] | (buffer[pc + 4] << 8);
+					int	frame = ins.m_arg;
 					// 0-based already?
 					//// Convert from 1-based to 0-based
 					//frame--;
@@ -1765,7 +2624,7 @@ namespace gameswf
 				case 0x87:	// store_register
 				{
 					CHECK_STACK(1);
-					int	reg = buffer[pc + 3];
+					int	reg = ins.m_arg;
 					// Save top of stack in specified register.
 					if (is_function2)
 					{
@@ -1799,7 +2658,7 @@ namespace gameswf
 					//int	count = buffer[pc + 3] | (buffer[pc + 4] << 8);
 					i += 2;
 
-					const_cast<action_buffer*>( this )->process_decl_dict(pc, next_pc);
+					const_cast<action_buffer*>( this )->process_decl_dict(pc, next_pc, atoms);
 
 					break;
 				}
@@ -1845,300 +2704,34 @@ namespace gameswf
 
 				case 0x8E:	// function2
 				{
-					int	i = pc;
-					i += 3;
-
-					// Extract name.
-					// @@ security: watch out for possible missing terminator here!
-					tu_string	name = (const char*) &buffer[i];
-					i += name.length() + 1;
-
-					bool function_exists = false;
-
-					if (name.length() > 0)
-					{
-						as_value value;
-						env->get_member(name, &value);
-						as_s_function* existing_function = cast_to<as_s_function>(value.to_object());
-
-						if (existing_function)
-						{
-							if (existing_function->m_action_buffer.m_buffer == m_buffer
-								&& existing_function->m_start_pc == next_pc )
-							{ 
-								function_exists = true;
-							}
-						}
-					}
-
-					if (function_exists == false)
-					{
-						as_s_function*	func = new as_s_function(env->get_player(), this, next_pc, with_stack);
-						func->set_target(env->get_target());
-						func->set_is_function2();
-
-						// Get number of arguments.
-						int	nargs = buffer[i] | (buffer[i + 1] << 8);
-						i += 2;
+					define_function(env, ins, *with_stack, true);
 
-						// Get the count of local registers used by this function.
-						uint8	register_count = buffer[i];
-						i += 1;
-						func->set_local_register_count(register_count);
-
-						// Flags, for controlling register assignment of implicit args.
-						uint16	flags = buffer[i] | (buffer[i + 1] << 8);
-						i += 2;
-						func->set_function2_flags(flags);
-
-						// Get the register assignments and names of the arguments.
-						for (int n = 0; n < nargs; n++)
-						{
-							int	arg_register = buffer[i];
-							i++;
-
-							// @@ security: watch out for possible missing terminator here!
-							func->add_arg(arg_register, (const char*) &buffer[i]);
-							i += func->m_args.back().m_name.length() + 1;
-						}
-
-						// Get the length of the actual function code.
-						int	length = buffer[i] | (buffer[i + 1] << 8);
-						i += 2;
-						func->set_length(length);
-
-						// Skip the function body (don't interpret it now).
-						next_pc += length;
-
-						// If we have a name, then save the function in this
-						// environment under that name.
-						as_value	function_value(func);
-						if (name.length() > 0)
-						{
-							// @@ NOTE: should this be m_target->set_variable()???
-							env->set_member(name, function_value);
-						}
-						else
-						{
-							// Also leave it on the stack.
-							env->push(function_value);
-						}
-					}
-					else
-					{
-						int	nargs = buffer[i] | (buffer[i + 1] << 8);
-						i += 2;
-
-						// Get the count of local registers used by this function.
-						i += 1;
-
-						// Flags, for controlling register assignment of implicit args.
-						i += 2;
-
-						// Get the register assignments and names of the arguments.
-						for (int n = 0; n < nargs; n++)
-						{
-							i++;
-							// @@ security: watch out for possible missing terminator here!
-							i += (int) strlen((const char*) &buffer[i]) + 1;
-						}
-
-						// Skip the length of the actual function code.
-						int	length = buffer[i] | (buffer[i + 1] << 8);
-						i += 2;
-
-						// Skip the function body (don't interpret it now).
-						next_pc += length;
-					}
+					// Skip the function body (don't interpret it now).
+					next_pc += program.m_functions[ins.m_arg].m_length;
 					break;
 				}
 
 				case 0x94:	// with
 				{
 					CHECK_STACK(1);
-					IF_VERBOSE_ACTION(log_msg("-------------- with block start: stack size is %d\n", with_stack.size()));
-					if (with_stack.size() < 8) //todo, depends on flash version, could be 16
+					IF_VERBOSE_ACTION(log_msg("-------------- with block start: stack size is %d\n", with_stack->size()));
+					if (with_stack->size() < 8) //todo, depends on flash version, could be 16
 					{
- 						int	block_length = buffer[pc + 3] | (buffer[pc + 4] << 8);
- 						int	block_end = next_pc + block_length;
+ 						int	block_end = next_pc + ins.m_arg;
  						as_object*	with_obj = env->top(0).to_object();
- 						with_stack.push_back(with_stack_entry(with_obj, block_end));
+ 						writable_with_stack(&with_stack, &own_with_stack).push_back(with_stack_entry(with_obj, block_end));
 					}
 					env->drop(1);
 					break;
 				}
 				case 0x96:	// push_data
 				{
-					int i = pc;
-					while (i - pc < length)
-					{
-						int	type = buffer[3 + i];
-						i++;
-						if (type == 0)
-						{
-							// string
-							const char*	str = (const char*) &buffer[3 + i];
-							i += int(strlen(str)) + 1;
-							env->push(str);
-
-							IF_VERBOSE_ACTION(log_msg("-------------- pushed '%s'\n", str));
-						}
-						else if (type == 1)
-						{
-							// float (little-endian)
-							union {
-								float	f;
-								Uint32	i;
-							} u;
-							compiler_assert(sizeof(u) == sizeof(u.i));
-
-							memcpy(&u.i, &buffer[3 + i], 4);
-							u.i = swap_le32(u.i);
-							i += 4;
-
-							env->push(u.f);
-
-							IF_VERBOSE_ACTION(log_msg("-------------- pushed '%f'\n", u.f));
-						}
-						else if (type == 2)
-						{
-							as_value nullvalue;
-							nullvalue.set_null();
-							env->push(nullvalue);	
-
-							IF_VERBOSE_ACTION(log_msg("-------------- pushed NULL\n"));
-						}
-						else if (type == 3)
-						{
-							env->push(as_value());
-
-							IF_VERBOSE_ACTION(log_msg("-------------- pushed UNDEFINED\n"));
-						}
-						else if (type == 4)
-						{
-							// contents of register
-							int	reg = buffer[3 + i];
-							UNUSED(reg);
-							i++;
-							if (is_function2)
-							{
-								env->push(*env->get_register(reg));
-								IF_VERBOSE_ACTION(
-									log_msg("-------------- pushed local register[%d] = '%s'\n",
-										reg,
-										env->top(0).to_string()));
-							}
-							else if (reg < 0 || reg >= 4)
-							{
-								env->push(as_value());
-								log_error("push register[%d] -- register out of bounds!\n", reg);
-							}
-							else
-							{
-								env->push(env->m_global_register[reg]);
-								IF_VERBOSE_ACTION(
-									log_msg("-------------- pushed global register[%d], '%s', 0x%p\n",
-										reg,
-										env->top(0).to_string(),
-										env->top(0).to_object()));
-							}
-
-						}
-						else if (type == 5)
-						{
-							bool	bool_val = buffer[3 + i] ? true : false;
-							i++;
-//							log_msg("bool(%d)\n", bool_val);
-							env->push(bool_val);
-
-							IF_VERBOSE_ACTION(log_msg("-------------- pushed %s\n", bool_val ? "true" : "false"));
-						}
-						else if (type == 6)
-						{
-							// double
-							// wacky format: 45670123
-							union {
-								double	d;
-								Uint64	i;
-								struct {
-									Uint32	lo;
-									Uint32	hi;
-								} sub;
-							} u;
-							compiler_assert(sizeof(u) == sizeof(u.i));
-
-							memcpy(&u.sub.hi, &buffer[3 + i], 4);
-							memcpy(&u.sub.lo, &buffer[3 + i + 4], 4);
-							u.i = swap_le64(u.i);
-							i += 8;
-
-//							if (i == 9)	// spec case, NaN constant
-//							{
-//								env->push(get_nan());
-//							}
-//							else
-//							{
-							env->push(u.d);
-//							}
-
-							IF_VERBOSE_ACTION(log_msg("-------------- pushed double %f\n", u.d));
-						}
-						else if (type == 7)
-						{
-							// int32
-							Sint32	val = buffer[3 + i]
-								| (buffer[3 + i + 1] << 8)
-								| (buffer[3 + i + 2] << 16)
-								| (buffer[3 + i + 3] << 24);
-							i += 4;
-						
-							env->push(val);
-
-
-							IF_VERBOSE_ACTION(log_msg("-------------- pushed int32 %d\n", val));
-						}
-						else if (type == 8)
-						{
-							int	id = buffer[3 + i];
-							i++;
-							if (id < m_dictionary.size())
-							{
-								env->push(m_dictionary[id]);
-
-								IF_VERBOSE_ACTION(log_msg("-------------- pushed '%s'\n", m_dictionary[id].c_str()));
-							}
-							else
-							{
-								log_error("error: dict_lookup(%d) is out of bounds!\n", id);
-								env->push(0);
-								IF_VERBOSE_ACTION(log_msg("-------------- pushed 0\n"));
-							}
-						}
-						else if (type == 9)
-						{
-							int	id = buffer[3 + i] | (buffer[4 + i] << 8);
-							i += 2;
-							if (id < m_dictionary.size())
-							{
-								env->push(m_dictionary[id]);
-								IF_VERBOSE_ACTION(log_msg("-------------- pushed '%s'\n", m_dictionary[id].c_str()));
-							}
-							else
-							{
-								log_error("error: dict_lookup(%d) is out of bounds!\n", id);
-								env->push(0);
-
-								IF_VERBOSE_ACTION(log_msg("-------------- pushed 0"));
-							}
-						}
-					}
-					
+					push_data(env, ins, is_function2);
 					break;
 				}
 				case 0x99:	// branch always (goto)
 				{
-					Sint16	offset = buffer[pc + 3] | (buffer[pc + 4] << 8);
-					next_pc += offset;
+					next_pc = ins.m_arg;
 					// @@ TODO range checks
 					break;
 				}
@@ -2146,7 +2739,7 @@ namespace gameswf
 				case 0x9A:	// get url2
 				{
 					CHECK_STACK(2);
-					int	method = buffer[pc + 3];
+					int	method = ins.m_arg;
 					const char*	url = env->top(1).to_string();
 
 					// If the url starts with "FSCommand:", then this is
@@ -2171,109 +2764,45 @@ namespace gameswf
 
 				case 0x9B:	// declare function
 				{
-					int	i = pc;
-					i += 3;
+					define_function(env, ins, *with_stack, false);
 
-					// Extract name.
-					// @@ security: watch out for possible missing terminator here!
-					tu_string	name = (const char*) &buffer[i];
-					i += name.length() + 1;
-
-					bool function_exists = false;
-
-					if (name.length() > 0)
-					{
-						as_value value;
-						env->get_member(name, &value);
-						as_s_function* existing_function = cast_to<as_s_function>(value.to_object());
-
-						if (existing_function)
-						{
-							if (existing_function->m_action_buffer.m_buffer == m_buffer
-								&& existing_function->m_start_pc == next_pc )
-							{ 
-								function_exists = true;
-							}
-						}
-					}
+					// Skip the function body (don't interpret it now).
+					next_pc += program.m_functions[ins.m_arg].m_length;
+					break;
+				}
 
-					if (function_exists == false)
+				case 0x9D:	// branch if true
+				{
+					CHECK_STACK(1);
+					bool	test = env->top(0).to_bool();
+					env->drop(1);
+					if (test)
 					{
-						as_s_function*	func = new as_s_function(env->get_player(), this, next_pc, with_stack);
-						func->set_target(env->get_target());
-
-						// Get number of arguments.
-						int	nargs = buffer[i] | (buffer[i + 1] << 8);
-						i += 2;
-
-						// Get the names of the arguments.
-						for (int n = 0; n < nargs; n++)
-						{
-							// @@ security: watch out for possible missing terminator here!
-							func->add_arg(0, (const char*) &buffer[i]);
-							i += func->m_args.back().m_name.length() + 1;
-						}
-
-						// Get the length of the actual function code.
-						int	length = buffer[i] | (buffer[i + 1] << 8);
-						i += 2;
-						func->set_length(length);
-
-						// Skip the function body (don't interpret it now).
-						next_pc += length;
+						IF_VERBOSE_ACTION(log_msg("-------------- branch is done\n"));
+						next_pc = ins.m_arg;
 
-						// ActionDefineFunction can be used in the following ways:
-						// Usage #1. Pushes an anonymous function on the stack that does not persist.
-						// Usage #2. Sets a variable with a given FunctionName and a given function definition.
-						// Thanks to Julien Hamaide
-						as_value	function_value(func);
-						if (name.length() > 0)
-						{
-							// @@ NOTE: should this be m_target->set_variable()???
-							// Usage #1. If we have a name, then save the function in this
-							// environment under that name.
-							env->set_member(name, function_value);
-						}
-						else
+						if (next_pc > stop_pc)
 						{
-							// Usage #2. Leave it on the stack
-							env->push(function_value);
+							log_error("branch to offset %d -- this section only runs to %d\n",
+								  next_pc,
+								  stop_pc);
 						}
 					}
 					else
 					{
-						// Get number of arguments.
-						int	nargs = buffer[i] | (buffer[i + 1] << 8);
-						i += 2;
-
-						// Get the names of the arguments.
-						for (int n = 0; n < nargs; n++)
-						{
-							// @@ security: watch out for possible missing terminator here!
-							i += (int) strlen((const char*) &buffer[i]) + 1;
-						}
-
-						// Get the length of the actual function code.
-						int	length = buffer[i] | (buffer[i + 1] << 8);
-
-						// Skip the function body (don't interpret it now).
-						next_pc += length;
+						IF_VERBOSE_ACTION(log_msg("-------------- no branch\n"));
 					}
-
 					break;
 				}
 
-				case 0x9D:	// branch if true
+				case ACTION_BRANCH_IF_FALSE:	// not + branch if true
 				{
 					CHECK_STACK(1);
-					Sint16	offset = buffer[pc + 3] | (buffer[pc + 4] << 8);
-					
 					bool	test = env->top(0).to_bool();
 					env->drop(1);
-					if (test)
+					if (test == false)
 					{
-						IF_VERBOSE_ACTION(log_msg("-------------- branch is done\n"));
-						next_pc += offset;
+						next_pc = ins.m_arg;
 
 						if (next_pc > stop_pc)
 						{
@@ -2282,10 +2811,6 @@ namespace gameswf
 								  stop_pc);
 						}
 					}
-					else
-					{
-						IF_VERBOSE_ACTION(log_msg("-------------- no branch\n"));
-					}
 					break;
 				}
 				case 0x9E:	// call frame
@@ -2314,7 +2839,7 @@ namespace gameswf
 					// that frame is reached. Otherwise, the
 					// frame is shown in stop mode.
 
-					unsigned char	play_flag = buffer[pc + 3];
+					unsigned char	play_flag = (unsigned char) ins.m_arg;
 					character::play_state	state = play_flag ? character::PLAY : character::STOP;
 
 					character* target = env->get_target();
@@ -13,6 +13,7 @@
 #include "gameswf/gameswf_environment.h"
 #include "gameswf/gameswf_object.h"
 #include "gameswf/gameswf_types.h"
+#include "gameswf/gameswf_jit.h"
 #include "base/container.h"
 #include "base/membuf.h"
 #include <wchar.h>
@@ -26,6 +27,8 @@ namespace gameswf
 	struct as_environment;
 	struct as_c_function;
 	struct as_s_function;
+	struct atom_table;
+	struct script_budget_counter;
 
 	exported_module const char*	call_method_parsed(
 		as_environment* env,
@@ -152,9 +155,226 @@ namespace gameswf
 		const tu_string&	get_function_name() const;
 	};
 
+	// One operand of a push_data (0x96) action, decoded once.
+	struct action_push_item
+	{
+		enum push_type
+		{
+			PUSH_VALUE,		// constant, prebuilt in m_value
+			PUSH_REGISTER,		// register number in m_index
+			PUSH_DICTIONARY		// constant pool index in m_index
+		};
+
+		Uint8	m_type;
+		int	m_index;
+		as_value	m_value;
+	};
+
+	// Header of a define_function (0x9B) or define_function2 (0x8E)
+	// action, decoded once.  The body starts right after the header.
+	struct action_function_def
+	{
+		struct arg
+		{
+			int	m_register;
+			tu_string	m_name;
+		};
+
+		tu_string	m_name;
+		array<arg>	m_args;
+		bool	m_is_function2;
+		uint8	m_local_register_count;
+		uint16	m_function2_flags;
+		int	m_length;
+
+		// See action_program::get_local_slots().
+		bool	m_local_slots_mapped;
+		array<local_slot>	m_local_slots;
+	};
+
+	// A decoded action.  m_arg is opcode-specific:
+	//   branch & branch_if_true: absolute target pc
+	//   push_data: index of the first action_push_item (m_count items)
+	//   function, function2: index of the action_function_def
+	//   goto_frame, store_register, get_url2, goto_frame_exp, with:
+	//     the immediate operand
+	//   get_variable, get_member, set_member: index of the
+	//     as_member_cache of this site
+	// and m_count of get_variable, set_variable, set_local and
+	// declare_local in function bodies is 1 + the fixed local
+	// slot the name is expected to be in, 0 if none.
+	//
+	// The optimizer (see gameswf_action_optimizer.cpp) may give
+	// an action a made-up id, and an m_next_pc past actions it has
+	// folded into it.
+	struct action_instruction
+	{
+		Uint16	m_action_id;
+		Uint16	m_count;
+		int	m_pc;
+		int	m_next_pc;
+		int	m_arg;
+	};
+
+	// Actions made up by the optimizer.  They're out of the range
+	// of SWF action ids; the low byte is the action they stand for.
+	enum
+	{
+		// push_data, then the action at m_next_pc right away
+		// (push + get_variable, push + call_method...).
+		ACTION_PUSH_THEN = 0x100 | 0x96,
+
+		// logical not + branch if true
+		ACTION_BRANCH_IF_FALSE = 0x100 | 0x9D
+	};
+
+	// What the optimizer did to the actions of a movie.
+	struct action_optimizer_stats
+	{
+		action_optimizer_stats() :
+			m_regions(0),
+			m_skipped(0),
+			m_actions(0),
+			m_folded(0),
+			m_merged(0),
+			m_dropped(0),
+			m_fused(0),
+			m_branches(0),
+			m_dead_bytes(0),
+			m_max_stack_depth(0)
+		{
+		}
+
+		int	m_regions;	// frames and functions optimized
+		int	m_skipped;	// left alone because of "with" blocks
+		int	m_actions;	// reachable actions seen
+		int	m_folded;	// operations done on constants
+		int	m_merged;	// push_data merged into the one before
+		int	m_dropped;	// values pushed then popped
+		int	m_fused;	// ACTION_PUSH_THEN made
+		int	m_branches;	// branches shortened or made branch-if-false
+		int	m_dead_bytes;	// unreachable actions
+		int	m_max_stack_depth;	// of the deepest region whose depth is known
+	};
+
+#ifdef __GAMESWF_ENABLE_JIT__
+	struct action_program;
+
+	// What the jitted code of an action buffer works on, see
+	// gameswf_action_jit.cpp.
+	struct action_jit_context
+	{
+		as_environment*	m_env;
+		action_program*	m_program;
+		const array<as_value>*	m_dictionary;
+		const array<with_stack_entry>*	m_with_stack;
+		tu_string*	m_last_varname;
+		bool	m_is_function2;
+		int	m_local_slots;
+		script_budget_counter*	m_budget;
+	};
+
+	// The native code of the actions from m_start_pc to m_stop_pc
+	// (the body of a function, or the actions of a frame).  It's
+	// built once the region has been executed
+	// get_jit_threshold() times.  Actions that the compiler leaves
+	// to the interpreter make the code return their pc; the
+	// interpreter executes them and enters the code again at the
+	// next compiled action.
+	struct action_jit_region
+	{
+		action_jit_region(int start_pc, int stop_pc, bool is_function2);
+
+		// Returns where the interpreter continues.
+		int	run(int pc, action_jit_context* context)
+		{
+			return m_code.call_at(m_entry[pc - m_start_pc], context);
+		}
+
+		bool	has_entry(int pc) const
+		{
+			return pc >= m_start_pc && pc < m_stop_pc && m_entry[pc - m_start_pc] >= 0;
+		}
+
+		void	compile(action_program* program, const membuf& buffer, atom_table* atoms);
+
+		int	m_start_pc;
+		int	m_stop_pc;
+		bool	m_is_function2;
+		int	m_call_count;
+		array<int>	m_entry;	// pc - m_start_pc --> position in m_code, -1 if interpreted
+		jit_function	m_code;
+	};
+#endif
+
+	// The pre-decoded form of an action buffer.  Built lazily
+	// the first time the buffer is executed so that the
+	// interpreter doesn't have to re-parse operand bytes on every
+	// pass through a loop or every call of a function.
+	//
+	// Decoding is done in linear runs starting at whatever pc we
+	// are asked for, so a branch into the middle of another
+	// action (seen in some copy protection schemes, see
+	// process_decl_dict()) simply starts a new run.
+	struct action_program
+	{
+		~action_program();
+		void	clear();
+
+		// Returns the index of the instruction that starts at pc,
+		// decoding it (and the instructions that follow it) if
+		// needed.  String constants are interned in atoms.
+		int	get_index(const membuf& buffer, int pc, atom_table* atoms);
+
+		// Returns the fixed local slots of the function whose
+		// header is m_functions[def_index] and whose body starts
+		// at start_pc: its args and the locals its body declares.  The first call maps them
+		// and sets the slots of the get_variable, set_variable,
+		// set_local and declare_local actions of the body that
+		// use a known name; dictionary is the constant pool the
+		// function is defined with.
+		const array<local_slot>&	get_local_slots(const membuf& buffer, int def_index, int start_pc,
+			const array<as_value>& dictionary, atom_table* atoms);
+
+		// Optimizes the actions from start_pc to stop_pc (a
+		// frame or a function body) the first time it's called
+		// for them, and books what was done in the stats of the
+		// movie target comes from.  Returns how far the actions
+		// can grow the stack, -1 if that isn't known.
+		int	optimize(const membuf& buffer, int start_pc, int stop_pc, atom_table* atoms,
+			character* target);
+
+		array<action_instruction>	m_instructions;
+		array<int>	m_index;	// pc --> instruction index, -1 if not decoded yet
+		array<action_push_item>	m_push_items;
+		array<action_function_def>	m_functions;
+		array<as_member_cache*>	m_member_caches;	// new'd, so they don't move
+		hash<int, int>	m_optimized;	// start pc --> max stack depth of the region
+
+#ifdef __GAMESWF_ENABLE_JIT__
+		// Counts the calls of the region and returns its code
+		// once it's compiled, NULL before.
+		action_jit_region*	get_jit_region(const membuf& buffer, int start_pc, int stop_pc,
+			bool is_function2, atom_table* atoms);
+
+		hash<int, action_jit_region*>	m_jit_regions;	// start pc --> region, new'd
+#endif
+
+	private:
+		void	decode_run(const membuf& buffer, int pc, atom_table* atoms);
+		void	decode_push(const membuf& buffer, action_instruction* ins, atom_table* atoms);
+		void	decode_function(const membuf& buffer, action_instruction* ins, bool is_function2);
+		void	map_local_slots(const membuf& buffer, int def_index, int start_pc,
+			const array<as_value>& dictionary, atom_table* atoms);
+		int	new_member_cache();
+	};
+
 	// allows sharing of as byte code buffer
 	class counted_buffer : public membuf, public gc_object
 	{
+	public:
+		// decoded actions, shared by all copies of the action_buffer
+		action_program	m_program;
 	};
 
 
@@ -170,7 +390,8 @@ namespace gameswf
 			int exec_bytes,
 			as_value* retval,
 			const array<with_stack_entry>& initial_with_stack,
-			bool is_function2) const;
+			bool is_function2,
+			int local_slots = -1) const;
 
 		static as_object* load_as_plugin(player* player,
 			const tu_string& classname, const array<as_value>& params);
@@ -188,12 +409,15 @@ namespace gameswf
 		// to new'd instances.
 		//action_buffer(const action_buffer& a) { assert(0); }
 
-		void	process_decl_dict(int start_pc, int stop_pc);
+		void	process_decl_dict(int start_pc, int stop_pc, atom_table* atoms);
+		void	define_function(as_environment* env, const action_instruction& ins,
+			const array<with_stack_entry>& with_stack, bool is_function2) const;
+		void	push_data(as_environment* env, const action_instruction& ins, bool is_function2) const;
 		static void	enumerate(as_environment* env, as_object* object);
 
 		// data:
 		gc_ptr<counted_buffer>	m_buffer;
-		array<tu_string>	m_dictionary;
+		array<as_value>	m_dictionary;
 		int	m_decl_dict_processed_at;
 #if ACTION_BUFFER_PROFILLING		
 		static hash<int, Uint64> profiling_table;
@@ -288,6 +512,114 @@ namespace gameswf
 	bool get_builtin(builtin_object id, const tu_stringi& name, as_value* val);
 	stringi_hash<as_value>* new_standard_method_map(builtin_object id);
 
+	// Interned identifiers.  Each player has one.  Names are
+	// interned when action buffers are decoded and when object
+	// members are added, and the string values pushed by the
+	// actions carry their atom (see as_value::get_atom()), so
+	// lookups that know the atom don't hash the name again.  The
+	// shapes of the player's objects are keyed by atom (see
+	// as_shape), and keep the table alive.
+	//
+	// Atoms 0 .. AS_STANDARD_MEMBER_COUNT - 1 are the standard
+	// members, in order, in every player.
+	struct atom_table : public ref_counted
+	{
+		atom_table();
+
+		// Returns the atom of name, adding it if it's new.
+		int	intern(const tu_stringi& name);
+
+		// Returns -1 if name has not been interned.
+		int	find(const tu_stringi& name) const;
+
+		int	size() const { return m_atoms.size(); }
+		const tu_stringi&	get_name(int atom) const { return m_atoms[atom].m_name; }
+
+		// atom may be -1, for names that aren't interned.
+		static as_standard_member	get_standard_member(int atom)
+		{
+			return atom >= 0 && atom < AS_STANDARD_MEMBER_COUNT ? (as_standard_member) atom : M_INVALID_MEMBER;
+		}
+
+		// Returns true if the atom names a method in the given
+		// builtin method map.
+		bool	is_builtin(int atom, builtin_object id);
+
+	private:
+		friend struct as_shape;
+
+		struct atom_info
+		{
+			tu_stringi	m_name;
+			int	m_builtins;	// bit per builtin_object, -1 until looked up
+		};
+
+		stringi_hash<int>	m_index;
+		array<atom_info>	m_atoms;
+
+		// Doesn't hold a ref, the root shape clears it when it
+		// dies; see as_shape::get_root().
+		as_shape*	m_root_shape;
+	};
+
+	// Target paths ("_root.hud.score_txt", "/menu/item3") cut
+	// into their names once.  Each player has one.  A name that
+	// can be a display list entry remembers the character it was
+	// found as last time, which is good as long as the parent
+	// is alive and its display list hasn't changed since (see
+	// display_list::get_generation()).
+	struct target_path_cache
+	{
+		struct segment
+		{
+			tu_stringi	m_name;	// empty if the path ends with a '/'
+			bool	m_from_root;	// the name follows a '/'
+			bool	m_child_lookup;	// not hidden by a sprite builtin
+			as_standard_member	m_std_member;
+			int	m_offset;	// of the rest of the path, for errors
+
+			weak_ptr<as_object>	m_parent;
+			int	m_generation;	// of m_parent's display list
+			weak_ptr<as_object>	m_child;	// NULL if m_parent has no such child
+		};
+
+		struct entry
+		{
+			// as_environment::parse_path() of the string.
+			bool	m_is_var_path;
+			tu_string	m_path;
+			tu_string	m_var;
+
+			array<segment>	m_segments;
+		};
+
+		// Entries aren't freed while there's a lock on the
+		// cache, hold one while using an entry you got.
+		struct lock
+		{
+			lock(target_path_cache* cache) : m_cache(cache) { m_cache->m_busy++; }
+			~lock() { m_cache->m_busy--; }
+
+			target_path_cache*	m_cache;
+		};
+
+		target_path_cache();
+		~target_path_cache();
+
+		// Returns the parsed path, parsing it if it's new.
+		entry*	get(const tu_string& path);
+
+		// as_object::find_target() of a path string.
+		as_object*	find_target(as_object* start, const tu_string& path);
+
+	private:
+		void	clear();
+		as_object*	find_child(as_object* parent, segment* seg);
+
+		string_hash<entry*>	m_entries;
+		int	m_busy;	// nested find_target() calls, don't clear under them
+	};
+
 }	// end namespace gameswf
 
 
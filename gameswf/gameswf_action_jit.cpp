@@ -0,0 +1,770 @@
+// gameswf_action_jit.cpp
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// AVM1 JIT-compiler implementation
+//
+// Works like the AVM2 one (see gameswf_avm2_jit.cpp): a hot region of
+// an action buffer is compiled into calls to the helpers below, one
+// per action, with the branches done in native code.  The helpers do
+// what action_buffer::execute() does for the same action.  A helper
+// that finds the stack too short returns -1 instead; the compiled code
+// then returns the pc of the action and the interpreter executes it,
+// reporting the error.
+
+#include "gameswf/gameswf_action.h"
+#include "gameswf/gameswf_log.h"
+#include "gameswf/gameswf_function.h"
+#include "gameswf/gameswf_script_budget.h"
+
+#ifdef __GAMESWF_ENABLE_JIT__
+
+namespace gameswf
+{
+
+	static inline action_instruction get_instruction(action_jit_context* ctx, intptr_t index)
+	// Take a copy, the program may grow during the action.
+	{
+		return ctx->m_program->m_instructions[index];
+	}
+
+// Bail out if there are fewer than n elements on the stack.
+#define JIT_CHECK_STACK(n) if (env->size() < n) { return -1; }
+
+	static int action_jit_add(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		env->top(1) += env->top(0).to_number();
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_subtract(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		env->top(1) -= env->top(0).to_number();
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_multiply(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		env->top(1) *= env->top(0).to_number();
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_divide(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		env->top(1) /= env->top(0).to_number();
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_equal(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		env->top(1).set_bool(env->top(1) == env->top(0));
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_less(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		env->top(1).set_bool(env->top(1) < env->top(0).to_number());
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_logical_and(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		env->top(1).set_bool(env->top(1).to_bool() && env->top(0).to_bool());
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_logical_or(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		env->top(1).set_bool(env->top(1).to_bool() || env->top(0).to_bool());
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_logical_not(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		env->top(0).set_bool(! env->top(0).to_bool());
+		return 0;
+	}
+
+	static int action_jit_pop(action_jit_context* ctx, intptr_t)
+	{
+		ctx->m_env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_int(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		env->top(0).set_int(int(floor(env->top(0).to_number())));
+		return 0;
+	}
+
+	static int action_jit_get_variable(action_jit_context* ctx, intptr_t index)
+	{
+		as_environment* env = ctx->m_env;
+		action_instruction ins = get_instruction(ctx, index);
+		if (ins.m_count > 0 && ctx->m_with_stack->size() == 0)
+		{
+			*ctx->m_last_varname = env->top(0).to_tu_string();
+			if (env->get_local_slot(ctx->m_local_slots, ins.m_count - 1, &env->top(0)))
+			{
+				return 0;
+			}
+		}
+
+		const tu_string var_string = env->top(0).to_tu_string();
+
+		// keep the latest var name(to log it if call_method failure)
+		*ctx->m_last_varname = var_string;
+
+		as_value variable = env->get_variable(var_string, *ctx->m_with_stack,
+			ctx->m_program->m_member_caches[ins.m_arg], env->top(0).get_atom());
+		env->top(0) = variable;
+		return 0;
+	}
+
+	static int action_jit_set_variable(action_jit_context* ctx, intptr_t index)
+	{
+		as_environment* env = ctx->m_env;
+		action_instruction ins = get_instruction(ctx, index);
+		if (ins.m_count > 0 && ctx->m_with_stack->size() == 0
+			&& env->set_variable_slot(ctx->m_local_slots, ins.m_count - 1, env->top(1), env->top(0)))
+		{
+			env->drop(2);
+			return 0;
+		}
+		env->set_variable(env->top(1).to_tu_string(), env->top(0), *ctx->m_with_stack);
+		env->drop(2);
+		return 0;
+	}
+
+	static int action_jit_set_local(action_jit_context* ctx, intptr_t index)
+	{
+		as_environment* env = ctx->m_env;
+		action_instruction ins = get_instruction(ctx, index);
+		if (ins.m_count == 0
+			|| env->set_local_slot(ctx->m_local_slots, ins.m_count - 1, env->top(1), env->top(0)) == false)
+		{
+			env->set_local(env->top(1).to_tu_string(), env->top(0));
+		}
+		env->drop(2);
+		return 0;
+	}
+
+	static int action_jit_modulo(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		as_value	result;
+		double	y = env->pop().to_number();
+		double	x = env->pop().to_number();
+		if (y != 0)
+		{
+			result.set_double(fmod(x, y));
+		}
+		env->push(result);
+		return 0;
+	}
+
+	static int action_jit_declare_local(action_jit_context* ctx, intptr_t index)
+	{
+		as_environment* env = ctx->m_env;
+		action_instruction ins = get_instruction(ctx, index);
+		if (ins.m_count == 0
+			|| env->declare_local_slot(ctx->m_local_slots, ins.m_count - 1, env->top(0)) == false)
+		{
+			const tu_string&	varname = env->top(0).to_tu_string();
+			env->declare_local(varname);
+		}
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_add_t(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		if (env->top(0).is_string() || env->top(1).is_string())
+		{
+			env->top(1).concat(env->top(0));
+		}
+		else
+		{
+			env->top(1) += env->top(0).to_number();
+		}
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_less_t(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		JIT_CHECK_STACK(2);
+		if (env->top(1).is_string())
+		{
+			env->top(1).set_bool(env->top(1).to_tu_string() < env->top(0).to_tu_string());
+		}
+		else
+		{
+			env->top(1).set_bool(env->top(1) < env->top(0).to_number());
+		}
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_equal_t(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		JIT_CHECK_STACK(2);
+		env->top(1).set_bool(env->top(1) == env->top(0));
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_to_number(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		JIT_CHECK_STACK(1);
+		double n = env->top(0).to_number();
+		env->top(0).set_double(n);
+		return 0;
+	}
+
+	static int action_jit_to_string(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		JIT_CHECK_STACK(1);
+		const tu_string& str = env->top(0).to_tu_string();
+		env->top(0).set_tu_string(str);
+		return 0;
+	}
+
+	static int action_jit_dup(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		JIT_CHECK_STACK(1);
+		env->push(env->top(0));
+		return 0;
+	}
+
+	static int action_jit_swap(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		JIT_CHECK_STACK(2);
+		as_value	temp = env->top(1);
+		env->top(1) = env->top(0);
+		env->top(0) = temp;
+		return 0;
+	}
+
+	static int action_jit_get_member(action_jit_context* ctx, intptr_t index)
+	{
+		as_environment* env = ctx->m_env;
+		JIT_CHECK_STACK(2);
+		action_instruction ins = get_instruction(ctx, index);
+
+		// keep alive 'obj'
+		gc_ptr<as_object>	obj = env->top(1).to_object();
+		if (obj == NULL)
+		{
+			// try property/method of a primitive type, like String.length
+			as_value val;
+			env->top(1).find_property(env->top(0).to_tu_string(), &val);
+			if (val.is_property())
+			{
+				val.get_property(env->top(1), &val);
+			}
+			env->top(1) = val;
+		}
+		else
+		{
+			// keep the latest var name(to log it if call_method failure)
+			*ctx->m_last_varname = env->top(0).to_tu_string();
+
+			env->top(1).set_undefined();
+			as_member_cache*	cache = ctx->m_program->m_member_caches[ins.m_arg];
+			if (cache->get_member(obj.get_ptr(), env->top(0).to_tu_string(),
+				env->top(0).get_atom(), &(env->top(1))) == false)
+			{
+				// try '__resolve' property
+				as_value val;
+				if (obj->get_member("__resolve", &val))
+				{
+					// call __resolve
+					as_function* resolve = cast_to<as_function>(val.to_object());
+					if (resolve)
+					{
+						(*resolve)(fn_call(&val, obj.get(), env, 1, env->get_top_index()));
+						env->top(1) = val;
+					}
+				}
+			}
+		}
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_set_member(action_jit_context* ctx, intptr_t index)
+	{
+		as_environment* env = ctx->m_env;
+		JIT_CHECK_STACK(3);
+		action_instruction ins = get_instruction(ctx, index);
+
+		as_object*	obj = env->top(2).to_object();
+		if (obj)
+		{
+			ctx->m_program->m_member_caches[ins.m_arg]->set_member(obj, env->top(1).to_tu_string(),
+				env->top(1).get_atom(), env->top(0));
+		}
+		env->drop(3);
+		return 0;
+	}
+
+	static int action_jit_increment(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		JIT_CHECK_STACK(1);
+		env->top(0) += 1;
+		return 0;
+	}
+
+	static int action_jit_decrement(action_jit_context* ctx, intptr_t)
+	{
+		as_environment* env = ctx->m_env;
+		JIT_CHECK_STACK(1);
+		env->top(0) -= 1;
+		return 0;
+	}
+
+	static int action_jit_bitwise(action_jit_context* ctx, intptr_t index)
+	// 0x60 .. 0x68
+	{
+		as_environment* env = ctx->m_env;
+		JIT_CHECK_STACK(2);
+		switch (get_instruction(ctx, index).m_action_id)
+		{
+			case 0x60:	// bitwise and
+				env->top(1) &= env->top(0).to_int();
+				break;
+			case 0x61:	// bitwise or
+				env->top(1) |= env->top(0).to_int();
+				break;
+			case 0x62:	// bitwise xor
+				env->top(1) ^= env->top(0).to_int();
+				break;
+			case 0x63:	// shift left
+				env->top(1).shl(env->top(0).to_int());
+				break;
+			case 0x64:	// shift right (signed)
+				env->top(1).asr(env->top(0).to_int());
+				break;
+			case 0x65:	// shift right (unsigned)
+				env->top(1).lsr(env->top(0).to_int());
+				break;
+			case 0x66:	// strict equal
+				env->top(1).set_bool(env->top(1) == env->top(0));
+				break;
+			case 0x67:	// gt (typed)
+				if (env->top(1).is_string())
+				{
+					env->top(1).set_bool(env->top(1).to_tu_string() > env->top(0).to_tu_string());
+				}
+				else
+				{
+					env->top(1).set_bool(env->top(1).to_number() > env->top(0).to_number());
+				}
+				break;
+			case 0x68:	// string gt
+				env->top(1).set_bool(env->top(1).to_tu_string() > env->top(0).to_tu_string());
+				break;
+		}
+		env->drop(1);
+		return 0;
+	}
+
+	static int action_jit_store_register(action_jit_context* ctx, intptr_t index)
+	{
+		as_environment* env = ctx->m_env;
+		JIT_CHECK_STACK(1);
+		int	reg = get_instruction(ctx, index).m_arg;
+
+		// Save top of stack in specified register.
+		if (ctx->m_is_function2)
+		{
+			env->set_register(reg, env->top(0));
+		}
+		else if (reg >= 0 && reg < 4)
+		{
+			env->m_global_register[reg] = env->top(0);
+		}
+		else
+		{
+			log_error("store_register[%d] -- register out of bounds!", reg);
+		}
+		return 0;
+	}
+
+	static int action_jit_push_data(action_jit_context* ctx, intptr_t index)
+	{
+		as_environment* env = ctx->m_env;
+		action_instruction ins = get_instruction(ctx, index);
+		const array<action_push_item>& items = ctx->m_program->m_push_items;
+		const array<as_value>& dictionary = *ctx->m_dictionary;
+
+		for (int k = ins.m_arg, end = ins.m_arg + ins.m_count; k < end; k++)
+		{
+			const action_push_item&	item = items[k];
+			if (item.m_type == action_push_item::PUSH_VALUE)
+			{
+				env->push(item.m_value);
+			}
+			else if (item.m_type == action_push_item::PUSH_REGISTER)
+			{
+				// contents of register
+				int	reg = item.m_index;
+				if (ctx->m_is_function2)
+				{
+					env->push(*env->get_register(reg));
+				}
+				else if (reg < 0 || reg >= 4)
+				{
+					env->push(as_value());
+					log_error("push register[%d] -- register out of bounds!\n", reg);
+				}
+				else
+				{
+					env->push(env->m_global_register[reg]);
+				}
+			}
+			else
+			{
+				int	id = item.m_index;
+				if (id < dictionary.size())
+				{
+					env->push(dictionary[id]);
+				}
+				else
+				{
+					log_error("error: dict_lookup(%d) is out of bounds!\n", id);
+					env->push(0);
+				}
+			}
+		}
+		return 0;
+	}
+
+	static int action_jit_tick(action_jit_context* ctx, intptr_t actions)
+	// Returns 1 if the script is over its budget.
+	{
+		return ctx->m_budget->tick((int) actions) ? 1 : 0;
+	}
+
+	static int action_jit_branch_if_true(action_jit_context* ctx, intptr_t)
+	// Returns 1 if the branch is taken.
+	{
+		as_environment* env = ctx->m_env;
+		JIT_CHECK_STACK(1);
+		bool	test = env->top(0).to_bool();
+		env->drop(1);
+		return test ? 1 : 0;
+	}
+
+	static jit_helper get_helper(int action_id, bool* can_bail_out)
+	// Returns NULL for the actions left to the interpreter.
+	{
+		*can_bail_out = false;
+		switch (action_id)
+		{
+			case 0x0A: return (jit_helper) action_jit_add;
+			case 0x0B: return (jit_helper) action_jit_subtract;
+			case 0x0C: return (jit_helper) action_jit_multiply;
+			case 0x0D: return (jit_helper) action_jit_divide;
+			case 0x0E: return (jit_helper) action_jit_equal;
+			case 0x0F: return (jit_helper) action_jit_less;
+			case 0x10: return (jit_helper) action_jit_logical_and;
+			case 0x11: return (jit_helper) action_jit_logical_or;
+			case 0x12: return (jit_helper) action_jit_logical_not;
+			case 0x17: return (jit_helper) action_jit_pop;
+			case 0x18: return (jit_helper) action_jit_int;
+			case 0x1C: return (jit_helper) action_jit_get_variable;
+			case 0x1D: return (jit_helper) action_jit_set_variable;
+			case 0x3C: return (jit_helper) action_jit_set_local;
+			case 0x3F: return (jit_helper) action_jit_modulo;
+			case 0x41: return (jit_helper) action_jit_declare_local;
+			case 0x47: return (jit_helper) action_jit_add_t;
+			case 0x96: return (jit_helper) action_jit_push_data;
+
+			// The optimizer's push + the next action: the next
+			// action is compiled on its own.
+			case ACTION_PUSH_THEN: return (jit_helper) action_jit_push_data;
+		}
+
+		*can_bail_out = true;
+		switch (action_id)
+		{
+			case 0x48: return (jit_helper) action_jit_less_t;
+			case 0x49: return (jit_helper) action_jit_equal_t;
+			case 0x4A: return (jit_helper) action_jit_to_number;
+			case 0x4B: return (jit_helper) action_jit_to_string;
+			case 0x4C: return (jit_helper) action_jit_dup;
+			case 0x4D: return (jit_helper) action_jit_swap;
+			case 0x4E: return (jit_helper) action_jit_get_member;
+			case 0x4F: return (jit_helper) action_jit_set_member;
+			case 0x50: return (jit_helper) action_jit_increment;
+			case 0x51: return (jit_helper) action_jit_decrement;
+			case 0x60: case 0x61: case 0x62: case 0x63: case 0x64:
+			case 0x65: case 0x66: case 0x67: case 0x68:
+				return (jit_helper) action_jit_bitwise;
+			case 0x87: return (jit_helper) action_jit_store_register;
+		}
+		return NULL;
+	}
+
+	action_jit_region::action_jit_region(int start_pc, int stop_pc, bool is_function2) :
+		m_start_pc(start_pc),
+		m_stop_pc(stop_pc),
+		m_is_function2(is_function2),
+		m_call_count(0)
+	{
+	}
+
+	void	action_jit_region::compile(action_program* program, const membuf& buffer, atom_table* atoms)
+	// Build m_code and m_entry.  Leaves them empty if there is
+	// nothing worth compiling.
+	{
+		int	size = m_stop_pc - m_start_pc;
+		int	stop_pc = imin(m_stop_pc, buffer.size());
+
+		// Find the actions, in the order the interpreter walks
+		// them: function bodies are skipped.
+		array<int>	labels;	// pc - m_start_pc --> label, -1 if no action starts there
+		labels.resize(size);
+		for (int i = 0; i < size; i++)
+		{
+			labels[i] = -1;
+		}
+
+		array<int>	indices;	// instruction indices, in pc order
+		int	pc = m_start_pc;
+		while (pc < stop_pc)
+		{
+			int	index = program->get_index(buffer, pc, atoms);
+			const action_instruction&	ins = program->m_instructions[index];
+			labels[pc - m_start_pc] = m_code.new_label();
+			indices.push_back(index);
+
+			if (ins.m_action_id == 0x00)
+			{
+				// end of actions
+				break;
+			}
+
+			pc = ins.m_next_pc;
+			if (ins.m_action_id == 0x8E || ins.m_action_id == 0x9B)
+			{
+				pc += program->m_functions[ins.m_arg].m_length;
+			}
+		}
+		int	end_pc = pc;
+
+		int	exit_label = m_code.new_label();
+		array<bool>	compiled;	// pc - m_start_pc --> not left to the interpreter
+		compiled.resize(size);
+		array<int>	bailouts;	// pc's of the actions whose helper may fail
+		array<int>	bailout_labels;
+		int	compiled_count = 0;
+
+		for (int i = 0; i < indices.size(); i++)
+		{
+			const action_instruction	ins = program->m_instructions[indices[i]];
+			int	offset = ins.m_pc - m_start_pc;
+			m_code.bind_label(labels[offset]);
+			compiled[offset] = true;
+
+			if (ins.m_action_id == 0x99 || ins.m_action_id == 0x9D || ins.m_action_id == ACTION_BRANCH_IF_FALSE)
+			{
+				int	target = ins.m_arg;
+				bool	known_target = target >= m_start_pc && target < stop_pc && labels[target - m_start_pc] >= 0;
+				bool	if_false = ins.m_action_id == ACTION_BRANCH_IF_FALSE;
+				if (known_target && target <= ins.m_pc)
+				{
+					// A loop; count the actions of its body
+					// against the script budget.  If it's
+					// over, the interpreter stops the script.
+					int	actions = 0;
+					for (int j = i; j >= 0 && program->m_instructions[indices[j]].m_pc >= target; j--)
+					{
+						actions++;
+					}
+					int	bailout_label = m_code.new_label();
+					jit_call_helper(m_code, action_jit_tick, actions);
+					jit_jump_if(m_code, jit_not_zero, bailout_label);
+					bailouts.push_back(ins.m_pc);
+					bailout_labels.push_back(bailout_label);
+				}
+
+				if (ins.m_action_id != 0x99 && target > m_stop_pc)
+				{
+					// Let the interpreter complain.
+					compiled[offset] = false;
+				}
+				else if (ins.m_action_id == 0x99)	// branch always
+				{
+					if (known_target)
+					{
+						jit_jump(m_code, labels[target - m_start_pc]);
+					}
+					else
+					{
+						jit_load_result(m_code, target);
+						jit_jump(m_code, exit_label);
+					}
+					compiled_count++;
+					continue;
+				}
+				else	// branch if true, or if false
+				{
+					int	bailout_label = m_code.new_label();
+					jit_call_helper(m_code, action_jit_branch_if_true, 0);
+					jit_jump_if(m_code, jit_negative, bailout_label);
+					bailouts.push_back(ins.m_pc);
+					bailout_labels.push_back(bailout_label);
+
+					if (known_target)
+					{
+						jit_jump_if(m_code, if_false ? jit_zero : jit_not_zero, labels[target - m_start_pc]);
+					}
+					else
+					{
+						int	not_taken = m_code.new_label();
+						jit_jump_if(m_code, if_false ? jit_not_zero : jit_zero, not_taken);
+						jit_load_result(m_code, target);
+						jit_jump(m_code, exit_label);
+						m_code.bind_label(not_taken);
+					}
+					compiled_count++;
+					continue;
+				}
+			}
+
+			bool	can_bail_out;
+			jit_helper	helper = get_helper(ins.m_action_id, &can_bail_out);
+			if (helper == NULL || compiled[offset] == false)
+			{
+				// Leave it to the interpreter.
+				compiled[offset] = false;
+				jit_load_result(m_code, ins.m_pc);
+				jit_jump(m_code, exit_label);
+				continue;
+			}
+
+			jit_call_helper(m_code, helper, indices[i]);
+			if (can_bail_out)
+			{
+				int	bailout_label = m_code.new_label();
+				jit_jump_if(m_code, jit_not_zero, bailout_label);
+				bailouts.push_back(ins.m_pc);
+				bailout_labels.push_back(bailout_label);
+			}
+			compiled_count++;
+		}
+
+		// Falling off the end of the region.
+		jit_load_result(m_code, end_pc);
+		jit_jump(m_code, exit_label);
+
+		// A failed helper makes the interpreter redo the action.
+		for (int i = 0; i < bailouts.size(); i++)
+		{
+			m_code.bind_label(bailout_labels[i]);
+			jit_load_result(m_code, bailouts[i]);
+			jit_jump(m_code, exit_label);
+		}
+
+		m_code.bind_label(exit_label);
+		jit_leave(m_code);
+
+		if (compiled_count == 0)
+		{
+			m_code.clear();
+			return;
+		}
+
+		// The interpreter may come back at any compiled action.
+		m_entry.resize(size);
+		for (int i = 0; i < size; i++)
+		{
+			m_entry[i] = -1;
+			if (labels[i] >= 0 && compiled[i])
+			{
+				m_entry[i] = m_code.get_position();
+				jit_enter(m_code);
+				jit_jump(m_code, labels[i]);
+			}
+		}
+
+		m_code.initialize();
+		if (m_code.is_valid() == false)
+		{
+			m_entry.clear();
+		}
+	}
+
+	action_jit_region*	action_program::get_jit_region(const membuf& buffer, int start_pc, int stop_pc,
+		bool is_function2, atom_table* atoms)
+	{
+		// Regions are dropped with the rest of the program when
+		// the buffer has grown; bring the program up to date
+		// first.
+		get_index(buffer, start_pc, atoms);
+
+		action_jit_region*	region = NULL;
+		if (m_jit_regions.get(start_pc, &region) == false)
+		{
+			region = new action_jit_region(start_pc, stop_pc, is_function2);
+			m_jit_regions.add(start_pc, region);
+		}
+
+		if (region->m_stop_pc != stop_pc || region->m_is_function2 != is_function2)
+		{
+			// Not the same code.
+			return NULL;
+		}
+
+		if (region->m_call_count < get_jit_threshold())
+		{
+			if (++region->m_call_count == get_jit_threshold())
+			{
+				region->compile(this, buffer, atoms);
+			}
+		}
+
+		return region->m_code.is_valid() ? region : NULL;
+	}
+
+}	// end namespace gameswf
+
+#endif	// __GAMESWF_ENABLE_JIT__
+
+
+// Local Variables:
+// mode: C++
+// c-basic-offset: 8
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
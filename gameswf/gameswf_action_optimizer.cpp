@@ -0,0 +1,634 @@
+// gameswf_action_optimizer.cpp
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// AVM1 bytecode optimizer.  Flash compilers leave the interpreter a
+// lot to redo on every pass: arithmetic on constants, runs of
+// push_data, push/pop pairs, "not not branch_if_true".  The first time
+// the actions of a frame or a function run, optimize() rewrites their
+// decoded form (never the action bytes):
+//
+//   - branches to a branch go straight to the final target
+//   - a push_data of constants followed by the arithmetic, comparison
+//     or "not" that uses them becomes a push_data of the result
+//   - consecutive push_data actions become one, and a push_data
+//     followed by a pop loses its last value
+//   - "not, branch_if_true" becomes ACTION_BRANCH_IF_FALSE, and so
+//     "not, not, branch_if_true" a plain branch_if_true
+//   - a push_data followed by another action becomes
+//     ACTION_PUSH_THEN, which the interpreter runs with the next
+//     action in one trip through its loop (push + get_variable, push +
+//     get_member, push + call_method...)
+//
+// Every action keeps its own decoded form at its own pc; the actions
+// folded into the one before them are only skipped when they are
+// reached from it.  A branch to one of them still runs it, and that's
+// all the interpreter needs to stay right.  The jitted code doesn't
+// know skipped actions though, so actions that are branched to are
+// never folded.  Between two actions the interpreter ends "with"
+// blocks, so code with "with" blocks is left alone.
+//
+// Unreachable actions are not optimized, only counted, and the
+// deepest the actions can grow the stack is worked out so that
+// execute() can make room for it up front.
+
+
+#include "gameswf/gameswf_action.h"
+#include "gameswf/gameswf_log.h"
+#include "gameswf/gameswf_sprite.h"
+#include "gameswf/gameswf_root.h"
+#include "gameswf/gameswf_movie_def.h"
+#include <math.h>
+
+
+namespace gameswf
+{
+
+	// Deeper than that the stack is taken as unknown (pushes in a
+	// loop).
+	static const int	MAX_STACK_DEPTH = 4096;
+
+	static bool	is_push(int action_id)
+	{
+		return action_id == 0x96 || action_id == ACTION_PUSH_THEN;
+	}
+
+	static int	get_stack_growth(const action_program* program, const action_instruction& ins)
+	// How much the action can grow the stack, at most.  The actions
+	// that pop a variable number of values are taken to pop as few
+	// as they can.  MAX_STACK_DEPTH for the enumerations, which push
+	// a value per member.
+	{
+		switch (ins.m_action_id)
+		{
+			case 0x96:	// push_data
+			case ACTION_PUSH_THEN:	// the action it runs next is counted on its own
+				return ins.m_count;
+
+			case 0x34:	// get timer
+			case 0x42:	// init array
+			case 0x4C:	// dup
+				return 1;
+
+			case 0x8E:	// function2
+			case 0x9B:	// declare function
+				// An anonymous function is left on the stack.
+				return program->m_functions[ins.m_arg].m_name.length() == 0 ? 1 : 0;
+
+			case 0x46:	// enumerate
+			case 0x55:	// enumerate object
+				return MAX_STACK_DEPTH;
+
+			case 0x0A: case 0x0B: case 0x0C: case 0x0D:	// arithmetic
+			case 0x0E: case 0x0F: case 0x10: case 0x11:	// comparisons, logical
+			case 0x13: case 0x17: case 0x20: case 0x21:	// string equal, pop, set target, concat
+			case 0x22: case 0x25: case 0x26: case 0x2B:	// get property, remove clip, trace, cast
+			case 0x3A: case 0x3D: case 0x3E: case 0x3F:	// delete, call function, return, modulo
+			case 0x40: case 0x41: case 0x47: case 0x48:	// new, declare local, add_t, less_t
+			case 0x49: case 0x4E: case 0x54:	// equal_t, get member, instance of
+			case 0x60: case 0x61: case 0x62: case 0x63: case 0x64:	// bitwise
+			case 0x65: case 0x66: case 0x67: case 0x68:
+			case 0x8D: case 0x94: case 0x9D: case 0x9E: case 0x9F:
+			case ACTION_BRANCH_IF_FALSE:
+				return -1;
+
+			case 0x15:	// substring
+			case 0x1D:	// set variable
+			case 0x3C:	// set local
+			case 0x52:	// call method
+			case 0x53:	// new method
+			case 0x69:	// extends
+			case 0x9A:	// get url2
+				return -2;
+
+			case 0x23:	// set property
+			case 0x24:	// duplicate clip
+			case 0x27:	// start drag
+			case 0x4F:	// set member
+				return -3;
+		}
+		return 0;
+	}
+
+	static int	get_successors(const action_program* program, const action_instruction& ins, int* branch)
+	// Returns where the action falls through to and puts where it
+	// branches to in *branch, -1 for none.
+	{
+		*branch = -1;
+		switch (ins.m_action_id)
+		{
+			case 0x00:	// end of actions
+			case 0x3E:	// return
+				return -1;
+
+			case 0x8E:	// function2
+			case 0x9B:	// declare function
+				return ins.m_next_pc + program->m_functions[ins.m_arg].m_length;
+
+			case 0x99:	// branch always
+				*branch = ins.m_arg;
+				return -1;
+
+			case 0x9D:	// branch if true
+			case ACTION_BRANCH_IF_FALSE:
+				*branch = ins.m_arg;
+				break;
+		}
+		return ins.m_next_pc;
+	}
+
+	static bool	fold_unary(int action_id, as_value* val)
+	// Does what the interpreter does to the top of the stack for the
+	// action, if it's one we fold.
+	{
+		if (val->is_number() == false
+			&& (action_id != 0x12 || (val->is_bool() == false && val->is_undefined() == false && val->is_null() == false)))
+		{
+			return false;
+		}
+
+		switch (action_id)
+		{
+			case 0x12:	// logical not
+				val->set_bool(! val->to_bool());
+				return true;
+
+			case 0x18:	// int
+				val->set_int(int(floor(val->to_number())));
+				return true;
+
+			case 0x4A:	// to number
+			{
+				double n = val->to_number();
+				val->set_double(n);
+				return true;
+			}
+
+			case 0x50:	// increment
+				*val += 1;
+				return true;
+
+			case 0x51:	// decrement
+				*val -= 1;
+				return true;
+		}
+		return false;
+	}
+
+	static bool	fold_binary(int action_id, as_value* a, const as_value& b)
+	// a = a <op> b, the way the interpreter does it to two numbers
+	// on the stack (a below b), if it's an action we fold.
+	{
+		if (a->is_number() == false || b.is_number() == false)
+		{
+			return false;
+		}
+
+		switch (action_id)
+		{
+			case 0x0A:	// add
+			case 0x47:	// add_t
+				*a += b.to_number();
+				return true;
+			case 0x0B:	// subtract
+				*a -= b.to_number();
+				return true;
+			case 0x0C:	// multiply
+				*a *= b.to_number();
+				return true;
+			case 0x0D:	// divide
+				*a /= b.to_number();
+				return true;
+			case 0x0E:	// equal
+			case 0x49:	// equal_t
+			case 0x66:	// strict equal
+				a->set_bool(*a == b);
+				return true;
+			case 0x0F:	// less than
+			case 0x48:	// less_t
+				a->set_bool(*a < b.to_number());
+				return true;
+			case 0x10:	// logical and
+				a->set_bool(a->to_bool() && b.to_bool());
+				return true;
+			case 0x11:	// logical or
+				a->set_bool(a->to_bool() || b.to_bool());
+				return true;
+			case 0x3F:	// modulo
+			{
+				double	y = b.to_number();
+				double	x = a->to_number();
+				as_value	result;
+				if (y != 0)
+				{
+					result.set_double(fmod(x, y));
+				}
+				*a = result;
+				return true;
+			}
+			case 0x60:	// bitwise and
+				*a &= b.to_int();
+				return true;
+			case 0x61:	// bitwise or
+				*a |= b.to_int();
+				return true;
+			case 0x62:	// bitwise xor
+				*a ^= b.to_int();
+				return true;
+			case 0x63:	// shift left
+				a->shl(b.to_int());
+				return true;
+			case 0x64:	// shift right (signed)
+				a->asr(b.to_int());
+				return true;
+			case 0x65:	// shift right (unsigned)
+				a->lsr(b.to_int());
+				return true;
+			case 0x67:	// gt (typed)
+				a->set_bool(a->to_number() > b.to_number());
+				return true;
+		}
+		return false;
+	}
+
+	static action_optimizer_stats*	get_stats(character* target)
+	// The stats of the movie the actions of target come from.
+	{
+		for (character* ch = target; ch; ch = ch->get_parent())
+		{
+			sprite_instance*	sprite = cast_to<sprite_instance>(ch);
+			if (sprite && sprite->get_root() && sprite->get_root()->m_def != NULL)
+			{
+				return &sprite->get_root()->m_def->m_optimizer_stats;
+			}
+		}
+		return NULL;
+	}
+
+	// The actions of the region being optimized.
+	struct optimizer_region
+	{
+		int	m_start_pc;
+		int	m_stop_pc;
+		array<int>	m_indices;	// instruction indices, in pc order
+		array<int>	m_position;	// pc - m_start_pc --> position in m_indices, -1 if no action starts there
+		array<bool>	m_reachable;	// position --> reachable
+		array<bool>	m_target;	// position --> branched to
+
+		int	get_position(int pc) const
+		{
+			if (pc < m_start_pc || pc >= m_stop_pc)
+			{
+				return -1;
+			}
+			return m_position[pc - m_start_pc];
+		}
+	};
+
+	static bool	peephole(action_program* program, const optimizer_region& region, int index,
+		action_optimizer_stats* stats)
+	// Rewrite the action with the one that follows it.  Returns true
+	// if it changed.
+	{
+		action_instruction&	ins = program->m_instructions[index];
+		int	next_position = region.get_position(ins.m_next_pc);
+		if (next_position < 0)
+		{
+			return false;
+		}
+		const action_instruction	next = program->m_instructions[region.m_indices[next_position]];
+
+		// Whether the next action can be folded into this one.
+		bool	absorb = region.m_target[next_position] == false;
+
+		if (ins.m_action_id == 0x12)	// logical not
+		{
+			if (absorb && (next.m_action_id == 0x9D || next.m_action_id == ACTION_BRANCH_IF_FALSE))
+			{
+				int	pc = ins.m_pc;
+				ins = next;
+				ins.m_pc = pc;
+				ins.m_action_id = next.m_action_id == 0x9D ? ACTION_BRANCH_IF_FALSE : 0x9D;
+				stats->m_branches++;
+				return true;
+			}
+			return false;
+		}
+
+		if (is_push(ins.m_action_id) == false)
+		{
+			return false;
+		}
+
+		array<action_push_item>&	items = program->m_push_items;
+		int	last = ins.m_arg + ins.m_count - 1;
+		if (absorb && is_push(next.m_action_id) && ins.m_count + next.m_count <= 0xFFFF)
+		{
+			// One push_data for both.
+			int	first = items.size();
+			items.resize(first + ins.m_count + next.m_count);
+			for (int i = 0; i < ins.m_count; i++)
+			{
+				items[first + i] = items[ins.m_arg + i];
+			}
+			for (int i = 0; i < next.m_count; i++)
+			{
+				items[first + ins.m_count + i] = items[next.m_arg + i];
+			}
+			ins.m_action_id = next.m_action_id;
+			ins.m_arg = first;
+			ins.m_count = next.m_count + ins.m_count;
+			ins.m_next_pc = next.m_next_pc;
+			stats->m_merged++;
+			return true;
+		}
+
+		// The push_data of each action has its own items, they
+		// can be changed in place.
+		if (absorb && next.m_action_id == 0x17	// pop
+			&& ins.m_count > 0 && items[last].m_type == action_push_item::PUSH_VALUE)
+		{
+			ins.m_action_id = 0x96;
+			ins.m_count--;
+			ins.m_next_pc = next.m_next_pc;
+			stats->m_dropped++;
+			return true;
+		}
+
+		if (absorb && ins.m_count > 0 && items[last].m_type == action_push_item::PUSH_VALUE)
+		{
+			as_value	val = items[last].m_value;
+			if (fold_unary(next.m_action_id, &val))
+			{
+				items[last].m_value = val;
+				ins.m_action_id = 0x96;
+				ins.m_next_pc = next.m_next_pc;
+				stats->m_folded++;
+				return true;
+			}
+
+			if (ins.m_count > 1 && items[last - 1].m_type == action_push_item::PUSH_VALUE)
+			{
+				val = items[last - 1].m_value;
+				if (fold_binary(next.m_action_id, &val, items[last].m_value))
+				{
+					items[last - 1].m_value = val;
+					ins.m_action_id = 0x96;
+					ins.m_count--;
+					ins.m_next_pc = next.m_next_pc;
+					stats->m_folded++;
+					return true;
+				}
+			}
+		}
+
+		if (ins.m_action_id == 0x96 && is_push(next.m_action_id) == false && next.m_action_id != 0x94)
+		{
+			ins.m_action_id = ACTION_PUSH_THEN;
+			stats->m_fused++;
+			return true;
+		}
+		return false;
+	}
+
+	int	action_program::optimize(const membuf& buffer, int start_pc, int stop_pc, atom_table* atoms,
+		character* target)
+	{
+		// Brings the program up to date first (see get_index()).
+		get_index(buffer, start_pc, atoms);
+
+		int	stack_depth = -1;
+		if (m_optimized.get(start_pc, &stack_depth))
+		{
+			return stack_depth;
+		}
+		m_optimized.set(start_pc, -1);
+
+		action_optimizer_stats	unused_stats;
+		action_optimizer_stats*	stats = get_stats(target);
+		if (stats == NULL)
+		{
+			stats = &unused_stats;
+		}
+
+		// Find the actions, in the order the interpreter walks
+		// them: function bodies are skipped, they are optimized
+		// when they are called.
+		optimizer_region	region;
+		region.m_start_pc = start_pc;
+		region.m_stop_pc = imin(stop_pc, buffer.size());
+		region.m_position.resize(region.m_stop_pc - start_pc);
+		for (int i = 0; i < region.m_position.size(); i++)
+		{
+			region.m_position[i] = -1;
+		}
+
+		int	pc = start_pc;
+		while (pc < region.m_stop_pc)
+		{
+			int	index = get_index(buffer, pc, atoms);
+			const action_instruction	ins = m_instructions[index];
+			region.m_position[pc - start_pc] = region.m_indices.size();
+			region.m_indices.push_back(index);
+
+			if (ins.m_action_id == 0x94)	// with
+			{
+				stats->m_skipped++;
+				return -1;
+			}
+
+			if (ins.m_action_id == 0x00)
+			{
+				// end of actions
+				break;
+			}
+
+			pc = ins.m_next_pc;
+			if (ins.m_action_id == 0x8E || ins.m_action_id == 0x9B)
+			{
+				pc += m_functions[ins.m_arg].m_length;
+			}
+		}
+
+		int	count = region.m_indices.size();
+		region.m_reachable.resize(count);
+		region.m_target.resize(count);
+		for (int i = 0; i < count; i++)
+		{
+			region.m_reachable[i] = false;
+			region.m_target[i] = false;
+		}
+
+		// Follow the branches from the start.
+		array<int>	work;
+		if (count > 0)
+		{
+			region.m_reachable[0] = true;
+			work.push_back(0);
+		}
+		while (work.size() > 0)
+		{
+			const action_instruction&	ins = m_instructions[region.m_indices[work.back()]];
+			work.resize(work.size() - 1);
+
+			int	successors[2];
+			successors[0] = get_successors(this, ins, &successors[1]);
+			for (int i = 0; i < 2; i++)
+			{
+				int	position = region.get_position(successors[i]);
+				if (position >= 0 && region.m_reachable[position] == false)
+				{
+					region.m_reachable[position] = true;
+					work.push_back(position);
+				}
+			}
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			const action_instruction&	ins = m_instructions[region.m_indices[i]];
+			if (region.m_reachable[i] == false)
+			{
+				int	length = ins.m_next_pc - ins.m_pc;
+				if (ins.m_action_id == 0x8E || ins.m_action_id == 0x9B)
+				{
+					length += m_functions[ins.m_arg].m_length;
+				}
+				stats->m_dead_bytes += length;
+				continue;
+			}
+			stats->m_actions++;
+		}
+
+		// Branches to a branch always.
+		for (int i = 0; i < count; i++)
+		{
+			action_instruction&	ins = m_instructions[region.m_indices[i]];
+			if (region.m_reachable[i] == false || (ins.m_action_id != 0x99 && ins.m_action_id != 0x9D))
+			{
+				continue;
+			}
+
+			int	dest = ins.m_arg;
+			for (int hops = 0; hops < 8; hops++)
+			{
+				int	position = region.get_position(dest);
+				if (position < 0)
+				{
+					break;
+				}
+				const action_instruction&	jump = m_instructions[region.m_indices[position]];
+				if (jump.m_action_id != 0x99 || jump.m_arg == dest)
+				{
+					break;
+				}
+				dest = jump.m_arg;
+			}
+
+			// Don't make the interpreter complain about a
+			// branch out of the region.
+			if (dest != ins.m_arg && (ins.m_action_id == 0x99 || dest <= stop_pc))
+			{
+				ins.m_arg = dest;
+				stats->m_branches++;
+			}
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			const action_instruction&	ins = m_instructions[region.m_indices[i]];
+			if (region.m_reachable[i] && (ins.m_action_id == 0x99 || ins.m_action_id == 0x9D))
+			{
+				int	position = region.get_position(ins.m_arg);
+				if (position >= 0)
+				{
+					region.m_target[position] = true;
+				}
+			}
+		}
+
+		// Backwards, so that the action after the one we're
+		// looking at is done already.
+		for (int i = count - 1; i >= 0; i--)
+		{
+			if (region.m_reachable[i])
+			{
+				while (peephole(this, region, region.m_indices[i], stats))
+				{
+				}
+			}
+		}
+
+		// How deep the stack gets, following every path from
+		// the start.
+		array<int>	height;	// position --> most values on the stack before the action, -1 if not reached
+		height.resize(count);
+		for (int i = 0; i < count; i++)
+		{
+			height[i] = -1;
+		}
+
+		int	max_depth = 0;
+		bool	known = true;
+		if (count > 0)
+		{
+			height[0] = 0;
+			work.push_back(0);
+		}
+		while (work.size() > 0 && known)
+		{
+			int	position = work.back();
+			work.resize(work.size() - 1);
+			const action_instruction&	ins = m_instructions[region.m_indices[position]];
+
+			int	depth = height[position] + get_stack_growth(this, ins);
+			if (depth >= MAX_STACK_DEPTH)
+			{
+				known = false;
+				break;
+			}
+			max_depth = imax(max_depth, depth);
+			depth = imax(depth, 0);
+
+			int	successors[2];
+			successors[0] = get_successors(this, ins, &successors[1]);
+			for (int i = 0; i < 2; i++)
+			{
+				int	next_position = region.get_position(successors[i]);
+				if (next_position < 0)
+				{
+					if (successors[i] >= start_pc && successors[i] < region.m_stop_pc)
+					{
+						// Into the middle of an action.
+						known = false;
+					}
+					continue;
+				}
+				if (height[next_position] < depth)
+				{
+					height[next_position] = depth;
+					work.push_back(next_position);
+				}
+			}
+		}
+
+		stats->m_regions++;
+		if (known)
+		{
+			stack_depth = max_depth;
+			stats->m_max_stack_depth = imax(stats->m_max_stack_depth, max_depth);
+		}
+		m_optimized.set(start_pc, stack_depth);
+		return stack_depth;
+	}
+
+}	// end namespace gameswf
+
+
+// Local Variables:
+// mode: C++
+// c-basic-offset: 8
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
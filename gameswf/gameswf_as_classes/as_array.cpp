@@ -478,27 +478,13 @@ namespace gameswf
 		return as_object::set_member(name, val);
 	}
 
-	void as_array::clear_refs(hash<as_object*, bool>* visited_objects, as_object* this_ptr)
+	void as_array::clear_refs(as_object_walk* walk, as_object* this_ptr)
 	{
-		// Is it a reentrance ?
-		if (visited_objects->get(this, NULL))
-		{
-			return;
-		}
-
-		// will be set in as_object::clear_refs
-//		visited_objects->set(this, true);
+		as_object::clear_refs(walk, this_ptr);
 
-		as_object::clear_refs(visited_objects, this_ptr);
-
-		// clear display list
 		for (int i = 0; i < size(); i++)
 		{
-			as_object* obj = m_array[i].to_object();
-			if (obj)
-			{
-				obj->clear_refs(visited_objects, this_ptr);
-			}
+			walk->push(m_array[i].to_object());
 		}
 	}
 
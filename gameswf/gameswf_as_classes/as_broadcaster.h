@@ -31,6 +31,7 @@ namespace gameswf
 
 		as_listener(player* player);
 		virtual bool	get_member(const tu_stringi& name, as_value* val);
+		virtual bool	use_member_cache() const { return false; }
 		void add(as_object* listener);
 		void remove(as_object* listener);
 		int size() const;
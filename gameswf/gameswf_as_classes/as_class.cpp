@@ -17,22 +17,18 @@ namespace gameswf
 			return true;
 		}
 
-		for (int i = 0; i < m_class->m_trait.size(); i++)
+		int i = m_class->m_traits.find(name);
+		if (i >= 0)
 		{
 			traits_info* ti = m_class->m_trait[i].get();
-			const char* traits_name = m_class->m_abc->get_multiname(ti->m_name);
-
-			if( name == traits_name)
+			if(ti->m_kind == traits_info::Trait_Slot)
 			{
-				if(ti->m_kind == traits_info::Trait_Slot)
-				{
-					as_object * object = new as_object( get_player() );
-					set_member(name, object);
-					val->set_as_object( object );
-					return true;
-				}
-				return false;
+				as_object * object = new as_object( get_player() );
+				set_member(name, object);
+				val->set_as_object( object );
+				return true;
 			}
+			return false;
 		}
 
 		return as_object::find_property(name, val);
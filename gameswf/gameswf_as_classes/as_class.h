@@ -27,6 +27,7 @@ namespace gameswf
 		}
 
 		exported_module virtual bool	find_property( const tu_stringi & name, as_value * val );
+		virtual bool	use_member_cache() const { return false; }
 
 	private:
 
@@ -28,6 +28,7 @@ namespace gameswf
 
 		exported_module virtual bool	set_member(const tu_stringi& name, const as_value& val);
 		exported_module virtual bool	get_member(const tu_stringi& name, as_value* val);
+		virtual bool	use_member_cache() const { return false; }
 		
 		cxform m_color_transform;
 	};
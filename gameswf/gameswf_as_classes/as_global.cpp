@@ -161,10 +161,9 @@ namespace gameswf
 		if (props == NULL)
 		{
 			// Takes all members of the object and sets its property flags
-			for (stringi_hash<as_value>::const_iterator it = obj->m_members.begin(); 
-				it != obj->m_members.end(); ++it)
+			for (int i = 0; i < obj->m_members.size(); i++)
 			{
-				const as_value& val = it->second;
+				const as_value& val = obj->m_members.value_at(i);
 				int flags = val.get_flags();
 				flags = flags & (~false_flags);
 				flags |= true_flags;
@@ -174,16 +173,15 @@ namespace gameswf
 		else
 		{
 			// Takes all string type prop and sets property flags of obj[prop]
-			for (stringi_hash<as_value>::const_iterator it = props->m_members.begin(); 
-				it != props->m_members.end(); ++it)
+			for (int i = 0; i < props->m_members.size(); i++)
 			{
-				const as_value& key = it->second;
+				const as_value& key = props->m_members.value_at(i);
 				if (key.is_string())
 				{
-					stringi_hash<as_value>::iterator obj_it = obj->m_members.find(key.to_tu_string());
-					if (obj_it != obj->m_members.end())
+					int	index = obj->m_members.find_index(key.to_tu_string());
+					if (index >= 0)
 					{
-						const as_value& val = obj_it->second;
+						const as_value& val = obj->m_members.value_at(index);
 						int flags = val.get_flags();
 						flags = flags & (~false_flags);
 						flags |= true_flags;
@@ -209,6 +207,13 @@ namespace gameswf
 		m_time_remainder += delta_time;
 		if (m_time_remainder >= m_interval)
 		{
+			if (script_budget_yield(m_func->get_root()))
+			{
+				// The frame's scripts have used up their time,
+				// we're still due on the next advance.
+				return;
+			}
+
 			m_time_remainder = fmod(m_time_remainder - m_interval, m_interval);
 
 			as_environment env(m_func->get_player());
@@ -23,6 +23,7 @@ namespace gameswf
 		as_sharedobject( player * player );
 
 		bool	get_member(const tu_stringi& name, as_value* val);
+		virtual bool	use_member_cache() const { return false; }
 
 		static gc_ptr<as_object> get_local( const tu_string & name, player * player );
 
@@ -29,15 +29,14 @@ namespace gameswf
   
 	void string_concat(const fn_call& fn)
 	{
-		const tu_string& str = fn.this_value.to_tu_string();
-
-		tu_string result(str);
+		as_value result("");
+		result.concat(fn.this_value);
 		for (int i = 0; i < fn.nargs; i++)
 		{
-			result += fn.arg(i).to_string();
+			result.concat(fn.arg(i));
 		}
 
-		fn.result->set_tu_string(result);
+		*fn.result = result;
 	}
   
 	void string_from_char_code(const fn_call& fn)
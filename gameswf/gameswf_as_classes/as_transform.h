@@ -29,6 +29,7 @@ namespace gameswf
 
 		exported_module virtual bool	set_member(const tu_stringi& name, const as_value& val);
 		exported_module virtual bool	get_member(const tu_stringi& name, as_value* val);
+		virtual bool	use_member_cache() const { return false; }
 
 		gc_ptr<as_color_transform> m_color_transform;
 		gc_ptr<character> m_movie;
@@ -162,6 +162,7 @@ struct xmlnode_as_object : public gameswf::as_object
     log_msg("\tDeleting xmlnode_as_object at %p \n", this);
   };
 #endif
+  virtual bool	use_member_cache() const { return false; }
   virtual bool	get_member(const tu_stringi& name, as_value* val)
   {
     //printf("GET XMLNode MEMBER: %s at %p for object %p\n", name.c_str(), val, this);
@@ -341,6 +342,7 @@ struct xml_as_object : public gameswf::as_object
     log_msg("\tDeleting xml_as_object at %p\n", this);
   };
 #endif
+  virtual bool	use_member_cache() const { return false; }
   virtual bool	get_member(const tu_stringi& name, as_value* val)
   {
     //printf("GET XML MEMBER: %s at %p for object %p\n", name.c_str(), val, this);
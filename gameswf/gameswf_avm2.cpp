@@ -11,9 +11,11 @@
 #include "gameswf/gameswf_abc.h"
 #include "gameswf/gameswf_disasm.h"
 #include "gameswf/gameswf_character.h"
+#include "gameswf/gameswf_profiler.h"
 #include "gameswf_jit.h"
 #include "gameswf/gameswf_as_classes/as_array.h"
 #include "gameswf/gameswf_as_classes/as_class.h"
+#include "base/tu_file.h"
 
 namespace gameswf
 {
@@ -25,10 +27,14 @@ namespace gameswf
 		m_name( -1 ),
 		m_flags( 0 ),
 		m_method(method),
+		m_body_pos( -1 ),
+		m_body_size( 0 ),
 		m_max_stack( 0 ),
 		m_local_count( 0 ),
 		m_init_scope_depth( 0 ),
-		m_max_scope_depth( 0 )
+		m_max_scope_depth( 0 ),
+		m_call_count( 0 ),
+		m_run_count( 0 )
 	{
 		m_this_ptr = this;
 
@@ -38,12 +44,22 @@ namespace gameswf
 
 	as_3_function::~as_3_function()
 	{
+		for (int i = 0; i < m_site.size(); i++)
+		{
+			delete m_site[i];
+		}
 	}
 
 	void	as_3_function::operator()(const fn_call& fn)
 	// dispatch
 	{
 		assert(fn.env);
+		as_profiler_scope	profile(this);
+
+		if (m_body_pos >= 0)
+		{
+			read_body();
+		}
 
 		// try to use caller environment
 		// if the caller object has own environment then we use its environment
@@ -87,49 +103,197 @@ namespace gameswf
 		}
 
 #ifdef __GAMESWF_ENABLE_JIT__
+		// Compile hot methods.
+		if (m_call_count < get_jit_threshold() && get_use_jit())
+		{
+			if (++m_call_count == get_jit_threshold())
+			{
+				compile();
+			}
+		}
+#endif
+
+		// keep stack size on entry
+		int stack_size = env->size();
 
-		if( !m_compiled_code.is_valid() )
+		IF_VERBOSE_ACTION(log_msg("\nEX: call method #%d\n", m_method));
+
+		// Execute the actions.
+		execute(local_register, env, fn.result);
+
+		IF_VERBOSE_ACTION(log_msg("EX: ended #%d.\n\n", m_method));
+
+		if (stack_size != env->size())
 		{
-			compile();
-			m_compiled_code.initialize();
+			log_error("error: stack size on exit must be same as on entry, %d:%d \n",
+				stack_size, env->size());
+
+			// restore stack size
+			env->resize(stack_size);
 		}
 
-#endif
+	}
 
-		if( m_compiled_code.is_valid() )
+	Sint32	avm2_wrap_int(double val)
+	{
+		if (isnan(val) || isinf(val))
 		{
-			try
-			{
-				m_compiled_code.call< array<as_value>&, vm_stack&, vm_stack&, as_value* >
-					(local_register, *env, env->m_scope, fn.result );
-			}
-			catch( ... )
-			{
-				log_msg( "jitted code crashed" );
-			}
+			return 0;
 		}
-		else
+		double d = fmod(val < 0 ? ceil(val) : floor(val), 4294967296.0);
+		if (d < 0)
 		{
-			// keep stack size on entry
-			int stack_size = env->size();
+			d += 4294967296.0;
+		}
+		return (Sint32) (Uint32) d;
+	}
 
-			IF_VERBOSE_ACTION(log_msg("\nEX: call method #%d\n", m_method));
+	void	avm2_numeric_op(int opcode, vm_stack& stack)
+	{
+		as_value& a = stack.top(0);
+		switch (opcode)
+		{
+			// Unary.
+			case 0x73: a.set_number(avm2_to_int(a)); return;	// convert_i
+			case 0x74: a.set_number((Uint32) avm2_to_int(a)); return;	// convert_u
+			case 0x75: a.set_number(avm2_to_number(a)); return;	// convert_d
+			case 0x76: a.set_bool(a.to_bool()); return;	// convert_b
+			case 0x90: a.set_number(- avm2_to_number(a)); return;	// negate
+			case 0x91: a.set_number(avm2_to_number(a) + 1); return;	// increment
+			case 0x93: a.set_number(avm2_to_number(a) - 1); return;	// decrement
+			case 0x96: a.set_bool(!a.to_bool()); return;	// not
+			case 0x97: a.set_number(~avm2_to_int(a)); return;	// bitnot
+			case 0xC0: a.set_number((Sint32) ((Uint32) avm2_to_int(a) + 1)); return;	// increment_i
+			case 0xC1: a.set_number((Sint32) ((Uint32) avm2_to_int(a) - 1)); return;	// decrement_i
+			case 0xC4: a.set_number((Sint32) (0 - (Uint32) avm2_to_int(a))); return;	// negate_i
+		}
 
-			// Execute the actions.
-			execute(local_register, env, fn.result);
+		// Binary, value1 op value2 => result.
+		as_value& b = a;
+		as_value& r = stack.top(1);
+		switch (opcode)
+		{
+			case 0xA0:	// add
+				if (r.is_numeric() && b.is_numeric())
+				{
+					r.set_number(r.get_number() + b.get_number());
+				}
+				else if (r.is_string() || b.is_string())
+				{
+					tu_string str = r.to_string();
+					str += b.to_string();
+					r.set_tu_string(str);
+				}
+				else
+				{
+					r.set_number(avm2_to_number(r) + avm2_to_number(b));
+				}
+				break;
 
-			IF_VERBOSE_ACTION(log_msg("EX: ended #%d.\n\n", m_method));
+			case 0xA1: r.set_number(avm2_to_number(r) - avm2_to_number(b)); break;	// subtract
+			case 0xA2: r.set_number(avm2_to_number(r) * avm2_to_number(b)); break;	// multiply
+			case 0xA3: r.set_number(avm2_to_number(r) / avm2_to_number(b)); break;	// divide
+			case 0xA4: r.set_number(fmod(avm2_to_number(r), avm2_to_number(b))); break;	// modulo
+			case 0xA5: r.set_number((Sint32) ((Uint32) avm2_to_int(r) << (avm2_to_int(b) & 0x1F))); break;	// lshift
+			case 0xA6: r.set_number(avm2_to_int(r) >> (avm2_to_int(b) & 0x1F)); break;	// rshift
+			case 0xA7: r.set_number((Uint32) avm2_to_int(r) >> (avm2_to_int(b) & 0x1F)); break;	// urshift
+			case 0xA8: r.set_number(avm2_to_int(r) & avm2_to_int(b)); break;	// bitand
+			case 0xA9: r.set_number(avm2_to_int(r) | avm2_to_int(b)); break;	// bitor
+			case 0xAA: r.set_number(avm2_to_int(r) ^ avm2_to_int(b)); break;	// bitxor
+			case 0xAB: r.set_bool(as_value::abstract_equality_comparison(r, b)); break;	// equals
+			case 0xAC: r.set_bool(r == b); break;	// strictequals
+			case 0xAD: r.set_bool(avm2_to_number(r) < avm2_to_number(b)); break;	// lessthan
+			case 0xAE: r.set_bool(avm2_to_number(r) <= avm2_to_number(b)); break;	// lessequals
+			case 0xAF: r.set_bool(avm2_to_number(r) > avm2_to_number(b)); break;	// greaterthan
+			case 0xB0: r.set_bool(avm2_to_number(r) >= avm2_to_number(b)); break;	// greaterequals
+			case 0xC5: r.set_number((Sint32) ((Uint32) avm2_to_int(r) + (Uint32) avm2_to_int(b))); break;	// add_i
+			case 0xC6: r.set_number((Sint32) ((Uint32) avm2_to_int(r) - (Uint32) avm2_to_int(b))); break;	// subtract_i
+			case 0xC7: r.set_number((Sint32) ((Uint32) avm2_to_int(r) * (Uint32) avm2_to_int(b))); break;	// multiply_i
+
+			default:
+				assert(0);
+				break;
+		}
 
-			if (stack_size != env->size())
-			{
-				log_error("error: stack size on exit must be same as on entry, %d:%d \n",
-					stack_size, env->size());
+		if (b.is_numeric())
+		{
+			stack.drop_number();
+		}
+		else
+		{
+			stack.drop(1);
+		}
+	}
 
-				// restore stack size
-				env->resize(stack_size);
+	void	avm2_local_op(int opcode, as_value* reg)
+	{
+		switch (opcode)
+		{
+			case 0x92: reg->set_number(avm2_to_number(*reg) + 1); break;	// inclocal
+			case 0x94: reg->set_number(avm2_to_number(*reg) - 1); break;	// declocal
+			case 0xC2: reg->set_number((Sint32) ((Uint32) avm2_to_int(*reg) + 1)); break;	// inclocal_i
+			case 0xC3: reg->set_number((Sint32) ((Uint32) avm2_to_int(*reg) - 1)); break;	// declocal_i
+			default:
+				assert(0);
+				break;
+		}
+	}
+
+	bool	avm2_branch_taken(int opcode, vm_stack& stack)
+	{
+		bool taken;
+		if (opcode == 0x11 || opcode == 0x12)
+		{
+			// iftrue, iffalse
+			taken = stack.top(0).to_bool() == (opcode == 0x11);
+			stack.drop(1);
+			return taken;
+		}
+
+		const as_value& a = stack.top(1);
+		const as_value& b = stack.top(0);
+		switch (opcode)
+		{
+			case 0x13: taken = as_value::abstract_equality_comparison(a, b); break;	// ifeq
+			case 0x14: taken = !as_value::abstract_equality_comparison(a, b); break;	// ifne
+			case 0x19: taken = a == b; break;	// ifstricteq
+			case 0x1A: taken = a != b; break;	// ifstrictne
+			default:
+			{
+				// Compared as Numbers, like lessthan.  The "not"
+				// forms are taken when a NaN makes the comparison
+				// false.
+				double x = avm2_to_number(a);
+				double y = avm2_to_number(b);
+				switch (opcode)
+				{
+					case 0x0C: taken = !(x < y); break;	// ifnlt
+					case 0x0D: taken = !(x <= y); break;	// ifnle
+					case 0x0E: taken = !(x > y); break;	// ifngt
+					case 0x0F: taken = !(x >= y); break;	// ifnge
+					case 0x15: taken = x < y; break;	// iflt
+					case 0x16: taken = x <= y; break;	// ifle
+					case 0x17: taken = x > y; break;	// ifgt
+					case 0x18: taken = x >= y; break;	// ifge
+					default:
+						assert(0);
+						taken = false;
+						break;
+				}
+				break;
 			}
 		}
 
+		if (a.is_numeric() && b.is_numeric())
+		{
+			stack.drop_number();
+			stack.drop_number();
+		}
+		else
+		{
+			stack.drop(2);
+		}
+		return taken;
 	}
 
 	// interperate action script bytecode
@@ -147,62 +311,84 @@ namespace gameswf
 			return;
 		}
 
+		m_abc->resolve_multinames(get_player()->m_atoms);
+		if (m_run_count < 2)
+		{
+			m_run_count++;
+		}
+
+#ifdef __GAMESWF_ENABLE_JIT__
+		// Run the compiled code where there is some.  It comes
+		// back here for the instructions it doesn't know.
+		bool use_jit = m_jit_entry.size() > 0 && get_use_jit() && get_verbose_action() == false;
+		avm2_jit_context jit_context = { this, &lregister, env, result };
+#endif
+
+		// m_code doesn't change while the method runs.
+		const Uint8* code = (const Uint8*) m_code.data();
+
 		int ip = 0;
 		do
 		{
-			Uint8 opcode = m_code[ip++];
-			switch (opcode)
+#ifdef __GAMESWF_ENABLE_JIT__
+			if (use_jit && m_jit_entry[ip] >= 0)
 			{
-			case 0x11: // iftrue
+				ip = m_compiled_code.call_at(m_jit_entry[ip], &jit_context);
+				if (ip < 0)
 				{
-					bool taken;
-					//Follows ECMA-262 11.9.3
-					taken = stack.top(0).to_bool();
-					stack.drop(1);
-					if (taken)
-					{
-						int offset = m_code[ip] | m_code[ip+1]<<8 | m_code[ip+2]<<16;
-						ip += offset;
-					}
-
-					ip += 3;
-
-					IF_VERBOSE_ACTION(log_msg("EX: iftrue\t %s\n", taken? "taken": "not taken"));
-				} break;
+					// returned
+					return;
+				}
+				continue;
+			}
+#endif
 
-				case 0x12: // iffalse
+			Uint8 opcode = code[ip++];
+			switch (opcode)
+			{
+				case 0x08:	// kill
 				{
-					bool taken;
-					//Follows ECMA-262 11.9.3
-					taken = !stack.top(0).to_bool();
-					stack.drop(1);
-					if (taken)
-					{
-						int offset = m_code[ip] | m_code[ip+1]<<8 | m_code[ip+2]<<16;
-						ip += offset;
-					}
+					int index;
+					ip += read_vu30(index, &code[ip]);
+					lregister[index].set_undefined();
+					IF_VERBOSE_ACTION(log_msg("EX: kill\t %d\n", index));
+					break;
+				}
 
-					ip += 3;
+				case 0x09:	// label
+					IF_VERBOSE_ACTION(log_msg("EX: label\n"));
+					break;
 
-					IF_VERBOSE_ACTION(log_msg("EX: iffalse\t %s\n", taken? "taken": "not taken"));
-				} break;
+				case 0x10:	// jump
+					ip += 3 + read_s24(&code[ip]);
+					IF_VERBOSE_ACTION(log_msg("EX: jump\t %d\n", ip));
+					break;
 
-				case 0x14: // ifne
+				case 0x0C:	// ifnlt
+				case 0x0D:	// ifnle
+				case 0x0E:	// ifngt
+				case 0x0F:	// ifnge
+				case 0x11:	// iftrue
+				case 0x12:	// iffalse
+				case 0x13:	// ifeq
+				case 0x14:	// ifne
+				case 0x15:	// iflt
+				case 0x16:	// ifle
+				case 0x17:	// ifgt
+				case 0x18:	// ifge
+				case 0x19:	// ifstricteq
+				case 0x1A:	// ifstrictne
 				{
-					bool taken;
-					//Follows ECMA-262 11.9.3
-					taken = !as_value::abstract_equality_comparison(scope[ scope.size() - 2 ], scope[ scope.size() - 1 ]);
+					bool taken = avm2_branch_taken(opcode, stack);
 					if (taken)
 					{
-						int offset = m_code[ip] | m_code[ip+1]<<8 | m_code[ip+2]<<16;
-						ip += offset;
+						ip += read_s24(&code[ip]);
 					}
-
 					ip += 3;
 
-					IF_VERBOSE_ACTION(log_msg("EX: ifne\t %s\n", taken? "taken": "not taken"));
-
-				} break;
+					IF_VERBOSE_ACTION(log_msg("EX: if 0x%02X\t %s\n", opcode, taken ? "taken" : "not taken"));
+					break;
+				}
 
 				case 0x1D: // popscope
 				{
@@ -224,8 +410,7 @@ namespace gameswf
 
 				case 0x24:	// pushbyte
 				{
-					int byte_value;
-					ip += read_vu30(byte_value, &m_code[ip]);
+					int byte_value = (Sint8) code[ip++];
 					stack.push(byte_value);
 
 					IF_VERBOSE_ACTION(log_msg("EX: pushbyte\t %d\n", byte_value));
@@ -236,7 +421,8 @@ namespace gameswf
 				case 0x25:  // pushshort
 				{
 					int val;
-					ip += read_vu30(val, &m_code[ip]);
+					ip += read_vu30(val, &code[ip]);
+					val = (Sint16) val;
 					stack.push(val);
 					IF_VERBOSE_ACTION(log_msg("EX: pushshort\t %d\n", val));
 					break;
@@ -258,6 +444,11 @@ namespace gameswf
 				}
 				break;
 
+				case 0x28:	// pushnan
+					stack.push(get_nan());
+					IF_VERBOSE_ACTION(log_msg("EX: pushnan\n"));
+					break;
+
 				case 0x29:  // pop the value from stack and discard it
 				{
 					stack.pop();
@@ -271,10 +462,29 @@ namespace gameswf
 					stack.push(stack.top(0));
 				} break;
 
+				case 0x2B:	// swap
+				{
+					as_value tmp = stack.top(0);
+					stack.top(0) = stack.top(1);
+					stack.top(1) = tmp;
+					IF_VERBOSE_ACTION(log_msg("EX: swap\n"));
+					break;
+				}
+
+				case 0x2E:	// pushuint
+				{
+					int index;
+					ip += read_vu30(index, &code[ip]);
+					double val = m_abc->get_uinteger(index);
+					stack.push(val);
+					IF_VERBOSE_ACTION(log_msg("EX: pushuint\t %.0f\n", val));
+					break;
+				}
+
 				case 0x2D:	// pushint
 				{
 					int index;
-					ip += read_vu30(index, &m_code[ip]);
+					ip += read_vu30(index, &code[ip]);
 					int val = m_abc->get_integer(index);
 					stack.push(val);
 
@@ -286,7 +496,7 @@ namespace gameswf
 				case 0x2C:	// pushstring
 				{
 					int index;
-					ip += read_vu30(index, &m_code[ip]);
+					ip += read_vu30(index, &code[ip]);
 					const char* val = m_abc->get_string(index);
 					stack.push(val);
 
@@ -298,7 +508,7 @@ namespace gameswf
 				case 0x2F:	// pushdouble
 				{
 					int index;
-					ip += read_vu30(index, &m_code[ip]);
+					ip += read_vu30(index, &code[ip]);
 					double val = m_abc->get_double(index);
 					stack.push(val);
 
@@ -319,12 +529,13 @@ namespace gameswf
 
 				case 0x46:  // callproperty
 				{
+					int start = ip - 1;
 					int index;
-					ip += read_vu30(index, &m_code[ip]);
+					ip += read_vu30(index, &code[ip]);
 					const char* name = m_abc->get_multiname(index);
 
 					int arg_count;
-					ip += read_vu30(arg_count, &m_code[ip]);
+					ip += read_vu30(arg_count, &code[ip]);
 
 					as_environment env(get_player());
 					for (int i = 0; i < arg_count; i++)
@@ -343,7 +554,7 @@ namespace gameswf
 
 						result.set_undefined();
 
-						if( obj &&  obj->get_member(name, &func))
+						if( obj && get_member(start, obj, index, &func) )
 						{
 							if( func.is_function() )
 							{
@@ -390,7 +601,7 @@ namespace gameswf
 				{
 					// stack: object, arg1, arg2, ..., argn
 					int arg_count;
-					ip += read_vu30(arg_count, &m_code[ip]);
+					ip += read_vu30(arg_count, &code[ip]);
 
 					as_environment env(get_player());
 					for (int i = 0; i < arg_count; i++)
@@ -438,13 +649,13 @@ namespace gameswf
 				// Stack ..., obj, [ns], [name], arg1,...,argn => ..., value
 				{
 					int index;
-					ip += read_vu30(index, &m_code[ip]);
+					ip += read_vu30(index, &code[ip]);
 					const char* name = m_abc->get_multiname(index);
 					const char * name_space = m_abc->get_multiname_namespace(index);
 					UNUSED(name_space);
 
 					int arg_count;
-					ip += read_vu30(arg_count, &m_code[ip]);
+					ip += read_vu30(arg_count, &code[ip]);
 
 					as_environment env(get_player());
 					for (int i = 0; i < arg_count; i++)
@@ -475,12 +686,13 @@ namespace gameswf
 				case 0x4F:	// callpropvoid, Call a property, discarding the return value.
 				// Stack: ..., obj, [ns], [name], arg1,...,argn => ...
 				{
+					int start = ip - 1;
 					int index;
-					ip += read_vu30(index, &m_code[ip]);
+					ip += read_vu30(index, &code[ip]);
 					const char* name = m_abc->get_multiname(index);
 
 					int arg_count;
-					ip += read_vu30(arg_count, &m_code[ip]);
+					ip += read_vu30(arg_count, &code[ip]);
 
 					as_environment env(get_player());
 					for (int i = 0; i < arg_count; i++)
@@ -493,7 +705,7 @@ namespace gameswf
 
 					as_value func, func2;
 
-					if( obj &&  obj->get_member(name, &func))
+					if( obj && get_member(start, obj, index, &func) )
 					{
 						if( func.is_function() )
 						{
@@ -515,7 +727,7 @@ namespace gameswf
 				{
 					int arg_count;
 					
-					ip += read_vu30(arg_count, &m_code[ip]);
+					ip += read_vu30(arg_count, &code[ip]);
 
 					as_array * array = new as_array( get_player() );
 					
@@ -537,7 +749,7 @@ namespace gameswf
 				{
 					// stack:	..., basetype => ..., newclass
 					int class_index;
-					ip += read_vu30( class_index, &m_code[ip] );
+					ip += read_vu30( class_index, &code[ip] );
 
 					IF_VERBOSE_ACTION(log_msg("EX: newclass\t class index:%i\n", class_index));
 
@@ -558,17 +770,18 @@ namespace gameswf
 
 				case 0x5D:	// findpropstrict
 				{
+					int start = ip - 1;
 					int index;
-					ip += read_vu30(index, &m_code[ip]);
+					ip += read_vu30(index, &code[ip]);
 					const char* name = m_abc->get_multiname(index);
 
 					// search property in scope
-					as_object* obj = scope.find_property(name);
+					as_object* obj = find_property(start, index, scope);
 
 					//Search for a script entry to execute
 
-					as_function* func = m_abc->get_script_function(name);
-					if (obj == NULL && func != NULL)
+					as_function* func = obj == NULL ? m_abc->get_script_function(name) : NULL;
+					if (func != NULL)
 					{
 						get_global()->set_member( name, new as_object( get_player() ) );
 
@@ -586,13 +799,14 @@ namespace gameswf
 
 				case 0x5E:	// findproperty, Search the scope stack for a property
 				{
+					int start = ip - 1;
 					int index;
-					ip += read_vu30(index, &m_code[ip]);
+					ip += read_vu30(index, &code[ip]);
 					const char* name = m_abc->get_multiname(index);
 					const char * name_space = m_abc->get_multiname_namespace(index);
 					UNUSED(name_space);
 
-					as_object* obj = scope.find_property(name);
+					as_object* obj = find_property(start, index, scope);
 
 					if( obj )
 					{
@@ -610,13 +824,14 @@ namespace gameswf
 
 				case 0x60:	// getlex, Find and get a property.
 				{
+					int start = ip - 1;
 					int index;
-					ip += read_vu30(index, &m_code[ip]);
+					ip += read_vu30(index, &code[ip]);
 					const char* name = m_abc->get_multiname(index);
 
 					// search and get property in scope
 					as_value val;
-					scope.get_property(name, &val);
+					get_lex(start, index, scope, &val);
 
 					if(val.is_undefined())
 					{
@@ -642,8 +857,9 @@ namespace gameswf
 
 				case 0x61: // setproperty
 				{
+					int start = ip - 1;
 					int index;
-					ip += read_vu30(index, &m_code[ip]);
+					ip += read_vu30(index, &code[ip]);
 					const char* name = m_abc->get_multiname(index);
 
 					IF_VERBOSE_ACTION(log_msg("EX: setproperty\t %s.%s, value=%s\n", stack.top(1).to_xstring(), name, stack.top(0).to_xstring()));
@@ -652,7 +868,7 @@ namespace gameswf
 
 					if( object )
 					{
-						object->set_member( name, stack.top(0) );
+						set_member( start, object, index, stack.top(0) );
 					}
 
 					stack.drop( 2 );
@@ -662,28 +878,28 @@ namespace gameswf
 				case 0x62: // getlocal
 					{
 						int index;
-						ip += read_vu30(index, &m_code[ip]);
+						ip += read_vu30(index, &code[ip]);
 
 						IF_VERBOSE_ACTION(log_msg("EX: getlocal\t index=%i, value=%s\n", index, lregister[index].to_xstring()));
 
-						stack.push(lregister[index]);
+						avm2_push(stack, lregister[index]);
 
 					} break;
 
 				case 0x63: // setlocal
 				{
 					int index;
-					ip += read_vu30(index, &m_code[ip]);
+					ip += read_vu30(index, &code[ip]);
 
 					IF_VERBOSE_ACTION(log_msg("EX: setlocal\t index=%i, value=%s\n", index, stack.top(0).to_xstring()));
 
-					lregister[index] = stack.pop();
+					avm2_assign(&lregister[index], stack.pop());
 
 				} break;
 
 				case 0x65: // getscopeobject
 				{
-					int index = m_code[ip];
+					int index = code[ip];
 					++ip;
 
 					assert( index < scope.size() );
@@ -696,36 +912,31 @@ namespace gameswf
 
 				case 0x66:	// getproperty
 				{
+					int start = ip - 1;
 					int index;
-					ip += read_vu30(index, &m_code[ip]);
-					tu_string name = get_multiname(index, stack);
+					ip += read_vu30(index, &code[ip]);
 
-					as_object* obj = stack.top(0).to_object();
-					if (obj)
-					{
-						obj->get_member(name, &stack.top(0));
-					}
-					else
-					{
-						stack.top(0).set_undefined();
-					}
+					get_property(start, index, stack);
 
-					IF_VERBOSE_ACTION(log_msg("EX: getproperty\t %s, value=%s\n", name.c_str(), stack.top(0).to_xstring()));
+					IF_VERBOSE_ACTION(log_msg("EX: getproperty\t %s, value=%s\n",
+						m_abc->get_multiname_type(index) == multiname::CONSTANT_MultinameL ? "[name]" : m_abc->get_multiname(index),
+						stack.top(0).to_xstring()));
 
 					break;
 				}
 
 				case 0x68:	// initproperty, Initialize a property.
 				{
+					int start = ip - 1;
 					int index;
-					ip += read_vu30(index, &m_code[ip]);
+					ip += read_vu30(index, &code[ip]);
 					const char* name = m_abc->get_multiname(index);
 
 					as_value& val = stack.top(0);
 					as_object* obj = stack.top(1).to_object();
 					if (obj)
 					{
-						obj->set_member(name, val);
+						set_member(start, obj, index, val);
 					}
 
 					IF_VERBOSE_ACTION(log_msg("EX: initproperty\t 0x%p.%s=%s\n", obj, name, val.to_xstring()));
@@ -734,16 +945,34 @@ namespace gameswf
 					break;
 				}
 
-				case 0x73: //convert_i
+				case 0x6C:	// getslot
 				{
-					stack.top(0).set_int( stack.top(0).to_int() );
-					IF_VERBOSE_ACTION(log_msg("EX: convert_i : %i \n", stack.top(0).to_int())); 
-				} break;
+					int start = ip - 1;
+					int slot_id;
+					ip += read_vu30(slot_id, &code[ip]);
+
+					get_slot(start, slot_id, stack);
+
+					IF_VERBOSE_ACTION(log_msg("EX: getslot\t %d, value=%s\n", slot_id, stack.top(0).to_xstring()));
+					break;
+				}
+
+				case 0x6D:	// setslot
+				{
+					int start = ip - 1;
+					int slot_id;
+					ip += read_vu30(slot_id, &code[ip]);
+
+					IF_VERBOSE_ACTION(log_msg("EX: setslot\t %s.%d, value=%s\n", stack.top(1).to_xstring(), slot_id, stack.top(0).to_xstring()));
+
+					set_slot(start, slot_id, stack);
+					break;
+				}
 
 				case 0x80: // coerce
 				{
 					int index;
-					ip += read_vu30( index, &m_code[ip]);
+					ip += read_vu30( index, &code[ip]);
 					const char * type_name = m_abc->get_multiname( index );
 					IF_VERBOSE_ACTION(log_msg("EX: coerce : %s todo\n", type_name)); 
 				} break;
@@ -754,80 +983,63 @@ namespace gameswf
 					IF_VERBOSE_ACTION(log_msg("EX: coerce_s : %s\n", stack.top(0).to_string())); 
 				} break;
 
-				case 0x96: // not
+				case 0x73:	// convert_i
+				case 0x74:	// convert_u
+				case 0x75:	// convert_d
+				case 0x76:	// convert_b
+				case 0x90:	// negate
+				case 0x91:	// increment
+				case 0x93:	// decrement
+				case 0x96:	// not
+				case 0x97:	// bitnot
+				case 0xA0:	// add
+				case 0xA1:	// subtract
+				case 0xA2:	// multiply
+				case 0xA3:	// divide
+				case 0xA4:	// modulo
+				case 0xA5:	// lshift
+				case 0xA6:	// rshift
+				case 0xA7:	// urshift
+				case 0xA8:	// bitand
+				case 0xA9:	// bitor
+				case 0xAA:	// bitxor
+				case 0xAB:	// equals
+				case 0xAC:	// strictequals
+				case 0xAD:	// lessthan
+				case 0xAE:	// lessequals
+				case 0xAF:	// greaterthan
+				case 0xB0:	// greaterequals
+				case 0xC0:	// increment_i
+				case 0xC1:	// decrement_i
+				case 0xC4:	// negate_i
+				case 0xC5:	// add_i
+				case 0xC6:	// subtract_i
+				case 0xC7:	// multiply_i
 				{
-					stack.top(0).set_bool( !stack.top(0).to_bool() );
-
-					IF_VERBOSE_ACTION(log_msg("EX: not\n"));
-
-				} break;
-
-				case 0xA0:	// Add two values
-				{
-					if (stack.top(0).is_string() || stack.top(1).is_string())
-					{
-						tu_string str = stack.top(1).to_string();
-						str += stack.top(0).to_string();
-						stack.top(1).set_tu_string(str);
-					}
-					else
-					{
-						stack.top(1) += stack.top(0).to_number();
-					}
-					stack.drop(1);
-
+					avm2_numeric_op(opcode, stack);
+					IF_VERBOSE_ACTION(log_msg("EX: op 0x%02X\t %s\n", opcode, stack.top(0).to_xstring()));
 					break;
 				}
 
-				case 0xA2: // multiply
+				case 0x92:	// inclocal
+				case 0x94:	// declocal
+				case 0xC2:	// inclocal_i
+				case 0xC3:	// declocal_i
 				{
-					stack.top(1) = stack.top(1).to_number() * stack.top(0).to_number();
-					stack.drop(1);
-
-					IF_VERBOSE_ACTION(log_msg("EX: multiply\n"));
-					
+					int index;
+					ip += read_vu30(index, &code[ip]);
+					avm2_local_op(opcode, &lregister[index]);
+					IF_VERBOSE_ACTION(log_msg("EX: op 0x%02X\t %d, value=%s\n", opcode, index, lregister[index].to_xstring()));
 					break;
 				}
 
-				case 0xAB: // equals
-				{
-					bool result = as_value::abstract_equality_comparison( stack.top(1), stack.top(0) );
-
-					IF_VERBOSE_ACTION(log_msg("EX: equals %s & %s : %s\n", stack.top(0).to_xstring(), stack.top(1).to_xstring(), result? "true":"false") );
-
-					stack.drop(1);
-					stack.top(0).set_bool( result );
-				} break;
-
-				case 0xAD: //lessthan
-				{
-					as_value result = as_value::abstract_relational_comparison( stack.top(1), stack.top(0) );
-
-					IF_VERBOSE_ACTION(log_msg("EX: lessthan %s & %s : %s\n", stack.top(1).to_xstring(), stack.top(0).to_xstring(), result.to_string() ) );
-
-					stack.drop(1);
-					stack.top(0) = result;
-				} break;
-
-				case 0xC2:  // inclocal_i
-				{
-					int index;
-					ip += read_vu30(index, &m_code[ip]);
-
-					as_value & reg = lregister[ index ];
-					reg.set_int( reg.to_int() + 1 );
-
-					IF_VERBOSE_ACTION(log_msg("EX: inclocal_i %i\n", index ) );
-					
-				}break;
-
 				case 0xD0:	// getlocal_0
 				case 0xD1:	// getlocal_1
 				case 0xD2:	// getlocal_2
 				case 0xD3:	// getlocal_3
 				{
 					as_value& val = lregister[opcode & 0x03];
-					stack.push(val);
+					avm2_push(stack, val);
 					IF_VERBOSE_ACTION(log_msg("EX: getlocal_%d\t %s\n", opcode & 0x03, val.to_xstring()));
 					break;
 				}
@@ -837,7 +1049,7 @@ namespace gameswf
 				case 0xD6:	// setlocal_2
 				case 0xD7:	// setlocal_3
 				{
-					lregister[opcode & 0x03] = stack.pop();
+					avm2_assign(&lregister[opcode & 0x03], stack.pop());
 
 					IF_VERBOSE_ACTION(log_msg("EX: setlocal_%d\t %s\n", opcode & 0x03, lregister[opcode & 0x03].to_xstring()));
 					break;
@@ -932,21 +1144,346 @@ namespace gameswf
 
 	}
 
-	tu_string as_3_function::get_multiname(int index, vm_stack & stack) const
+	void as_3_function::read_body()
+	// Decode our body from the abc_def, the first time we run.
+	{
+		assert(m_body_pos >= 0);
+		membuf& data = m_abc->m_body_data;
+		tu_file file(tu_file::memory_buffer, data.size(), data.data());
+		stream in(&file);
+		in.set_position(m_body_pos);
+		m_body_pos = -1;
+		read_body(&in);
+	}
+
+	void as_3_function::skip_body(stream* in)
+	// Same layout as read_body(stream*).
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			in->read_vu30();	// max_stack, local_count, init_scope_depth, max_scope_depth
+		}
+
+		int code_length = in->read_vu30();
+		in->set_position(in->get_position() + code_length);
+
+		int n = in->read_vu30();	// exception_count
+		for (int i = 0; i < n * 5; i++)
+		{
+			in->read_vu30();	// from, to, target, exc_type, var_name
+		}
+
+		n = in->read_vu30();	// trait_count
+		for (int i = 0; i < n; i++)
+		{
+			traits_info::skip(in);
+		}
+	}
+
+	avm2_site* as_3_function::get_site(int ip)
+	{
+		// Most methods run once (initializers, frame scripts),
+		// it is not worth keeping the caches of those.
+		if (m_run_count < 2)
+		{
+			return NULL;
+		}
+
+		if (m_site.size() == 0)
+		{
+			m_site.resize(m_code.size());
+			for (int i = 0; i < m_site.size(); i++)
+			{
+				m_site[i] = NULL;
+			}
+		}
+
+		avm2_site* site = m_site[ip];
+		if (site == NULL)
+		{
+			site = new avm2_site();
+			m_site[ip] = site;
+		}
+		return site;
+	}
+
+	as_object* as_3_function::find_property(int ip, int index, vm_stack& scope)
+	// Same as scope.find_property(name).
+	{
+		const tu_string& name = m_abc->get_multiname_string(index);
+		avm2_site* site = get_site(ip);
+		if (site == NULL)
+		{
+			return scope.find_property(name.c_str());
+		}
+
+		as_object* owner;
+		if (site->m_scope.find(scope, &owner) >= 0)
+		{
+			return owner;
+		}
+
+		for (int i = scope.size() - 1; i >= 0; i--)
+		{
+			as_value val;
+			if (scope[i].find_property_owner(name, &val))
+			{
+				owner = val.to_object();
+				if (owner)
+				{
+					site->m_scope.fill(scope, i, owner);
+				}
+				return owner;
+			}
+		}
+		return NULL;
+	}
+
+	bool as_3_function::get_lex(int ip, int index, vm_stack& scope, as_value* val)
+	// Same as scope.get_property(name, val).
+	{
+		const tu_string& name = m_abc->get_multiname_string(index);
+		avm2_site* site = get_site(ip);
+		if (site == NULL)
+		{
+			return scope.get_property(name.c_str(), val);
+		}
+
+		int atom = m_abc->get_multiname_atom(index);
+		as_object* owner;
+		if (site->m_scope.find(scope, &owner) >= 0)
+		{
+			return site->m_member.get_member(owner, name, atom, val);
+		}
+
+		for (int i = scope.size() - 1; i >= 0; i--)
+		{
+			as_object* obj = scope[i].to_object();
+			bool found = obj ? site->m_member.get_member(obj, name, atom, val) : scope[i].find_property(name, val);
+			if (found)
+			{
+				if (obj)
+				{
+					site->m_scope.fill(scope, i, obj);
+				}
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool as_3_function::get_member(int ip, as_object* obj, int index, as_value* val)
+	{
+		return get_member(ip, obj, m_abc->get_multiname_string(index), m_abc->get_multiname_atom(index), val);
+	}
+
+	void as_3_function::set_member(int ip, as_object* obj, int index, const as_value& val)
+	{
+		set_member(ip, obj, m_abc->get_multiname_string(index), m_abc->get_multiname_atom(index), val);
+	}
+
+	bool as_3_function::get_member(int ip, as_object* obj, const tu_string& name, int atom, as_value* val)
 	{
-		multiname::kind kind = (multiname::kind)m_abc->get_multiname_type( index );
-		switch( kind )
-		{
-		case multiname::CONSTANT_MultinameL :
-			assert(stack.top(0).is_string() || stack.top(0).is_number());
-			return stack.pop().to_string();
-			break;
-		case multiname::CONSTANT_Multiname:
-		case multiname::CONSTANT_QName:
-			return m_abc->get_multiname(index);
-		default:
-			assert(!"todo");
-			return "";
+		avm2_site* site = get_site(ip);
+		if (site)
+		{
+			return site->m_member.get_member(obj, name, atom, val);
+		}
+		return obj->get_member_atom(atom, name, val);
+	}
+
+	void as_3_function::set_member(int ip, as_object* obj, const tu_string& name, int atom, const as_value& val)
+	{
+		avm2_site* site = get_site(ip);
+		if (site)
+		{
+			site->m_member.set_member(obj, name, atom, val);
+		}
+		else
+		{
+			obj->set_member_atom(atom, name, val);
+		}
+	}
+
+	void as_3_function::get_property(int ip, int index, vm_stack& stack)
+	{
+		as_value val;
+		switch (m_abc->get_multiname_type(index))
+		{
+			case multiname::CONSTANT_MultinameL:
+			{
+				assert(stack.top(0).is_string() || stack.top(0).is_number());
+				as_value name = stack.pop();
+				as_object* obj = stack.top(0).to_object();
+				if (obj)
+				{
+					get_member(ip, obj, name.to_tu_string(), name.get_atom(), &val);
+				}
+				break;
+			}
+
+			case multiname::CONSTANT_Multiname:
+			case multiname::CONSTANT_QName:
+			{
+				as_object* obj = stack.top(0).to_object();
+				if (obj)
+				{
+					get_member(ip, obj, index, &val);
+				}
+				break;
+			}
+
+			default:
+				assert(!"todo");
+				break;
+		}
+
+		// obj may go with the value it held.
+		stack.top(0) = val;
+	}
+
+	static traits_info* find_slot(as_object* obj, int slot_id, abc_def** abc)
+	// The trait of the slot declared by the class of obj.
+	{
+		instance_info* ii = obj ? obj->m_instance.get_ptr() : NULL;
+		if (ii == NULL)
+		{
+			return NULL;
+		}
+
+		int i = ii->m_traits.find_slot(slot_id);
+		if (i < 0)
+		{
+			return NULL;
+		}
+		*abc = ii->m_abc.get_ptr();
+		(*abc)->resolve_multinames(obj->get_player()->m_atoms);
+		return ii->m_trait[i].get();
+	}
+
+	void as_3_function::get_slot(int ip, int slot_id, vm_stack& stack)
+	// Slots are members named after their trait.
+	{
+		as_value val;
+		as_object* obj = stack.top(0).to_object();
+		abc_def* abc = NULL;
+		traits_info* ti = find_slot(obj, slot_id, &abc);
+		if (ti)
+		{
+			get_member(ip, obj,
+				abc->get_multiname_string(ti->m_name), abc->get_multiname_atom(ti->m_name), &val);
+		}
+		else
+		{
+			log_error("error: getslot, %s has no slot %d\n", stack.top(0).to_xstring(), slot_id);
+		}
+		stack.top(0) = val;
+	}
+
+	void as_3_function::set_slot(int ip, int slot_id, vm_stack& stack)
+	{
+		as_object* obj = stack.top(1).to_object();
+		abc_def* abc = NULL;
+		traits_info* ti = find_slot(obj, slot_id, &abc);
+		if (ti)
+		{
+			set_member(ip, obj,
+				abc->get_multiname_string(ti->m_name), abc->get_multiname_atom(ti->m_name), stack.top(0));
+		}
+		else
+		{
+			log_error("error: setslot, %s has no slot %d\n", stack.top(1).to_xstring(), slot_id);
+		}
+		stack.drop(2);
+	}
+
+	int avm2_scope_cache::find(vm_stack& scope, as_object** owner) const
+	{
+		if (m_scope_size != scope.size())
+		{
+			return -1;
+		}
+
+		int n = 0;
+		for (int i = scope.size() - 1; i >= m_level; i--)
+		{
+			as_object* obj = scope[i].to_object();
+			if (obj == NULL)
+			{
+				return -1;
+			}
+
+			for (as_object* o = obj; ; o = o->m_proto.get_ptr())
+			{
+				if (o != m_object[n])
+				{
+					return -1;
+				}
+				if (o == NULL)
+				{
+					n++;
+					break;
+				}
+				if (o->get_layout_id() != m_layout_id[n] || o->m_instance.get_ptr() != m_instance[n])
+				{
+					return -1;
+				}
+				n++;
+			}
+		}
+
+		*owner = m_object[m_owner];
+		return m_level;
+	}
+
+	void avm2_scope_cache::fill(vm_stack& scope, int level, as_object* owner)
+	{
+		m_scope_size = -1;
+
+		int n = 0;
+		int owner_index = -1;
+		for (int i = scope.size() - 1; i >= level; i--)
+		{
+			as_object* obj = scope[i].to_object();
+			if (obj == NULL)
+			{
+				return;
+			}
+
+			for (as_object* o = obj; ; o = o->m_proto.get_ptr())
+			{
+				if (n >= MAX_OBJECTS)
+				{
+					return;
+				}
+				m_object[n] = o;
+				if (o == NULL)
+				{
+					n++;
+					break;
+				}
+
+				// Only the plain as_object lookup is cached.
+				m_layout_id[n] = o->get_layout_id();
+				if (m_layout_id[n] == 0)
+				{
+					return;
+				}
+				m_instance[n] = o->m_instance.get_ptr();
+
+				if (i == level && o == owner && owner_index < 0)
+				{
+					owner_index = n;
+				}
+				n++;
+			}
+		}
+
+		if (owner_index >= 0)
+		{
+			m_scope_size = scope.size();
+			m_level = level;
+			m_owner = owner_index;
 		}
 	}
 }
@@ -82,6 +82,7 @@ namespace gameswf
 		array<int> m_metadata;
 
 		void	read(stream* in, abc_def* abc);
+		static void	skip(stream* in);
 	};
 
 	struct except_info : public ref_counted
@@ -95,6 +96,118 @@ namespace gameswf
 		void	read(stream* in, abc_def* abc);
 	};
 
+	struct as_3_function;
+	struct instance_info;
+
+	// Per call site cache of a search of the scope stack
+	// (findpropstrict, findproperty, getlex).  Remembers the objects
+	// the search went through and their prototypes: it ends at the
+	// same place as long as the scope stack holds the same objects,
+	// with the same members (see as_members::get_layout_id()) and
+	// the same traits.  Only objects that use the plain as_object
+	// lookup are cached.
+	struct avm2_scope_cache
+	{
+		enum { MAX_OBJECTS = 16 };
+
+		avm2_scope_cache() :
+			m_scope_size(-1)
+		{
+		}
+
+		// Returns the scope level where the name is, and sets
+		// *owner to the object that has it; -1 if we don't know.
+		int	find(vm_stack& scope, as_object** owner) const;
+
+		// Remember that the name was found at level, in owner.
+		void	fill(vm_stack& scope, int level, as_object* owner);
+
+	private:
+		int	m_scope_size;	// -1 if unused
+		int	m_level;
+		int	m_owner;	// in m_object
+
+		// The prototype chain of each level, top down, each one
+		// ended by NULL.  m_object[] are only dereferenced once
+		// they've been matched against a live pointer.
+		as_object*	m_object[MAX_OBJECTS];
+		Uint32	m_layout_id[MAX_OBJECTS];
+		instance_info*	m_instance[MAX_OBJECTS];
+	};
+
+	// The caches of an instruction that looks up a name.
+	struct avm2_site
+	{
+		as_member_cache	m_member;
+		avm2_scope_cache	m_scope;
+	};
+
+	// Numbers.  as_value holds a Number in place, so the numeric
+	// instructions read and write it directly when their operands
+	// are Numbers, and only go through the conversions otherwise.
+	// int and uint results are kept as Numbers too.
+
+	inline double	avm2_to_number(const as_value& val)
+	{
+		return val.is_numeric() ? val.get_number() : val.to_number();
+	}
+
+	// ToInt32, NaN and the infinities are 0, the others wrap.
+	Sint32	avm2_wrap_int(double val);
+
+	inline Sint32	avm2_to_int(const as_value& val)
+	{
+		double d = avm2_to_number(val);
+		if (d > -2147483649.0 && d < 2147483648.0)
+		{
+			return (Sint32) d;
+		}
+		return avm2_wrap_int(d);
+	}
+
+	inline void	avm2_assign(as_value* dst, const as_value& src)
+	{
+		if (src.is_numeric())
+		{
+			dst->set_number(src.get_number());
+		}
+		else
+		{
+			*dst = src;
+		}
+	}
+
+	inline void	avm2_push(vm_stack& stack, const as_value& val)
+	{
+		if (val.is_numeric())
+		{
+			stack.push(val.get_number());
+		}
+		else
+		{
+			stack.push(val);
+		}
+	}
+
+	// The numeric instructions, for the interpreter and the JIT.
+	// avm2_numeric_op() does the arithmetic, conversion and
+	// comparison ones on the stack, avm2_local_op() inclocal,
+	// declocal and their _i forms on a register.
+	// avm2_branch_taken() pops the operands of a conditional
+	// branch and returns true if it is taken.
+	void	avm2_numeric_op(int opcode, vm_stack& stack);
+	void	avm2_local_op(int opcode, as_value* reg);
+	bool	avm2_branch_taken(int opcode, vm_stack& stack);
+
+	// What the jitted code of a method works on, see gameswf_avm2_jit.cpp.
+	struct avm2_jit_context
+	{
+		as_3_function* m_function;
+		array<as_value>* m_lregister;
+		as_environment* m_env;
+		as_value* m_result;
+	};
+
 	struct as_3_function : public as_function
 	{
 		// Unique id of a gameswf resource
@@ -127,7 +240,10 @@ namespace gameswf
 		array<option_detail> m_options;
 		int m_method;	// index in method_info
 
-		// body_info
+		// body_info, decoded by read_body() from m_abc->m_body_data
+		// when the method first runs
+		int m_body_pos;	// -1 if there is no body or it has been decoded
+		int m_body_size;
 		int m_max_stack;
 
 		// this is the index of the highest-numbered local register plus one.	
@@ -139,6 +255,10 @@ namespace gameswf
 		array<gc_ptr<except_info> > m_exception;
 		array<gc_ptr<traits_info> > m_trait;
 		jit_function m_compiled_code;
+		array<int> m_jit_entry;	// ip --> position in m_compiled_code, -1 if not compiled
+		int m_call_count;
+		array<avm2_site*> m_site;	// ip --> caches of the instruction there, NULL until it runs
+		int m_run_count;	// up to 2, see get_site()
 
 		as_3_function(abc_def* abc, int method, player* player);
 		~as_3_function();
@@ -148,12 +268,28 @@ namespace gameswf
 
 		void	execute(array<as_value>& lregister, as_environment* env, as_value* result);
 		void	compile();
-
-		void	compile_stack_resize(int count);
 		void	read(stream* in);
 		void	read_body(stream* in);
-
-		tu_string get_multiname(int index, vm_stack & stack) const;
+		void	read_body();
+		static void	skip_body(stream* in);
+
+		// Name lookups of the instruction at ip, through its
+		// avm2_site.  index is the multiname of the instruction.
+		// get_site() is NULL the first time the method runs.
+		avm2_site*	get_site(int ip);
+		as_object*	find_property(int ip, int index, vm_stack& scope);
+		bool	get_lex(int ip, int index, vm_stack& scope, as_value* val);
+		bool	get_member(int ip, as_object* obj, int index, as_value* val);
+		void	set_member(int ip, as_object* obj, int index, const as_value& val);
+		bool	get_member(int ip, as_object* obj, const tu_string& name, int atom, as_value* val);
+		void	set_member(int ip, as_object* obj, const tu_string& name, int atom, const as_value& val);
+
+		// obj, [name] => value
+		void	get_property(int ip, int index, vm_stack& stack);
+
+		// obj => value, obj, value =>
+		void	get_slot(int ip, int slot_id, vm_stack& stack);
+		void	set_slot(int ip, int slot_id, vm_stack& stack);
 
 	};
 
@@ -4,6 +4,14 @@
 // whatever you want with it.
 
 // AVM2 JIT-compiler implementation
+//
+// A method is compiled into a sequence of calls to the helpers
+// below, one per instruction, with the branches done in native
+// code.  The helpers do exactly what as_3_function::execute() does
+// for the same opcode.  Opcodes without a helper are left to the
+// interpreter: the compiled code returns the ip of the instruction
+// and execute() carries on from there, entering the compiled code
+// again at the next instruction.
 
 #include "gameswf/gameswf_avm2.h"
 #include "gameswf/gameswf_stream.h"
@@ -16,523 +24,510 @@
 namespace gameswf
 {
 
-	template< typename T >
-	void stack_push_back_value( array<as_value> & stack, T value )
+#ifdef __GAMESWF_ENABLE_JIT__
+
+	// Helpers.  Branch helpers return 1 if the branch is taken.
+
+	static int avm2_jit_branch(avm2_jit_context* ctx, intptr_t opcode)
 	{
-		stack.push_back( value );
+		return avm2_branch_taken((int) opcode, *ctx->m_env) ? 1 : 0;
 	}
 
-	template< typename T >
-	void stack_push_back_ref( array<as_value> & stack, T & value )
+	static int avm2_jit_popscope(avm2_jit_context* ctx, intptr_t)
 	{
-		stack.push_back( value );
+		ctx->m_env->m_scope.pop();
+		return 0;
 	}
 
-	typedef void ( *stack_int_function )( array<as_value> & stack, int value );
-	typedef void ( *stack_charp_function )( array<as_value> & stack, char * value );
-	typedef void (array<as_value>::*push_value_function )( as_value & );
-	typedef as_value & (array<as_value>::*index_function)(int);
+	static int avm2_jit_pushnull(avm2_jit_context* ctx, intptr_t)
+	{
+		as_value value;
+		value.set_null();
+		ctx->m_env->push(value);
+		return 0;
+	}
 
-	template<typename T> struct constructor_helper
+	static int avm2_jit_pushint(avm2_jit_context* ctx, intptr_t value)
 	{
-		static void construct( void * object )
-		{
-			new( object ) T;
-		}
+		ctx->m_env->push((int) value);
+		return 0;
+	}
 
-		static void destruct( T * object )
-		{
-			delete object;
-		}
-	};
+	static int avm2_jit_pushbool(avm2_jit_context* ctx, intptr_t value)
+	{
+		ctx->m_env->push(value != 0);
+		return 0;
+	}
 
+	static int avm2_jit_pushnan(avm2_jit_context* ctx, intptr_t)
+	{
+		ctx->m_env->push(get_nan());
+		return 0;
+	}
 
-	struct callpropvoid
+	static int avm2_jit_pop(avm2_jit_context* ctx, intptr_t)
 	{
-		static void call( const as_object *_this, const char* name, int arg_count, array<as_value> & stack )
-		{
-			as_environment env(_this->get_player());
-			for (int i = 0; i < arg_count; i++)
-			{
-				as_value& val = stack[stack.size() - 1 - i];
-				env.push(val);
-			}
-			stack.resize(stack.size() - arg_count);
+		ctx->m_env->pop();
+		return 0;
+	}
 
-			as_object* obj = stack.back().to_object();
-			stack.resize(stack.size() - 1);
+	static int avm2_jit_dup(avm2_jit_context* ctx, intptr_t)
+	{
+		vm_stack& stack = *ctx->m_env;
+		stack.push(stack.top(0));
+		return 0;
+	}
 
-			as_value func;
-			if (obj && obj->get_member(name, &func))
-			{
-				call_method(func, &env, obj,	arg_count, env.get_top_index());
-			}
+	static int avm2_jit_swap(avm2_jit_context* ctx, intptr_t)
+	{
+		vm_stack& stack = *ctx->m_env;
+		as_value tmp = stack.top(0);
+		stack.top(0) = stack.top(1);
+		stack.top(1) = tmp;
+		return 0;
+	}
 
-			IF_VERBOSE_ACTION(log_msg("EX: callpropvoid\t 0x%p.%s(args:%d)\n", obj, name, arg_count));
+	static int avm2_jit_pushstring(avm2_jit_context* ctx, intptr_t index)
+	{
+		const char* val = ctx->m_function->m_abc->get_string(index);
+		ctx->m_env->push(val);
+		return 0;
+	}
 
-		}
-	};
+	static int avm2_jit_pushdouble(avm2_jit_context* ctx, intptr_t index)
+	{
+		double val = ctx->m_function->m_abc->get_double(index);
+		ctx->m_env->push(val);
+		return 0;
+	}
 
-	void as_3_function::compile()
+	static int avm2_jit_pushuint(avm2_jit_context* ctx, intptr_t index)
 	{
-#define var_stack jit_getarg( 1 )
-#define var_scope jit_getarg( 2 )
+		double val = ctx->m_function->m_abc->get_uinteger(index);
+		ctx->m_env->push(val);
+		return 0;
+	}
 
-#ifdef __GAMESWF_ENABLE_JIT__
-		int ip = 0;
-		jit_prologue( m_compiled_code );
+	static int avm2_jit_pushscope(avm2_jit_context* ctx, intptr_t)
+	{
+		as_value val = ctx->m_env->pop();
+		ctx->m_env->m_scope.push(val);
+		return 0;
+	}
 
-		if( m_code.size() == 0 ) return;
-		do
-		{
-			Uint8 opcode = m_code[ip++];
-			switch (opcode)
-			{
-				case 0x24:	// pushbyte
-				{
-					int byte_value;
-					ip += read_vu30(byte_value, &m_code[ip]);
+	static int avm2_jit_returnvoid(avm2_jit_context* ctx, intptr_t)
+	{
+		ctx->m_result->set_undefined();
+		return 0;
+	}
 
-					//stack.push_back(byte_value);
-					jit_pushargi( m_compiled_code, byte_value );
-					jit_load( m_compiled_code, jit_eax, jit_getarg( 1 ) );
-					jit_pusharg( m_compiled_code, jit_eax );
-					jit_call( m_compiled_code, stack_int_function(stack_push_back_value) );
-					jit_popargs( m_compiled_code, 2 );
+	static int avm2_jit_returnvalue(avm2_jit_context* ctx, intptr_t)
+	{
+		*ctx->m_result = ctx->m_env->pop();
+		return 0;
+	}
 
-					//IF_VERBOSE_ACTION(log_msg("EX: pushbyte\t %d\n", byte_value));
+	static int avm2_jit_read_operand(avm2_jit_context* ctx, int ip)
+	// The first operand of the instruction at ip.
+	{
+		int value;
+		read_vu30(value, &ctx->m_function->m_code[ip + 1]);
+		return value;
+	}
 
-					break;
-				}
+	// The name lookups get the ip of their instruction, for its
+	// avm2_site.
 
-				case 0x2D:	// pushint
-				{
-					int index;
-					ip += read_vu30(index, &m_code[ip]);
-					int val = m_abc->get_integer(index);
+	static int avm2_jit_findproperty(avm2_jit_context* ctx, intptr_t ip)
+	{
+		int index = avm2_jit_read_operand(ctx, ip);
+		as_object* obj = ctx->m_function->find_property(ip, index, ctx->m_env->m_scope);
+		if (obj)
+		{
+			ctx->m_env->push(obj);
+		}
+		else
+		{
+			ctx->m_env->push(ctx->m_function->get_global());
+		}
+		return 0;
+	}
 
-					//stack.push_back(val);
-					jit_pushargi( m_compiled_code, val );
-					jit_load( m_compiled_code, jit_eax, jit_getarg( 1 ) );
-					jit_pusharg( m_compiled_code, jit_eax );
-					jit_call( m_compiled_code, stack_int_function(stack_push_back_value) );
-					jit_popargs( m_compiled_code, 2 );
+	static int avm2_jit_setproperty(avm2_jit_context* ctx, intptr_t ip)
+	{
+		vm_stack& stack = *ctx->m_env;
+		int index = avm2_jit_read_operand(ctx, ip);
+		as_object * object = stack.top(1).to_object();
+		if (object)
+		{
+			ctx->m_function->set_member(ip, object, index, stack.top(0));
+		}
+		stack.drop(2);
+		return 0;
+	}
 
-					//IF_VERBOSE_ACTION(log_msg("EX: pushint\t %d\n", val));
+	static int avm2_jit_getlocal(avm2_jit_context* ctx, intptr_t index)
+	{
+		avm2_push(*ctx->m_env, (*ctx->m_lregister)[index]);
+		return 0;
+	}
 
-					break;
-				}
+	static int avm2_jit_setlocal(avm2_jit_context* ctx, intptr_t index)
+	{
+		avm2_assign(&(*ctx->m_lregister)[index], ctx->m_env->pop());
+		return 0;
+	}
 
-				case 0x2C:	// pushstring
-				{
-					int index;
-					ip += read_vu30(index, &m_code[ip]);
-					const char* val = m_abc->get_string(index);
+	static int avm2_jit_kill(avm2_jit_context* ctx, intptr_t index)
+	{
+		(*ctx->m_lregister)[index].set_undefined();
+		return 0;
+	}
 
-					//stack.push_back(val);
-					jit_pushargi( m_compiled_code, val );
-					jit_load( m_compiled_code, jit_eax, jit_getarg( 1 ) );
-					jit_pusharg( m_compiled_code, jit_eax );
-					jit_call( m_compiled_code, stack_charp_function( &stack_push_back_value ) );
-					jit_popargs( m_compiled_code, 2 );
+	static int avm2_jit_getscopeobject(avm2_jit_context* ctx, intptr_t index)
+	{
+		vm_stack& scope = ctx->m_env->m_scope;
+		assert(index < scope.size());
+		ctx->m_env->push(scope[index]);
+		return 0;
+	}
 
-					//IF_VERBOSE_ACTION(log_msg("EX: pushstring\t '%s'\n", val));
+	static int avm2_jit_getproperty(avm2_jit_context* ctx, intptr_t ip)
+	{
+		int index = avm2_jit_read_operand(ctx, ip);
+		ctx->m_function->get_property(ip, index, *ctx->m_env);
+		return 0;
+	}
 
-					break;
-				}
+	static int avm2_jit_initproperty(avm2_jit_context* ctx, intptr_t ip)
+	{
+		vm_stack& stack = *ctx->m_env;
+		int index = avm2_jit_read_operand(ctx, ip);
 
-				case 0x2F:	// pushdouble
-				{
-					int index;
-					ip += read_vu30(index, &m_code[ip]);
-					double val = m_abc->get_double(index);
-					
-					jit_pushargi( m_compiled_code, val );
-					jit_load( m_compiled_code, jit_esi, var_stack );
-					jit_pusharg( m_compiled_code, jit_esi );
-					jit_call( m_compiled_code, &(stack_push_back_value<double>) );
-					jit_popargs( m_compiled_code, 3 ); //double counts for 2;
-					//stack.push_back(val);
-
-					//IF_VERBOSE_ACTION(log_msg("EX: pushdouble\t %f\n", val));
+		as_value& val = stack.top(0);
+		as_object* obj = stack.top(1).to_object();
+		if (obj)
+		{
+			ctx->m_function->set_member(ip, obj, index, val);
+		}
+		stack.drop(2);
+		return 0;
+	}
 
-					break;
-				}
+	static int avm2_jit_getslot(avm2_jit_context* ctx, intptr_t ip)
+	{
+		ctx->m_function->get_slot(ip, avm2_jit_read_operand(ctx, ip), *ctx->m_env);
+		return 0;
+	}
 
-				case 0x30:	// pushscope
-				{
-					//as_value& val = stack.back();
-					typedef as_value& ( array<as_value>::*back_function )();
-					jit_load( m_compiled_code, jit_this_pointer, jit_getarg( 1 ) );
-					jit_this_call( m_compiled_code, (back_function)&array<as_value>::back );
+	static int avm2_jit_setslot(avm2_jit_context* ctx, intptr_t ip)
+	{
+		ctx->m_function->set_slot(ip, avm2_jit_read_operand(ctx, ip), *ctx->m_env);
+		return 0;
+	}
 
-					jit_load( m_compiled_code, jit_this_pointer, var_scope );
-					jit_push( m_compiled_code, jit_result );
-					jit_call( m_compiled_code, (push_value_function)&array<as_value>::push_back );
-					jit_popargs( m_compiled_code, 1 );
+	static int avm2_jit_coerce_s(avm2_jit_context* ctx, intptr_t)
+	{
+		vm_stack& stack = *ctx->m_env;
+		stack.top(0).set_string(stack.top(0).to_string());
+		return 0;
+	}
 
+	static int avm2_jit_numeric(avm2_jit_context* ctx, intptr_t opcode)
+	{
+		avm2_numeric_op((int) opcode, *ctx->m_env);
+		return 0;
+	}
 
-					//IF_VERBOSE_ACTION(log_msg("EX: pushscope\t %s\n", val.to_xstring()));
-					//TODO: Ecx is caller-saved, copy it to esi or edi before calling to prevent reload from memory
-					//stack.resize(stack.size() - 1); 
-					compile_stack_resize( 1 );
+	static int avm2_jit_local(avm2_jit_context* ctx, intptr_t arg)
+	// arg is the register << 8 | the opcode.
+	{
+		avm2_local_op((int) (arg & 0xFF), &(*ctx->m_lregister)[arg >> 8]);
+		return 0;
+	}
 
-					break;
-				}
+	static int avm2_jit_operand_size(const Uint8* code, int opcode)
+	// Returns the size of the operands of an opcode that the
+	// interpreter knows, -1 for the others.
+	{
+		int value;
+		switch (opcode)
+		{
+			case 0x0C: case 0x0D: case 0x0E: case 0x0F: case 0x10:	// branches
+			case 0x11: case 0x12: case 0x13: case 0x14: case 0x15:
+			case 0x16: case 0x17: case 0x18: case 0x19: case 0x1A:
+				return 3;
+
+			case 0x09: case 0x1D: case 0x20: case 0x26: case 0x27: case 0x28:
+			case 0x29: case 0x2A: case 0x2B: case 0x30: case 0x47: case 0x48:
+			case 0x73: case 0x74: case 0x75: case 0x76: case 0x85:
+			case 0x90: case 0x91: case 0x93: case 0x96: case 0x97:
+			case 0xA0: case 0xA1: case 0xA2: case 0xA3: case 0xA4: case 0xA5:
+			case 0xA6: case 0xA7: case 0xA8: case 0xA9: case 0xAA: case 0xAB:
+			case 0xAC: case 0xAD: case 0xAE: case 0xAF: case 0xB0:
+			case 0xC0: case 0xC1: case 0xC4: case 0xC5: case 0xC6: case 0xC7:
+			case 0xD0: case 0xD1: case 0xD2: case 0xD3:
+			case 0xD4: case 0xD5: case 0xD6: case 0xD7:
+				return 0;
+
+			case 0x24:	// pushbyte
+			case 0x65:	// getscopeobject
+				return 1;
+
+			case 0x08: case 0x25: case 0x2C: case 0x2D: case 0x2E: case 0x2F:
+			case 0x49: case 0x56: case 0x58: case 0x5D: case 0x5E: case 0x60:
+			case 0x61: case 0x62: case 0x63: case 0x66: case 0x68: case 0x6C:
+			case 0x6D: case 0x80: case 0x92: case 0x94: case 0xC2: case 0xC3:
+				return read_vu30(value, code);
+
+			case 0x46:	// callproperty
+			case 0x4A:	// constructprop
+			case 0x4F:	// callpropvoid
+			{
+				int size = read_vu30(value, code);
+				return size + read_vu30(value, code + size);
+			}
 
-				case 0x47:	// returnvoid
-				{
-					//IF_VERBOSE_ACTION(log_msg("EX: returnvoid\t\n"));
+			default:
+				return -1;
+		}
+	}
 
-					//result->set_undefined();
-					jit_load( m_compiled_code, jit_this_pointer, jit_getarg( 3 ) );
-					jit_this_call( m_compiled_code, &as_value::set_undefined );
+#endif	// __GAMESWF_ENABLE_JIT__
 
-					break;
-				}
+	void as_3_function::compile()
+	// Build m_compiled_code and m_jit_entry.  Leaves them empty if
+	// there is nothing worth compiling.
+	{
+#ifdef __GAMESWF_ENABLE_JIT__
+		int size = m_code.size();
+		if (size == 0)
+		{
+			return;
+		}
+		const Uint8* code = (const Uint8*) m_code.data();
 
-				case 0x49:	// constructsuper
-				{
-					// stack: object, arg1, arg2, ..., argn
-					int arg_count;
-					ip += read_vu30(arg_count, &m_code[ip]);
+		// Find the instructions.
+		array<int> labels;	// ip --> label, -1 if no instruction starts there
+		labels.resize(size);
+		for (int i = 0; i < size; i++)
+		{
+			labels[i] = -1;
+		}
 
-					struct constructsuper
-					{
-					
-						static void call( array<as_value> & stack, int arg_count )
-						{
-							as_object* obj = stack.back().to_object();
-							stack.resize(stack.size() - 1);
-							for (int i = 0; i < arg_count; i++)
-							{
-								as_value& val = stack.back();
-								stack.resize(stack.size() - 1);
-							}
-
-							//TODO: construct super of obj
-
-							IF_VERBOSE_ACTION(log_msg("EX: constructsuper\t 0x%p(args:%d)\n", obj, arg_count));
-						}
-					};
-
-					jit_pushi( m_compiled_code, arg_count );
-					jit_load( m_compiled_code, jit_esi, var_stack );
-					jit_push( m_compiled_code, jit_esi );
-					jit_call( m_compiled_code, &constructsuper::call );
-					jit_popargs( m_compiled_code, 2 );
+		int ip = 0;
+		while (ip < size)
+		{
+			labels[ip] = m_compiled_code.new_label();
+			int operand_size = avm2_jit_operand_size(code + ip + 1, code[ip]);
+			if (operand_size < 0)
+			{
+				// Unknown to the interpreter too, it stops there.
+				break;
+			}
+			ip += 1 + operand_size;
+		}
 
-					break;
-				}
+		int exit_label = m_compiled_code.new_label();
+		array<bool> bailout;	// ip --> the compiled code leaves it to the interpreter
+		bailout.resize(size);
+		int compiled_count = 0;
+
+		for (ip = 0; ip < size && labels[ip] >= 0; )
+		{
+			int start = ip;
+			Uint8 opcode = code[ip++];
+			int operand_size = avm2_jit_operand_size(code + ip, opcode);
+			jit_helper helper = NULL;
+			intptr_t arg = 0;
+			int index;
+
+			m_compiled_code.bind_label(labels[start]);
+			bailout[start] = false;
 
-				case 0x4F:	// callpropvoid, Call a property, discarding the return value.
-				// Stack: , obj, [ns], [name], arg1,...,argn => 
+			switch (opcode)
+			{
+				case 0x0C: case 0x0D: case 0x0E: case 0x0F: case 0x10:	// branches
+				case 0x11: case 0x12: case 0x13: case 0x14: case 0x15:
+				case 0x16: case 0x17: case 0x18: case 0x19: case 0x1A:
 				{
-					int index;
-					ip += read_vu30(index, &m_code[ip]);
-					const char* name = m_abc->get_multiname(index);
-
-					int arg_count;
-					ip += read_vu30(arg_count, &m_code[ip]);
-
-					jit_load( m_compiled_code, jit_esi, var_stack );
-					jit_pusharg( m_compiled_code, jit_esi );
-					jit_pushargi( m_compiled_code, arg_count );
-					jit_pushargi( m_compiled_code, name );
-					jit_pushargi( m_compiled_code, this );
-					jit_call( m_compiled_code, &callpropvoid::call );
-					jit_popargs( m_compiled_code, 4 );
-
-					/*
-					struct local
+					int target = ip + 3 + read_s24(code + ip);
+					bool compiled = target >= 0 && target < size && labels[target] >= 0;
+					int taken = compiled ? labels[target] : m_compiled_code.new_label();
+
+					if (opcode == 0x10)
 					{
-						static void construct_env( as_environment *env, player * player )
-						{
-							new( env ) as_environment( player );
-						}
-
-						static void destruct_env( as_environment *env )
-						{
-							env->~as_environment();
-						}
-					};
-
-					//as_environment env(get_player());
-					int env_offset = jit_allocate_stack_object_memory( m_compiled_code, sizeof( as_environment ) );
-					//Do we query it each it or it won't change? I decided it won't change
-					jit_mov( m_compiled_code, jit_edi, jit_stack_pointer );
-					jit_pushi( m_compiled_code, (uint32)get_player() );
-					jit_push( m_compiled_code, jit_edi );
-					jit_call( m_compiled_code, &local::construct_env );
-					jit_popargs( m_compiled_code, 2 );
-
-					//as_value* val = stack.back();
-					jit_load( m_compiled_code, jit_this_pointer, jit_getarg( 1 ) );
-					typedef as_value& ( array<as_value>::*back_function )();
-					jit_this_call( m_compiled_code, (back_function)&array<as_value>::back );
-					jit_mov( m_compiled_code, jit_esi, jit_result );
-
-					for (int i = 0; i < arg_count; i++)
+						// jump
+						jit_jump(m_compiled_code, taken);
+					}
+					else
 					{
-					 //env.push( *val);
-					 jit_mov( m_compiled_code, jit_this_pointer, jit_edi );
-					 jit_push( m_compiled_code, jit_esi );
-					 jit_this_call( m_compiled_code, & as_environment::push<as_value&> );
-					 
-					 //val--;
-					 jit_subi( m_compiled_code, jit_esi, sizeof( as_value ) );
+						jit_call_helper(m_compiled_code, avm2_jit_branch, opcode);
+						jit_jump_if(m_compiled_code, jit_not_zero, taken);
 					}
 
-					//stack.resize(stack.size() - arg_count);
-					compile_stack_resize( arg_count );
-
-					//as_object* obj = stack.back().to_object();
-					jit_load( m_compiled_code, jit_this_pointer, jit_getarg( 1 ) );
-					typedef as_value& ( array<as_value>::*back_function )();
-					jit_this_call( m_compiled_code, (back_function)&array<as_value>::back );
-					jit_mov( m_compiled_code, jit_this_pointer, jit_result );
-					jit_this_call( m_compiled_code, &as_value::to_object );
-					jit_mov( m_compiled_code, jit_esi, jit_result );
-
-					 //stack.resize(stack.size() - 1);
-					compile_stack_resize( 1 );
-
-
-					//as_value func;
-					//if (obj && obj->get_member(name, &func))
-					//{
-					//	call_method(func, &env, obj,	arg_count, env.get_top_index());
-					//}
-
-					// Destruct env
-					jit_getaddress( m_compiled_code, jit_result, jit_stack_pointer, env_offset );
-					jit_push( m_compiled_code ,jit_result );
-					jit_call( m_compiled_code, &local::destruct_env );
-					jit_popargs( m_compiled_code, 1 );
-
- 
-					//IF_VERBOSE_ACTION(log_msg("EX: callpropvoid\t 0x%p.%s(args:%d)\n", obj, name, arg_count));
-					*/
-					break;
-				}
-
-				case 0x5D:	// findpropstrict
-				{
-					int index;
-					ip += read_vu30(index, &m_code[ip]);
-					const char* name = m_abc->get_multiname(index);
-
-					// search property in scope
-					
-					// TODO: inline
-					struct findpropstrict
+					if (compiled == false)
 					{
-						static as_object * call( char* name, array<as_value> & scope )
-						{
-							for (int i = scope.size() - 1; i >= 0; i--)
-							{
-								as_value val;
-								if (scope[i].find_property(name, &val))
-								{
-									return scope[i].to_object();
-								}
-							}
-
-							return NULL;
-						}
-					};
-
-					jit_load( m_compiled_code, jit_esi, var_scope );
-					jit_push( m_compiled_code, jit_esi );
-					jit_pushi( m_compiled_code, name);
-					jit_call( m_compiled_code, &findpropstrict::call );
-					jit_popargs( m_compiled_code, 2 );
-
-					//IF_VERBOSE_ACTION(log_msg("EX: findpropstrict\t %s, obj=0x%p\n", name, obj));
-
-					//stack.push_back(obj);
-					jit_load( m_compiled_code, jit_esi, var_stack );
-					jit_push( m_compiled_code, jit_result );
-					jit_push( m_compiled_code, jit_esi );
-					jit_call( m_compiled_code, &stack_push_back_value<as_object*> );
-					jit_popargs( m_compiled_code, 2 );
-
-					break;
+						// Let the interpreter find out.
+						int not_taken = m_compiled_code.new_label();
+						jit_jump(m_compiled_code, not_taken);
+						m_compiled_code.bind_label(taken);
+						jit_load_result(m_compiled_code, target);
+						jit_jump(m_compiled_code, exit_label);
+						m_compiled_code.bind_label(not_taken);
+					}
+					compiled_count++;
+					ip += operand_size;
+					continue;
 				}
 
-				case 0x5E:	// findproperty, Search the scope stack for a property
-				{
-					int index;
-					ip += read_vu30(index, &m_code[ip]);
-					const char* name = m_abc->get_multiname(index);
-
-					struct findproperty
-					{
-						static void call( const char* name, array<as_value> & scope, array<as_value> & stack )
-						{
-							as_object* obj = NULL;
-							for (int i = scope.size() - 1; i >= 0; i--)
-							{
-								as_value val;
-								if (scope[i].find_property(name, &val))
-								{
-									obj = scope[i].to_object();
-									break;
-								}
-							}
-
-							IF_VERBOSE_ACTION(log_msg("EX: findproperty\t %s, obj=0x%p\n", name, obj));
-
-							stack.push_back(obj);
-						}
-					};
-
-					jit_load( m_compiled_code, jit_esi, var_stack );
-					jit_push( m_compiled_code, jit_esi );
-					jit_load( m_compiled_code, jit_esi, var_scope );
-					jit_push( m_compiled_code, jit_esi );
-					jit_pushi( m_compiled_code, name );
-					jit_call( m_compiled_code, &findproperty::call );
-					jit_popargs( m_compiled_code, 3 );
+				case 0x47:	// returnvoid
+				case 0x48:	// returnvalue
+					jit_call_helper(m_compiled_code, opcode == 0x47 ? avm2_jit_returnvoid : avm2_jit_returnvalue, 0);
+					jit_load_result(m_compiled_code, -1);
+					jit_jump(m_compiled_code, exit_label);
+					compiled_count++;
+					ip += operand_size;
+					continue;
+
+				case 0x80:	// coerce, todo in the interpreter
+					ip += operand_size;
+					continue;
+
+				case 0x1D: helper = (jit_helper) avm2_jit_popscope; break;
+				case 0x20: helper = (jit_helper) avm2_jit_pushnull; break;
+				case 0x09:	// label
+					ip += operand_size;
+					continue;
 
+				case 0x24:	// pushbyte
+					helper = (jit_helper) avm2_jit_pushint;
+					arg = (Sint8) code[ip];
 					break;
-
-				}
-
-				case 0x60:	// getlex, Find and get a property.
-				{
-					int index;
-					ip += read_vu30(index, &m_code[ip]);
-					const char* name = m_abc->get_multiname(index);
-
-					struct getlex
+				case 0x25:	// pushshort
+					read_vu30(index, code + ip);
+					helper = (jit_helper) avm2_jit_pushint;
+					arg = (Sint16) index;
+					break;
+				case 0x28: helper = (jit_helper) avm2_jit_pushnan; break;
+				case 0x26: helper = (jit_helper) avm2_jit_pushbool; arg = 1; break;
+				case 0x27: helper = (jit_helper) avm2_jit_pushbool; arg = 0; break;
+				case 0x29: helper = (jit_helper) avm2_jit_pop; break;
+				case 0x2A: helper = (jit_helper) avm2_jit_dup; break;
+				case 0x2B: helper = (jit_helper) avm2_jit_swap; break;
+				case 0x2D:	// pushint
+					read_vu30(index, code + ip);
+					helper = (jit_helper) avm2_jit_pushint;
+					arg = m_abc->get_integer(index);
+					break;
+				case 0x08:	// kill
+				case 0x2C:	// pushstring
+				case 0x2E:	// pushuint
+				case 0x2F:	// pushdouble
+				case 0x62:	// getlocal
+				case 0x63:	// setlocal
+					read_vu30(index, code + ip);
+					arg = index;
+					switch (opcode)
 					{
-						static void call( const char* name, array<as_value> & scope, array<as_value> &stack )
-						{
-							// search property in scope
-							as_value val;
-							for (int i = scope.size() - 1; i >= 0; i--)
-							{
-								if (scope[i].find_property(name, &val))
-								{
-									break;
-								}
-							}
-
-							IF_VERBOSE_ACTION(log_msg("EX: getlex\t %s, value=%s\n", name, val.to_xstring()));
-
-							stack.push_back(val);
-						}
-					};
-
-					jit_load( m_compiled_code, jit_esi, var_stack );
-					jit_push( m_compiled_code, jit_esi );
-					jit_load( m_compiled_code, jit_esi, var_scope );
-					jit_push( m_compiled_code, jit_esi );
-					jit_pushi( m_compiled_code, name );
-					jit_call( m_compiled_code, &getlex::call );
-					jit_popargs( m_compiled_code, 2 );
+						case 0x08: helper = (jit_helper) avm2_jit_kill; break;
+						case 0x2C: helper = (jit_helper) avm2_jit_pushstring; break;
+						case 0x2E: helper = (jit_helper) avm2_jit_pushuint; break;
+						case 0x2F: helper = (jit_helper) avm2_jit_pushdouble; break;
+						case 0x62: helper = (jit_helper) avm2_jit_getlocal; break;
+						case 0x63: helper = (jit_helper) avm2_jit_setlocal; break;
+					}
 					break;
-				}
-
-				case 0x66:	// getproperty
-				{
-					//					 int index;
-					//					 ip += read_vu30(index, &m_code[ip]);
-					//					 const char* name = m_abc->get_multiname(index);
-					// 
-					//					 as_object* obj = stack.back().to_object();
-					//					 if (obj)
-					//					 {
-					//						 obj->get_member(name, &stack.back());
-					//					 }
-					//					 else
-					//					 {
-					//						 stack.back().set_undefined();
-					//					 }
-					// 
-					//					 IF_VERBOSE_ACTION(log_msg("EX: getproperty\t %s, value=%s\n", name, stack.back().to_xstring()));
-					// 
+				case 0x92:	// inclocal
+				case 0x94:	// declocal
+				case 0xC2:	// inclocal_i
+				case 0xC3:	// declocal_i
+					read_vu30(index, code + ip);
+					helper = (jit_helper) avm2_jit_local;
+					arg = (index << 8) | opcode;
+					break;
+				case 0x5E: helper = (jit_helper) avm2_jit_findproperty; arg = start; break;
+				case 0x61: helper = (jit_helper) avm2_jit_setproperty; arg = start; break;
+				case 0x66: helper = (jit_helper) avm2_jit_getproperty; arg = start; break;
+				case 0x68: helper = (jit_helper) avm2_jit_initproperty; arg = start; break;
+				case 0x6C: helper = (jit_helper) avm2_jit_getslot; arg = start; break;
+				case 0x6D: helper = (jit_helper) avm2_jit_setslot; arg = start; break;
+				case 0x30: helper = (jit_helper) avm2_jit_pushscope; break;
+				case 0x65: helper = (jit_helper) avm2_jit_getscopeobject; arg = code[ip]; break;
+				case 0x85: helper = (jit_helper) avm2_jit_coerce_s; break;
+				case 0x73: case 0x74: case 0x75: case 0x76:	// numeric
+				case 0x90: case 0x91: case 0x93: case 0x96: case 0x97:
+				case 0xA0: case 0xA1: case 0xA2: case 0xA3: case 0xA4: case 0xA5:
+				case 0xA6: case 0xA7: case 0xA8: case 0xA9: case 0xAA: case 0xAB:
+				case 0xAC: case 0xAD: case 0xAE: case 0xAF: case 0xB0:
+				case 0xC0: case 0xC1: case 0xC4: case 0xC5: case 0xC6: case 0xC7:
+					helper = (jit_helper) avm2_jit_numeric;
+					arg = opcode;
+					break;
+				case 0xD0: case 0xD1: case 0xD2: case 0xD3:	// getlocal_<n>
+					helper = (jit_helper) avm2_jit_getlocal;
+					arg = opcode & 0x03;
+					break;
+				case 0xD4: case 0xD5: case 0xD6: case 0xD7:	// setlocal_<n>
+					helper = (jit_helper) avm2_jit_setlocal;
+					arg = opcode & 0x03;
 					break;
-				}
-
-				case 0x68:	// initproperty, Initialize a property.
-				{
-					int index;
-					ip += read_vu30(index, &m_code[ip]);
-					const char* name = m_abc->get_multiname(index);
 
-					struct initproperty
-					{
-						static void call( const char * name, array<as_value> & stack )
-						{
-							as_value& val = stack[stack.size() - 1];
-							as_object* obj = stack[stack.size() - 2].to_object();
-							if (obj)
-							{
-								obj->set_member(name, val);
-							}
-
-							IF_VERBOSE_ACTION(log_msg("EX: initproperty\t 0x%p.%s=%s\n", obj, name, val.to_xstring()));
-
-							stack.resize(stack.size() - 2);
-						}
-					};
-
-					jit_load( m_compiled_code, jit_esi, var_stack );
-					jit_push( m_compiled_code, jit_esi );
-					jit_pushi( m_compiled_code, name );
-					jit_call( m_compiled_code, &initproperty::call );
-					jit_popargs( m_compiled_code, 2 );
+				default:
 					break;
-				}
+			}
 
-				case 0xD0:	// getlocal_0
-				case 0xD1:	// getlocal_1
-				case 0xD2:	// getlocal_2
-				case 0xD3:	// getlocal_3
+			if (helper == NULL)
+			{
+				// Bail out to the interpreter, it comes back at
+				// the next instruction.
+				jit_load_result(m_compiled_code, start);
+				jit_jump(m_compiled_code, exit_label);
+				bailout[start] = true;
+				if (operand_size < 0)
 				{
-					//as_value& val = lregister[opcode & 0x03];
-					jit_load( m_compiled_code, jit_this_pointer, jit_getarg( 0 ) );
-					jit_pushi( m_compiled_code, opcode & 0x03 );
-					jit_this_call( m_compiled_code, (index_function)&array<as_value>::operator[] );
-					jit_popargs( m_compiled_code, 1 );
-
-					//stack.push_back(val);
-					jit_push( m_compiled_code, jit_result );
-					jit_load( m_compiled_code, jit_this_pointer, jit_getarg( 1 ) );
-					jit_this_call( m_compiled_code, (push_value_function) &array<as_value>::push_back );
-					jit_popargs( m_compiled_code, 1 );
-
-					//IF_VERBOSE_ACTION(log_msg("EX: getlocal_%d\t %s\n", opcode & 0x03, val.to_xstring()));
 					break;
 				}
-
-				default:
-					log_msg("TODO opcode 0x%02X\n", opcode);
-					break;
 			}
+			else
+			{
+				jit_call_helper(m_compiled_code, helper, arg);
+				compiled_count++;
+			}
+			ip += operand_size;
+		}
+
+		// Falling off the end of the method.
+		jit_load_result(m_compiled_code, size);
+		m_compiled_code.bind_label(exit_label);
+		jit_leave(m_compiled_code);
 
+		if (compiled_count == 0)
+		{
+			m_compiled_code.clear();
+			return;
+		}
+
+		// The interpreter may come back at any instruction after a
+		// bailout, give each of them an entry point.
+		m_jit_entry.resize(size);
+		for (int i = 0; i < size; i++)
+		{
+			m_jit_entry[i] = -1;
+			if (labels[i] >= 0 && bailout[i] == false)
+			{
+				m_jit_entry[i] = m_compiled_code.get_position();
+				jit_enter(m_compiled_code);
+				jit_jump(m_compiled_code, labels[i]);
+			}
 		}
-		while (ip < m_code.size());
 
-		jit_return( m_compiled_code );
 		m_compiled_code.initialize();
-#else
-		assert( false );
+		if (m_compiled_code.is_valid() == false)
+		{
+			m_jit_entry.clear();
+		}
 #endif
 	}
 
-	void as_3_function::compile_stack_resize( int count )
-	{
-#ifdef __GAMESWF_ENABLE_JIT__
-		jit_load( m_compiled_code, jit_this_pointer, jit_getarg( 1 ) );
-		jit_this_call( m_compiled_code, &array<as_value>::size );
-		jit_subi( m_compiled_code, jit_eax, count );
-		jit_pusharg( m_compiled_code, jit_eax );
-		jit_load( m_compiled_code, jit_this_pointer, jit_getarg( 1 ) );
-		jit_this_call( m_compiled_code,  &array<as_value>::resize );
-		jit_popargs( m_compiled_code, 1 );
-#endif
-	}
 }
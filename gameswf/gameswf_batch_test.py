@@ -144,11 +144,14 @@ passing_tests = [
   'tests/test_basic_types.txt',
   'tests/test_currentframe.txt',
   'tests/test_delete_references.txt',
+  'tests/test_dlist_advance.txt',
   'tests/test_forin_array.txt',
   'tests/test_motion_exec_order.txt',
+  'tests/test_mouse_hit.txt',
   'tests/test_string.txt',
   'tests/test_undefined_v6.txt',
   'tests/test_undefined_v7.txt',
+  'tests/test_world_cache.txt',
   # Add more passing tests here, as gameswf improves.
   ]
   
@@ -13,6 +13,8 @@
 #include "gameswf/gameswf_stream.h"
 #include "gameswf/gameswf_movie_def.h"
 #include "gameswf/gameswf_filters.h"
+#include "gameswf/gameswf_profiler.h"
+#include "gameswf/gameswf_script_budget.h"
 
 /*
 
@@ -213,6 +215,17 @@ namespace gameswf
 		{
 		}
 
+		virtual void	invalidate_children_world(int what)
+		{
+			for (int i = 0; i < m_record_character.size(); i++)
+			{
+				if (m_record_character[i] != NULL)
+				{
+					m_record_character[i]->invalidate_world(what);
+				}
+			}
+		}
+
 		virtual	void	execute_frame_tags(int frame, bool state_only)
 		{
 			// Keep this (particularly m_as_environment) alive during execution!
@@ -389,6 +402,8 @@ namespace gameswf
 					event_id key_event = keycode < 32 ? s_key[keycode] : event_id(event_id::KEY_PRESS, (key::code) keycode);
 					if (key_event == id)
 					{
+						as_profiler_scope	profile(this, id);
+						script_budget_scope	budget(this, id);
 						parent->do_actions(def->m_button_actions[i].m_actions);
 						called = true;
 					}
@@ -419,6 +434,9 @@ namespace gameswf
 					return false;	// unhandled event, like setfocus, ...
 				};
 
+				// Other records are shown.
+				invalidate_bound();
+
 				// Button transition sounds.
 				if (def->m_sound != NULL)
 				{
@@ -485,6 +503,8 @@ namespace gameswf
 				{
 					if (def->m_button_actions[i].m_conditions & c)
 					{
+						as_profiler_scope	profile(this, id);
+						script_budget_scope	budget(this, id);
 						parent->do_actions(def->m_button_actions[i].m_actions);
 						called = true;
 					}
@@ -504,7 +524,8 @@ namespace gameswf
 
 		virtual bool	set_member(const tu_stringi& name, const as_value& val)
 		{
-			as_standard_member	std_member = get_standard_member(name);
+			int	atom;
+			as_standard_member	std_member = find_standard_member(name, &atom);
 			switch (std_member)
 			{
 				default:
@@ -515,16 +536,18 @@ namespace gameswf
 					as_value new_val(val);
 					call_watcher(name, as_value(m_enabled), &new_val);
 					m_enabled = new_val.to_bool();
+					mouse_scene_changed();
 					return true;
 				}
 			}
-			return character::set_member(name, val);
+			return character::set_member_std(atom, name, std_member, val);
 		}
 
 		virtual bool	get_member(const tu_stringi& name, as_value* val)
 		{
 			// first try character members
-			as_standard_member	std_member = get_standard_member(name);
+			int	atom;
+			as_standard_member	std_member = find_standard_member(name, &atom);
 			switch (std_member)
 			{
 				default:
@@ -536,7 +559,7 @@ namespace gameswf
 					return true;
 				}
 			}
-			return character::get_member(name, val);
+			return character::get_member_std(atom, name, std_member, val);
 		}
 
 		virtual void	get_bound(rect* bound)
@@ -575,6 +598,35 @@ namespace gameswf
 			}
 		}
 
+		virtual void	get_hit_bound(rect* bound)
+		// The bound of the hit test records, whatever the state.
+		{
+			bound->m_x_min = FLT_MAX;
+			bound->m_x_max = - FLT_MAX;
+			bound->m_y_min = FLT_MAX;
+			bound->m_y_max = - FLT_MAX;
+
+			const matrix& m = get_matrix();
+			for (int i = 0; i < m_def->m_button_records.size(); i++)
+			{
+				button_record&	rec = m_def->m_button_records[i];
+				if (rec.m_character_id < 0 || rec.m_hit_test == false)
+				{
+					continue;
+				}
+
+				// In our frame, the record characters have
+				// the record matrices.
+				rect ch_bound;
+				m_record_character[i]->get_hit_bound(&ch_bound);
+				if (ch_bound.m_x_min <= ch_bound.m_x_max)
+				{
+					m.transform(&ch_bound);
+					bound->expand_to_rect(ch_bound);
+				}
+			}
+		}
+
 		virtual bool can_handle_mouse_event()
 		{
 			return is_enabled();
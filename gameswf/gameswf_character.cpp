@@ -7,6 +7,7 @@
 
 
 #include "gameswf/gameswf_character.h"
+#include "gameswf/gameswf_sprite.h"
 #include "gameswf/gameswf_render.h"
 
 namespace gameswf
@@ -22,19 +23,83 @@ namespace gameswf
 		m_blend_mode(0),
 		m_visible(true),
 		m_display_callback(NULL),
-		m_display_callback_user_ptr(NULL)
+		m_display_callback_user_ptr(NULL),
+		m_world_valid(0),
+		m_bound_cached(false),
+		m_hit_bound_cached(false)
 	{
 		// loadMovieClip() requires that the following will be commented out
 		// assert((parent == NULL && m_id == -1)	|| (parent != NULL && m_id >= 0));
 	}
 
+	Uint32	character::s_mouse_scene = 0;
+
+	void	character::invalidate_bound()
+	{
+		mouse_scene_changed();
+
+		m_bound_cached = false;
+		m_hit_bound_cached = false;
+		for (character* ch = get_parent(); ch; ch = ch->get_parent())
+		{
+			if (ch->m_bound_cached == false && ch->m_hit_bound_cached == false
+				&& ch->is(AS_SPRITE))
+			{
+				// A sprite caches its bounds only when the
+				// ones it holds are cached, so the sprites
+				// above this one have nothing cached either.
+				break;
+			}
+			ch->m_bound_cached = false;
+			ch->m_hit_bound_cached = false;
+		}
+	}
+
+	void	character::get_hit_bound(rect* bound)
+	{
+		bound->m_x_min = FLT_MAX;
+		bound->m_x_max = - FLT_MAX;
+		bound->m_y_min = FLT_MAX;
+		bound->m_y_max = - FLT_MAX;
+	}
+
+	void	character::set_name(const tu_string& name)
+	{
+		m_name = name;
+
+		// Paths to us may find someone else now.
+		sprite_instance*	parent = cast_to<sprite_instance>(get_parent());
+		if (parent)
+		{
+			parent->m_display_list.invalidate();
+		}
+	}
+
 	bool	character::get_member(const tu_stringi& name, as_value* val)
 	// Set *val to the value of the named member and
 	// return true, if we have the named member.
 	// Otherwise leave *val alone and return false.
+	{
+		int	atom;
+		as_standard_member	std_member = find_standard_member(name, &atom);
+		return get_member_std(atom, name, std_member, val);
+	}
+
+	as_standard_member	character::find_standard_member(const tu_stringi& name, int* atom) const
+	{
+		atom_table*	atoms = get_atoms();
+		if (atoms == NULL)
+		{
+			*atom = -1;
+			return get_standard_member(name);
+		}
+		*atom = atoms->find(name);
+		return atom_table::get_standard_member(*atom);
+	}
+
+	bool	character::get_member_std(int atom, const tu_stringi& name, as_standard_member std_member, as_value* val)
 	{
 		// first try character members
-		as_standard_member	std_member = get_standard_member(name);
 		switch (std_member)
 		{
 			default:
@@ -218,14 +283,20 @@ namespace gameswf
 			}
 		}	// end switch
 
-		return as_object::get_member(name, val);
+		return as_object::get_member_plain(atom, name, val);
 	}
 
-	// TODO: call_watcher
 	bool	character::set_member(const tu_stringi& name, const as_value& val)
+	{
+		int	atom;
+		as_standard_member	std_member = find_standard_member(name, &atom);
+		return set_member_std(atom, name, std_member, val);
+	}
+
+	// TODO: call_watcher
+	bool	character::set_member_std(int atom, const tu_stringi& name, as_standard_member std_member, const as_value& val)
 	{
 		// first try character members
-		as_standard_member	std_member = get_standard_member(name);
 		switch (std_member)
 		{
 			default:
@@ -374,7 +445,7 @@ namespace gameswf
 			}
 		}	// end switch
 
-		return as_object::set_member(name, val);
+		return as_object::set_member_plain(atom, name, val);
 	}
 
 	float	character::get_width()
@@ -137,6 +137,31 @@ namespace gameswf
 		void		(*m_display_callback)(void*);
 		void*		m_display_callback_user_ptr;
 
+		// Our transforms concatenated with our ancestors', kept
+		// until set_matrix()/set_cxform() of us or of an ancestor.
+		// A valid cache implies a valid one in the parent, so
+		// invalidating stops at the first character already invalid.
+		enum world_cache
+		{
+			WORLD_MATRIX = 1 << 0,
+			WORLD_CXFORM = 1 << 1
+		};
+		mutable matrix	m_world_matrix;
+		mutable cxform	m_world_cxform;
+		mutable Uint8	m_world_valid;	// world_cache bits
+		bool	m_bound_cached;	// get_bound() is cached, by sprites
+		bool	m_hit_bound_cached;	// get_hit_bound() too
+
+		// Bumped by every change that can change what
+		// get_topmost_mouse_entity() finds: the transforms,
+		// bounds, visibility and display lists, and the members
+		// can_handle_mouse_event() looks for.  root::advance()
+		// doesn't do the hit test again while neither the mouse
+		// nor this has moved.
+		static Uint32	s_mouse_scene;
+		static Uint32	get_mouse_scene() { return s_mouse_scene; }
+		static void	mouse_scene_changed() { s_mouse_scene++; }
+
 		struct drag_state
 		{
 		private:
@@ -226,6 +251,12 @@ namespace gameswf
 		//
 		virtual bool get_topmost_mouse_entity( character * &te, float x, float y) { return false; }
 
+		// A bound of the points, in our parent's frame, where
+		// get_topmost_mouse_entity() can find something, or an
+		// empty rect (min > max), the default.  Sprites use it to
+		// skip the characters the mouse is not over.
+		virtual void	get_hit_bound(rect* bound);
+
 		// The host app uses this to tell the movie where the
 		// user's mouse pointer is.
 		virtual void	get_mouse_state(int* x, int* y, int* buttons)
@@ -447,13 +478,24 @@ namespace gameswf
 
 		int	get_id() const { return m_id; }
 		character*	get_parent() const { return m_parent.get_ptr(); }
-		void set_parent(character* parent) { m_parent = parent; }  // for extern movie
+		void set_parent(character* parent)  // for extern movie
+		{
+			m_parent = parent;
+			invalidate_world(WORLD_MATRIX | WORLD_CXFORM);
+			mouse_scene_changed();
+		}
 		int	get_depth() const { return m_depth; }
 		void	set_depth(int d) { m_depth = d; }
 		const matrix&	get_matrix() const { return m_matrix; }
 		void	set_matrix(const matrix& m)
 		{
-			m_matrix = m;
+			// The timeline sets the same matrix again every frame.
+			if (m != m_matrix)
+			{
+				m_matrix = m;
+				invalidate_world(WORLD_MATRIX);
+				invalidate_bound();
+			}
 		}
 		const cxform&	get_cxform() const 
 		{ 
@@ -461,56 +503,102 @@ namespace gameswf
 		}
 		void	set_cxform(const cxform& cx)
 		{
-			m_color_transform = cx;
+			if (memcmp(&cx, &m_color_transform, sizeof(cxform)) != 0)
+			{
+				m_color_transform = cx;
+				invalidate_world(WORLD_CXFORM);
+			}
+		}
+		void	concatenate_cxform(const cxform& cx)
+		{
+			m_color_transform.concatenate(cx);
+			invalidate_world(WORLD_CXFORM);
+		}
+		void	concatenate_matrix(const matrix& m)
+		{
+			m_matrix.concatenate(m);
+			invalidate_world(WORLD_MATRIX);
+			invalidate_bound();
 		}
-		void	concatenate_cxform(const cxform& cx) { m_color_transform.concatenate(cx); }
-		void	concatenate_matrix(const matrix& m) { m_matrix.concatenate(m); }
 		float	get_ratio() const { return m_ratio; }
-		void	set_ratio(float f) { m_ratio = f; }
+		void	set_ratio(float f)
+		{
+			// Morphs change shape with it.
+			if (f != m_ratio)
+			{
+				m_ratio = f;
+				invalidate_bound();
+			}
+		}
 		Uint16	get_clip_depth() const { return m_clip_depth; }
 		void	set_clip_depth(Uint16 d) { m_clip_depth = d; }
 		Uint8   get_blend_mode() const { return m_blend_mode; }
 		void    set_blend_mode(Uint8 d) { m_blend_mode = d; }
 
-		void	set_name(const tu_string& name) { m_name = name; }
+		void	set_name(const tu_string& name);
 		const tu_string&	get_name() const { return m_name; }
 
-		matrix	get_world_matrix() const
+		const matrix&	get_world_matrix() const
 		// Get our concatenated matrix (all our ancestor transforms, times our matrix).	 Maps
 		// from our local space into "world" space (i.e. root movie space).
 		{
-			matrix	m;
-			const character * current = m_parent.get_ptr();
-
-			m = get_matrix();
-			
-			while (current != NULL)
+			if ((m_world_valid & WORLD_MATRIX) == 0)
 			{
-				matrix new_m;
-
-				new_m = current->get_matrix();
-				new_m.concatenate( m );
-				m = new_m;
-				current = current->m_parent.get_ptr();
+				const character*	parent = m_parent.get_ptr();
+				if (parent)
+				{
+					m_world_matrix = parent->get_world_matrix();
+					m_world_matrix.concatenate(m_matrix);
+				}
+				else
+				{
+					m_world_matrix = m_matrix;
+				}
+				m_world_valid |= WORLD_MATRIX;
 			}
-
-			return m;
+			return m_world_matrix;
 		}
 
-		virtual cxform	get_world_cxform() const
+		const cxform&	get_world_cxform() const
 		// Get our concatenated color transform (all our ancestor transforms,
 		// times our cxform).  Maps from our local space into normal color space.
 		{
-			cxform	m;
-			if (m_parent != NULL)
+			if ((m_world_valid & WORLD_CXFORM) == 0)
 			{
-				m = m_parent->get_world_cxform();
+				const character*	parent = m_parent.get_ptr();
+				if (parent)
+				{
+					m_world_cxform = parent->get_world_cxform();
+				}
+				else
+				{
+					m_world_cxform = cxform::identity;
+				}
+				m_world_cxform.concatenate(m_color_transform);
+				m_world_valid |= WORLD_CXFORM;
 			}
-			m.concatenate(get_cxform());
+			return m_world_cxform;
+		}
 
-			return m;
+		// Drops the world transforms cached by us and our
+		// descendants; what is WORLD_MATRIX and/or WORLD_CXFORM.
+		void	invalidate_world(int what)
+		{
+			if (m_world_valid & what)
+			{
+				m_world_valid &= ~what;
+				invalidate_children_world(what);
+			}
 		}
 
+		// Calls invalidate_world() of the characters whose parent
+		// we are.
+		virtual void	invalidate_children_world(int what) {}
+
+		// Our bound, as get_bound() gives it, has changed: drops
+		// the bounds cached by us and the sprites holding us.
+		void	invalidate_bound();
+
 		// Movie interfaces.  By default do nothing.  sprite_instance and some others override these.
 		virtual void	display() {}
 		virtual float	get_height();
@@ -533,7 +621,11 @@ namespace gameswf
 
 		// Make the movie visible/invisible.  An invisible
 		// movie does not advance and does not render.
-		virtual void	set_visible(bool visible) { m_visible = visible; }
+		virtual void	set_visible(bool visible)
+		{
+			m_visible = visible;
+			mouse_scene_changed();
+		}
 
 		// Return visibility status.
 		virtual bool	get_visible() const { return m_visible; }
@@ -560,8 +652,18 @@ namespace gameswf
 		virtual bool can_handle_mouse_event() { return false; }
 	
 		virtual bool	get_member(const tu_stringi& name, as_value* val);
+		virtual bool	use_member_cache() const { return false; }
 		virtual bool	set_member(const tu_stringi& name, const as_value& val);
 
+		// get_member()/set_member() with the atom of name (or -1)
+		// and its standard member id already looked up.
+		bool	get_member_std(int atom, const tu_stringi& name, as_standard_member std_member, as_value* val);
+		bool	set_member_std(int atom, const tu_stringi& name, as_standard_member std_member, const as_value& val);
+
+		// Looks up the atom of name, which is also its standard
+		// member id if it's one.
+		as_standard_member	find_standard_member(const tu_stringi& name, int* atom) const;
+
 		// Movie info
 		virtual int	get_movie_version() { return 0; }
 		virtual int	get_movie_width() { return 0; }
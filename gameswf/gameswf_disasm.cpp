@@ -82,6 +82,11 @@ namespace gameswf
 		return 5;
 	}
 
+	int read_s24(const uint8* args)
+	{
+		return args[0] | args[1] << 8 | (*(int8*) &args[2]) << 16;	// sign extend the high byte
+	}
+
 	struct inst_info_avm2
 	{
 		const char*	m_instruction;
@@ -205,7 +210,7 @@ namespace gameswf
 					break;
 
 				case ARG_OFFSET:
-					value = args[byte_count] | args[byte_count+1]<<8 | args[byte_count+2]<<16;
+					value = read_s24(&args[byte_count]);
 					byte_count += 3;
 					log_msg( "\t\toffset: %i\n", value);
 					break;
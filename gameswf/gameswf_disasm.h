@@ -15,4 +15,7 @@ namespace gameswf
 	// Disassemble one instruction to the log, AVM2
 	void	log_disasm_avm2(const membuf& code, const abc_def* def);
 	int read_vu30(int& result, const Uint8* args);
+
+	// The signed 24 bit offset of the AVM2 branches.
+	int read_s24(const Uint8* args);
 }
@@ -178,9 +178,36 @@ namespace gameswf
 		return NULL;
 	}
 
+	void	display_list::before_change()
+	// Called before the array is changed.  The advance() loops
+	// going over it continue with a copy of the characters they
+	// haven't advanced yet, the current one included so it stays
+	// alive until its advance() returns.
+	{
+		for (advance_state* state = m_advancing; state; state = state->m_outer)
+		{
+			if (state->m_copied)
+			{
+				continue;
+			}
+
+			int	first = imax(state->m_next - 1, 0);
+			int	n = m_display_object_array.size();
+			state->m_rest.reserve(n - first);
+			for (int i = first; i < n; i++)
+			{
+				state->m_rest.push_back(m_display_object_array[i]);
+			}
+			state->m_next -= first;
+			state->m_copied = true;
+		}
+	}
+
 	void display_list::remove(int index)
 	// Removing the character at get_display_object(index).
 	{
+		before_change();
+
 		display_object_info&	di = m_display_object_array[index];
 
 		// indirect call onUnload & killFocus of children
@@ -193,8 +220,11 @@ namespace gameswf
 		// remove this character from listener
 		remove_keypress_listener(di.m_character.get_ptr());
 
+		di.m_character->invalidate_bound();
+
 		di.set_character(NULL);
 		m_display_object_array.remove(index);
+		invalidate();
 	}
 
 	void	display_list::add_display_object( character* ch,  int depth, bool replace_if_depth_is_occupied,
@@ -246,7 +276,12 @@ namespace gameswf
 		// Insert into the display list...
 		assert(index == find_display_index(depth));
 		
-		m_display_object_array.insert(index, di);
+		before_change();
+		m_display_object_array.insert(index, std::move(di));
+		invalidate();
+
+		// The bounds of the sprites holding it grow.
+		ch->invalidate_bound();
 
 		ch->execute_frame_tags(0);
 		add_keypress_listener(ch);
@@ -447,20 +482,34 @@ namespace gameswf
 	
 	void	display_list::advance(float delta_time)
 	// advance referenced characters.
+	// The characters advanced are the ones in the list when it
+	// starts, in that order, even if the scripts they run remove
+	// them; the ones added meanwhile wait for the next frame.  The
+	// list is gone through in place, and copied by before_change()
+	// only if a script changes it.
 	{
+		advance_state	state;
+		state.m_outer = m_advancing;
+		m_advancing = &state;
 
-		// That there was no crash because of actions script
-		// we iterate through the copy
-		array<display_object_info> tmp_list = m_display_object_array;
-		int n = tmp_list.size();
-		for (int i = 0; i < n; i++)
+		for (;;)
 		{
-			character*	ch = tmp_list[i].m_character.get_ptr();
+			const array<display_object_info>&	list =
+				state.m_copied ? state.m_rest : m_display_object_array;
+			if (state.m_next >= list.size())
+			{
+				break;
+			}
+
+			character*	ch = list[state.m_next++].m_character.get_ptr();
 			if (ch)
 			{
 				ch->advance(delta_time);
 			}
 		}
+
+		assert(m_advancing == &state);
+		m_advancing = state.m_outer;
 	}
 	
 	
@@ -586,9 +635,11 @@ namespace gameswf
 		int i2 = get_character_by_ptr(ch2);
 		if (i1 >=0 && i2 >= 0) 
 		{ 
-			display_object_info tmp = m_display_object_array[i2];
-			m_display_object_array[i2] = m_display_object_array[i1];
-			m_display_object_array[i1] = tmp;
+			before_change();
+			display_object_info tmp = std::move(m_display_object_array[i2]);
+			m_display_object_array[i2] = std::move(m_display_object_array[i1]);
+			m_display_object_array[i1] = std::move(tmp);
+			invalidate();
 		} 
 	} 
 
@@ -603,12 +654,14 @@ namespace gameswf
 		display_object_info	di;
 		di.set_character(ch);
 
+		before_change();
 		m_display_object_array.remove( ch_index );
 
 		// Insert into the display list...
 		int new_index = find_display_index(depth);
 
-		m_display_object_array.insert(new_index, di);
+		m_display_object_array.insert(new_index, std::move(di));
+		invalidate();
 
 	}
 
@@ -628,15 +681,11 @@ namespace gameswf
 		return depth + 1;
 	}
 
-	void	display_list::clear_refs(hash<as_object*, bool>* visited_objects,	as_object* this_ptr)
+	void	display_list::clear_refs(as_object_walk* walk, as_object* this_ptr)
 	{
 		for (int i = 0, n = size(); i < n; i++)
 		{
-			character*	ch = get_character(i);
-			if (ch)
-			{
-				ch->clear_refs(visited_objects, this_ptr);
-			}
+			walk->push(get_character(i));
 		}
 	}
 
@@ -34,6 +34,11 @@ namespace gameswf
 			*this = di;
 		}
 
+		display_object_info(display_object_info&& di) :
+			m_character(std::move(di.m_character))
+		{
+		}
+
 		~display_object_info()
 		{
 		}
@@ -43,6 +48,14 @@ namespace gameswf
 			m_character = di.m_character;
 		}
 
+		void	operator=(display_object_info&& di)
+		{
+			m_character = std::move(di.m_character);
+		}
+
+		// array<> may move it bitwise when the collector allows it.
+		enum { is_relocatable = gc_ptr<character>::is_relocatable };
+
 		void	set_character(character* ch)
 		{
 			m_character = ch;
@@ -55,6 +68,7 @@ namespace gameswf
 	// A list of active characters.
 	struct display_list
 	{
+		display_list() : m_generation(0), m_advancing(NULL) {}
 
 		// TODO use better names!
 		int	find_display_index(int depth);
@@ -112,13 +126,39 @@ namespace gameswf
 		void change_character_depth(character* ch, int depth);
 		int get_highest_depth();
 
-		void clear_refs(hash<as_object*, bool>* visited_objects, as_object* this_ptr);
+		void clear_refs(as_object_walk* walk, as_object* this_ptr);
 		void dump(tu_string& tabs);
 
+		// Changes whenever a character is added, removed or moved
+		// in the list, or renamed; target_path_cache uses it to
+		// know that the characters it found by name are still the
+		// ones to find.  The mouse may be over another one too.
+		int	get_generation() const { return m_generation; }
+		void	invalidate()
+		{
+			m_generation++;
+			character::mouse_scene_changed();
+		}
+
 	private:
 
+		// The state of an advance() loop over this list.
+		struct advance_state
+		{
+			advance_state() : m_next(0), m_copied(false), m_outer(NULL) {}
+
+			int	m_next;	// index of the next character to advance
+			bool	m_copied;	// iterating m_rest, not the list
+			array<display_object_info>	m_rest;
+			advance_state*	m_outer;	// advance() running further up the stack
+		};
+
+		void	before_change();
+
 		void remove(int index);
 		array<display_object_info> m_display_object_array;
+		int	m_generation;
+		advance_state*	m_advancing;	// innermost advance() loop, or NULL
 	};
 
 
@@ -150,7 +150,7 @@ namespace gameswf
 		}
 	}
 
-	void vm_stack::clear_refs(hash<as_object*, bool>* visited_objects, as_object* this_ptr)
+	void vm_stack::clear_refs(as_object_walk* walk, as_object* this_ptr)
 	{
 		for (int i = 0; i < array<as_value>::size(); i++)
 		{
@@ -163,7 +163,7 @@ namespace gameswf
 				}
 				else
 				{
-					obj->clear_refs(visited_objects, this_ptr);
+					walk->push(obj);
 				}
 			}
 		}
@@ -346,24 +346,40 @@ namespace gameswf
 	}
 
 
-	as_value	as_environment::get_variable(const tu_string& varname, const ::array<with_stack_entry>& with_stack) const
-	// Return the value of the given var, if it's defined.
+	static bool	get_member_cached(as_member_cache* cache, as_object* obj, const tu_string& name, int atom, as_value* val)
+	{
+		if (cache)
+		{
+			return cache->get_member(obj, name, atom, val);
+		}
+		return obj->get_member_atom(atom, name, val);
+	}
+
+	as_value	as_environment::get_variable(const tu_string& varname, const ::array<with_stack_entry>& with_stack,
+		as_member_cache* cache, int atom) const
+	// Return the value of the given var, if it's defined.  cache
+	// is the inline cache of the calling site, if any, atom is
+	// the atom of varname, or -1.
 	{
 		// Path lookup rigamarole.
 		as_object*	target = get_target();
-		tu_string	path;
-		tu_string	var;
-		if (parse_path(varname, &path, &var))
+		target_path_cache*	paths = get_player()->get_path_cache();
+		const target_path_cache::entry*	e = paths->get(varname);
+		if (e->m_is_var_path)
 		{
+			target_path_cache::lock	hold(paths);
+			const tu_string&	path = e->m_path;
+			const tu_string&	var = e->m_var;
+
 			// @@ Use with_stack here too???  Need to test.
-			target = find_target(path.c_str());
+			target = m_target != NULL ? paths->find_target(m_target.get_ptr(), path) : NULL;
 			if (target)
 			{
 				as_value	val;
-				target->get_member(var, &val);
+				get_member_cached(cache, target, var, -1, &val);
 				return val;
 			}
-			else if ((target = get_player()->get_global()->find_target(path.c_str())))
+			else if ((target = paths->find_target(get_player()->get_global(), path)))
 			{
 				as_value	val;
 				target->get_member(var, &val);
@@ -377,14 +393,16 @@ namespace gameswf
 		}
 		else
 		{
-			return get_variable_raw(varname, with_stack);
+			return get_variable_raw(varname, with_stack, cache, atom);
 		}
 	}
 
 
 	as_value	as_environment::get_variable_raw(
 		const tu_string& varname,
-		const ::array<with_stack_entry>& with_stack) const
+		const ::array<with_stack_entry>& with_stack,
+		as_member_cache* cache,
+		int atom) const
 	// varname must be a plain variable name; no path parsing.
 	{
 		as_value	val;
@@ -393,7 +411,7 @@ namespace gameswf
 		for (int i = with_stack.size() - 1; i >= 0; i--)
 		{
 			as_object*	obj = with_stack[i].m_object.get_ptr();
-			if (obj && obj->get_member(varname, &val))
+			if (obj && get_member_cached(cache, obj, varname, atom, &val))
 			{
 				// Found the var in this context.
 				return val;
@@ -408,13 +426,14 @@ namespace gameswf
 		}
 
 		// Check movie members.
-		if (m_target != NULL && m_target->get_member(varname, &val))
+		if (m_target != NULL && m_target->get_member_atom(atom, varname, &val))
 		{
 			return val;
 		}
 
 		// Check this, _global, _root
-		as_standard_member	varname_id = get_standard_member(varname);
+		as_standard_member	varname_id = atom >= 0 ?
+			get_player()->get_atoms()->get_standard_member(atom) : get_standard_member(varname);
 		switch (varname_id)
 		{
 			default:
@@ -435,7 +454,7 @@ namespace gameswf
 		}
 
 		// check _global.member
-		if (get_player()->get_global()->get_member(varname, &val))
+		if (get_member_cached(cache, get_player()->get_global(), varname, atom, &val))
 		{
 			return val;
 		}
@@ -501,14 +520,22 @@ namespace gameswf
 
 		// Path lookup rigamarole.
 		character*	target = get_target();
-		tu_string	path;
-		tu_string	var;
-		if (parse_path(varname, &path, &var))
+		target_path_cache*	paths = get_player()->get_path_cache();
+		const target_path_cache::entry*	e = paths->get(varname);
+		if (e->m_is_var_path)
 		{
-			target = cast_to<character>(find_target(path.c_str()));
+			target_path_cache::lock	hold(paths);
+			if (m_target != NULL)
+			{
+				target = cast_to<character>(paths->find_target(m_target.get_ptr(), e->m_path));
+			}
+			else
+			{
+				target = NULL;
+			}
 			if (target)
 			{
-				target->set_member(var, val);
+				target->set_member(e->m_var, val);
 			}
 		}
 		else
@@ -597,10 +624,42 @@ namespace gameswf
 	// e.g. when setting up args for a function.
 	{
 		assert(varname.length() > 0);
+
+		// The frame may have a fixed slot waiting for it.
+		for (int i = m_local_frames.size() - 1; i >= 0; i--)
+		{
+			frame_slot&	slot = m_local_frames[i];
+			if (slot.m_name.length() == 0)
+			{
+				break;
+			}
+			if (slot.m_declared == false && slot.m_name == varname)
+			{
+				slot.m_value = val;
+				slot.m_declared = true;
+				return;
+			}
+		}
+
 		m_local_frames.push_back(frame_slot(varname, val));
 	}
 
 
+	int	as_environment::add_local_slots(const ::array<local_slot>& slots)
+	{
+		int	base = m_local_frames.size();
+		m_local_frames.resize(base + slots.size());
+		for (int i = 0; i < slots.size(); i++)
+		{
+			frame_slot&	slot = m_local_frames[base + i];
+			slot.m_name = slots[i].m_name;
+			slot.m_atom = slots[i].m_atom;
+			slot.m_declared = false;
+		}
+		return base;
+	}
+
+
 	void	as_environment::declare_local(const tu_string& varname)
 	// Create the specified local var if it doesn't exist already.
 	{
@@ -675,7 +734,7 @@ namespace gameswf
 				return -1;
 			}
 			else
-			if (slot.m_name == varname)
+			if (slot.m_declared && slot.m_name == varname)
 			{
 				// Found it.
 				return i;
@@ -735,6 +794,164 @@ namespace gameswf
 		return false;
 	}
 
+	//
+	// target_path_cache
+	//
+
+	target_path_cache::target_path_cache() :
+		m_busy(0)
+	{
+	}
+
+	target_path_cache::~target_path_cache()
+	{
+		clear();
+	}
+
+	void	target_path_cache::clear()
+	{
+		for (string_hash<entry*>::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+		{
+			delete it->second;
+		}
+		m_entries.clear();
+	}
+
+	target_path_cache::entry*	target_path_cache::get(const tu_string& path)
+	{
+		entry*	e = NULL;
+		if (m_entries.get(path, &e))
+		{
+			return e;
+		}
+
+		// Computed paths ("item" + i) would make it grow forever.
+		if (m_entries.size() >= 1024 && m_busy == 0)
+		{
+			clear();
+		}
+
+		e = new entry;
+		m_entries.add(path, e);
+		e->m_is_var_path = as_environment::parse_path(path, &e->m_path, &e->m_var);
+
+		// Cut it the way find_target() walks it: a leading '/'
+		// restarts from the root movie, then the name goes up to
+		// the next '/', or to the next '.' if there's no '/'
+		// left ("a..b" is one name).
+		const char*	str = path.c_str();
+		const char*	p = str;
+		for (;;)
+		{
+			bool	from_root = false;
+			while (*p == '/')
+			{
+				from_root = true;
+				p++;
+			}
+			if (*p == 0 && from_root == false)
+			{
+				break;
+			}
+
+			const char*	end = strchr(p, '/');
+			if (end == NULL)
+			{
+				end = strchr(p, '.');
+				if (end && end[1] == '.')
+				{
+					end = NULL;
+				}
+			}
+
+			e->m_segments.resize(e->m_segments.size() + 1);
+			segment&	seg = e->m_segments.back();
+			seg.m_name = end ? tu_string(p, int(end - p)) : tu_string(p);
+			seg.m_from_root = from_root;
+			seg.m_offset = int(p - str);
+			seg.m_std_member = get_standard_member(seg.m_name);
+			as_value	unused;
+			seg.m_child_lookup = get_builtin(BUILTIN_SPRITE_METHOD, seg.m_name, &unused) == false
+				&& seg.m_std_member != M_ENABLED
+				&& seg.m_std_member != M_CURRENTFRAME
+				&& seg.m_std_member != M_TOTALFRAMES
+				&& seg.m_std_member != M_FRAMESLOADED;
+			seg.m_generation = 0;
+
+			if (end == NULL)
+			{
+				break;
+			}
+			p = end + 1;
+		}
+
+		return e;
+	}
+
+	as_object*	target_path_cache::find_child(as_object* parent, segment* seg)
+	// parent->get_member(seg->m_name), for an object.
+	{
+		sprite_instance*	sprite = cast_to<sprite_instance>(parent);
+		if (sprite == NULL || seg->m_child_lookup == false)
+		{
+			as_value	val;
+			parent->get_member(seg->m_name, &val);
+			return val.to_object();
+		}
+
+		int	generation = sprite->m_display_list.get_generation();
+		if (seg->m_parent != parent || seg->m_generation != generation)
+		{
+			seg->m_parent = parent;
+			seg->m_generation = generation;
+			seg->m_child = sprite->m_display_list.get_character_by_name_i(seg->m_name);
+		}
+
+		if (seg->m_child.get_ptr())
+		{
+			return seg->m_child.get_ptr();
+		}
+
+		// Not a child: what sprite_instance::get_member() looks
+		// at after the display list.
+		as_value	val;
+		sprite->character::get_member_std(-1, seg->m_name, seg->m_std_member, &val);
+		return val.to_object();
+	}
+
+	as_object*	target_path_cache::find_target(as_object* start, const tu_string& path)
+	{
+		if (path.length() == 0)
+		{
+			return start;
+		}
+
+		entry*	e = get(path);
+		lock	hold(this);
+
+		as_object*	tar = start;
+		for (int i = 0; i < e->m_segments.size(); i++)
+		{
+			segment&	seg = e->m_segments[i];
+			if (seg.m_from_root)
+			{
+				tar = start->get_player()->get_root_movie();
+			}
+			if (tar == NULL || seg.m_name.length() == 0)
+			{
+				break;
+			}
+
+			tar = find_child(tar, &seg);
+			if (tar == NULL)
+			{
+				log_error("can't find target %s\n", path.c_str() + seg.m_offset);
+				break;
+			}
+		}
+		return tar;
+	}
+
 	as_object*	as_environment::find_target(const as_value& target) const
 	{
 		if (m_target != NULL)
@@ -762,7 +979,7 @@ namespace gameswf
 		return false;
 	}
 
-	void as_environment::clear_refs(hash<as_object*, bool>* visited_objects, as_object* this_ptr)
+	void as_environment::clear_refs(as_object_walk* walk, as_object* this_ptr)
 	{
 		// target
 		if (m_target.get() == this_ptr)
@@ -782,16 +999,16 @@ namespace gameswf
 				}
 				else
 				{
-					obj->clear_refs(visited_objects, this_ptr);
+					walk->push(obj);
 				}
 			}
 		}
 
 		// clear refs to 'this_ptr' from stack
-		vm_stack::clear_refs(visited_objects, this_ptr);
+		vm_stack::clear_refs(walk, this_ptr);
 
 		// clear refs to 'this_ptr' from scope stack
-		m_scope.clear_refs(visited_objects, this_ptr);
+		m_scope.clear_refs(walk, this_ptr);
 
 		// global register
 		for (int i = 0, n = GLOBAL_REGISTER_COUNT; i < n; i++)
@@ -805,7 +1022,7 @@ namespace gameswf
 				}
 				else
 				{
-					obj->clear_refs(visited_objects, this_ptr);
+					walk->push(obj);
 				}
 			}
 		}
@@ -822,7 +1039,7 @@ namespace gameswf
 				}
 				else
 				{
-					obj->clear_refs(visited_objects, this_ptr);
+					walk->push(obj);
 				}
 			}
 		}
@@ -20,9 +20,20 @@ namespace gameswf
 	struct character;
 	struct sprite_instance;
 	struct as_object;
+	struct as_member_cache;
+	struct as_object_walk;
 
 	exported_module tu_string get_full_url(const tu_string& workdir, const char* url);
 
+	// A local var or arg of a function body that gets a fixed
+	// slot in the local frame of each call, see
+	// action_program::get_local_slots().
+	struct local_slot
+	{
+		tu_string	m_name;
+		int	m_atom;
+	};
+
 	//
 	// with_stack_entry
 	//
@@ -89,17 +100,17 @@ namespace gameswf
 
 		void reset(int val)
 		{
-			(*this)[m_stack_size].set_int(val);
+			(*this)[m_stack_size].set_number(val);
 		}
 
 		void reset(float val)
 		{
-			(*this)[m_stack_size].set_double(val);
+			(*this)[m_stack_size].set_number(val);
 		}
 
 		void reset(double val)
 		{
-			(*this)[m_stack_size].set_double(val);
+			(*this)[m_stack_size].set_number(val);
 		}
 
 		void reset(as_object* val)
@@ -123,14 +134,33 @@ namespace gameswf
 			m_stack_size++;
 		}
 
+		// Makes room for count more values, so that pushing them
+		// doesn't grow the array.
+		void	reserve(int count)
+		{
+			if (m_stack_size + count > array<as_value>::size())
+			{
+				array<as_value>::resize(m_stack_size + count);
+			}
+		}
+
 		as_value&	pop();
 		exported_module void	drop(int count);
+
+		// Same as drop(1) for a Number on top.  Unlike drop() it
+		// leaves the Number in its slot, so that the next Number
+		// pushed is written in place.
+		void	drop_number()
+		{
+			assert(m_stack_size > 0 && top(0).is_numeric());
+			m_stack_size--;
+		}
 		as_value&	top(int dist) { return (*this)[m_stack_size - 1 - dist]; }
 		as_value&	bottom(int index) { return (*this)[index]; }
 		inline int	get_top_index() const { return m_stack_size - 1; }
 		inline int	size() const { return m_stack_size; }
 		void resize(int new_size);
-		void clear_refs(hash<as_object*, bool>* visited_objects, as_object* this_ptr);
+		void clear_refs(as_object_walk* walk, as_object* this_ptr);
 
 		// return object that contains the property
 		as_object* find_property(const char* name);
@@ -143,23 +173,79 @@ namespace gameswf
 		int m_stack_size;
 	};
 
+	// An array whose storage stays allocated when it shrinks, for
+	// the frames and registers that each function call pushes and
+	// pops.  The slots dropped by resize() are reset to T(), so
+	// that they don't keep anything alive.
+	template<class T>
+	struct local_stack : private array<T>
+	{
+		local_stack() :
+			m_size(0)
+		{
+		}
+
+		T&	operator[](int index)
+		{
+			assert(index >= 0 && index < m_size);
+			return array<T>::operator[](index);
+		}
+
+		const T&	operator[](int index) const
+		{
+			assert(index >= 0 && index < m_size);
+			return array<T>::operator[](index);
+		}
+
+		int	size() const { return m_size; }
+
+		void	resize(int new_size)
+		{
+			assert(new_size >= 0);
+			for (int i = new_size; i < m_size; i++)
+			{
+				array<T>::operator[](i) = T();
+			}
+			if (new_size > array<T>::size())
+			{
+				array<T>::resize(new_size);
+			}
+			m_size = new_size;
+		}
+
+		void	push_back(const T& val)
+		{
+			resize(m_size + 1);
+			(*this)[m_size - 1] = val;
+		}
+
+	private:
+		int	m_size;
+	};
+
 	struct as_environment : public vm_stack
 	{
 		vm_stack m_scope;	// scope stack for AVM2
 		as_value	m_global_register[GLOBAL_REGISTER_COUNT];
-		::array<as_value>	m_local_register;	// function2 uses this
+		local_stack<as_value>	m_local_register;	// function2 uses this
 		gc_ptr<as_object>	m_target;
 
 		// For local vars.  Use empty names to separate frames.
+		// The fixed slots of a function (add_local_slots()) come
+		// right after its barrier; they have an atom and they
+		// don't exist as vars until they're declared.
 		struct frame_slot
 		{
 			tu_string	m_name;
 			as_value	m_value;
+			int	m_atom;
+			bool	m_declared;
 
-			frame_slot() {}
-			frame_slot(const tu_string& name, const as_value& val) : m_name(name), m_value(val) {}
+			frame_slot() : m_atom(-1), m_declared(true) {}
+			frame_slot(const tu_string& name, const as_value& val) :
+				m_name(name), m_value(val), m_atom(-1), m_declared(true) {}
 		};
-		::array<frame_slot>	m_local_frames;
+		local_stack<frame_slot>	m_local_frames;
 
 		weak_ptr<player> m_player;
 
@@ -176,9 +262,11 @@ namespace gameswf
 		void set_target(character* target);
 		void set_target(as_value& target, character* original_target);
 
-		as_value	get_variable(const tu_string& varname, const ::array<with_stack_entry>& with_stack) const;
+		as_value	get_variable(const tu_string& varname, const ::array<with_stack_entry>& with_stack,
+			as_member_cache* cache = NULL, int atom = -1) const;
 		// no path stuff:
-		as_value	get_variable_raw(const tu_string& varname, const ::array<with_stack_entry>& with_stack) const;
+		as_value	get_variable_raw(const tu_string& varname, const ::array<with_stack_entry>& with_stack,
+			as_member_cache* cache = NULL, int atom = -1) const;
 
 		void	set_variable(const tu_string& path, const as_value& val, const ::array<with_stack_entry>& with_stack);
 		// no path stuff:
@@ -193,6 +281,67 @@ namespace gameswf
 		void	set_local_frame_top(int t) { assert(t <= m_local_frames.size()); m_local_frames.resize(t); }
 		void	add_frame_barrier() { m_local_frames.push_back(frame_slot()); }
 
+		// Fixed local slots.  add_local_slots() pushes the
+		// (undeclared) slots of a function onto the current
+		// frame and returns the index of the first one, the
+		// base the actions of the function body address them
+		// from.  The *_local_slot() calls are the fast paths of
+		// get_variable, set_variable, set_local and
+		// declare_local for a name that's expected in the given
+		// slot; they return false, without doing anything, when
+		// the name has to be looked up the slow way.
+		int	add_local_slots(const ::array<local_slot>& slots);
+		void	init_local_slot(int index, const as_value& val)
+		{
+			m_local_frames[index].m_value = val;
+			m_local_frames[index].m_declared = true;
+		}
+		bool	get_local_slot(int base, int slot, as_value* name_and_result)
+		{
+			frame_slot*	s = find_local_slot(base, slot, *name_and_result);
+			if (s && s->m_declared)
+			{
+				*name_and_result = s->m_value;
+				return true;
+			}
+			return false;
+		}
+		bool	set_variable_slot(int base, int slot, const as_value& name, const as_value& val)
+		{
+			frame_slot*	s = find_local_slot(base, slot, name);
+			if (s && s->m_declared)
+			{
+				s->m_value = val;
+				return true;
+			}
+			return false;
+		}
+		bool	set_local_slot(int base, int slot, const as_value& name, const as_value& val)
+		{
+			frame_slot*	s = find_local_slot(base, slot, name);
+			if (s)
+			{
+				s->m_value = val;
+				s->m_declared = true;
+				return true;
+			}
+			return false;
+		}
+		bool	declare_local_slot(int base, int slot, const as_value& name)
+		{
+			frame_slot*	s = find_local_slot(base, slot, name);
+			if (s)
+			{
+				if (s->m_declared == false)
+				{
+					s->m_value.set_undefined();
+					s->m_declared = true;
+				}
+				return true;
+			}
+			return false;
+		}
+
 		// Local registers.
 		void	add_local_registers(int register_count)
 		{
@@ -215,7 +364,7 @@ namespace gameswf
 		int	find_local(const tu_string& varname, bool ignore_barrier) const;
 		character* load_file(const char* url, const as_value& target, int method = 0);
 		as_object*	find_target(const as_value& target) const;
-		void clear_refs(hash<as_object*, bool>* visited_objects, as_object* this_ptr);
+		void clear_refs(as_object_walk* walk, as_object* this_ptr);
 		player* get_player() const;
 		root* get_root() const;
 
@@ -223,6 +372,22 @@ namespace gameswf
 
 		as_value*	local_register_ptr(int reg);
 
+		frame_slot*	find_local_slot(int base, int slot, const as_value& name)
+		// Returns the fixed slot if it's the one of name.
+		{
+			int	atom = name.get_atom();
+			int	index = base + slot;
+			if (atom >= 0 && base >= 0 && index < m_local_frames.size())
+			{
+				frame_slot&	s = m_local_frames[index];
+				if (s.m_atom == atom && s.m_name == name.to_tu_string())
+				{
+					return &s;
+				}
+			}
+			return NULL;
+		}
+
 	};
 
 
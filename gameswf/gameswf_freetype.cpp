@@ -203,9 +203,11 @@ namespace gameswf
 		// form hash key
 		int key = (fontsize << 16) | code;
 
-		// try to find the stored image of character
-		glyph_entity* ge = NULL;
-		if (fe->m_ge.get(key, &ge) == false)
+		// try to find the stored image of character, it may have
+		// been evicted
+		freetype_glyph* ge = NULL;
+		fe->m_ge.get(key, &ge);
+		if (ge == NULL || ge->m_bi == NULL)
 		{
 			FT_Set_Pixel_Sizes(fe->m_face, fontsize, fontsize);
 			if (FT_Load_Char(fe->m_face, code, FT_LOAD_RENDER))
@@ -213,7 +215,13 @@ namespace gameswf
 				return NULL;
 			}
 
-			ge = new glyph_entity();
+			if (ge == NULL)
+			{
+				ge = new freetype_glyph();
+
+				// keep image of character
+				fe->m_ge.add(key, ge);
+			}
 
 			image::alpha* im = draw_bitmap(fe->m_face->glyph->bitmap);
 			ge->m_bi = render::create_bitmap_info_alpha(im->m_width, im->m_height, im->m_data);
@@ -230,10 +238,8 @@ namespace gameswf
 
 			float scale = 16.0f / fontsize;	// hack
 			ge->m_advance = (float) fe->m_face->glyph->metrics.horiAdvance * scale;
-
-			// keep image of character
-			fe->m_ge.add(key, ge);
 		}
+		ge->touch(get_bitmap_bytes(ge->m_bi.get_ptr()));
 
 		if (bounds)
 		{
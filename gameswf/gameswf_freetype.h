@@ -13,6 +13,7 @@
 #include "gameswf/gameswf.h"
 #include "gameswf/gameswf_shape.h"
 #include "gameswf/gameswf_canvas.h"
+#include "gameswf/gameswf_memory.h"
 
 #if TU_CONFIG_LINK_TO_FREETYPE == 1
 
@@ -24,10 +25,17 @@
 
 namespace gameswf
 {
+	// A rendered character.  The bitmap can be evicted, it's rendered
+	// again when it's needed.
+	struct freetype_glyph : public glyph_entity, public memory_cache
+	{
+		virtual void	evict() { m_bi = NULL; }
+	};
+
 	struct face_entity : public ref_counted
 	{
 		FT_Face m_face;
-		hash<int, glyph_entity*> m_ge;	// <code, glyph_entity>
+		hash<int, freetype_glyph*> m_ge;	// <code, freetype_glyph>
 
 		face_entity(FT_Face face) :
 			m_face(face)
@@ -38,7 +46,7 @@ namespace gameswf
 		~face_entity()
 		{
 			FT_Done_Face(m_face);
-			for (hash<int, glyph_entity*>::iterator it = m_ge.begin(); it != m_ge.end(); ++it)
+			for (hash<int, freetype_glyph*>::iterator it = m_ge.begin(); it != m_ge.end(); ++it)
 			{
 				delete it->second;
 			}
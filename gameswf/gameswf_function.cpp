@@ -9,6 +9,8 @@
 #include "gameswf/gameswf_log.h"
 #include "gameswf/gameswf_character.h"
 #include "gameswf/gameswf_sprite.h"
+#include "gameswf/gameswf_profiler.h"
+#include "gameswf/gameswf_script_budget.h"
 #include "gameswf/gameswf_as_classes/as_array.h"
 
 namespace gameswf
@@ -71,11 +73,33 @@ namespace gameswf
 	{
 	}
 
+	void	as_s_function::set_local_slots(const array<local_slot>& slots)
+	{
+		m_local_slots = slots;
+		for (int i = 0; i < m_args.size(); i++)
+		{
+			if (m_args[i].m_register != 0)
+			{
+				continue;
+			}
+			for (int j = 0; j < slots.size(); j++)
+			{
+				if (slots[j].m_name == m_args[i].m_name)
+				{
+					m_args[i].m_slot = j;
+					break;
+				}
+			}
+		}
+	}
+
 	void	as_s_function::operator()(const fn_call& fn)
 	// Dispatch.
 	{
 
 		assert(fn.env);
+		as_profiler_scope	profile(this);
+		script_budget_scope	budget(this);
 
 		// Keep target alive during execution!
 		gc_ptr<as_object> target(m_target.get_ptr());
@@ -120,6 +144,7 @@ namespace gameswf
 		// Set up local stack frame, for parameters and locals.
 		int	local_stack_top = env->get_local_frame_top();
 		env->add_frame_barrier();
+		int	local_slots = env->add_local_slots(m_local_slots);
 
 		if (m_is_function2 == false)
 		{
@@ -130,7 +155,14 @@ namespace gameswf
 			for (int i = 0; i < args_to_pass; i++)
 			{
 				assert(m_args[i].m_register == 0);
-				env->add_local(m_args[i].m_name, fn.arg(i));
+				if (m_args[i].m_slot >= 0)
+				{
+					env->init_local_slot(local_slots + m_args[i].m_slot, fn.arg(i));
+				}
+				else
+				{
+					env->add_local(m_args[i].m_name, fn.arg(i));
+				}
 			}
 
 			env->set_local("this", this_ptr);
@@ -152,7 +184,11 @@ namespace gameswf
 			int	args_to_pass = imin(fn.nargs, m_args.size());
 			for (int i = 0; i < args_to_pass; i++)
 			{
-				if (m_args[i].m_register == 0)
+				if (m_args[i].m_slot >= 0)
+				{
+					env->init_local_slot(local_slots + m_args[i].m_slot, fn.arg(i));
+				}
+				else if (m_args[i].m_register == 0)
 				{
 					// Conventional arg passing: create a local var.
 					env->add_local(m_args[i].m_name, fn.arg(i));
@@ -269,7 +305,7 @@ namespace gameswf
 		int stack_size = env->get_stack_size();
 
 		// Execute the actions.
-		m_action_buffer.execute(env, m_start_pc, m_length, fn.result, m_with_stack, m_is_function2);
+		m_action_buffer.execute(env, m_start_pc, m_length, fn.result, m_with_stack, m_is_function2, local_slots);
 
 		// restore stack size
 		// it should not be but it happens
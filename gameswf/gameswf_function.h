@@ -87,8 +87,11 @@ namespace gameswf
 		{
 			int	m_register;
 			tu_string	m_name;
+			int	m_slot;	// fixed local slot, -1 if none
 		};
 		array<arg_spec>	m_args;
+		array<local_slot>	m_local_slots;
+		tu_string	m_name;	// empty for anonymous functions
 		bool	m_is_function2;
 		uint8	m_local_register_count;
 		uint16	m_function2_flags;	// used by function2 to control implicit arg register assignments
@@ -114,8 +117,12 @@ namespace gameswf
 			m_args.resize(m_args.size() + 1);
 			m_args.back().m_register = arg_register;
 			m_args.back().m_name = name;
+			m_args.back().m_slot = -1;
 		}
 
+		// Call after the args have been added.
+		void	set_local_slots(const array<local_slot>& slots);
+
 		void	set_length(int len) { assert(len >= 0); m_length = len; }
 		void set_target(as_object* target)
 		{
@@ -0,0 +1,540 @@
+// gameswf_heap.cpp
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// The garbage manager of a player, see gameswf_heap.h.
+
+#include "gameswf/gameswf_heap.h"
+#include "gameswf/gameswf_object.h"
+#include "base/tu_timer.h"
+
+namespace gameswf
+{
+
+	// How many objects are marked or swept between two looks at
+	// the clock; also the least work a frame does on the old
+	// generation, so that a collection always ends.
+	static const int	s_step_objects = 64;
+
+	//
+	// as_heap_list
+	//
+
+	void	as_heap_list::push_front(as_object* obj)
+	{
+		as_heap_node&	node = obj->m_heap_node;
+		node.m_prev = NULL;
+		node.m_next = m_first;
+		if (m_first)
+		{
+			m_first->m_heap_node.m_prev = obj;
+		}
+		m_first = obj;
+		m_size++;
+	}
+
+	void	as_heap_list::remove(as_object* obj)
+	{
+		as_heap_node&	node = obj->m_heap_node;
+		if (node.m_prev)
+		{
+			node.m_prev->m_heap_node.m_next = node.m_next;
+		}
+		else
+		{
+			assert(m_first == obj);
+			m_first = node.m_next;
+		}
+		if (node.m_next)
+		{
+			node.m_next->m_heap_node.m_prev = node.m_prev;
+		}
+		node.m_prev = NULL;
+		node.m_next = NULL;
+		m_size--;
+	}
+
+	//
+	// as_object_walk
+	//
+
+	void	as_object_walk::start(Uint32 stamp, as_object* obj)
+	{
+		m_stamp = stamp;
+		m_stack.resize(0);
+		push(obj);
+	}
+
+	void	as_object_walk::push(as_object* obj)
+	{
+		if (obj && obj->m_heap_node.m_walk != m_stamp)
+		{
+			obj->m_heap_node.m_walk = m_stamp;
+			m_stack.push_back(obj);
+		}
+	}
+
+	as_object*	as_object_walk::pop()
+	{
+		if (m_stack.size() == 0)
+		{
+			return NULL;
+		}
+		as_object* obj = m_stack.back();
+		m_stack.pop_back();
+		return obj;
+	}
+
+	//
+	// as_heap
+	//
+
+	as_heap::as_heap() :
+		m_cursor(NULL),
+		m_sweep(NULL),
+		m_walk_stamp(0),
+		m_cycle(0),
+		m_epoch(0),
+		m_major(0),
+		m_phase(IDLE),
+		m_old_live(0),
+		m_promoted(0),
+		m_frames(0),
+		m_budget_us(DEFAULT_BUDGET_US)
+	{
+	}
+
+	as_heap::~as_heap()
+	{
+		clear();
+	}
+
+	as_heap_list*	as_heap::get_list(int gen)
+	{
+		switch (gen)
+		{
+			case NURSERY:
+				return &m_nursery;
+			case YOUNG:
+				return &m_young;
+			case OLD:
+				return &m_old;
+			default:
+				assert(0);
+		}
+		return NULL;
+	}
+
+	void	as_heap::move_to(as_heap_list* gen, as_object* obj, generation g)
+	{
+		as_heap_node&	node = obj->m_heap_node;
+		if (node.m_gen != NOT_IN_HEAP)
+		{
+			get_list(node.m_gen)->remove(obj);
+		}
+		gen->push_front(obj);
+		node.m_gen = g;
+	}
+
+	void	as_heap::add(as_object* obj)
+	{
+		assert(obj);
+		if (obj->m_heap_node.m_gen != NOT_IN_HEAP)
+		{
+			mark(obj);
+			return;
+		}
+
+		move_to(&m_nursery, obj, NURSERY);
+		obj->m_heap_node.m_mark = m_epoch;
+	}
+
+	void	as_heap::unlink(as_object* obj)
+	{
+		as_heap_node&	node = obj->m_heap_node;
+		if (node.m_gen == NOT_IN_HEAP)
+		{
+			return;
+		}
+
+		if (m_cursor == obj)
+		{
+			m_cursor = node.m_next;
+		}
+		if (m_sweep == obj)
+		{
+			m_sweep = node.m_next;
+		}
+		get_list(node.m_gen)->remove(obj);
+		node.m_gen = NOT_IN_HEAP;
+	}
+
+	void	as_heap::remove(as_object* obj)
+	{
+		// The remembered and the gray objects are held, so they
+		// can't die here.
+		unlink(obj);
+	}
+
+	bool	as_heap::mark(as_object* obj)
+	// Returns true if obj is young and was not marked yet.
+	{
+		as_heap_node&	node = obj->m_heap_node;
+		switch (node.m_gen)
+		{
+			case NURSERY:
+			case YOUNG:
+				if (node.m_mark != m_epoch)
+				{
+					node.m_mark = m_epoch;
+					return true;
+				}
+				break;
+
+			case OLD:
+				shade(obj);
+				break;
+
+			default:
+				break;
+		}
+		return false;
+	}
+
+	void	as_heap::mark_reached(as_object* obj)
+	{
+		// Getters may run scripts that get here again, so each
+		// call only pops what it has pushed.
+		int	base = m_mark_stack.size();
+		if (mark(obj))
+		{
+			m_mark_stack.push_back(obj);
+		}
+
+		while (m_mark_stack.size() > base)
+		{
+			as_object* reached = m_mark_stack.back();
+			m_mark_stack.pop_back();
+			for (int i = 0; i < reached->m_members.size(); i++)
+			{
+				as_object* member = reached->m_members.value_at(i).to_object();
+				if (member && mark(member))
+				{
+					m_mark_stack.push_back(member);
+				}
+			}
+		}
+	}
+
+	bool	as_heap::is_garbage(as_object* obj) const
+	{
+		const as_heap_node&	node = obj->m_heap_node;
+		switch (node.m_gen)
+		{
+			case YOUNG:
+				return node.m_mark != m_epoch;
+
+			case OLD:
+				return m_phase != IDLE && node.m_mark != m_major;
+
+			default:
+				break;
+		}
+		return false;
+	}
+
+	void	as_heap::shade(as_object* obj)
+	// Marks an old object for the running collection.
+	{
+		as_heap_node&	node = obj->m_heap_node;
+		assert(node.m_gen == OLD);
+		if (m_phase == IDLE || node.m_mark == m_major)
+		{
+			return;
+		}
+
+		node.m_mark = m_major;
+		if (m_phase == MARK)
+		{
+			m_gray.push_back(obj);
+		}
+	}
+
+	void	as_heap::remember(as_object* obj)
+	{
+		as_heap_node&	node = obj->m_heap_node;
+		if (node.m_remembered == false)
+		{
+			node.m_remembered = true;
+			m_remembered.push_back(obj);
+		}
+	}
+
+	void	as_heap::write_barrier(as_object* holder, as_object* val)
+	{
+		assert(holder->m_heap_node.m_gen == OLD);
+		switch (val->m_heap_node.m_gen)
+		{
+			case NURSERY:
+			case YOUNG:
+				// end_frame() must see val through holder
+				remember(holder);
+				break;
+
+			case OLD:
+				// holder may have been marked already, so it
+				// won't be looked at again in this collection
+				if (holder->m_heap_node.m_mark == m_major)
+				{
+					shade(val);
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	void	as_heap::scan(as_object* obj)
+	// Marks the old objects that obj has in its members.  The young
+	// ones are marked by the frames.
+	{
+		for (int i = 0; i < obj->m_members.size(); i++)
+		{
+			as_object* member = obj->m_members.value_at(i).to_object();
+			if (member && member->m_heap_node.m_gen == OLD)
+			{
+				shade(member);
+			}
+		}
+	}
+
+	void	as_heap::clear_refs(as_object* obj)
+	{
+		m_walk.start(++m_walk_stamp, obj);
+		while (as_object* reached = m_walk.pop())
+		{
+			reached->clear_refs(&m_walk, obj);
+		}
+	}
+
+	void	as_heap::drop(as_object* obj)
+	// The caller holds obj.
+	{
+		unlink(obj);
+		clear_refs(obj);
+		m_stats.m_freed++;
+	}
+
+	void	as_heap::begin_frame(as_object* global)
+	{
+		m_epoch = ++m_cycle;
+		m_frames++;
+
+		if (m_phase == IDLE &&
+			(m_promoted >= imax(MIN_GROWTH, m_old_live / 2) || m_frames >= MAJOR_INTERVAL))
+		{
+			// Start an old collection.  Everything that the
+			// frames mark from now on is alive, so it can end
+			// at the end of this frame at the soonest.
+			m_major = ++m_cycle;
+			m_phase = MARK;
+			m_promoted = 0;
+			m_frames = 0;
+			if (global && global->m_heap_node.m_gen == OLD)
+			{
+				shade(global);
+			}
+		}
+	}
+
+	void	as_heap::collect_young()
+	// Drops the objects of the last frame that this frame has not
+	// reached, and makes the others old.
+	{
+		// Objects that only an old object has, since they were
+		// created.
+		{
+			array<gc_ptr<as_object> >	remembered;
+			remembered.transfer_members(&m_remembered);
+			for (int i = 0; i < remembered.size(); i++)
+			{
+				as_object* obj = remembered[i].get_ptr();
+				obj->m_heap_node.m_remembered = false;
+				if (obj->m_heap_node.m_gen != OLD)
+				{
+					// swept since
+					continue;
+				}
+
+				bool	has_nursery = false;
+				for (int j = 0; j < obj->m_members.size(); j++)
+				{
+					as_object* member = obj->m_members.value_at(j).to_object();
+					if (member)
+					{
+						mark_reached(member);
+						has_nursery |= member->m_heap_node.m_gen == NURSERY;
+					}
+				}
+
+				// The nursery is looked at in the next frame.
+				if (has_nursery)
+				{
+					remember(obj);
+				}
+			}
+		}
+
+		m_cursor = m_young.m_first;
+		while (m_cursor)
+		{
+			// Dropping it may free others, remove() keeps
+			// m_cursor right.
+			gc_ptr<as_object>	obj = m_cursor;
+			m_cursor = obj->m_heap_node.m_next;
+
+			if (obj->m_heap_node.m_mark != m_epoch)
+			{
+				drop(obj.get_ptr());
+				continue;
+			}
+
+			move_to(&m_old, obj.get_ptr(), OLD);
+			shade(obj.get_ptr());
+			m_promoted++;
+			m_stats.m_promoted++;
+
+			for (int j = 0; j < obj->m_members.size(); j++)
+			{
+				as_object* member = obj->m_members.value_at(j).to_object();
+				if (member && member->m_heap_node.m_gen == NURSERY)
+				{
+					remember(obj.get_ptr());
+					break;
+				}
+			}
+		}
+		assert(m_young.m_size == 0);
+
+		m_young = m_nursery;
+		m_nursery = as_heap_list();
+		for (as_object* obj = m_young.m_first; obj; obj = obj->m_heap_node.m_next)
+		{
+			obj->m_heap_node.m_gen = YOUNG;
+		}
+	}
+
+	bool	as_heap::over_budget(Uint64 start) const
+	{
+		if (m_budget_us <= 0)
+		{
+			return false;
+		}
+		double	ms = tu_timer::profile_ticks_to_milliseconds(tu_timer::get_profile_ticks() - start);
+		return ms * 1000.0 >= m_budget_us;
+	}
+
+	void	as_heap::step_old(Uint64 start)
+	// Does some of the old collection, as much as the budget lets.
+	{
+		int	n = 0;
+		while (m_phase == MARK)
+		{
+			if (m_gray.size() == 0)
+			{
+				m_phase = SWEEP;
+				m_sweep = m_old.m_first;
+				break;
+			}
+
+			gc_ptr<as_object>	obj = m_gray.back();
+			m_gray.pop_back();
+			scan(obj.get_ptr());
+
+			if (++n % s_step_objects == 0 && over_budget(start))
+			{
+				return;
+			}
+		}
+
+		while (m_phase == SWEEP)
+		{
+			if (m_sweep == NULL)
+			{
+				m_phase = IDLE;
+				m_old_live = m_old.m_size;
+				m_stats.m_major++;
+				break;
+			}
+
+			// The objects promoted since the sweep began are
+			// put before m_sweep, and are marked.
+			gc_ptr<as_object>	obj = m_sweep;
+			m_sweep = obj->m_heap_node.m_next;
+			if (obj->m_heap_node.m_mark != m_major)
+			{
+				drop(obj.get_ptr());
+			}
+
+			if (++n % s_step_objects == 0 && over_budget(start))
+			{
+				return;
+			}
+		}
+	}
+
+	void	as_heap::end_frame(as_object* global)
+	{
+		Uint64	start = tu_timer::get_profile_ticks();
+
+		if (global)
+		{
+			mark_reached(global);
+		}
+		collect_young();
+
+		if (m_phase != IDLE)
+		{
+			step_old(start);
+		}
+
+		m_stats.m_minor++;
+		float	us = (float) (tu_timer::profile_ticks_to_milliseconds(tu_timer::get_profile_ticks() - start) * 1000.0);
+		m_stats.m_last_pause_us = us;
+		if (us > m_stats.m_max_pause_us)
+		{
+			m_stats.m_max_pause_us = us;
+		}
+	}
+
+	void	as_heap::clear()
+	{
+		as_heap_list*	gens[] = { &m_nursery, &m_young, &m_old };
+		for (int g = 0; g < 3; g++)
+		{
+			while (gens[g]->m_first)
+			{
+				gc_ptr<as_object>	obj = gens[g]->m_first;
+				drop(obj.get_ptr());
+			}
+		}
+
+		m_remembered.resize(0);
+		m_gray.resize(0);
+		m_phase = IDLE;
+		m_old_live = 0;
+		m_promoted = 0;
+		m_frames = 0;
+	}
+
+	void	as_heap::get_stats(as_heap_stats* stats) const
+	{
+		*stats = m_stats;
+		stats->m_young = m_nursery.m_size + m_young.m_size;
+		stats->m_old = m_old.m_size;
+		stats->m_remembered = m_remembered.size();
+	}
+
+}
@@ -0,0 +1,238 @@
+// gameswf_heap.h
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// The garbage manager of a player.  It holds the objects created by
+// scripts (and the sprites), finds those that are no longer reached
+// from _global or from the sprites that advance, and breaks their
+// cycles so that they can be freed, see as_object::clear_refs().
+//
+// It is generational and incremental.  The objects created in a
+// frame are not looked at until the end of the next frame, when
+// they are dropped if nothing reached them, or promoted to the old
+// generation.  The end of a frame only traces from the young
+// objects that were reached and from the old objects that got a
+// young one in their members (the remembered set), so its cost
+// follows what the frame created, not the size of the heap.
+//
+// The old generation is collected by a mark and sweep that is spread
+// over the frames, each frame doing at most the budget of
+// microseconds set by set_budget().  as_object::member_stored() is
+// the write barrier that keeps both working while scripts change
+// the members of the objects.
+
+#ifndef GAMESWF_HEAP_H
+#define GAMESWF_HEAP_H
+
+#include "base/container.h"
+#include "base/tu_types.h"
+#include "gameswf/gameswf.h"
+
+namespace gameswf
+{
+	struct as_object;
+
+	// An as_object's place in the as_heap.  The heap doesn't hold a
+	// ref on the objects: it links them in the list of their
+	// generation, and an object unlinks itself when it dies, see
+	// as_heap::remove().
+	struct as_heap_node
+	{
+		as_heap_node() :
+			m_prev(NULL),
+			m_next(NULL),
+			m_mark(0),
+			m_walk(0),
+			m_gen(0),
+			m_remembered(false)
+		{
+		}
+
+		as_object*	m_prev;
+		as_object*	m_next;
+		Uint32	m_mark;	// cycle that last found it alive
+		Uint32	m_walk;	// last as_object_walk that went through it
+		Uint8	m_gen;	// as_heap::generation
+		bool	m_remembered;
+	};
+
+	// The objects of a generation.
+	struct as_heap_list
+	{
+		as_heap_list() :
+			m_first(NULL),
+			m_size(0)
+		{
+		}
+
+		void	push_front(as_object* obj);
+		void	remove(as_object* obj);
+
+		as_object*	m_first;
+		int	m_size;
+	};
+
+	// Goes through the objects reached from one, each of them once,
+	// with a stack instead of recursion.  The objects a walk has
+	// been through are stamped with it, see as_heap::clear_refs().
+	struct as_object_walk
+	{
+		as_object_walk() :
+			m_stamp(0)
+		{
+		}
+
+		void	start(Uint32 stamp, as_object* obj);
+
+		// Pushes obj unless the walk has been there already.
+		void	push(as_object* obj);
+
+		// Returns the next object, NULL at the end.
+		as_object*	pop();
+
+	private:
+		array<as_object*>	m_stack;
+		Uint32	m_stamp;
+	};
+
+	// What the heap has done.
+	struct as_heap_stats
+	{
+		as_heap_stats() :
+			m_young(0),
+			m_old(0),
+			m_remembered(0),
+			m_minor(0),
+			m_major(0),
+			m_promoted(0),
+			m_freed(0),
+			m_last_pause_us(0),
+			m_max_pause_us(0)
+		{
+		}
+
+		int	m_young;	// objects created in the last two frames
+		int	m_old;
+		int	m_remembered;
+		int	m_minor;	// frames collected
+		int	m_major;	// collections of the old generation
+		int	m_promoted;
+		int	m_freed;
+		float	m_last_pause_us;
+		float	m_max_pause_us;
+	};
+
+	struct as_heap
+	{
+		enum generation
+		{
+			NOT_IN_HEAP,
+			NURSERY,	// created in this frame
+			YOUNG,	// created in the last frame
+			OLD
+		};
+
+		enum phase
+		{
+			IDLE,
+			MARK,
+			SWEEP
+		};
+
+		// An old collection is started when the old generation has
+		// grown by half since the last one, or after MAJOR_INTERVAL
+		// frames.
+		enum { MIN_GROWTH = 256, MAJOR_INTERVAL = 256, DEFAULT_BUDGET_US = 1000 };
+
+		as_heap();
+		~as_heap();
+
+		// Puts obj in the heap, alive for this frame.
+		void	add(as_object* obj);
+
+		// Called when obj dies.
+		void	remove(as_object* obj);
+
+		// Marks obj and the young objects reached from it alive, see
+		// as_object::this_alive().  The old ones are only queued, to
+		// be marked a bit at a time by end_frame().
+		void	mark_reached(as_object* obj);
+
+		bool	is_garbage(as_object* obj) const;
+
+		// Called around the scripts of a frame.  The objects the
+		// frame doesn't reach are collected by end_frame(), within
+		// the budget.
+		void	begin_frame(as_object* global);
+		void	end_frame(as_object* global);
+
+		// Breaks the cycles of all the objects and drops them.
+		void	clear();
+
+		// Microseconds of old generation work a frame may do, 0
+		// means finish each collection in the frame that starts it.
+		void	set_budget(int us) { m_budget_us = us; }
+		int	get_budget() const { return m_budget_us; }
+
+		void	get_stats(as_heap_stats* stats) const;
+
+		// Called by as_object::member_stored() when an old object
+		// gets another object in its members.
+		void	write_barrier(as_object* holder, as_object* val);
+
+		// Breaks the cycles through obj: clears the refs to obj
+		// of the objects reached from it.
+		void	clear_refs(as_object* obj);
+
+	private:
+		bool	mark(as_object* obj);
+		void	remember(as_object* obj);
+		void	shade(as_object* obj);
+		void	scan(as_object* obj);
+		void	collect_young();
+		void	step_old(Uint64 start);
+		bool	over_budget(Uint64 start) const;
+		void	unlink(as_object* obj);
+		void	drop(as_object* obj);
+		void	move_to(as_heap_list* gen, as_object* obj, generation g);
+		as_heap_list*	get_list(int gen);
+
+		as_heap_list	m_nursery;
+		as_heap_list	m_young;
+		as_heap_list	m_old;
+
+		// Next objects to look at by collect_young() and by the
+		// sweep, remove() moves them on.
+		as_object*	m_cursor;
+		as_object*	m_sweep;
+
+		// Old objects that may hold young ones.  These and the gray
+		// objects are held until they have been looked at.
+		array<gc_ptr<as_object> >	m_remembered;
+
+		// Marked old objects whose members are not marked yet.
+		array<gc_ptr<as_object> >	m_gray;
+
+		// Young objects whose members are not marked yet, see
+		// mark_reached().
+		array<as_object*>	m_mark_stack;
+
+		as_object_walk	m_walk;
+		Uint32	m_walk_stamp;
+
+		Uint32	m_cycle;	// last value given to m_epoch or m_major
+		Uint32	m_epoch;	// of the frame, young objects are marked with it
+		Uint32	m_major;	// of the old collection, old objects are marked with it
+		phase	m_phase;
+		int	m_old_live;	// size of m_old after the last sweep
+		int	m_promoted;	// since the last old collection
+		int	m_frames;	// since the last old collection
+		int	m_budget_us;
+
+		as_heap_stats	m_stats;
+	};
+
+}
+
+#endif // GAMESWF_HEAP_H
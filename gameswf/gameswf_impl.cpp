@@ -31,6 +31,8 @@
 #include "gameswf/gameswf_function.h"
 #include "gameswf/gameswf_abc.h"
 #include "gameswf/gameswf_filters.h"
+#include "gameswf/gameswf_profiler.h"
+#include "gameswf/gameswf_script_budget.h"
 #include "base/image.h"
 #include "base/jpeg.h"
 #include "base/zlib_adapter.h"
@@ -54,6 +56,9 @@ namespace gameswf
 	bool	s_verbose_action = false;
 	bool	s_verbose_parse = false;
 	bool	s_use_cached_movie_instance = false;
+	bool	s_use_jit = true;
+	int	s_jit_threshold = 10;
+	bool	s_optimize_actions = false;
 
 #ifndef NDEBUG
 	bool	s_verbose_debug = true;
@@ -89,6 +94,39 @@ namespace gameswf
 		s_verbose_parse = verbose;
 	}
 
+	bool get_use_jit()
+	{
+		return s_use_jit;
+	}
+
+	void	set_use_jit(bool use_jit)
+	// Enable/disable entering jitted code.
+	{
+		s_use_jit = use_jit;
+	}
+
+	int get_jit_threshold()
+	{
+		return s_jit_threshold;
+	}
+
+	void	set_jit_threshold(int calls)
+	// Number of calls before code is compiled.
+	{
+		s_jit_threshold = calls;
+	}
+
+	bool get_optimize_actions()
+	{
+		return s_optimize_actions;
+	}
+
+	void	set_optimize_actions(bool optimize)
+	// Enable/disable optimizing actions that haven't run yet.
+	{
+		s_optimize_actions = optimize;
+	}
+
 	//
 	// some utility stuff
 	//
@@ -97,6 +135,10 @@ namespace gameswf
 	// Execute the actions in the action list, in the given
 	// environment.
 	{
+		character*	target = env->get_target();
+		as_profiler_scope	profile(target, target ? target->get_current_frame() : -1);
+		script_budget_scope	budget(target, target ? target->get_current_frame() : -1);
+
 		for (int i = 0; i < action_list.size(); i++)
 		{
 			action_list[i]->execute(env);
@@ -102,6 +102,12 @@ namespace gameswf
 			}
 			return false;
 		}
+
+		virtual void	get_hit_bound(rect* bound)
+		// point_test_local() is false outside of our bound.
+		{
+			get_bound(bound);
+		}
 	};
 
 
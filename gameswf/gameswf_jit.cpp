@@ -5,25 +5,142 @@
 
 // Jit helpers
 
-#ifdef __GAMESWF_ENABLE_JIT__ 
-
 #include "gameswf_jit.h"
 
+#ifdef __GAMESWF_ENABLE_JIT__
+
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <sys/mman.h>
+#	ifndef MAP_ANONYMOUS
+#		define MAP_ANONYMOUS MAP_ANON
+#	endif
+#endif
+
+// Executable memory.  Pages are allocated read/write, filled, then
+// switched to read/execute, so no page is ever writable and executable
+// at the same time.
+
+static void* allocate_code_memory( int size )
+{
+#ifdef _WIN32
+	return VirtualAlloc( NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE );
+#else
+	void* memory = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+	return memory == MAP_FAILED ? NULL : memory;
+#endif
+}
+
+static bool protect_code_memory( void* memory, int size )
+{
+#ifdef _WIN32
+	DWORD old_protection;
+	if( VirtualProtect( memory, size, PAGE_EXECUTE_READ, &old_protection ) == FALSE )
+	{
+		return false;
+	}
+	FlushInstructionCache( GetCurrentProcess(), memory, size );
+	return true;
+#else
+	return mprotect( memory, size, PROT_READ | PROT_EXEC ) == 0;
+#endif
+}
+
+static void free_code_memory( void* memory, int size )
+{
+#ifdef _WIN32
+	VirtualFree( memory, 0, MEM_RELEASE );
+#else
+	munmap( memory, size );
+#endif
+}
+
+jit_function::~jit_function()
+{
+	clear();
+}
+
+void jit_function::clear()
+{
+	if( m_executable_byte_code )
+	{
+		free_code_memory( m_executable_byte_code, m_executable_size );
+		m_executable_byte_code = NULL;
+		m_executable_size = 0;
+	}
+
+	m_work_byte_code.clear();
+	m_address_patches.clear();
+	m_labels.clear();
+	m_label_patches.clear();
+}
+
 void jit_function::initialize()
 {
-	m_executable_byte_code = &m_work_byte_code[ 0 ];
+	assert( m_executable_byte_code == NULL );
+
+	int size = m_work_byte_code.size();
+	if( size == 0 )
+	{
+		return;
+	}
 
 	int patch_index, patch_count;
+	patch_count = m_label_patches.size();
+
+	for( patch_index = 0; patch_index < patch_count; ++patch_index )
+	{
+		label_patch & entry = m_label_patches[ patch_index ];
+		int target = m_labels[ entry.m_label ];
+		assert( target >= 0 );
+
+		int32 offset = target - ( entry.m_byte_code_position + 4 );
+		memcpy( &m_work_byte_code[ entry.m_byte_code_position ], &offset, 4 );
+	}
+
+	uint8 * memory = (uint8 *) allocate_code_memory( size );
+	if( memory == NULL )
+	{
+		return;
+	}
+	memcpy( memory, &m_work_byte_code[ 0 ], size );
+
+	// Calls to absolute addresses are relative to where the code
+	// finally lives.
 	patch_count = m_address_patches.size();
 
 	for( patch_index = 0; patch_index < patch_count; ++patch_index )
 	{
 		patch_entry & entry = m_address_patches[ patch_index ];
 		uint32 offset = (Uint32)
-			(entry.m_address - &m_work_byte_code[entry.m_byte_code_position] - entry.m_byte_count);
+			(entry.m_address - &memory[entry.m_byte_code_position] - entry.m_byte_count);
 
 		assert( entry.m_byte_count == 4 );
-		*(uint32*)&m_work_byte_code[ entry.m_byte_code_position ] = offset;
+		memcpy( &memory[ entry.m_byte_code_position ], &offset, 4 );
+	}
+
+	if( protect_code_memory( memory, size ) == false )
+	{
+		free_code_memory( memory, size );
+		return;
+	}
+
+	m_executable_byte_code = memory;
+	m_executable_size = size;
+
+	// The work buffers aren't needed anymore.
+	m_work_byte_code.clear();
+	m_address_patches.clear();
+	m_labels.clear();
+	m_label_patches.clear();
+}
+
+void jit_function::push_bytes( const uint8 * bytes, const int byte_count )
+{
+	for( int i = 0; i < byte_count; ++i )
+	{
+		m_work_byte_code.push_back( bytes[ i ] );
 	}
 }
 
@@ -56,11 +173,27 @@ void jit_function::add_address_patch( void * address, int byte_count )
 	m_address_patches.push_back( entry );
 }
 
-int jit_function::add_stack_offset( int size )
+int jit_function::new_label()
 {
-	m_current_stack_offset += size;
+	m_labels.push_back( -1 );
+	return m_labels.size() - 1;
+}
+
+void jit_function::bind_label( int label )
+{
+	assert( m_labels[ label ] == -1 );
+	m_labels[ label ] = m_work_byte_code.size();
+}
+
+void jit_function::add_label_patch( int label )
+{
+	label_patch entry;
+
+	entry.m_label = label;
+	entry.m_byte_code_position = m_work_byte_code.size();
 
-	return m_current_stack_offset;
+	m_work_byte_code.resize( m_work_byte_code.size() + 4 );
+	m_label_patches.push_back( entry );
 }
 
 #endif	// __GAMESWF_ENABLE_JIT__
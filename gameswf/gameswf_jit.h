@@ -8,10 +8,20 @@
 #ifndef GAMESWF_JIT_H
 #define GAMESWF_JIT_H
 
+// The code emitters only know x86 and x86-64.
+#if defined(__GAMESWF_ENABLE_JIT__) && !(defined(__i386__) || defined(_M_IX86) || defined(__x86_64__) || defined(_M_X64))
+#	undef __GAMESWF_ENABLE_JIT__
+#endif
+
 #ifdef __GAMESWF_ENABLE_JIT__
 
 #include "base/container.h"
 
+// Compiled code is built as a sequence of calls to C++ helpers of this
+// form.  The context pointer is passed to the compiled code by the
+// caller and handed to every helper unchanged.
+typedef int (*jit_helper)(void* context, intptr_t arg);
+
 class jit_function
 {
 	struct patch_entry
@@ -21,36 +31,65 @@ class jit_function
 		int m_byte_count;
 	};
 
-	int m_current_stack_offset;
+	struct label_patch
+	{
+		int m_label;
+		int m_byte_code_position;
+	};
+
 	array<uint8> m_work_byte_code;
 	array<patch_entry> m_address_patches;
+	array<int> m_labels;	// label --> byte code position, -1 until bound
+	array<label_patch> m_label_patches;
 	void * m_executable_byte_code; // must allocate with execute rights
+	int m_executable_size;
+
+	// Owns executable memory
+	jit_function( const jit_function& );
+	jit_function& operator=( const jit_function& );
 
 public:
 
 	jit_function() :
 		m_executable_byte_code( NULL ),
-		m_current_stack_offset( 4 )
+		m_executable_size( 0 )
 	{
 	}
 
-	template<typename T1, typename T2, typename T3, typename T4>
-	void call( T1 t1, T2 t2, T3 t3, T4 t4 )
+	~jit_function();
+
+	// Runs the code that starts at the given byte code position
+	// (see get_position()) with the given helper context.
+	int call_at( int position, void * context )
 	{
-		typedef void (*function)(T1, T2, T3, T4);
+		typedef int (*function)(void *);
 
-		// run compiled code
-		((function) m_executable_byte_code)(t1, t2, t3, t4);
+		assert( is_valid() && position >= 0 && position < m_executable_size );
+		return ((function) ((uint8*) m_executable_byte_code + position))(context);
 	}
 
 	bool is_valid() const { return m_executable_byte_code != NULL; }
+	int get_position() const { return m_work_byte_code.size(); }
 
 	void push_bytes( const uint8 * bytes, const int byte_count );
 	void push_byte( const uint8 byte );
 	void push_integer( const uint32 value );
 	void add_address_patch( void * address, int byte_count );
+
+	// Labels for jumps inside the function.  A label may be used
+	// before it's bound; the 32 bits displacement is patched by
+	// initialize().
+	int new_label();
+	void bind_label( int label );
+	void add_label_patch( int label );
+
+	// Copies the code to executable memory.  The memory is never
+	// writable and executable at the same time: it's filled while
+	// read/write, then switched to read/execute.
 	void initialize();
-	int add_stack_offset( int size );
+
+	// Drops the executable code and the work buffers.
+	void clear();
 
 };
 
@@ -63,14 +102,8 @@ class jit_function
 
 public:
 
-	template<typename T1, typename T2, typename T3, typename T4>
-	void call( T1 t1, T2 t2, T3 t3, T4 t4 )
-	{
-		assert( false );
-	}
-
 	bool is_valid() const { return false; }
-	void initialize(){};
+	void clear() {}
 };
 
 
@@ -0,0 +1,72 @@
+#!/usr/bin/python
+
+# gameswf_jit_bench.py
+
+# This source code has been donated to the Public Domain.  Do
+# whatever you want with it.
+
+# Times gameswf on a set of movies with the JIT-compiler off and on.
+# The player must be built with __GAMESWF_ENABLE_JIT__ (cmake
+# -DGAMESWF_ENABLE_JIT=ON), otherwise both runs use the interpreter.
+
+import sys
+import glob
+import time
+import commands
+
+GAMESWF = "../dmb-out/vc9-release/gameswf/gameswf_test_ogl"
+SECONDS = 10
+BENCH_ARGS = " -r 0 -1 -t %d " % SECONDS
+
+
+def run(swf_file, use_jit):
+  '''Run gameswf on the given movie, return the wall-clock time and
+  the status code.'''
+
+  start = time.time()
+  [status, output] = commands.getstatusoutput(GAMESWF + BENCH_ARGS + (" -j %d " % use_jit) + swf_file)
+  return time.time() - start, status
+
+
+def format_line(name, interpreted, compiled):
+  '''Make a nice aligned result line'''
+  padding = 50 - len(name)
+  if compiled > 0:
+    ratio = "%6.2fx" % (interpreted / compiled)
+  else:
+    ratio = "      -"
+  return name + ("." * padding) + ("%8.3fs %8.3fs %s\n" % (interpreted, compiled, ratio))
+
+
+def do_bench(filenames):
+  sys.stdout.writelines("movie" + (" " * 45) + "     -j 0     -j 1  speedup\n")
+  total_interpreted = 0
+  total_compiled = 0
+
+  for swf_file in filenames:
+    [interpreted, status0] = run(swf_file, 0)
+    [compiled, status1] = run(swf_file, 1)
+    if status0 != status1:
+      sys.stdout.writelines(swf_file + ": status %d without the JIT, %d with it\n" % (status0, status1))
+    sys.stdout.writelines(format_line(swf_file, interpreted, compiled))
+    total_interpreted += interpreted
+    total_compiled += compiled
+
+  sys.stdout.writelines(format_line("total", total_interpreted, total_compiled))
+
+
+# main
+
+if len(sys.argv) < 2:
+  print "gameswf_jit_bench.py:  compares gameswf with and without the JIT-compiler"
+  print "usage:"
+  print "  %s [list of swf files]" % sys.argv[0]
+  print "If no files are given, runs samples/*.swf.  Movies that don't stop"
+  print "by themselves are timed out after %d seconds.\n" % SECONDS
+  files = glob.glob("samples/*.swf")
+  files.sort()
+else:
+  files = sys.argv[1:]
+
+do_bench(files)
+sys.exit(0)
@@ -5,21 +5,14 @@
 
 // Platform-agnostic jit opcodes
 
-#ifdef __GAMESWF_ENABLE_JIT__
-
-#include "gameswf_jit_opcode.h"
+#include "gameswf_jit.h"
 
-#include "platforms/gameswf_jit_x86.hpp"
-
-//#define jit_prologue( _function_ ) \
-//{\
-//	jit_push( jit_ebp );\
-//	jit_mov( jit_ebp, jit_esp );\
-//}
+#ifdef __GAMESWF_ENABLE_JIT__
 
-#define jit_epilogue( _function_ )\
-{\
-	jit_pop( jit_ebp );\
-}
+#if defined(__x86_64__) || defined(_M_X64)
+	#include "platforms/gameswf_jit_x86_64.hpp"
+#else
+	#include "platforms/gameswf_jit_x86.hpp"
+#endif
 
 #endif	// __GAMESWF_ENABLE_JIT__
@@ -8,23 +8,49 @@
 #ifndef GAMESWF_JIT_OPCODE_H
 #define GAMESWF_JIT_OPCODE_H
 
+#if defined(__x86_64__) || defined(_M_X64)
+	#include "platforms/gameswf_jit_x86_64.h"
+#else
 	#include "platforms/gameswf_jit_x86.h"
+#endif
 
-	#define jit_prologue( _function_ ) \
-	{\
-		jit_push( _function_, jit_ebp );\
-		jit_mov( _function_, jit_ebp, jit_esp );\
-	}
+	// Compiled functions are threaded calls to jit_helper's.  The
+	// context passed to the compiled code is kept in a callee-saved
+	// register and given to every helper; the int "result" register
+	// holds the return value of the last helper.
+	enum jit_condition
+	{
+		jit_zero,
+		jit_not_zero,
+		jit_negative
+	};
 
-	#define jit_return( _function_ )\
-	{\
-		jit_mov( _function_, jit_esp, jit_ebp );\
-		jit_pop( _function_, jit_ebp );\
-		jit_ret( _function_ ); \
-	}
+	// Starts an entry point: saves the context.  Every entry
+	// point of a function has the same frame, so any of them can
+	// jit_leave().
+	void jit_enter( jit_function & function );
+
+	// Returns result to the caller.
+	void jit_leave( jit_function & function );
+
+	// result = helper( context, arg )
+	void jit_call_helper( jit_function & function, jit_helper helper, intptr_t arg );
 
-	#define jit_allocate_stack_object_memory( _function_, _size_ ) \
-		(jit_subi( _function_, jit_stack_pointer, _size_ ), _function_.add_stack_offset( _size_ ))
+	// result = value
+	void jit_load_result( jit_function & function, int value );
 
+	void jit_jump( jit_function & function, int label );
+
+	// Tests result against 0.
+	void jit_jump_if( jit_function & function, jit_condition condition, int label );
+
+	// Jumps if result == value.
+	void jit_jump_if_result( jit_function & function, int value, int label );
+
+	template<typename T>
+	void jit_call_helper( jit_function & function, int (*helper)( T*, intptr_t ), intptr_t arg )
+	{
+		jit_call_helper( function, (jit_helper) helper, arg );
+	}
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,155 @@
+// gameswf_memory.cpp
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// Memory accounting and the LRU list of the caches.
+
+#include "gameswf/gameswf_memory.h"
+
+namespace gameswf
+{
+
+	static int	s_memory_budget = 0;	// 0 means no limit
+
+	// The list of the caches, most recently used first.
+	static const memory_cache*	s_first = NULL;
+	static const memory_cache*	s_last = NULL;
+	static memory_cache_stats	s_cache_stats;
+
+	int	get_memory_budget()
+	{
+		return s_memory_budget;
+	}
+
+	void	set_memory_budget(int bytes)
+	// The caches are trimmed to the new budget at the end of the
+	// next display.
+	{
+		assert(bytes >= 0);
+		s_memory_budget = bytes;
+	}
+
+	memory_cache::memory_cache() :
+		m_prev(NULL),
+		m_next(NULL),
+		m_cache_bytes(0)
+	{
+	}
+
+	memory_cache::memory_cache(const memory_cache&) :
+		m_prev(NULL),
+		m_next(NULL),
+		m_cache_bytes(0)
+	{
+	}
+
+	memory_cache::~memory_cache()
+	{
+		unlink();
+	}
+
+	void	memory_cache::unlink() const
+	{
+		if (m_cache_bytes == 0)
+		{
+			// Not in the list.
+			return;
+		}
+
+		if (m_prev)
+		{
+			m_prev->m_next = m_next;
+		}
+		else
+		{
+			assert(s_first == this);
+			s_first = m_next;
+		}
+		if (m_next)
+		{
+			m_next->m_prev = m_prev;
+		}
+		else
+		{
+			assert(s_last == this);
+			s_last = m_prev;
+		}
+		m_prev = NULL;
+		m_next = NULL;
+
+		s_cache_stats.m_caches--;
+		s_cache_stats.m_bytes -= m_cache_bytes;
+		m_cache_bytes = 0;
+	}
+
+	void	memory_cache::touch(int bytes) const
+	{
+		assert(bytes >= 0);
+		if (bytes == m_cache_bytes && s_first == this)
+		{
+			return;
+		}
+
+		unlink();
+		if (bytes == 0)
+		{
+			return;
+		}
+
+		// Link in front.
+		m_cache_bytes = bytes;
+		m_next = s_first;
+		if (s_first)
+		{
+			s_first->m_prev = this;
+		}
+		else
+		{
+			s_last = this;
+		}
+		s_first = this;
+
+		s_cache_stats.m_caches++;
+		s_cache_stats.m_bytes += bytes;
+	}
+
+	void	memory_cache::trim()
+	{
+		if (s_memory_budget == 0)
+		{
+			return;
+		}
+
+		while (s_cache_stats.m_bytes > s_memory_budget && s_last)
+		{
+			memory_cache*	cache = const_cast<memory_cache*>(s_last);
+			int	bytes = cache->m_cache_bytes;
+			cache->unlink();
+
+			s_cache_stats.m_evicted++;
+			s_cache_stats.m_evicted_bytes += bytes;
+			cache->evict();
+		}
+	}
+
+	void	memory_cache::get_stats(memory_cache_stats* stats)
+	{
+		assert(stats);
+		*stats = s_cache_stats;
+	}
+
+	int	get_bitmap_bytes(bitmap_info* bi)
+	{
+		if (bi == NULL)
+		{
+			return 0;
+		}
+
+		// Once uploaded, the handlers don't tell the texture
+		// format, count RGBA.
+		int	bpp = bi->get_bpp();
+		return bi->get_width() * bi->get_height() * (bpp > 0 ? bpp : 4);
+	}
+
+}
@@ -0,0 +1,104 @@
+// gameswf_memory.h
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// What the movies and the players hold in memory, and the budget of
+// the caches.
+//
+// movie_definition::get_memory_stats() and player::get_memory_stats()
+// add up the bytes of their bitmaps, meshes, sounds and objects.
+//
+// Some of that is a cache, data that can be dropped and built again
+// when it's needed: the meshes of the shapes and the glyph bitmaps
+// of the device fonts.  Each cache is a memory_cache; they are all in
+// one list, most recently used first, and when they take more than
+// the budget given to set_memory_budget() the least recently used
+// ones are evicted at the end of root::display().
+//
+// The caches are used and evicted by the thread that displays the
+// movies.
+
+#ifndef GAMESWF_MEMORY_H
+#define GAMESWF_MEMORY_H
+
+#include "gameswf/gameswf.h"
+
+namespace gameswf
+{
+
+	// Bytes.
+	struct memory_stats
+	{
+		memory_stats() :
+			m_bitmaps(0),
+			m_meshes(0),
+			m_glyphs(0),
+			m_sounds(0),
+			m_heap(0)
+		{
+		}
+
+		int	get_total() const { return m_bitmaps + m_meshes + m_glyphs + m_sounds + m_heap; }
+
+		int	m_bitmaps;	// textures, and the images not uploaded yet
+		int	m_meshes;	// tesselated shapes
+		int	m_glyphs;	// tesselated glyphs of the fonts
+		int	m_sounds;	// samples given to the sound handler
+		int	m_heap;	// script objects, for a player
+	};
+
+	// The LRU list of the caches.
+	struct memory_cache_stats
+	{
+		memory_cache_stats() :
+			m_caches(0),
+			m_bytes(0),
+			m_evicted(0),
+			m_evicted_bytes(0)
+		{
+		}
+
+		int	m_caches;	// in the list
+		int	m_bytes;	// held by them
+		int	m_evicted;	// since the start
+		int	m_evicted_bytes;
+	};
+
+	struct memory_cache
+	{
+		memory_cache();
+		memory_cache(const memory_cache&);	// the copy is not in the list
+		virtual ~memory_cache();
+
+		void	operator=(const memory_cache&) {}
+
+		// Tells that the cache has been used, and how many bytes
+		// it holds now.  0 takes it out of the list.
+		void	touch(int bytes) const;
+
+		int	get_cache_bytes() const { return m_cache_bytes; }
+
+		// Drops the data.  The cache is out of the list already.
+		virtual void	evict() = 0;
+
+		// Evicts the least recently used caches until the rest
+		// fits the budget.
+		static void	trim();
+
+		exported_module static void	get_stats(memory_cache_stats* stats);
+
+	private:
+		void	unlink() const;
+
+		mutable const memory_cache*	m_prev;	// more recently used
+		mutable const memory_cache*	m_next;
+		mutable int	m_cache_bytes;
+	};
+
+	// Bytes a bitmap takes, for the stats.
+	int	get_bitmap_bytes(bitmap_info* bi);
+
+}
+
+#endif // GAMESWF_MEMORY_H
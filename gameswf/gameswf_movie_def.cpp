@@ -15,6 +15,8 @@
 
 #include "base/tu_file.h"
 #include "gameswf/gameswf_font.h"
+#include "gameswf/gameswf_memory.h"
+#include "gameswf/gameswf_shape.h"
 #include "gameswf/gameswf_sound.h"
 #include "gameswf/gameswf_stream.h"
 #include "gameswf/gameswf_fontlib.h"
@@ -188,6 +190,43 @@ namespace gameswf
 		return m_bitmap_list[i].get_ptr();
 	}
 
+	void	movie_def_impl::get_memory_stats(memory_stats* stats) const
+	{
+		assert(stats);
+
+		for (int i = 0; i < m_bitmap_list.size(); i++)
+		{
+			stats->m_bitmaps += get_bitmap_bytes(m_bitmap_list[i].get_ptr());
+		}
+
+		for (hash<int, gc_ptr<character_def> >::const_iterator it = m_characters.begin(); it != m_characters.end(); ++it)
+		{
+			shape_character_def*	sh = cast_to<shape_character_def>(it->second.get_ptr());
+			if (sh)
+			{
+				stats->m_meshes += sh->get_mesh_bytes();
+			}
+		}
+
+		for (hash<int, gc_ptr<font> >::const_iterator it = m_fonts.begin(); it != m_fonts.end(); ++it)
+		{
+			const font*	f = it->second.get_ptr();
+			for (int i = 0; i < f->get_glyph_count(); i++)
+			{
+				shape_character_def*	glyph = f->get_glyph_by_index(i);
+				if (glyph)
+				{
+					stats->m_glyphs += glyph->get_mesh_bytes();
+				}
+			}
+		}
+
+		for (hash<int, gc_ptr<sound_sample> >::const_iterator it = m_sound_samples.begin(); it != m_sound_samples.end(); ++it)
+		{
+			stats->m_sounds += it->second->m_bytes;
+		}
+	}
+
 	void	movie_def_impl::export_resource(const tu_string& symbol, character_def* res)
 	// Expose one of our resources under the given symbol,
 	// for export.	Other movies can import it.
@@ -115,6 +115,11 @@ namespace gameswf
 		// }
 		virtual int	get_bitmap_info_count() const = 0;
 		virtual bitmap_info*	get_bitmap_info(int i) const = 0;
+
+		// Adds the bytes held by this movie to *stats, see
+		// gameswf_memory.h.  The movies it imports from are not
+		// counted.
+		virtual void	get_memory_stats(memory_stats* stats) const = 0;
 	};
 
 
@@ -323,6 +328,12 @@ namespace gameswf
 		int	m_version;
 		volatile uint32	m_loaded_length;
 
+		tu_string	m_url;	// what it was loaded from, for the profiler
+
+		// What the optimizer did to our actions (see
+		// set_optimize_actions()).
+		action_optimizer_stats	m_optimizer_stats;
+
 		jpeg::input*	m_jpeg_in;
 
 		stream*	m_str;
@@ -358,6 +369,7 @@ namespace gameswf
 		virtual void	add_bitmap_info(bitmap_info* bi);
 		virtual int	get_bitmap_info_count() const;
 		virtual bitmap_info*	get_bitmap_info(int i) const;
+		virtual void	get_memory_stats(memory_stats* stats) const;
 		virtual void	export_resource(const tu_string& symbol, character_def* res);
 		virtual character_def*	get_exported_resource(const tu_string& symbol);
 		virtual void	add_import(const tu_string& source_url, int id, const tu_string& symbol);
@@ -8,9 +8,12 @@
 
 #include "gameswf/gameswf_object.h"
 #include "gameswf/gameswf_action.h"
+#include "gameswf/gameswf_character.h"
 #include "gameswf/gameswf_function.h"
 #include "gameswf/gameswf_log.h"
 #include "gameswf/gameswf_movie_def.h"
+#include "gameswf/gameswf_profiler.h"
+#include "gameswf/gameswf_script_budget.h"
 
 namespace gameswf
 {
@@ -174,11 +177,296 @@ namespace gameswf
 	}
 
 
+	//
+	// as_shape
+	//
+
+	as_shape*	as_shape::get_root(atom_table* atoms)
+	// The shape of atoms' objects without members.
+	{
+		assert(atoms);
+		if (atoms->m_root_shape == NULL)
+		{
+			atoms->m_root_shape = new as_shape(atoms, NULL, -1);
+		}
+		return atoms->m_root_shape;
+	}
+
+	as_shape::as_shape(atom_table* atoms, as_shape* parent, int atom) :
+		m_atoms(atoms),
+		m_parent(parent),
+		m_atom(atom),
+		m_size(parent ? parent->m_size + 1 : 0),
+		m_id(as_members::new_layout_id()),
+		m_index(NULL),
+		m_chain(NULL)
+	{
+	}
+
+	as_shape::~as_shape()
+	{
+		if (m_parent != NULL)
+		{
+			m_parent->m_transitions.erase(m_atom);
+		}
+		else
+		{
+			assert(m_atoms->m_root_shape == this);
+			m_atoms->m_root_shape = NULL;
+		}
+		delete m_index;
+		delete m_chain;
+	}
+
+	void	as_shape::build_table()
+	{
+		assert(m_chain == NULL);
+		m_chain = new array<as_shape*>;
+		m_chain->resize(m_size);
+		for (as_shape* s = this; s->m_size > 0; s = s->m_parent.get_ptr())
+		{
+			(*m_chain)[s->m_size - 1] = s;
+		}
+
+		if (m_size > LINEAR_FIND)
+		{
+			m_index = new hash<int, int>;
+			for (int i = 0; i < m_size; i++)
+			{
+				m_index->add((*m_chain)[i]->m_atom, i);
+			}
+		}
+	}
+
+	int	as_shape::find(int atom)
+	{
+		if (m_size <= LINEAR_FIND)
+		{
+			for (const as_shape* s = this; s->m_size > 0; s = s->m_parent.get_ptr())
+			{
+				if (s->m_atom == atom)
+				{
+					return s->m_size - 1;
+				}
+			}
+			return -1;
+		}
+
+		if (m_index == NULL)
+		{
+			build_table();
+		}
+		int	slot = -1;
+		m_index->get(atom, &slot);
+		return slot;
+	}
+
+	int	as_shape::get_atom(int slot)
+	{
+		assert(slot >= 0 && slot < m_size);
+		if (m_chain == NULL)
+		{
+			build_table();
+		}
+		return (*m_chain)[slot]->m_atom;
+	}
+
+	const tu_stringi&	as_shape::get_name(int slot)
+	{
+		return m_atoms->get_name(get_atom(slot));
+	}
+
+	as_shape*	as_shape::add(int atom)
+	{
+		assert(atom >= 0 && find(atom) == -1);
+
+		as_shape*	child = NULL;
+		if (m_transitions.get(atom, &child))
+		{
+			return child;
+		}
+
+		// The root has a child for every first member name, don't
+		// limit it.
+		if (m_size >= MAX_SIZE || (m_size > 0 && m_transitions.size() >= MAX_TRANSITIONS))
+		{
+			return NULL;
+		}
+
+		child = new as_shape(m_atoms.get_ptr(), this, atom);
+		m_transitions.add(atom, child);
+		return child;
+	}
+
+	//
+	// as_members
+	//
+
+	as_members::as_members(atom_table* atoms) :
+		m_shape(atoms ? as_shape::get_root(atoms) : NULL),
+		m_dictionary(NULL),
+		m_layout_id(m_shape != NULL ? m_shape->get_id() : new_layout_id())
+	{
+	}
+
+	as_members::~as_members()
+	{
+		delete m_dictionary;
+	}
+
+	Uint32	as_members::new_layout_id()
+	// Ids are unique, so a cache that has seen an id knows it is
+	// looking at the same member names without holding a
+	// reference to the shape or object.
+	{
+		static Uint32	s_last_layout_id = 0;
+		if (++s_last_layout_id == 0)
+		{
+			// wrapped around
+			++s_last_layout_id;
+		}
+		return s_last_layout_id;
+	}
+
+	int	as_members::find_index(int atom, const tu_stringi& name) const
+	{
+		if (m_shape != NULL)
+		{
+			if (atom < 0)
+			{
+				// The shapes only have interned names.
+				atom = m_shape->get_atoms()->find(name);
+				if (atom < 0)
+				{
+					return -1;
+				}
+			}
+			return m_shape->find(atom);
+		}
+
+		if (m_dictionary == NULL)
+		{
+			return -1;
+		}
+
+		int	index = -1;
+		if (atom < 0 && m_dictionary->m_atoms != NULL)
+		{
+			atom = m_dictionary->m_atoms->find(name);
+		}
+		if (atom >= 0 && m_dictionary->m_atom_index.get(atom, &index))
+		{
+			return index;
+		}
+
+		// The slow path, for the names that had no atom when they
+		// were added.
+		if (m_dictionary->m_name_index.size() > 0)
+		{
+			m_dictionary->m_name_index.get(name, &index);
+		}
+		return index;
+	}
+
+	const tu_stringi&	as_members::name_at(int index) const
+	{
+		if (m_dictionary)
+		{
+			return m_dictionary->m_names[index];
+		}
+		return m_shape->get_name(index);
+	}
+
+	bool	as_members::get(int atom, const tu_stringi& name, as_value* val) const
+	{
+		int	index = find_index(atom, name);
+		if (index < 0)
+		{
+			return false;
+		}
+		if (val)
+		{
+			*val = m_slots[index];
+		}
+		return true;
+	}
+
+	void	as_members::set(int atom, const tu_stringi& name, const as_value& val)
+	{
+		int	index = find_index(atom, name);
+		if (index >= 0)
+		{
+			m_slots[index] = val;
+			return;
+		}
+
+		// A new member.  val may live in m_slots, copy it before
+		// they move.
+		as_value	new_val(val);
+		if (m_dictionary == NULL)
+		{
+			as_shape*	shape = NULL;
+			if (m_shape != NULL)
+			{
+				if (atom < 0)
+				{
+					atom = m_shape->get_atoms()->intern(name);
+				}
+				shape = m_shape->add(atom);
+			}
+
+			if (shape)
+			{
+				m_shape = shape;
+				m_layout_id = shape->get_id();
+			}
+			else
+			{
+				to_dictionary(m_shape != NULL ? m_shape->get_atoms() : NULL);
+			}
+		}
+
+		if (m_dictionary)
+		{
+			if (atom < 0 && m_dictionary->m_atoms != NULL)
+			{
+				atom = m_dictionary->m_atoms->find(name);
+			}
+			if (atom >= 0)
+			{
+				m_dictionary->m_atom_index.add(atom, m_slots.size());
+			}
+			else
+			{
+				m_dictionary->m_name_index.add(name, m_slots.size());
+			}
+			m_dictionary->m_names.push_back(name);
+			m_layout_id = new_layout_id();
+		}
+		m_slots.push_back(new_val);
+	}
+
+	void	as_members::to_dictionary(atom_table* atoms)
+	{
+		assert(m_dictionary == NULL);
+		m_dictionary = new dictionary;
+		m_dictionary->m_atoms = atoms;
+		m_dictionary->m_names.resize(m_slots.size());
+		for (int i = 0; i < m_slots.size(); i++)
+		{
+			m_dictionary->m_names[i] = m_shape->get_name(i);
+			m_dictionary->m_atom_index.add(m_shape->get_atom(i), i);
+		}
+		m_shape = NULL;
+	}
+
 	// this stuff should be high optimized
 	// therefore we can't use here set_member(...)
 	as_object::as_object(player* player) :
+		m_members(player ? player->get_atoms() : NULL),
 		m_watch(NULL),
-		m_player(player)
+		m_player(player),
+		m_cache_state(CACHE_UNKNOWN)
 	{
 		// as_c_function has no pointer to player
 //		assert(player);
@@ -186,14 +474,34 @@ namespace gameswf
 
 	as_object::~as_object()
 	{
+		if (m_heap_node.m_gen != as_heap::NOT_IN_HEAP)
+		{
+			// player::clear_heap() empties the heap before the
+			// player goes
+			assert(m_player != NULL);
+			m_player->get_heap()->remove(this);
+		}
 		delete m_watch;
 	}
 
+	static void	member_added(const tu_stringi& name)
+	// An onPress or onRelease makes the movieclips that have it,
+	// or have it in their prototype, take the mouse.
+	{
+		const char*	s = name.c_str();
+		if ((s[0] == 'o' || s[0] == 'O') && (s[1] == 'n' || s[1] == 'N'))
+		{
+			character::mouse_scene_changed();
+		}
+	}
+
 	// called from a object constructor only
 	void	as_object::builtin_member(const tu_stringi& name, const as_value& val)
 	{
 		val.set_flags(as_value::DONT_ENUM);
-		m_members.set(name, val);
+		m_members.set(-1, name, val);
+		member_stored(val);
+		member_added(name);
 	}
 
 	void as_object::call_watcher(const tu_stringi& name, const as_value& old_val, as_value* new_val)
@@ -215,12 +523,39 @@ namespace gameswf
 		}
 	}
 
-	bool	as_object::set_member(const tu_stringi& name, const as_value& new_val)
+	atom_table*	as_object::get_atoms() const
+	{
+		player*	p = get_player();
+		return p ? p->get_atoms() : NULL;
+	}
+
+	int	as_object::find_atom(const tu_stringi& name) const
+	{
+		atom_table*	atoms = get_atoms();
+		return atoms ? atoms->find(name) : -1;
+	}
+
+	bool	as_object::set_member(const tu_stringi& name, const as_value& val)
+	{
+		return set_member_plain(find_atom(name), name, val);
+	}
+
+	bool	as_object::set_member_atom(int atom, const tu_stringi& name, const as_value& val)
+	{
+		// Classes with their own set_member() can't be cached.
+		if (get_layout_id() == 0)
+		{
+			return set_member(name, val);
+		}
+		return set_member_plain(atom, name, val);
+	}
+
+	bool	as_object::set_member_plain(int atom, const tu_stringi& name, const as_value& new_val)
 	{
 //		printf("SET MEMBER: %s at %p for object %p\n", name.c_str(), val.to_object(), this);
 		as_value val(new_val);
 		as_value old_val;
-		if (as_object::get_member(name, &old_val))
+		if (as_object::get_member_plain(atom, name, &old_val))
 		{
 			if (old_val.is_property())
 			{
@@ -232,20 +567,23 @@ namespace gameswf
 		// try watcher
 		call_watcher(name, old_val, &val);
 
-		stringi_hash<as_value>::const_iterator it = this->m_members.find(name);
-		if (it != this->m_members.end())
+		int	index = m_members.find_index(atom, name);
+		if (index >= 0)
 		{
 			// update a old members
 			// is the member read-only ?
-			if (it->second.is_readonly() == false)
+			if (m_members.value_at(index).is_readonly() == false)
 			{
-				m_members.set(name, val);
+				m_members.value_at(index) = val;
+				member_stored(val);
 			}
 		}
 		else
 		{
 			// create a new members
-			m_members.set(name, val);
+			m_members.set(atom, name, val);
+			member_stored(val);
+			member_added(name);
 		}
 		return true;
 	}
@@ -256,16 +594,38 @@ namespace gameswf
 	}
 
 	bool	as_object::get_member(const tu_stringi& name, as_value* val)
+	{
+		return get_member_plain(find_atom(name), name, val);
+	}
+
+	bool	as_object::get_member_atom(int atom, const tu_stringi& name, as_value* val)
+	{
+		// Classes with their own get_member() can't be cached.
+		if (get_layout_id() == 0)
+		{
+			return get_member(name, val);
+		}
+		return get_member_plain(atom, name, val);
+	}
+
+	bool	as_object::get_member_plain(int atom, const tu_stringi& name, as_value* val)
 	{
 		//printf("GET MEMBER: %s at %p for object %p\n", name.c_str(), val, this);
 		
-		// first try built-ins object methods
-		if (get_builtin(BUILTIN_OBJECT_METHOD, name, val))
+		// first try built-ins object methods; the atom tells
+		// whether it can be one without hashing the name.
+		atom_table*	atoms = get_atoms();
+		if (atom < 0 && atoms)
+		{
+			atom = atoms->find(name);
+		}
+		if ((atom < 0 || atoms == NULL || atom >= atoms->size() || atoms->is_builtin(atom, BUILTIN_OBJECT_METHOD))
+			&& get_builtin(BUILTIN_OBJECT_METHOD, name, val))
 		{
 			return true;
 		}
 
-		if (m_members.get(name, val) == false)
+		if (m_members.get(atom, name, val) == false)
 		{
 			as_object* proto = get_proto();
 			if (proto == NULL)
@@ -273,7 +633,7 @@ namespace gameswf
 				return false;
 			}
 
-			if (proto->get_member(name, val) == false)
+			if (proto->get_member_atom(atom, name, val) == false)
 			{
 				return false;
 			}
@@ -299,20 +659,16 @@ namespace gameswf
 		if(m_instance.get_ptr() != NULL)
 		{
 			// create traits
-			for (int i = 0; i < m_instance->m_trait.size(); i++)
+			int i = m_instance->m_traits.find(name);
+			if (i >= 0)
 			{
 				traits_info* ti = m_instance->m_trait[i].get();
-				const char* traits_name = m_instance->m_abc->get_multiname(ti->m_name);
-
-				if( name == traits_name)
+				if(ti->m_kind == traits_info::Trait_Slot)
 				{
-					if(ti->m_kind == traits_info::Trait_Slot)
-					{
-						val->set_as_object( this );
-						return true;
-					}
-					return false;
+					val->set_as_object( this );
+					return true;
 				}
+				return false;
 			}
 		}
 
@@ -325,39 +681,33 @@ namespace gameswf
 		return false;
 	}
 
-	void	as_object::clear_refs(hash<as_object*, bool>* visited_objects, as_object* this_ptr)
+	void	as_object::clear_refs(as_object_walk* walk, as_object* this_ptr)
+	// Clears our refs to this_ptr, and lets walk go on to the
+	// objects we have.
 	{
-		// Is it a reentrance ?
-		if (visited_objects->get(this, NULL))
+		for (int i = 0; i < m_members.size(); i++)
 		{
-			return;
-		}
-		visited_objects->set(this, true);
-
-		as_value undefined;
-		for (stringi_hash<as_value>::iterator it = m_members.begin();
-			it != m_members.end(); ++it)
-		{
-			as_object* obj = it->second.to_object();
+			as_value&	val = m_members.value_at(i);
+			as_object* obj = val.to_object();
 			if (obj)
 			{
 				if (obj == this_ptr)
 				{
-					it->second.set_undefined();
+					val.set_undefined();
 				}
 				else
 				{
-					obj->clear_refs(visited_objects, this_ptr);
+					walk->push(obj);
 				}
 				continue;
 			}
 
-			as_property* prop = it->second.to_property();
+			as_property* prop = val.to_property();
 			if (prop)
 			{
-				if (it->second.get_property_target() == this_ptr)
+				if (val.get_property_target() == this_ptr)
 				{
-					const_cast<as_value&>(it->second).set_property_target(NULL);
+					val.set_property_target(NULL);
 				}
 			}
 		}
@@ -392,6 +742,8 @@ namespace gameswf
 							env->push((*id.m_args)[i]);
 						}
 					}
+					as_profiler_scope	profile(cast_to<character>(this), id);
+					script_budget_scope	budget(this, id);
 					call_method(method, env, this, nargs, env->get_top_index());
 					called = true;
 
@@ -407,18 +759,16 @@ namespace gameswf
 	void as_object::enumerate(as_environment* env)
 	// retrieves members & pushes them into env
 	{
-		stringi_hash<as_value>::const_iterator it = m_members.begin();
-		while (it != m_members.end())
+		for (int i = 0; i < m_members.size(); i++)
 		{
-			if (it->second.is_enum())
+			if (m_members.value_at(i).is_enum())
 			{
-				env->push(it->first);
+				const tu_stringi&	name = m_members.name_at(i);
+				env->push(name);
 
 				IF_VERBOSE_ACTION(log_msg("-------------- enumerate - push: %s\n",
-					it->first.c_str()));
+					name.c_str()));
 			}
-
-			++it;
 		}
 
 //		as_object_interface* proto = get_proto();
@@ -467,10 +817,9 @@ namespace gameswf
 	{
 		if (target)
 		{
-			for (stringi_hash<as_value>::const_iterator it = m_members.begin(); 
-				it != m_members.end(); ++it ) 
+			for (int i = 0; i < m_members.size(); i++)
 			{ 
-				target->set_member(it->first, it->second); 
+				target->set_member(m_members.name_at(i), m_members.value_at(i)); 
 			} 
 		}
 	}
@@ -488,15 +837,15 @@ namespace gameswf
 	{
 		tabs += "  ";
 		printf("%s*** object 0x%p ***\n", tabs.c_str(), this);
-		for (stringi_hash<as_value>::const_iterator it = m_members.begin(); 
-			it != m_members.end(); ++it)
+		for (int i = 0; i < m_members.size(); i++)
 		{
-			const as_value& val = it->second;
+			const tu_stringi& name = m_members.name_at(i);
+			const as_value& val = m_members.value_at(i);
 			if (val.is_property())
 			{
 				printf("%s%s: <as_property 0x%p, target 0x%p, getter 0x%p, setter 0x%p>\n",
 								tabs.c_str(), 
-								it->first.c_str(), val.to_property(), val.get_property_target(),
+								name.c_str(), val.to_property(), val.get_property_target(),
 								val.to_property()->m_getter.get_ptr(), val.to_property()->m_setter.get_ptr());
 			}
 			else
@@ -505,31 +854,31 @@ namespace gameswf
 				if (cast_to<as_s_function>(val.to_object()))
 				{
 					printf("%s%s: <as_s_function 0x%p>\n", tabs.c_str(), 
-						it->first.c_str(), val.to_object());
+						name.c_str(), val.to_object());
 				}
 				else
 				if (cast_to<as_3_function>(val.to_object()))
 				{
 					printf("%s%s: <as_3_function 0x%p>\n", tabs.c_str(), 
-						it->first.c_str(), val.to_object());
+						name.c_str(), val.to_object());
 				}
 				else
 				{
 					printf("%s%s: <as_c_function 0x%p>\n", tabs.c_str(), 
-						it->first.c_str(), val.to_object());
+						name.c_str(), val.to_object());
 				}
 			}
 			else if (val.is_object())
 			{
 				printf("%s%s: <as_object 0x%p>\n",
 					tabs.c_str(), 
-					it->first.c_str(), val.to_object());
+					name.c_str(), val.to_object());
 			}
 			else
 			{
 				printf("%s%s: %s\n", 
 					tabs.c_str(), 
-					it->first.c_str(), it->second.to_string());
+					name.c_str(), val.to_string());
 			}
 		}
 
@@ -549,74 +898,26 @@ namespace gameswf
 			return target.to_object();
 		}
 
-		const tu_string& path = target.to_tu_string();
-		if (path.length() == 0)
-		{
-			return this;
-		}
-
-		as_value val;
-		as_object* tar = NULL;
-
-		// absolute path ?
-		if (*path.c_str() == '/')
-		{
-			return m_player->get_root_movie()->find_target(path.c_str() + 1);
-		}
-
-		const char* slash = strchr(path.c_str(), '/');
-		if (slash == NULL)
-		{
-			slash = strchr(path.c_str(), '.');
-			if (slash)
-			{
-				if (slash[1] == '.')
-				{
-					slash = NULL;
-				}
-			}
-		}
-
-		if (slash)
-		{
-			tu_string name(path.c_str(), int(slash - path.c_str()));
-			get_member(name, &val);
-			tar = val.to_object();
-			if (tar)	
-			{
-				return tar->find_target(slash + 1);
-			}
-		}
-		else
-		{
-			get_member(path, &val);
-			tar = val.to_object();
-		}
+		// Paths are parsed once, see target_path_cache.
+		return m_player->get_path_cache()->find_target(this, target.to_tu_string());
+	}
 
-		if (tar == NULL)
+	// mark 'this' as alive
+	void as_object::this_alive()
+	{
+		// 'this' and its members is alive.  The old objects are
+		// marked by the heap itself, a bit at a time.
+		if (m_player != NULL)
 		{
-			log_error("can't find target %s\n", path.c_str());
+			m_player->get_heap()->mark_reached(this);
 		}
-		return tar;
 	}
 
-	// mark 'this' as alive
-	void as_object::this_alive()
+	void	as_object::write_barrier(as_object* val)
 	{
-		// Whether there were we here already ?
-		if (m_player != NULL && m_player->is_garbage(this))
+		if (val && m_player != NULL)
 		{
-			// 'this' and its members is alive
-			m_player->set_alive(this);
-			for (stringi_hash<as_value>::iterator it = m_members.begin();
-				it != m_members.end(); ++it)
-			{
-				as_object* obj = it->second.to_object();
-				if (obj)
-				{
-					obj->this_alive();
-				}
-			}
+			m_player->get_heap()->write_barrier(this, val);
 		}
 	}
 
@@ -696,6 +997,7 @@ namespace gameswf
 	{ 	 
 		m_proto = new as_object(get_player()); 	 
 		m_proto->m_this_ptr = m_this_ptr; 	
+		character::mouse_scene_changed();
 
 		if (constructor.to_object()) 	 
 		{ 	 
@@ -717,4 +1019,201 @@ namespace gameswf
 		return m_proto.get_ptr();
 	}
 
+
+	//
+	// as_member_cache
+	//
+
+	as_member_cache::as_member_cache() :
+		m_atom(-1),
+		m_name_changes(0),
+		m_next(0)
+	{
+		for (int i = 0; i < ENTRY_COUNT; i++)
+		{
+			m_entries[i].m_depth = -1;
+		}
+	}
+
+	bool	as_member_cache::set_name(const tu_string& name, int atom)
+	// Returns false if this site sees too many different names
+	// (e.g. obj[key] in a loop) for caching to pay off.
+	{
+		if (atom >= 0 && atom == m_atom)
+		{
+			return true;
+		}
+		if (m_name == name)
+		{
+			m_atom = atom;
+			return true;
+		}
+
+		if (m_name_changes >= MAX_NAME_CHANGES)
+		{
+			return false;
+		}
+		m_name_changes++;
+
+		m_name = name;
+		m_atom = atom;
+		for (int i = 0; i < ENTRY_COUNT; i++)
+		{
+			m_entries[i].m_depth = -1;
+		}
+		return true;
+	}
+
+	as_member_cache::entry*	as_member_cache::find(as_object* obj)
+	{
+		Uint32	layout_id = obj->get_layout_id();
+		if (layout_id == 0)
+		{
+			return NULL;
+		}
+
+		for (int i = 0; i < ENTRY_COUNT; i++)
+		{
+			entry&	e = m_entries[i];
+			if (e.m_depth < 0 || e.m_layout_id[0] != layout_id)
+			{
+				continue;
+			}
+
+			// Same members; check the prototype chain.
+			// m_proto[] are only dereferenced once they've been
+			// matched against a live pointer.
+			as_object*	o = obj;
+			int	depth = 1;
+			for (; depth <= e.m_depth; depth++)
+			{
+				as_object*	proto = o->m_proto.get_ptr();
+				if (proto != e.m_proto[depth] || proto->get_layout_id() != e.m_layout_id[depth])
+				{
+					break;
+				}
+				o = proto;
+			}
+
+			if (depth > e.m_depth)
+			{
+				return &e;
+			}
+		}
+		return NULL;
+	}
+
+	void	as_member_cache::fill(as_object* obj, bool for_set)
+	// Remember where m_name lives for obj, if we can.
+	{
+		if (obj->get_layout_id() == 0)
+		{
+			return;
+		}
+
+		// Builtin methods shadow the members.
+		as_value	dummy;
+		if (get_builtin(BUILTIN_OBJECT_METHOD, m_name, &dummy))
+		{
+			return;
+		}
+
+		entry	e;
+		e.m_layout_id[0] = obj->get_layout_id();
+		e.m_proto[0] = NULL;
+
+		as_object*	o = obj;
+		for (int depth = 0; depth < MAX_DEPTH; depth++)
+		{
+			if (depth > 0)
+			{
+				// set_member() never writes into a prototype.
+				if (for_set)
+				{
+					return;
+				}
+
+				as_object*	proto = o->m_proto.get_ptr();
+				if (proto == NULL || proto->get_layout_id() == 0)
+				{
+					return;
+				}
+				e.m_proto[depth] = proto;
+				e.m_layout_id[depth] = proto->get_layout_id();
+				o = proto;
+			}
+
+			int	index = o->m_members.find_index(m_atom, m_name);
+			if (index >= 0)
+			{
+				e.m_depth = depth;
+				e.m_index = index;
+				m_entries[m_next] = e;
+				m_next = (m_next + 1) % ENTRY_COUNT;
+				return;
+			}
+		}
+	}
+
+	bool	as_member_cache::get_member(as_object* obj, const tu_string& name, int atom, as_value* val)
+	{
+		assert(obj);
+		if (set_name(name, atom))
+		{
+			entry*	e = find(obj);
+			if (e)
+			{
+				as_object*	holder = e->m_depth == 0 ? obj : e->m_proto[e->m_depth];
+				*val = holder->m_members.value_at(e->m_index);
+				if (val->is_property())
+				{
+					val->set_property_target(obj);
+				}
+				return true;
+			}
+		}
+
+		// name may live on the vm stack, which can move while
+		// get_member() runs a getter.
+		tu_stringi	key(name);
+		if (obj->get_member_atom(atom, key, val) == false)
+		{
+			return false;
+		}
+
+		// The getter may also have reused this site.
+		if (m_name == key.to_tu_string())
+		{
+			fill(obj, false);
+		}
+		return true;
+	}
+
+	bool	as_member_cache::set_member(as_object* obj, const tu_string& name, int atom, const as_value& val)
+	{
+		assert(obj);
+		if (set_name(name, atom))
+		{
+			entry*	e = find(obj);
+			if (e && e->m_depth == 0 && obj->m_watch == NULL)
+			{
+				as_value&	slot = obj->m_members.value_at(e->m_index);
+				if (slot.is_property() == false && slot.is_readonly() == false)
+				{
+					slot = val;
+					obj->member_stored(val);
+					return true;
+				}
+			}
+		}
+
+		tu_stringi	key(name);
+		bool	ret = obj->set_member_atom(atom, key, val);
+		if (m_name == key.to_tu_string())
+		{
+			fill(obj, true);
+		}
+		return ret;
+	}
+
 }
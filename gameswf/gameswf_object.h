@@ -13,6 +13,8 @@
 #include "gameswf/gameswf_environment.h"
 #include "gameswf/gameswf_types.h"
 #include "gameswf/gameswf_player.h"
+#include "gameswf/gameswf_heap.h"
+#include "gameswf/gameswf_pool.h"
 #include "base/container.h"
 #include "base/weak_ptr.h"
 #include "base/tu_loadlib.h"
@@ -31,6 +33,121 @@ namespace gameswf
 	exported_module void	as_object_add_event_listener(const fn_call& fn);
 
 	struct instance_info;
+	struct atom_table;
+
+	// Hidden class: the names of an object's members, in the order
+	// they were added, and their slots.  Objects that get the same
+	// members in the same order share a shape, so the names are
+	// stored once and an inline cache can recognize the layout by
+	// its id.  Shapes are immutable; adding a member moves the
+	// object to a child shape (a transition).
+	//
+	// The names are atoms of the player's atom_table, so each
+	// player has its own tree of shapes, and finding a slot
+	// compares and hashes ints.
+	struct as_shape : public gc_object
+	{
+		enum { MAX_SIZE = 64, MAX_TRANSITIONS = 64, LINEAR_FIND = 8 };
+
+		// The shape of atoms' objects without members.
+		exported_module static as_shape*	get_root(atom_table* atoms);
+		~as_shape();
+
+		// The shapes of the objects a script makes and drops
+		// come and go with them, see as_object::operator new.
+		static void*	operator new(size_t size) { return object_pool::allocate(size); }
+		static void	operator delete(void* p) { object_pool::deallocate(p); }
+
+		int	size() const { return m_size; }
+		Uint32	get_id() const { return m_id; }
+		atom_table*	get_atoms() const { return m_atoms.get_ptr(); }
+
+		// Returns the slot of atom, or -1.
+		int	find(int atom);
+		int	get_atom(int slot);
+		const tu_stringi&	get_name(int slot);
+
+		// Returns the shape with atom added as the last slot, or
+		// NULL if this shape is too big or has too many children;
+		// the object should use a dictionary then.
+		as_shape*	add(int atom);
+
+	private:
+		as_shape(atom_table* atoms, as_shape* parent, int atom);
+		void	build_table();
+
+		gc_ptr<atom_table>	m_atoms;
+		gc_ptr<as_shape>	m_parent;
+		int	m_atom;	// of slot m_size - 1
+		int	m_size;
+		Uint32	m_id;
+
+		// Children don't hold a ref, they remove themselves
+		// when they die.
+		hash<int, as_shape*>	m_transitions;
+
+		// Built on demand.
+		hash<int, int>*	m_index;
+		array<as_shape*>*	m_chain;	// m_chain[slot] added slot
+	};
+
+	// The members of an as_object, kept in slots in the order they
+	// were added.  Slots are never removed, so a slot index stays
+	// valid for the life of the object.  Objects with many members,
+	// or whose shape has too many children already, go to
+	// dictionary mode: a private atom --> slot hash, and a name -->
+	// slot hash for the names that weren't interned.  Objects
+	// without a player have no atoms and always use a dictionary.
+	//
+	// atom is the atom of name in the player's atom_table, or -1
+	// when the caller doesn't know it; it's looked up then.  New
+	// names are interned while the object has a shape.
+	struct as_members
+	{
+		as_members(atom_table* atoms);
+		~as_members();
+
+		exported_module bool	get(int atom, const tu_stringi& name, as_value* val) const;
+		bool	get(const tu_stringi& name, as_value* val) const { return get(-1, name, val); }
+
+		// Replaces the member or adds a new one.
+		exported_module void	set(int atom, const tu_stringi& name, const as_value& val);
+		void	set(const tu_stringi& name, const as_value& val) { set(-1, name, val); }
+
+		// Returns the slot of name, or -1.
+		exported_module int	find_index(int atom, const tu_stringi& name) const;
+		int	find_index(const tu_stringi& name) const { return find_index(-1, name); }
+
+		int	size() const { return m_slots.size(); }
+		as_value&	value_at(int index) { return m_slots[index]; }
+		const as_value&	value_at(int index) const { return m_slots[index]; }
+		exported_module const tu_stringi&	name_at(int index) const;
+
+		// Identifies the member names, see as_member_cache.
+		// Objects in the same shape have the same id; each
+		// dictionary gets its own id, renewed on every add.
+		Uint32	get_layout_id() const { return m_layout_id; }
+
+		static Uint32	new_layout_id();
+
+	private:
+		struct dictionary
+		{
+			gc_ptr<atom_table>	m_atoms;	// NULL without a player
+			hash<int, int>	m_atom_index;
+			stringi_hash<int>	m_name_index;	// names without an atom
+			array<tu_stringi>	m_names;
+		};
+
+		as_members(const as_members&);
+		void	operator=(const as_members&);
+		void	to_dictionary(atom_table* atoms);
+
+		array<as_value>	m_slots;
+		gc_ptr<as_shape>	m_shape;	// NULL in dictionary mode, or without a player
+		dictionary*	m_dictionary;
+		Uint32	m_layout_id;
+	};
 
 	struct as_object : public as_object_interface
 	{
@@ -41,7 +158,7 @@ namespace gameswf
 			return m_class_id == class_id;
 		}
 
-		stringi_hash<as_value>	m_members;
+		as_members	m_members;
 
 		// It is used to register an event handler to be invoked when
 		// a specified property of object changes.
@@ -72,10 +189,23 @@ namespace gameswf
 
 		weak_ptr<instance_info> m_instance;
 
+		// our place in the garbage manager of the player
+		as_heap_node	m_heap_node;
+
 		exported_module as_object(player* player);
 		exported_module virtual ~as_object();
+
+		// The objects come from the object_pool of the player.
+		// This takes the place of gc_object_base's new, which
+		// only matters to the collectors that keep track of the
+		// blocks; our ref-counting one doesn't.
+		static void*	operator new(size_t size) { return object_pool::allocate(size); }
+		static void	operator delete(void* p) { object_pool::deallocate(p); }
 		
 		exported_module virtual const char*	to_string() { return "[object Object]"; }
+
+		// to_string(), kept by us for as_value::to_tu_string().
+		const tu_string&	to_tu_string() { m_text = to_string(); return m_text; }
 		exported_module virtual double	to_number();
 		exported_module virtual bool to_bool() { return true; }
 		exported_module virtual const char*	type_of() { return "object"; }
@@ -84,13 +214,31 @@ namespace gameswf
 		exported_module void	call_watcher(const tu_stringi& name, const as_value& old_val, as_value* new_val);
 		exported_module virtual bool	set_member(const tu_stringi& name, const as_value& val);
 		exported_module virtual bool	get_member(const tu_stringi& name, as_value* val);
+
+		// Same as get_member()/set_member(); atom is the atom of
+		// name in our player's atom_table, or -1 if it's not
+		// known, so the lookups don't hash the name again.  The
+		// default calls get_member()/set_member() if a class has
+		// its own (see use_member_cache()).
+		exported_module virtual bool	get_member_atom(int atom, const tu_stringi& name, as_value* val);
+		exported_module virtual bool	set_member_atom(int atom, const tu_stringi& name, const as_value& val);
+
+		// The as_object get_member()/set_member(), by atom.
+		exported_module bool	get_member_plain(int atom, const tu_stringi& name, as_value* val);
+		exported_module bool	set_member_plain(int atom, const tu_stringi& name, const as_value& val);
+
+		// Our player's atom_table, and the atom of name in it or
+		// -1.
+		atom_table*	get_atoms() const;
+		int	find_atom(const tu_stringi& name) const;
+
 		exported_module virtual bool	find_property( const tu_stringi & name, as_value * val );
 		exported_module virtual bool	on_event(const event_id& id);
 		exported_module virtual	void enumerate(as_environment* env);
 		exported_module virtual as_object* get_proto() const;
 		exported_module virtual bool watch(const tu_string& name, as_function* callback, const as_value& user_data);
 		exported_module virtual bool unwatch(const tu_string& name);
-		exported_module virtual void clear_refs(hash<as_object*, bool>* visited_objects, as_object* this_ptr);
+		exported_module virtual void clear_refs(as_object_walk* walk, as_object* this_ptr);
 		exported_module virtual void this_alive();
 		exported_module virtual void alive() {}
 		exported_module virtual void copy_to(as_object* target);
@@ -112,6 +260,79 @@ namespace gameswf
 
 		as_object* create_proto(const as_value& constructor);
 
+		// Write barrier, called after val has been stored in our
+		// members.  Only the old objects of the heap need it.
+		inline void	member_stored(const as_value& val)
+		{
+			if (m_heap_node.m_gen == as_heap::OLD && val.is_object())
+			{
+				write_barrier(val.to_object());
+			}
+		}
+
+		// Inline cache support.  Classes that override get_member(),
+		// set_member() or find_property() must return false from
+		// use_member_cache().
+		exported_module virtual bool	use_member_cache() const { return true; }
+
+		// Returns the layout id of our members, or 0 if we can't
+		// be cached.
+		Uint32	get_layout_id()
+		{
+			if (m_cache_state == CACHE_UNKNOWN)
+			{
+				m_cache_state = use_member_cache() ? CACHE_YES : CACHE_NO;
+			}
+			return m_cache_state == CACHE_YES ? m_members.get_layout_id() : 0;
+		}
+
+	private:
+		void	write_barrier(as_object* val);
+
+		enum { CACHE_UNKNOWN, CACHE_YES, CACHE_NO };
+		Uint8	m_cache_state;
+
+		tu_string	m_text;	// see to_tu_string()
+
+	};
+
+	// Per call site inline cache for get_member()/set_member().
+	// Remembers the slot where a name was found, in the object
+	// itself or MAX_DEPTH - 1 levels down its prototype chain at
+	// most, for up to ENTRY_COUNT object layouts (see
+	// as_members::get_layout_id()).  Only objects that use the
+	// plain as_object lookup are cached, anything else goes through
+	// the virtual get_member()/set_member().
+	struct as_member_cache
+	{
+		enum { ENTRY_COUNT = 4, MAX_DEPTH = 4, MAX_NAME_CHANGES = 8 };
+
+		as_member_cache();
+
+		// Same as obj->get_member(name, val) and
+		// obj->set_member(name, val).  atom is the atom of name,
+		// or -1.
+		bool	get_member(as_object* obj, const tu_string& name, int atom, as_value* val);
+		bool	set_member(as_object* obj, const tu_string& name, int atom, const as_value& val);
+
+	private:
+		struct entry
+		{
+			int	m_depth;	// -1 if unused
+			Uint32	m_layout_id[MAX_DEPTH];
+			as_object*	m_proto[MAX_DEPTH];	// [0] is unused
+			int	m_index;	// in m_proto[m_depth]->m_members
+		};
+
+		bool	set_name(const tu_string& name, int atom);
+		entry*	find(as_object* obj);
+		void	fill(as_object* obj, bool for_set);
+
+		tu_string	m_name;
+		int	m_atom;
+		int	m_name_changes;
+		int	m_next;
+		entry	m_entries[ENTRY_COUNT];
 	};
 
 }
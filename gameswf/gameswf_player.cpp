@@ -12,6 +12,7 @@
 #include "gameswf/gameswf_player.h"
 #include "gameswf/gameswf_object.h"
 #include "gameswf/gameswf_action.h"
+#include "gameswf/gameswf_memory.h"
 
 // action script classes
 #include "gameswf/gameswf_as_sprite.h"
@@ -322,52 +323,60 @@ namespace gameswf
 		s_fscommand_handler = handler;
 	}
 
+	// Names of the standard members, in as_standard_member order.
+	static const char*	s_standard_member_names[AS_STANDARD_MEMBER_COUNT] =
+	{
+		"_x",				// M_X
+		"_y",				// M_Y
+		"_xscale",			// M_XSCALE
+		"_yscale",			// M_YSCALE
+		"_currentframe",		// M_CURRENTFRAME
+		"_totalframes",		// M_TOTALFRAMES
+		"_alpha",			// M_ALPHA
+		"_visible",			// M_VISIBLE
+		"_width",			// M_WIDTH
+		"_height",			// M_HEIGHT
+		"_rotation",			// M_ROTATION
+		"_target",			// M_TARGET
+		"_framesloaded",		// M_FRAMESLOADED
+		"_name",			// M_NAME
+		"_droptarget",			// M_DROPTARGET
+		"_url",			// M_URL
+		"_highquality",		// M_HIGHQUALITY
+		"_focusrect",			// M_FOCUSRECT
+		"_soundbuftime",		// M_SOUNDBUFTIME
+		"_xmouse",			// M_XMOUSE
+		"_ymouse",			// M_YMOUSE
+		"_parent",			// M_PARENT
+		"text",			// M_TEXT
+		"textWidth",			// M_TEXTWIDTH
+		"textColor",			// M_TEXTCOLOR
+		"border",			// M_BORDER
+		"multiline",			// M_MULTILINE
+		"wordWrap",			// M_WORDWRAP
+		"type",			// M_TYPE
+		"backgroundColor",		// M_BACKGROUNDCOLOR
+		"_this",			// M_THIS
+		"this",			// MTHIS
+		"_root",			// M_ROOT
+		".",				// MDOT
+		"..",				// MDOT2
+		"_level0",			// M_LEVEL0
+		"_global",			// M_GLOBAL
+		"enabled",			// M_ENABLED
+		"password",			// M_PASSWORD
+		"onMouseMove",			// M_MOUSE_MOVE
+	};
+
 	as_standard_member	get_standard_member(const tu_stringi& name)
 	{
 		if (s_standard_property_map.size() == 0)
 		{
 			s_standard_property_map.set_capacity(int(AS_STANDARD_MEMBER_COUNT));
-
-			s_standard_property_map.add("_x", M_X);
-			s_standard_property_map.add("_y", M_Y);
-			s_standard_property_map.add("_xscale", M_XSCALE);
-			s_standard_property_map.add("_yscale", M_YSCALE);
-			s_standard_property_map.add("_currentframe", M_CURRENTFRAME);
-			s_standard_property_map.add("_totalframes", M_TOTALFRAMES);
-			s_standard_property_map.add("_alpha", M_ALPHA);
-			s_standard_property_map.add("_visible", M_VISIBLE);
-			s_standard_property_map.add("_width", M_WIDTH);
-			s_standard_property_map.add("_height", M_HEIGHT);
-			s_standard_property_map.add("_rotation", M_ROTATION);
-			s_standard_property_map.add("_target", M_TARGET);
-			s_standard_property_map.add("_framesloaded", M_FRAMESLOADED);
-			s_standard_property_map.add("_name", M_NAME);
-			s_standard_property_map.add("_droptarget", M_DROPTARGET);
-			s_standard_property_map.add("_url", M_URL);
-			s_standard_property_map.add("_highquality", M_HIGHQUALITY);
-			s_standard_property_map.add("_focusrect", M_FOCUSRECT);
-			s_standard_property_map.add("_soundbuftime", M_SOUNDBUFTIME);
-			s_standard_property_map.add("_xmouse", M_XMOUSE);
-			s_standard_property_map.add("_ymouse", M_YMOUSE);
-			s_standard_property_map.add("_parent", M_PARENT);
-			s_standard_property_map.add("text", M_TEXT);
-			s_standard_property_map.add("textWidth", M_TEXTWIDTH);
-			s_standard_property_map.add("textColor", M_TEXTCOLOR);
-			s_standard_property_map.add("border", M_BORDER);
-			s_standard_property_map.add("multiline", M_MULTILINE);
-			s_standard_property_map.add("wordWrap", M_WORDWRAP);
-			s_standard_property_map.add("type", M_TYPE);
-			s_standard_property_map.add("backgroundColor", M_BACKGROUNDCOLOR);
-			s_standard_property_map.add("_this", M_THIS);
-			s_standard_property_map.add("this", MTHIS);
-			s_standard_property_map.add("_root", M_ROOT);
-			s_standard_property_map.add(".", MDOT);
-			s_standard_property_map.add("..", MDOT2);
-			s_standard_property_map.add("_level0", M_LEVEL0);
-			s_standard_property_map.add("_global", M_GLOBAL);
-			s_standard_property_map.add("enabled", M_ENABLED);
-			s_standard_property_map.add("password", M_PASSWORD);
-			s_standard_property_map.add("onMouseMove", M_MOUSE_MOVE);
+			for (int i = 0; i < AS_STANDARD_MEMBER_COUNT; i++)
+			{
+				s_standard_property_map.add(s_standard_member_names[i], (as_standard_member) i);
+			}
 		}
 
 		as_standard_member	result = M_INVALID_MEMBER;
@@ -376,6 +385,67 @@ namespace gameswf
 		return result;
 	}
 
+	//
+	// atom_table
+	//
+
+	atom_table::atom_table() :
+		m_root_shape(NULL)
+	{
+		// the standard members come first, so their atoms are
+		// their as_standard_member values.
+		for (int i = 0; i < AS_STANDARD_MEMBER_COUNT; i++)
+		{
+			int	atom = intern(s_standard_member_names[i]);
+			assert(atom == i);
+			UNUSED(atom);
+		}
+	}
+
+	int	atom_table::intern(const tu_stringi& name)
+	{
+		int	atom;
+		if (m_index.get(name, &atom))
+		{
+			return atom;
+		}
+
+		atom = m_atoms.size();
+		m_atoms.resize(atom + 1);
+		m_atoms[atom].m_name = name;
+		m_atoms[atom].m_builtins = -1;
+		m_index.add(name, atom);
+		return atom;
+	}
+
+	int	atom_table::find(const tu_stringi& name) const
+	{
+		int	atom = -1;
+		m_index.get(name, &atom);
+		return atom;
+	}
+
+	bool	atom_table::is_builtin(int atom, builtin_object id)
+	{
+		assert(atom >= 0 && atom < m_atoms.size());
+		atom_info&	info = m_atoms[atom];
+		if (info.m_builtins == -1)
+		{
+			// The builtin maps are filled when the first player
+			// is created, look them up on demand.
+			info.m_builtins = 0;
+			for (int i = 0; i < BUILTIN_COUNT; i++)
+			{
+				as_value	val;
+				if (get_builtin((builtin_object) i, info.m_name, &val))
+				{
+					info.m_builtins |= 1 << i;
+				}
+			}
+		}
+		return (info.m_builtins & (1 << id)) != 0;
+	}
+
 	//
 	// properties by number
 	//
@@ -437,8 +507,11 @@ namespace gameswf
 	//
 
 	player::player() :
+		m_pool(object_pool::attach()),
 		m_force_realtime_framerate(false),
-		m_log_bitmap_info(false)
+		m_log_bitmap_info(false),
+		m_atoms(new atom_table()),
+		m_path_cache(new target_path_cache())
 	{
 		m_global = new as_object(this);
 
@@ -500,6 +573,11 @@ namespace gameswf
 		gameswf_engine_mutex().unlock();
 
 		action_clear();
+
+		delete m_path_cache;
+		m_atoms = NULL;
+
+		m_pool->detach();
 	}
 
 	void player::set_flash_vars(const tu_string& param)
@@ -526,7 +604,7 @@ namespace gameswf
 		// global init
 		//
 
-		m_heap.set(m_global.get_ptr(), false);
+		m_heap.add(m_global.get_ptr());
 		m_global->builtin_member("trace", as_global_trace);
 		m_global->builtin_member("Object", as_global_object_ctor);
 		m_global->builtin_member("Sound", as_global_sound_ctor);
@@ -692,6 +770,26 @@ namespace gameswf
 		m_chardef_library.clear();
 	}
 
+	void player::get_memory_stats(memory_stats* stats) const
+	{
+		assert(stats);
+		*stats = memory_stats();
+
+		for (string_hash<gc_ptr<character_def> >::const_iterator it = m_chardef_library.begin();
+			it != m_chardef_library.end(); ++it)
+		{
+			const movie_definition_sub*	md = cast_to<movie_definition_sub>(it->second.get_ptr());
+			if (md)
+			{
+				md->get_memory_stats(stats);
+			}
+		}
+
+		object_pool_stats	pool_stats;
+		m_pool->get_stats(&pool_stats);
+		stats->m_heap = pool_stats.m_bytes;
+	}
+
 	void	ensure_loaders_registered();
 	movie_definition*	player::create_movie(const char* filename)
 	{
@@ -733,6 +831,7 @@ namespace gameswf
 		ensure_loaders_registered();
 
 		movie_def_impl*	m = new movie_def_impl(this, DO_LOAD_BITMAPS, DO_LOAD_FONT_SHAPES);
+		m->m_url = filename;
 
 		if (s_use_cached_movie_def)
 		{
@@ -810,67 +909,27 @@ namespace gameswf
 
 	void player::set_alive(as_object* obj)
 	{
-		m_heap.set(obj, false);
+		m_heap.add(obj);
 	}
 
 	bool player::is_garbage(as_object* obj)
 	{
-		bool is_garbage = false;
-		m_heap.get(obj, &is_garbage);
-		return is_garbage;
+		return m_heap.is_garbage(obj);
 	}
 
 	void player::clear_heap()
 	{
-		for (hash<gc_ptr<as_object>, bool>::iterator it = m_heap.begin();
-			it != m_heap.end(); ++it)
-		{
-			as_object* obj = it->first.get_ptr();
-			if (obj)
-			{
-				if (gc_collector::debug_get_ref_count(obj) > 1)
-				{
-					hash<as_object*, bool> visited_objects;
-					obj->clear_refs(&visited_objects, obj);
-				}
-			}
-		}
 		m_heap.clear();
 	}
 
 	void player::set_as_garbage()
 	{
-		for (hash<gc_ptr<as_object>, bool>::iterator it = m_heap.begin();
-			it != m_heap.end(); ++it)
-		{
-			as_object* obj = it->first.get_ptr();
-			if (obj)
-			{
-				m_heap.set(obj, true);
-			}
-		}
+		m_heap.begin_frame(m_global.get_ptr());
 	}
 
 	void player::clear_garbage()
 	{
-		m_global->this_alive();
-		for (hash<gc_ptr<as_object>, bool>::iterator it = m_heap.begin();
-			it != m_heap.end(); ++it)
-		{
-			as_object* obj = it->first.get_ptr();
-			if (obj)
-			{
-				if (it->second)	// is garbage ?
-				{
-					if (gc_collector::debug_get_ref_count(obj) > 1)	// is in heap only ?
-					{
-						hash<as_object*, bool> visited_objects;
-						obj->clear_refs(&visited_objects, obj);
-					}
-					m_heap.erase(obj);
-				}
-			}
-		}
+		m_heap.end_frame(m_global.get_ptr());
 	}
 
 	bool player::use_separate_thread()
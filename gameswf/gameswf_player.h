@@ -14,9 +14,14 @@
 #include "base/utility.h"
 #include "base/tu_loadlib.h"
 #include "gameswf/gameswf_object.h"
+#include "gameswf/gameswf_heap.h"
+#include "gameswf/gameswf_pool.h"
 
 namespace gameswf
 {
+	struct atom_table;
+	struct target_path_cache;
+
 	typedef exported_module as_object* (*gameswf_module_init)(player* player, const array<as_value>& params);
 
 	as_value	get_property(as_object* obj, int prop_number);
@@ -34,7 +39,9 @@ namespace gameswf
 
 	struct player : public ref_counted
 	{
-		hash<gc_ptr<as_object>, bool> m_heap;
+		// first, the objects of the player are allocated from it
+		object_pool* m_pool;
+		as_heap m_heap;
 		gc_ptr<as_object>	m_global;
 		weak_ptr<root> m_current_root;
 		tu_string m_workdir;
@@ -45,6 +52,12 @@ namespace gameswf
 		// it's used to watch texture memory
 		bool m_log_bitmap_info;
 
+		// interned identifiers
+		gc_ptr<atom_table> m_atoms;
+
+		// parsed target paths
+		target_path_cache* m_path_cache;
+
 		// Players count to release all static stuff at the right time
 		static int s_player_count;
 
@@ -99,6 +112,8 @@ namespace gameswf
 		void clear_library();
 
 		as_object* get_global() const;
+		atom_table* get_atoms() const { return m_atoms.get_ptr(); }
+		target_path_cache* get_path_cache() const { return m_path_cache; }
 		void notify_key_object(key::code k, bool down);
 
 		exported_module const bool get_force_realtime_framerate() const;
@@ -106,7 +121,20 @@ namespace gameswf
 		exported_module bool get_log_bitmap_info() const { return m_log_bitmap_info; }
 		exported_module void set_log_bitmap_info(bool log_bitmap_info) { m_log_bitmap_info = log_bitmap_info; }
 
+		// Microseconds the garbage collector may take from a frame
+		// for the old objects, 0 for no limit; see as_heap.
+		exported_module void set_gc_budget(int us) { m_heap.set_budget(us); }
+		exported_module int get_gc_budget() const { return m_heap.get_budget(); }
+		exported_module void get_gc_stats(as_heap_stats* stats) const { m_heap.get_stats(stats); }
+		exported_module void get_pool_stats(object_pool_stats* stats) const { m_pool->get_stats(stats); }
+
+		// The movies in the library, and the objects of the pool
+		// (which the players of this thread share), see
+		// gameswf_memory.h.
+		exported_module void get_memory_stats(memory_stats* stats) const;
+
 		// the garbage manager
+		as_heap* get_heap() { return &m_heap; }
 		void set_alive(as_object* obj);
 		bool is_garbage(as_object* obj);
 		void clear_heap();
@@ -0,0 +1,128 @@
+// gameswf_pool.cpp
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// Size-class pools for the objects of the players.
+
+#include "gameswf/gameswf_pool.h"
+
+namespace gameswf
+{
+
+	// In front of each block.  HEADER_SIZE keeps the objects
+	// aligned like the blocks of tu_malloc().
+	struct block_header
+	{
+		object_pool*	m_pool;	// NULL for a block from tu_malloc()
+		int	m_size;	// of the block, header included
+	};
+	static const int	HEADER_SIZE = 16;
+
+	static thread_local object_pool*	s_current_pool = NULL;
+
+	object_pool::object_pool() :
+		m_players(0),
+		m_live(0)
+	{
+	}
+
+	void*	object_pool::allocate(size_t size)
+	{
+		assert(sizeof(block_header) <= HEADER_SIZE);
+
+		int	block_size = (int) size + HEADER_SIZE;
+		object_pool*	pool = s_current_pool;
+		block_header*	header;
+		if (pool)
+		{
+			header = (block_header*) pool->m_freelist.alloc(block_size);
+			pool->m_live++;
+		}
+		else
+		{
+			header = (block_header*) tu_malloc(block_size);
+		}
+		header->m_pool = pool;
+		header->m_size = block_size;
+		return (char*) header + HEADER_SIZE;
+	}
+
+	void	object_pool::deallocate(void* p)
+	{
+		if (p == NULL)
+		{
+			return;
+		}
+
+		block_header*	header = (block_header*) ((char*) p - HEADER_SIZE);
+		object_pool*	pool = header->m_pool;
+		if (pool)
+		{
+			pool->m_freelist.dealloc(header, header->m_size);
+			pool->release_block();
+		}
+		else
+		{
+			tu_free(header, header->m_size);
+		}
+	}
+
+	void	object_pool::release_block()
+	{
+		assert(m_live > 0);
+		m_live--;
+		if (m_live == 0 && m_players == 0)
+		{
+			// Outlived its players.
+			delete this;
+		}
+	}
+
+	object_pool*	object_pool::attach()
+	{
+		if (s_current_pool == NULL)
+		{
+			s_current_pool = new object_pool();
+		}
+		s_current_pool->m_players++;
+		return s_current_pool;
+	}
+
+	void	object_pool::detach()
+	{
+		assert(m_players > 0);
+		m_players--;
+		if (m_players > 0)
+		{
+			return;
+		}
+
+		assert(s_current_pool == this);
+		s_current_pool = NULL;
+
+		// The objects still held by the host or by the movie
+		// definitions keep the pool until they are released.
+		if (m_live == 0)
+		{
+			delete this;
+		}
+	}
+
+	object_pool*	object_pool::get_current()
+	{
+		return s_current_pool;
+	}
+
+	void	object_pool::get_stats(object_pool_stats* stats) const
+	{
+		assert(stats);
+		const tu_freelist_stats&	s = m_freelist.get_stats();
+		stats->m_allocs = s.m_allocs;
+		stats->m_frees = s.m_frees;
+		stats->m_reused = s.m_reused;
+		stats->m_live = m_live;
+		stats->m_bytes = m_freelist.get_arena().get_chunk_bytes();
+	}
+
+}
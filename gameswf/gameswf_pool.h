@@ -0,0 +1,78 @@
+// gameswf_pool.h
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// Where the small objects that scripts make and drop all the time
+// get their memory: as_object (and so the characters) and the
+// strings of the as_value's allocate from the object_pool of their
+// player instead of from malloc.
+//
+// The pool belongs to the players of a thread.  The first player a
+// thread creates makes it, and the blocks that thread allocates
+// while it has a player come from it; the other threads, e.g. the
+// movie loader, use tu_malloc().  A block goes back to the pool it
+// came from, and the pool is freed when its last player is gone and
+// its last block has been given back.  So a player has to be
+// destroyed by the thread that created it, and the objects of the
+// player must not be released by another thread.
+//
+// Each block has a small header that tells where it came from.
+
+#ifndef GAMESWF_POOL_H
+#define GAMESWF_POOL_H
+
+#include "base/tu_arena.h"
+#include "gameswf/gameswf.h"
+
+namespace gameswf
+{
+
+	struct object_pool_stats
+	{
+		object_pool_stats() :
+			m_allocs(0),
+			m_frees(0),
+			m_reused(0),
+			m_live(0),
+			m_bytes(0)
+		{
+		}
+
+		int	m_allocs;
+		int	m_frees;
+		int	m_reused;	// allocs served by a freed block
+		int	m_live;	// blocks not given back yet
+		int	m_bytes;	// taken from tu_malloc() by the size classes
+	};
+
+	struct object_pool
+	{
+		// Used by the operator new/delete of the pooled objects.
+		static void*	allocate(size_t size);
+		static void	deallocate(void* p);
+
+		// The pool of the players of the calling thread, made by
+		// the first one.  Each attach() needs a detach().
+		static object_pool*	attach();
+		void	detach();
+
+		// The pool of the calling thread, NULL if it has no
+		// player.
+		exported_module static object_pool*	get_current();
+
+		exported_module void	get_stats(object_pool_stats* stats) const;
+
+	private:
+		object_pool();
+
+		void	release_block();
+
+		tu_freelist	m_freelist;
+		int	m_players;
+		int	m_live;
+	};
+
+}
+
+#endif // GAMESWF_POOL_H
@@ -0,0 +1,362 @@
+// gameswf_profiler.cpp
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// ActionScript profiler.  Every profiled scope knows its full
+// collapsed stack ("movie;path:frame 1;path:f@12"), the self time of
+// the scopes is summed per stack.  The whole thing runs under the
+// engine mutex, like the ActionScript it times.
+
+
+#include "gameswf/gameswf_profiler.h"
+#include "gameswf/gameswf_log.h"
+#include "gameswf/gameswf_character.h"
+#include "gameswf/gameswf_sprite.h"
+#include "gameswf/gameswf_root.h"
+#include "gameswf/gameswf_movie_def.h"
+#include "gameswf/gameswf_player.h"
+#include "gameswf/gameswf_function.h"
+#include "gameswf/gameswf_avm2.h"
+#include "gameswf/gameswf_abc.h"
+#include "base/tu_timer.h"
+#include "base/container.h"
+
+#include <stdio.h>
+
+
+namespace gameswf
+{
+
+	struct profile_entry
+	{
+		profile_entry() : m_ticks(0), m_calls(0) {}
+
+		Uint64	m_ticks;	// self time
+		int	m_calls;
+	};
+
+	// A scope that is running.
+	struct profile_scope_entry
+	{
+		tu_string	m_stack;
+		Uint64	m_start;
+		Uint64	m_children;	// time spent in nested scopes
+	};
+
+	struct profile_frame
+	{
+		profile_frame() :
+			m_frame(1),
+			m_ticks(0),
+			m_calls(0),
+			m_frame_time(0),
+			m_slowest_ticks(0)
+		{
+		}
+
+		int	m_frame;
+		Uint64	m_ticks;
+		int	m_calls;
+		float	m_frame_time;
+		tu_string	m_slowest;	// the top level scope that took the longest
+		Uint64	m_slowest_ticks;
+	};
+
+	static bool	s_profiling = false;
+	static array<profile_scope_entry>	s_scopes;
+	static string_hash<profile_entry>	s_profile;	// collapsed stack --> totals
+	static array<profile_frame>	s_frames;
+	static profile_frame	s_frame;	// being recorded
+
+	bool	get_profiling()
+	{
+		return s_profiling;
+	}
+
+	void	set_profiling(bool profiling)
+	{
+		if (profiling && s_profiling == false)
+		{
+			// Start over.
+			s_scopes.resize(0);
+			s_profile.clear();
+			s_frames.resize(0);
+			s_frame = profile_frame();
+		}
+		s_profiling = profiling;
+	}
+
+	static character*	get_top(character* ch)
+	{
+		while (ch->get_parent())
+		{
+			ch = ch->get_parent();
+		}
+		return ch;
+	}
+
+	static void	append_path(tu_string* str, character* ch)
+	// Dot syntax, "_level0.clip.child".
+	{
+		character*	parent = ch->get_parent();
+		if (parent == NULL)
+		{
+			*str += "_level0";
+			return;
+		}
+
+		append_path(str, parent);
+		*str += ".";
+		*str += ch->get_name().length() > 0 ? ch->get_name().c_str() : "noname";
+	}
+
+	static tu_string	get_path(character* ch)
+	{
+		tu_string	path;
+		if (ch)
+		{
+			append_path(&path, ch);
+		}
+		else
+		{
+			path = "object";
+		}
+		return path;
+	}
+
+	static tu_string	get_movie_name(character* ch)
+	{
+		if (ch)
+		{
+			sprite_instance*	top = cast_to<sprite_instance>(get_top(ch));
+			if (top && top->get_root() && top->get_root()->m_def != NULL)
+			{
+				const tu_string&	url = top->get_root()->m_def->m_url;
+				if (url.length() > 0)
+				{
+					return url;
+				}
+			}
+		}
+		return "movie";
+	}
+
+	as_profiler_scope::as_profiler_scope(character* target, int frame) :
+		m_active(s_profiling)
+	{
+		if (m_active)
+		{
+			enter(target, get_path(target) + string_printf(":frame %d", frame + 1));
+		}
+	}
+
+	as_profiler_scope::as_profiler_scope(character* target, const event_id& id) :
+		m_active(s_profiling)
+	{
+		if (m_active)
+		{
+			enter(target, get_path(target) + ":" + id.get_function_name());
+		}
+	}
+
+	as_profiler_scope::as_profiler_scope(const as_s_function* func) :
+		m_active(s_profiling)
+	{
+		if (m_active)
+		{
+			// Named after the clip it was declared in, and
+			// where it starts in its action buffer.
+			character*	target = cast_to<character>(func->m_target.get_ptr());
+			tu_string	name = get_path(target) + ":";
+			name += func->m_name.length() > 0 ? func->m_name.c_str() : "function";
+			name += string_printf("@%d", func->m_start_pc);
+			enter(target, name);
+		}
+	}
+
+	as_profiler_scope::as_profiler_scope(const as_3_function* func) :
+		m_active(s_profiling)
+	{
+		if (m_active)
+		{
+			tu_string	name;
+			const abc_def*	abc = func->m_abc.get_ptr();
+			if (abc && func->m_name > 0)
+			{
+				name = abc->get_string(func->m_name);
+			}
+			if (name.length() == 0)
+			{
+				name = string_printf("method #%d", func->m_method);
+			}
+
+			// Methods of classes don't know their clip.
+			character*	target = cast_to<character>(func->m_target.get_ptr());
+			if (target == NULL && func->get_player())
+			{
+				target = func->get_player()->get_root_movie();
+			}
+			enter(target, name);
+		}
+	}
+
+	void	as_profiler_scope::enter(character* target, const tu_string& name)
+	{
+		profile_scope_entry	scope;
+		if (s_scopes.size() == 0)
+		{
+			scope.m_stack = get_movie_name(target);
+		}
+		else
+		{
+			scope.m_stack = s_scopes.back().m_stack;
+		}
+		scope.m_stack += ";";
+		scope.m_stack += name;
+		scope.m_children = 0;
+		scope.m_start = tu_timer::get_profile_ticks();
+		s_scopes.push_back(scope);
+	}
+
+	as_profiler_scope::~as_profiler_scope()
+	{
+		if (m_active == false || s_scopes.size() == 0)
+		{
+			return;
+		}
+
+		Uint64	ticks = tu_timer::get_profile_ticks() - s_scopes.back().m_start;
+
+		profile_entry	entry;
+		s_profile.get(s_scopes.back().m_stack, &entry);
+		entry.m_ticks += ticks - s_scopes.back().m_children;
+		entry.m_calls++;
+		s_profile.set(s_scopes.back().m_stack, entry);
+
+		s_frame.m_calls++;
+		if (s_scopes.size() == 1)
+		{
+			s_frame.m_ticks += ticks;
+			if (ticks > s_frame.m_slowest_ticks || s_frame.m_slowest.length() == 0)
+			{
+				s_frame.m_slowest_ticks = ticks;
+				s_frame.m_slowest = s_scopes.back().m_stack;
+			}
+		}
+		else
+		{
+			s_scopes[s_scopes.size() - 2].m_children += ticks;
+		}
+
+		s_scopes.resize(s_scopes.size() - 1);
+	}
+
+	void	profiler_frame_done(float frame_time)
+	{
+		if (s_profiling == false)
+		{
+			return;
+		}
+
+		s_frame.m_frame_time = frame_time;
+		s_frames.push_back(s_frame);
+
+		int	next_frame = s_frame.m_frame + 1;
+		s_frame = profile_frame();
+		s_frame.m_frame = next_frame;
+	}
+
+	bool	write_profile(const char* filename)
+	{
+		FILE*	out = fopen(filename, "w");
+		if (out == NULL)
+		{
+			log_error("can't open '%s' to write the profile\n", filename);
+			return false;
+		}
+
+		// Microseconds, flamegraph.pl only wants a count.
+		for (string_hash<profile_entry>::iterator it = s_profile.begin(); it != s_profile.end(); ++it)
+		{
+			fprintf(out, "%s %.0f\n", it->first.c_str(),
+				tu_timer::profile_ticks_to_milliseconds(it->second.m_ticks) * 1000.0);
+		}
+
+		fclose(out);
+		return true;
+	}
+
+	struct profile_total
+	{
+		const tu_string*	m_stack;
+		const profile_entry*	m_entry;
+	};
+
+	static int	compare_self_time(const void* a, const void* b)
+	// Slowest first.
+	{
+		Uint64	ta = ((const profile_total*) a)->m_entry->m_ticks;
+		Uint64	tb = ((const profile_total*) b)->m_entry->m_ticks;
+		return ta < tb ? 1 : (ta > tb ? -1 : 0);
+	}
+
+	bool	write_profile_summary(const char* filename)
+	{
+		FILE*	out = fopen(filename, "w");
+		if (out == NULL)
+		{
+			log_error("can't open '%s' to write the profile summary\n", filename);
+			return false;
+		}
+
+		fprintf(out, "# frame\tms\tcalls\tslowest ms\tslowest script (* = over the frame time)\n");
+		for (int i = 0; i < s_frames.size(); i++)
+		{
+			const profile_frame&	frame = s_frames[i];
+			double	ms = tu_timer::profile_ticks_to_milliseconds(frame.m_ticks);
+			fprintf(out, "%d\t%.3f\t%d\t%.3f\t%s%s\n",
+				frame.m_frame,
+				ms,
+				frame.m_calls,
+				tu_timer::profile_ticks_to_milliseconds(frame.m_slowest_ticks),
+				frame.m_slowest.c_str(),
+				ms > frame.m_frame_time * 1000.0f ? " *" : "");
+		}
+
+		// Then the totals per call stack.
+		array<profile_total>	totals;
+		for (string_hash<profile_entry>::iterator it = s_profile.begin(); it != s_profile.end(); ++it)
+		{
+			profile_total	total;
+			total.m_stack = &it->first;
+			total.m_entry = &it->second;
+			totals.push_back(total);
+		}
+		if (totals.size() > 0)
+		{
+			qsort(&totals[0], totals.size(), sizeof(totals[0]), compare_self_time);
+		}
+
+		fprintf(out, "\n# self ms\tcalls\tstack\n");
+		for (int i = 0; i < totals.size(); i++)
+		{
+			fprintf(out, "%.3f\t%d\t%s\n",
+				tu_timer::profile_ticks_to_milliseconds(totals[i].m_entry->m_ticks),
+				totals[i].m_entry->m_calls,
+				totals[i].m_stack->c_str());
+		}
+
+		fclose(out);
+		return true;
+	}
+
+}
+
+
+// Local Variables:
+// mode: C++
+// c-basic-offset: 8
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
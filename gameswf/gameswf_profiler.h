@@ -0,0 +1,62 @@
+// gameswf_profiler.h
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// ActionScript profiler.  Books the time spent in frame scripts,
+// event handlers and functions under the call stack they ran in, see
+// set_profiling() in gameswf.h.
+
+
+#ifndef GAMESWF_PROFILER_H
+#define GAMESWF_PROFILER_H
+
+#include "gameswf/gameswf.h"
+#include "base/tu_types.h"
+
+namespace gameswf
+{
+	struct character;
+	struct event_id;
+	struct as_s_function;
+	struct as_3_function;
+
+	// Times the ActionScript run during its lifetime.  Does
+	// nothing (but testing a flag) when profiling is off.
+	struct as_profiler_scope
+	{
+		// Frame script of a sprite.
+		as_profiler_scope(character* target, int frame);
+
+		// Event handler of a character (or of a plain object if
+		// target is NULL).
+		as_profiler_scope(character* target, const event_id& id);
+
+		as_profiler_scope(const as_s_function* func);
+		as_profiler_scope(const as_3_function* func);
+
+		~as_profiler_scope();
+
+	private:
+		void	enter(character* target, const tu_string& name);
+
+		bool	m_active;
+	};
+
+	// Called by root::advance() each time the movie has advanced
+	// a frame, closes the frame record.  ActionScript run by the
+	// advance() calls in between (mouse events, intervals) is
+	// booked to the next frame.  frame_time is in seconds.
+	void	profiler_frame_done(float frame_time);
+}
+
+
+#endif // GAMESWF_PROFILER_H
+
+
+// Local Variables:
+// mode: C++
+// c-basic-offset: 8
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -10,10 +10,12 @@
 // http://sswf.sourceforge.net/SWFalexref.html
 // http://www.openswf.org
 
+#include "gameswf/gameswf_memory.h"
 #include "gameswf/gameswf_movie_def.h"
 #include "gameswf/gameswf_render.h"
 #include "gameswf/gameswf_root.h"
 #include "gameswf/gameswf_sprite.h"
+#include "gameswf/gameswf_profiler.h"
 #include "base/tu_random.h"
 
 #ifdef _WIN32
@@ -44,6 +46,10 @@ namespace gameswf
 		m_mouse_y(0),
 		m_mouse_buttons(0),
 		m_userdata(NULL),
+		m_hit_test_done(false),
+		m_hit_test_x(0),
+		m_hit_test_y(0),
+		m_hit_test_scene(0),
 		m_on_event_load_called(false),
 		m_shift_key_state(false),
 		m_current_active_entity(NULL),
@@ -409,6 +415,7 @@ namespace gameswf
 	{
 		m_movie = root_movie;
 		assert(m_movie != NULL);
+		character::mouse_scene_changed();
 	}
 
 	void	root::set_display_viewport(int x0, int y0, int w, int h)
@@ -594,6 +601,21 @@ namespace gameswf
 		return m_background_color.m_a / 255.0f;
 	}
 
+	void	root::set_script_budget(const script_budget& budget)
+	{
+		m_script_budget = budget;
+	}
+
+	const script_budget&	root::get_script_budget() const
+	{
+		return m_script_budget;
+	}
+
+	const script_usage&	root::get_script_usage() const
+	{
+		return m_script_usage;
+	}
+
 	void	root::advance(float delta_time)
 	{
 		// Lock gameswf engine. Video is running in separate thread and
@@ -604,10 +626,21 @@ namespace gameswf
 		// Handle mouse dragging
 		do_mouse_drag();
 
-		// Handle the mouse.
-		character *te;
-		m_movie->get_topmost_mouse_entity(te, PIXELS_TO_TWIPS(m_mouse_x), PIXELS_TO_TWIPS(m_mouse_y));
-		m_mouse_button_state.m_topmost_entity = te;
+		// Handle the mouse.  What is under it stays the same
+		// until it or the scene moves.
+		Uint32	scene = character::get_mouse_scene();
+		if (m_hit_test_done == false || scene != m_hit_test_scene
+			|| m_mouse_x != m_hit_test_x || m_mouse_y != m_hit_test_y)
+		{
+			character*	te = NULL;
+			m_movie->get_topmost_mouse_entity(te, PIXELS_TO_TWIPS(m_mouse_x), PIXELS_TO_TWIPS(m_mouse_y));
+			m_mouse_button_state.m_topmost_entity = te;
+
+			m_hit_test_done = true;
+			m_hit_test_x = m_mouse_x;
+			m_hit_test_y = m_mouse_y;
+			m_hit_test_scene = scene;
+		}
 
 		m_mouse_button_state.m_mouse_button_state_current = (m_mouse_buttons & 1);
 		m_mouse_button_state.m_x = m_mouse_x;
@@ -667,6 +700,9 @@ namespace gameswf
 			}
 
 			m_player->clear_garbage();
+
+			profiler_frame_done(m_frame_time);
+			script_budget_frame_done(this);
 		}
 
 		gameswf_engine_mutex().unlock();
@@ -695,6 +731,9 @@ namespace gameswf
 		m_movie->display();
 
 		gameswf::render::end_display();
+
+		// Drop the least recently used caches over the budget.
+		memory_cache::trim();
 	}
 
 	bool	root::goto_labeled_frame(const char* label)
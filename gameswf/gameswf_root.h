@@ -18,6 +18,7 @@
 #include "gameswf/gameswf_mutex.h"
 #include "gameswf/gameswf_listener.h"
 #include "gameswf/gameswf_player.h"
+#include "gameswf/gameswf_script_budget.h"
 #include <assert.h>
 #include "base/container.h"
 #include "base/utility.h"
@@ -75,6 +76,13 @@ namespace gameswf
 		void*		m_userdata;
 		character::drag_state	m_drag_state;	// @@ fold this into m_mouse_button_state?
 		mouse_button_state m_mouse_button_state;
+
+		// The mouse and character::get_mouse_scene() at the
+		// last get_topmost_mouse_entity().
+		bool	m_hit_test_done;
+		int	m_hit_test_x, m_hit_test_y;
+		Uint32	m_hit_test_scene;
+
 		bool		m_on_event_load_called;
 		bool        m_shift_key_state;
 
@@ -87,6 +95,10 @@ namespace gameswf
 		listener m_listener;
 		listener m_mouse_listener;
 
+		// limits of the ActionScript run, and what it used
+		script_budget	m_script_budget;
+		script_usage	m_script_usage;
+
 		weak_ptr<player> m_player;
 
 		root(player* player, movie_def_impl* def);
@@ -119,6 +131,11 @@ namespace gameswf
 		float	get_background_alpha() const;
 		exported_module void	advance(float delta_time);
 
+		// See gameswf_script_budget.h.
+		exported_module void	set_script_budget(const script_budget& budget);
+		exported_module const script_budget&	get_script_budget() const;
+		exported_module const script_usage&	get_script_usage() const;
+
 		exported_module void	goto_frame(int target_frame_number);
 		virtual bool	has_looped() const;
 
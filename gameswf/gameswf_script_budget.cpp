@@ -0,0 +1,363 @@
+// gameswf_script_budget.cpp
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// Script budgets.  The call being run and the counters of its
+// executes are kept here; like the ActionScript they count, all of
+// it runs under the engine mutex.
+
+
+#include "gameswf/gameswf_script_budget.h"
+#include "gameswf/gameswf_log.h"
+#include "gameswf/gameswf_root.h"
+#include "gameswf/gameswf_character.h"
+#include "gameswf/gameswf_function.h"
+#include "base/tu_timer.h"
+
+
+namespace gameswf
+{
+
+	// The limit of the counters when there is nothing to check.
+	static const int	NO_LIMIT = 1 << 30;
+
+	struct script_clock
+	{
+		weak_ptr<root>	m_root;	// whose budget the call runs on, NULL outside of calls
+		const script_budget_scope*	m_scope;	// innermost
+		script_budget_counter*	m_counter;	// innermost
+		Uint64	m_call_start;
+		int	m_call_actions;
+		bool	m_call_over;	// has gone over the call budget
+		bool	m_stopping;
+	};
+
+	static script_clock	s_clock;
+
+	static float	get_frame_ms(const script_usage& usage, Uint64 now)
+	{
+		Uint64	ticks = usage.m_frame_ticks;
+		if (s_clock.m_root != NULL)
+		{
+			ticks += now - s_clock.m_call_start;
+		}
+		return (float) tu_timer::profile_ticks_to_milliseconds(ticks);
+	}
+
+	static int	get_limit()
+	// Actions to run before the next check.
+	{
+		root*	r = s_clock.m_root.get_ptr();
+		if (r == NULL)
+		{
+			return NO_LIMIT;
+		}
+		const script_budget&	budget = r->m_script_budget;
+		const script_usage&	usage = r->m_script_usage;
+		if (s_clock.m_stopping || (usage.m_frame_over && budget.m_policy != script_budget::WARN))
+		{
+			return 0;
+		}
+
+		// Once a warning has been logged, the budget it was
+		// about isn't checked anymore.
+		bool	check_call = s_clock.m_call_over == false;
+		bool	check_frame = usage.m_frame_over == false;
+
+		int	limit = NO_LIMIT;
+		if ((check_call && budget.m_call_ms > 0) || (check_frame && budget.m_frame_ms > 0))
+		{
+			limit = SCRIPT_BUDGET_INTERVAL;
+		}
+		if (check_call && budget.m_call_actions > 0)
+		{
+			limit = imin(limit, budget.m_call_actions - s_clock.m_call_actions + 1);
+		}
+		if (check_frame && budget.m_frame_actions > 0)
+		{
+			limit = imin(limit, budget.m_frame_actions - usage.m_frame_actions + 1);
+		}
+		return imax(limit, 0);
+	}
+
+	static tu_string	get_call_path()
+	// "_level0:frame 1 > _level0.menu:onEnterFrame > _level0.menu:update@120"
+	{
+		array<const script_budget_scope*>	scopes;
+		for (const script_budget_scope* scope = s_clock.m_scope; scope; scope = scope->m_parent)
+		{
+			scopes.push_back(scope);
+		}
+
+		tu_string	path;
+		for (int i = scopes.size() - 1; i >= 0; i--)
+		{
+			path += scopes[i]->get_name();
+			if (i > 0)
+			{
+				path += " > ";
+			}
+		}
+		return path;
+	}
+
+	void	script_budget_add(int count)
+	{
+		if (s_clock.m_root != NULL)
+		{
+			s_clock.m_call_actions += count;
+			s_clock.m_root->m_script_usage.m_frame_actions += count;
+		}
+	}
+
+	bool	script_budget_check(int* count, int* limit)
+	{
+		script_budget_add(*count);
+		*count = 0;
+
+		root*	r = s_clock.m_root.get_ptr();
+		if (r == NULL || s_clock.m_stopping)
+		{
+			*limit = get_limit();
+			return s_clock.m_stopping;
+		}
+
+		const script_budget&	budget = r->m_script_budget;
+		script_usage&	usage = r->m_script_usage;
+
+		Uint64	now = tu_timer::get_profile_ticks();
+		float	call_ms = (float) tu_timer::profile_ticks_to_milliseconds(now - s_clock.m_call_start);
+		float	frame_ms = get_frame_ms(usage, now);
+
+		const char*	over_call = NULL;
+		if (s_clock.m_call_over == false)
+		{
+			if (budget.m_call_actions > 0 && s_clock.m_call_actions > budget.m_call_actions)
+			{
+				over_call = "action";
+			}
+			else if (budget.m_call_ms > 0 && call_ms > budget.m_call_ms)
+			{
+				over_call = "time";
+			}
+		}
+
+		const char*	over_frame = NULL;
+		if (usage.m_frame_over == false)
+		{
+			if (budget.m_frame_actions > 0 && usage.m_frame_actions > budget.m_frame_actions)
+			{
+				over_frame = "action";
+			}
+			else if (budget.m_frame_ms > 0 && frame_ms > budget.m_frame_ms)
+			{
+				over_frame = "time";
+			}
+		}
+		else if (budget.m_policy != script_budget::WARN)
+		{
+			// The frame has no time left for this call either,
+			// it has been logged already.
+			s_clock.m_stopping = true;
+			usage.m_stopped++;
+		}
+
+		if (over_call || over_frame)
+		{
+			s_clock.m_call_over = s_clock.m_call_over || over_call != NULL;
+			usage.m_frame_over = usage.m_frame_over || over_frame != NULL;
+
+			tu_string	path = get_call_path();
+			if (budget.m_policy == script_budget::WARN)
+			{
+				log_error("slow script: %s has run %d actions in %.1f ms, over the %s %s budget\n",
+					path.c_str(), s_clock.m_call_actions, call_ms,
+					over_call ? "call" : "frame", over_call ? over_call : over_frame);
+			}
+			else
+			{
+				log_error("script budget: stopped %s after %d actions in %.1f ms, over the %s %s budget\n",
+					path.c_str(), s_clock.m_call_actions, call_ms,
+					over_call ? "call" : "frame", over_call ? over_call : over_frame);
+				s_clock.m_stopping = true;
+				usage.m_stopped++;
+			}
+		}
+
+		if (s_clock.m_stopping)
+		{
+			// Unwind the executes this one is nested in.
+			for (script_budget_counter* counter = s_clock.m_counter; counter; counter = counter->m_parent)
+			{
+				counter->m_limit = 0;
+			}
+		}
+
+		*limit = get_limit();
+		return s_clock.m_stopping;
+	}
+
+	bool	script_budget_yield(root* r)
+	{
+		if (r == NULL || r->m_script_budget.m_policy != script_budget::YIELD)
+		{
+			return false;
+		}
+
+		const script_budget&	budget = r->m_script_budget;
+		const script_usage&	usage = r->m_script_usage;
+		if (usage.m_frame_over)
+		{
+			return true;
+		}
+		if (budget.m_frame_actions > 0 && usage.m_frame_actions >= budget.m_frame_actions)
+		{
+			return true;
+		}
+		if (budget.m_frame_ms > 0 &&
+			tu_timer::profile_ticks_to_milliseconds(usage.m_frame_ticks) >= budget.m_frame_ms)
+		{
+			return true;
+		}
+		return false;
+	}
+
+	void	script_budget_frame_done(root* r)
+	{
+		script_usage&	usage = r->m_script_usage;
+		usage.m_last_frame_actions = usage.m_frame_actions;
+		usage.m_last_frame_ms = (float) tu_timer::profile_ticks_to_milliseconds(usage.m_frame_ticks);
+		usage.m_frame_actions = 0;
+		usage.m_frame_ticks = 0;
+		usage.m_frame_over = false;
+	}
+
+	script_budget_counter::script_budget_counter() :
+		m_count(0),
+		m_limit(get_limit()),
+		m_parent(s_clock.m_counter)
+	{
+		s_clock.m_counter = this;
+	}
+
+	script_budget_counter::~script_budget_counter()
+	{
+		s_clock.m_counter = m_parent;
+		if (m_count > 0)
+		{
+			script_budget_add(m_count);
+		}
+	}
+
+	script_budget_scope::script_budget_scope(character* target, int frame) :
+		m_object(target),
+		m_frame(frame),
+		m_event(NULL),
+		m_function(NULL)
+	{
+		enter(target);
+	}
+
+	script_budget_scope::script_budget_scope(as_object* obj, const event_id& id) :
+		m_object(obj),
+		m_frame(-1),
+		m_event(&id),
+		m_function(NULL)
+	{
+		enter(obj);
+	}
+
+	script_budget_scope::script_budget_scope(const as_s_function* func) :
+		m_object(func->m_target.get_ptr()),
+		m_frame(-1),
+		m_event(NULL),
+		m_function(func)
+	{
+		enter(const_cast<as_s_function*>(func));
+	}
+
+	void	script_budget_scope::enter(as_object* obj)
+	{
+		m_parent = s_clock.m_scope;
+		s_clock.m_scope = this;
+		if (m_parent == NULL)
+		{
+			// A new call.
+			s_clock.m_root = obj ? obj->get_root() : NULL;
+			s_clock.m_call_start = tu_timer::get_profile_ticks();
+			s_clock.m_call_actions = 0;
+			s_clock.m_call_over = false;
+			s_clock.m_stopping = false;
+		}
+	}
+
+	script_budget_scope::~script_budget_scope()
+	{
+		s_clock.m_scope = m_parent;
+		if (m_parent == NULL)
+		{
+			if (s_clock.m_root != NULL)
+			{
+				s_clock.m_root->m_script_usage.m_frame_ticks +=
+					tu_timer::get_profile_ticks() - s_clock.m_call_start;
+			}
+			s_clock.m_root = NULL;
+			s_clock.m_stopping = false;
+		}
+	}
+
+	static void	append_path(tu_string* str, character* ch)
+	// Dot syntax, "_level0.clip.child".
+	{
+		character*	parent = ch->get_parent();
+		if (parent == NULL)
+		{
+			*str += "_level0";
+			return;
+		}
+
+		append_path(str, parent);
+		*str += ".";
+		*str += ch->get_name().length() > 0 ? ch->get_name().c_str() : "noname";
+	}
+
+	tu_string	script_budget_scope::get_name() const
+	{
+		tu_string	name;
+		character*	ch = cast_to<character>(m_object.get_ptr());
+		if (ch)
+		{
+			append_path(&name, ch);
+		}
+		else
+		{
+			name = "object";
+		}
+
+		if (m_function)
+		{
+			name += ":";
+			name += m_function->m_name.length() > 0 ? m_function->m_name.c_str() : "function";
+			name += string_printf("@%d", m_function->m_start_pc);
+		}
+		else if (m_event)
+		{
+			name += ":";
+			name += m_event->get_function_name();
+		}
+		else
+		{
+			name += string_printf(":frame %d", m_frame + 1);
+		}
+		return name;
+	}
+}
+
+
+// Local Variables:
+// mode: C++
+// c-basic-offset: 8
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
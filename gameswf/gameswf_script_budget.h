@@ -0,0 +1,147 @@
+// gameswf_script_budget.h
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// Bounds the ActionScript a root runs.  A root has a budget of
+// actions and milliseconds for all the scripts of a frame, and for
+// each call (a frame script, an event handler, an interval timer or
+// a method called by the host), see root::set_script_budget().
+// action_buffer::execute() counts the actions it runs and checks the
+// clock every SCRIPT_BUDGET_INTERVAL actions.
+
+
+#ifndef GAMESWF_SCRIPT_BUDGET_H
+#define GAMESWF_SCRIPT_BUDGET_H
+
+#include "gameswf/gameswf.h"
+#include "base/tu_types.h"
+#include "base/weak_ptr.h"
+
+namespace gameswf
+{
+	struct root;
+	struct character;
+	struct as_object;
+	struct as_s_function;
+	struct event_id;
+
+	// 0 means no limit.
+	struct script_budget
+	{
+		enum policy
+		{
+			ABORT,	// stop the script with an error
+			YIELD,	// stop it, and put off interval timers until the next frame
+			WARN	// let it run, log a slow script warning with its call path
+		};
+
+		script_budget() :
+			m_frame_actions(0),
+			m_frame_ms(0),
+			m_call_actions(0),
+			m_call_ms(0),
+			m_policy(ABORT)
+		{
+		}
+
+		int	m_frame_actions;
+		float	m_frame_ms;
+		int	m_call_actions;
+		float	m_call_ms;
+		policy	m_policy;
+	};
+
+	// What a root's scripts used.
+	struct script_usage
+	{
+		script_usage() :
+			m_frame_actions(0),
+			m_frame_ticks(0),
+			m_frame_over(false),
+			m_last_frame_actions(0),
+			m_last_frame_ms(0),
+			m_stopped(0)
+		{
+		}
+
+		// The frame being run.
+		int	m_frame_actions;
+		Uint64	m_frame_ticks;
+		bool	m_frame_over;	// has gone over the frame budget
+
+		int	m_last_frame_actions;
+		float	m_last_frame_ms;
+		int	m_stopped;	// scripts stopped so far
+	};
+
+	enum { SCRIPT_BUDGET_INTERVAL = 1024 };
+
+	// Called by action_buffer::execute() after it has run
+	// *count more actions; adds them to the call and the frame.
+	// Returns true if the script must stop.  Sets *count to 0 and
+	// *limit to the actions to run before the next check.
+	bool	script_budget_check(int* count, int* limit);
+
+	// True if the scripts of root's frame have used up their
+	// budget (interval timers yield to the next frame then).
+	bool	script_budget_yield(root* r);
+
+	// Called by root::advance() each time the movie has advanced
+	// a frame.
+	void	script_budget_frame_done(root* r);
+
+	// Counts the actions run by one action_buffer::execute().
+	// When a script has to stop, the counters of all the
+	// executes it is nested in are told to stop too.
+	struct script_budget_counter
+	{
+		script_budget_counter();
+		~script_budget_counter();
+
+		// Returns true if the script must stop.
+		bool	tick(int actions = 1)
+		{
+			m_count += actions;
+			return m_count >= m_limit && script_budget_check(&m_count, &m_limit);
+		}
+
+		int	m_count;
+		int	m_limit;
+		script_budget_counter*	m_parent;
+	};
+
+	// A call: a frame script, an event handler or a function.
+	// The outermost one is what the call budget applies to, the
+	// nested ones make up the call path of the warnings.
+	struct script_budget_scope
+	{
+		script_budget_scope(character* target, int frame);
+		script_budget_scope(as_object* obj, const event_id& id);
+		script_budget_scope(const as_s_function* func);
+		~script_budget_scope();
+
+		tu_string	get_name() const;
+
+		const script_budget_scope*	m_parent;
+
+	private:
+		void	enter(as_object* obj);
+
+		weak_ptr<as_object>	m_object;	// scripts can delete their clip
+		int	m_frame;
+		const event_id*	m_event;
+		const as_s_function*	m_function;
+	};
+}
+
+
+#endif // GAMESWF_SCRIPT_BUDGET_H
+
+
+// Local Variables:
+// mode: C++
+// c-basic-offset: 8
+// tab-width: 8
+// indent-tabs-mode: t
+// End:
@@ -402,6 +402,11 @@ namespace gameswf
 	{
 	}
 
+	int	mesh::get_bytes() const
+	{
+		return sizeof(mesh) + (m_triangle_strip.size() + m_triangle_list.size()) * sizeof(coord_component);
+	}
+
 	void	mesh::set_tri_strip(const point pts[], int count)
 	{
 		m_triangle_strip.resize(count * 2);	// 2 coords per point
@@ -471,6 +476,11 @@ namespace gameswf
 		m_style(-1)
 	{}
 
+	int	line_strip::get_bytes() const
+	{
+		return sizeof(line_strip) + m_coords.size() * sizeof(coord_component);
+	}
+
 
 	line_strip::line_strip(int style, const point coords[], int coord_count)
 	// Construct the line strip (polyline) made up of the given sequence of points.
@@ -838,6 +848,28 @@ namespace gameswf
 	}
 
 
+	int	mesh_set::get_bytes() const
+	{
+		int	bytes = sizeof(mesh_set);
+		for (int i = 0; i < m_layers.size(); i++)
+		{
+			const layer&	l = m_layers[i];
+			for (int j = 0; j < l.m_meshes.size(); j++)
+			{
+				if (l.m_meshes[j])
+				{
+					bytes += l.m_meshes[j]->get_bytes();
+				}
+			}
+			for (int j = 0; j < l.m_line_strips.size(); j++)
+			{
+				bytes += l.m_line_strips[j]->get_bytes();
+			}
+		}
+		return bytes;
+	}
+
+
 	void mesh_set::new_layer()
 	// Make room for a new layer.
 	{
@@ -1589,6 +1621,7 @@ namespace gameswf
 			{
 				// Do it.
 				candidate->display(mat, cx, fill_styles, line_styles, bm);
+				touch(get_cache_bytes() > 0 ? get_cache_bytes() : get_mesh_bytes());
 				return;
 			}
 		}
@@ -1599,6 +1632,18 @@ namespace gameswf
 		m->display(mat, cx, fill_styles, line_styles, bm);
 		
 		sort_and_clean_meshes();
+		touch(get_mesh_bytes());
+	}
+
+
+	int	shape_character_def::get_mesh_bytes() const
+	{
+		int	bytes = 0;
+		for (int i = 0; i < m_cached_meshes.size(); i++)
+		{
+			bytes += m_cached_meshes[i]->get_bytes();
+		}
+		return bytes;
 	}
 
 
@@ -1776,6 +1821,7 @@ namespace gameswf
 			}
 
 		m_cached_meshes.resize( 0 );
+		touch(0);
 	}
 
 
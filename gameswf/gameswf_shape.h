@@ -11,6 +11,7 @@
 
 
 #include "gameswf/gameswf_styles.h"
+#include "gameswf/gameswf_memory.h"
 
 
 namespace gameswf
@@ -84,6 +85,8 @@ namespace gameswf
 
 		void	display(const base_fill_style& style, float ratio, render_handler::bitmap_blend_mode bm) const;
 
+		int	get_bytes() const;
+
 		void	output_cached_data(tu_file* out);
 		void	input_cached_data(tu_file* in);
 	private:
@@ -101,6 +104,7 @@ namespace gameswf
 		void	display(const base_line_style& style, float ratio) const;
 
 		int	get_style() const { return m_style; }
+		int	get_bytes() const;
 		void	output_cached_data(tu_file* out);
 		void	input_cached_data(tu_file* in);
 	private:
@@ -128,6 +132,8 @@ namespace gameswf
 		void	add_line_strip(int style, const point coords[], int coord_count);
 
 		mesh* get_mutable_mesh(int style);
+
+		int	get_bytes() const;
 		
 		void	output_cached_data(tu_file* out);
 		void	input_cached_data(tu_file* in);
@@ -146,10 +152,20 @@ namespace gameswf
 	};
 
 
-	struct shape_character_def : public character_def, public tesselate::tesselating_shape
+	struct shape_character_def : public character_def, public tesselate::tesselating_shape, public memory_cache
 	// Represents the outline of one or more shapes, along with
 	// information on fill and line styles.
+	//
+	// The meshes it caches can be evicted, see gameswf_memory.h.
 	{
+		// Unique id of a gameswf resource
+		enum { m_class_id = AS_SHAPE_DEF };
+		virtual bool is(int class_id) const
+		{
+			if (m_class_id == class_id) return true;
+			else return character_def::is(class_id);
+		}
+
 		shape_character_def(player* player);
 		virtual ~shape_character_def();
 
@@ -181,6 +197,10 @@ namespace gameswf
 		void	set_bound(const rect& r) { m_bound = r; /* should do some verifying */ }
 		
 		void	flush_cache();
+		virtual void	evict() { flush_cache(); }
+
+		// Bytes of the cached meshes.
+		int	get_mesh_bytes() const;
 
 	protected:
 		friend struct morph2_character_def;
@@ -131,6 +131,10 @@ namespace gameswf
 				get_sample_rate(sample_rate),
 				stereo);
 			sound_sample*	sam = new sound_sample(m->get_player(), handler_id);
+			if (handler_id >= 0)
+			{
+				sam->m_bytes = data_bytes;
+			}
 			m->add_sound_sample(character_id, sam);
 
 			delete [] data;
@@ -32,10 +32,12 @@ namespace gameswf
 		}
 
 		int	m_sound_handler_id;
+		int	m_bytes;	// given to the sound handler
 
 		sound_sample(player* player, int id) :
 			character_def(player),
-			m_sound_handler_id(id)
+			m_sound_handler_id(id),
+			m_bytes(0)
 		{
 		}
 
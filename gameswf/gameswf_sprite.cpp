@@ -17,6 +17,8 @@
 #include "gameswf/gameswf_sprite.h"
 #include "gameswf/gameswf_as_sprite.h"
 #include "gameswf/gameswf_text.h"
+#include "gameswf/gameswf_profiler.h"
+#include "gameswf/gameswf_script_budget.h"
 #include "gameswf/gameswf_as_classes/as_string.h"
 
 namespace gameswf
@@ -69,31 +71,49 @@ namespace gameswf
 	}
 
 	void sprite_instance::get_bound(rect* bound)
+	// Cached until invalidate_bound() of us or of one of the
+	// characters we hold.
 	{
 		int i, n = m_display_list.size();
 		if (n == 0)
 		{
+			// Cached as empty, the next add_display_object()
+			// drops it.
+			m_bound_cached = true;
 			return;
 		}
 
-		bound->m_x_min = FLT_MAX;
-		bound->m_x_max = - FLT_MAX;
-		bound->m_y_min = FLT_MAX;
-		bound->m_y_max = - FLT_MAX;
-
-		matrix m = get_matrix();
-		for (i = 0; i < n; i++)
+		if (m_bound_cached == false)
 		{
-			character* ch = m_display_list.get_character(i);
-			if (ch != NULL)
+			m_bound.m_x_min = FLT_MAX;
+			m_bound.m_x_max = - FLT_MAX;
+			m_bound.m_y_min = FLT_MAX;
+			m_bound.m_y_max = - FLT_MAX;
+
+			const matrix& m = get_matrix();
+			for (i = 0; i < n; i++)
 			{
-				rect ch_bound;
-				ch->get_bound(&ch_bound);
+				character* ch = m_display_list.get_character(i);
+				if (ch != NULL)
+				{
+					rect ch_bound;
+					ch->get_bound(&ch_bound);
 
-				m.transform(&ch_bound);
+					m.transform(&ch_bound);
 
-				bound->expand_to_rect(ch_bound);
+					m_bound.expand_to_rect(ch_bound);
+				}
 			}
+			m_bound_cached = true;
+		}
+		*bound = m_bound;
+	}
+
+	void	sprite_instance::invalidate_children_world(int what)
+	{
+		for (int i = 0, n = m_display_list.size(); i < n; i++)
+		{
+			m_display_list.get_character(i)->invalidate_world(what);
 		}
 	}
 
@@ -166,6 +186,47 @@ namespace gameswf
 	}
 
 
+	static bool	hit_bound_test(const rect& bound, float x, float y)
+	// rect::point_test() with some slop: the characters test the
+	// point transformed into their frame, not their bound into
+	// ours.
+	{
+		const float	slop = 1.0f;	// twips
+		return x >= bound.m_x_min - slop && x <= bound.m_x_max + slop
+			&& y >= bound.m_y_min - slop && y <= bound.m_y_max + slop;
+	}
+
+	void	sprite_instance::get_hit_bound(rect* bound)
+	// Cached like get_bound().  The invisible characters count
+	// too, so showing or hiding one doesn't drop it.
+	{
+		if (m_hit_bound_cached == false)
+		{
+			m_hit_bound.m_x_min = FLT_MAX;
+			m_hit_bound.m_x_max = - FLT_MAX;
+			m_hit_bound.m_y_min = FLT_MAX;
+			m_hit_bound.m_y_max = - FLT_MAX;
+
+			const matrix& m = get_matrix();
+			for (int i = 0, n = m_display_list.size(); i < n; i++)
+			{
+				character* ch = m_display_list.get_character(i);
+				if (ch != NULL)
+				{
+					rect ch_bound;
+					ch->get_hit_bound(&ch_bound);
+					if (ch_bound.m_x_min <= ch_bound.m_x_max)
+					{
+						m.transform(&ch_bound);
+						m_hit_bound.expand_to_rect(ch_bound);
+					}
+				}
+			}
+			m_hit_bound_cached = true;
+		}
+		*bound = m_hit_bound;
+	}
+
 	bool sprite_instance::get_topmost_mouse_entity( character * &top_ent, float x, float y)
 	// Return the topmost entity that the given point
 	// covers that can receive mouse events.  NULL if
@@ -175,6 +236,16 @@ namespace gameswf
 			return NULL;
 		}
 
+		// The hit bounds, cached down the tree, skip whole
+		// subtrees the point is not over.
+		rect	hit_bound;
+		get_hit_bound(&hit_bound);
+		if (hit_bound_test(hit_bound, x, y) == false)
+		{
+			top_ent = NULL;
+			return false;
+		}
+
 		matrix	m = get_matrix();
 		point	p;
 		m.transform_by_inverse(&p, point(x, y));
@@ -879,9 +950,25 @@ namespace gameswf
 
 	// useful for catching of the calls
 	bool sprite_instance::set_member(const tu_stringi& name, const as_value& val)
+	{
+		int	atom;
+		as_standard_member	std_member = find_standard_member(name, &atom);
+		return set_member_std(atom, name, std_member, val);
+	}
+
+	bool sprite_instance::set_member_atom(int atom, const tu_stringi& name, const as_value& val)
+	{
+		atom_table*	atoms = get_player() ? get_player()->get_atoms() : NULL;
+		if (atoms == NULL || atom < 0 || atom >= atoms->size())
+		{
+			return set_member(name, val);
+		}
+		return set_member_std(atom, name, atom_table::get_standard_member(atom), val);
+	}
+
+	bool sprite_instance::set_member_std(int atom, const tu_stringi& name, as_standard_member std_member, const as_value& val)
 	{
 		// first try built-ins sprite properties
-		as_standard_member	std_member = get_standard_member(name);
 		switch (std_member)
 		{
 			default:
@@ -905,11 +992,12 @@ namespace gameswf
 				as_value new_val(val);
 				call_watcher(name, as_value(m_enabled), &new_val);
 				m_enabled = new_val.to_bool();
+				mouse_scene_changed();
 				return true;
 			}
 		}
 
-		return character::set_member(name, val);
+		return character::set_member_std(atom, name, std_member, val);
 	}
 
 	// Set *val to the value of the named member and
@@ -924,8 +1012,33 @@ namespace gameswf
 			return true;
 		}
 
+		int	atom;
+		as_standard_member	std_member = find_standard_member(name, &atom);
+		return get_member_std(atom, name, std_member, val);
+	}
+
+	bool sprite_instance::get_member_atom(int atom, const tu_stringi& name, as_value* val)
+	// The atom tells us whether name is a builtin method or a
+	// standard member without hashing it.
+	{
+		atom_table*	atoms = get_player() ? get_player()->get_atoms() : NULL;
+		if (atoms == NULL || atom < 0 || atom >= atoms->size())
+		{
+			return get_member(name, val);
+		}
+
+		if (atoms->is_builtin(atom, BUILTIN_SPRITE_METHOD)
+			&& get_builtin(BUILTIN_SPRITE_METHOD, name, val))
+		{
+			return true;
+		}
+
+		return get_member_std(atom, name, atom_table::get_standard_member(atom), val);
+	}
+
+	bool sprite_instance::get_member_std(int atom, const tu_stringi& name, as_standard_member std_member, as_value* val)
+	{
 		// then try built-ins sprite properties
-		as_standard_member	std_member = get_standard_member(name);
 		switch (std_member)
 		{
 			case M_ENABLED:
@@ -988,7 +1101,7 @@ namespace gameswf
 		}
 
 		// finally try standart character properties & movieclip variables
-		return character::get_member(name, val);
+		return character::get_member_std(atom, name, std_member, val);
 	}
 
 	void sprite_instance::call_frame_actions(const as_value& frame_spec)
@@ -1141,6 +1254,8 @@ namespace gameswf
 				}
 			}
 
+			as_profiler_scope	profile(this, id);
+			script_budget_scope	budget(this, id);
 			gameswf::call_method(method, &m_as_environment, this, nargs, 
 				m_as_environment.get_top_index());
 
@@ -1337,24 +1452,15 @@ namespace gameswf
 		return textfield;
 	}
 
-	void sprite_instance::clear_refs(hash<as_object*, bool>* visited_objects, as_object* this_ptr)
+	void sprite_instance::clear_refs(as_object_walk* walk, as_object* this_ptr)
 	{
-		// Is it a reentrance ?
-		if (visited_objects->get(this, NULL))
-		{
-			return;
-		}
-
-		// will be set in as_object::clear_refs
-//		visited_objects->set(this, true);
-
-		as_object::clear_refs(visited_objects, this_ptr);
+		as_object::clear_refs(walk, this_ptr);
 
 		// clear display list
-		m_display_list.clear_refs(visited_objects, this_ptr);
+		m_display_list.clear_refs(walk, this_ptr);
 
 		// clear self-refs from environment
-		m_as_environment.clear_refs(visited_objects, this_ptr);
+		m_as_environment.clear_refs(walk, this_ptr);
 	}
 
 	sprite_instance* sprite_instance::attach_movie(const tu_string& id, 
@@ -1478,6 +1584,10 @@ namespace gameswf
 			m_display_list.add_display_object( m_canvas.get_ptr(), get_highest_depth(),
 					true, m_color_transform, identity, 0.0f, 0, 0); 
 		}
+
+		// The caller is about to draw.
+		m_canvas->invalidate_bound();
+
 		return cast_to<canvas>(m_canvas->get_character_def());
 	}
 
@@ -62,6 +62,8 @@ namespace gameswf
 		bool m_enabled;
 		bool m_on_event_load_called;
 		gc_ptr<character> m_canvas;
+		rect	m_bound;	// valid if m_bound_cached
+		rect	m_hit_bound;	// valid if m_hit_bound_cached
 
 		// flash9
 		hash<int, gc_ptr<as_function> >* m_script;	// <frame, script>
@@ -86,6 +88,7 @@ namespace gameswf
 		movie_definition*	get_movie_definition() { return m_def.get_ptr(); }
 
 		virtual void get_bound(rect* bound);
+		virtual void	invalidate_children_world(int what);
 
 		virtual int	get_current_frame() const { return m_current_frame; }
 		virtual int	get_frame_count() const { return m_def->get_frame_count(); }
@@ -136,6 +139,7 @@ namespace gameswf
 
 		virtual bool can_handle_mouse_event();
 		virtual bool get_topmost_mouse_entity( character * &te, float x, float y);
+		virtual void	get_hit_bound(rect* bound);
 		void advance(float delta_time);
 
 		virtual void	alive();
@@ -184,6 +188,10 @@ namespace gameswf
 
 		virtual bool	set_member(const tu_stringi& name, const as_value& val);
 		virtual bool	get_member(const tu_stringi& name, as_value* val);
+		virtual bool	set_member_atom(int atom, const tu_stringi& name, const as_value& val);
+		virtual bool	get_member_atom(int atom, const tu_stringi& name, as_value* val);
+		bool	set_member_std(int atom, const tu_stringi& name, as_standard_member std_member, const as_value& val);
+		bool	get_member_std(int atom, const tu_stringi& name, as_standard_member std_member, as_value* val);
 		virtual void	call_frame_actions(const as_value& frame_spec);
 		virtual void	stop_drag();
 		character*	clone_display_object(const tu_string& newname, int depth);
@@ -200,7 +208,7 @@ namespace gameswf
 
 		character* create_text_field(const char* name, int depth, int x, int y, int width, int height);
 
-		virtual void clear_refs(hash<as_object*, bool>* visited_objects, as_object* this_ptr);
+		virtual void clear_refs(as_object_walk* walk, as_object* this_ptr);
 		virtual as_environment*	get_environment() { return &m_as_environment; }
 		virtual void dump(tu_string& tabs);
 
@@ -93,6 +93,9 @@ namespace gameswf
 		virtual bitmap_info*	get_bitmap_info(int i) const { assert(0); return NULL; }
 		virtual void	add_bitmap_info(bitmap_info* bi) { assert(0); }
 
+		// Our characters are in m_movie_def's dictionary.
+		virtual void	get_memory_stats(memory_stats* stats) const {}
+
 		virtual void	export_resource(const tu_string& symbol, character_def* res) { log_error("can't export from sprite\n"); }
 		virtual character_def*	get_exported_resource(const tu_string& sym) { return m_movie_def->get_exported_resource(sym); }
 		virtual void	add_import(const tu_string& source_url, int id, const tu_string& symbol) { assert(0); }
@@ -21,7 +21,9 @@
 #include "gameswf/gameswf_types.h"
 #include "gameswf/gameswf_impl.h"
 #include "gameswf/gameswf_root.h"
+#include "gameswf/gameswf_movie_def.h"
 #include "gameswf/gameswf_freetype.h"
+#include "gameswf/gameswf_memory.h"
 #include "gameswf/gameswf_player.h"
 
 #if TU_ENABLE_NETWORK == 1
@@ -59,7 +61,15 @@ void	print_usage()
 		"  -va         Be verbose about movie Actions\n"
 		"  -vp         Be verbose about parsing the movie\n"
 		"  -ml <bias>  Specify the texture LOD bias (float, default is -1)\n"
+		"  -ma         Print the allocations of each frame: those of the player's\n"
+		"              object pool, and tu_malloc/new when built with\n"
+		"              TU_MEMDEBUG_COUNT_ALLOCS\n"
+		"  -mb <bytes> Keep the meshes and glyph bitmaps under <bytes>, evicting\n"
+		"              the least recently used ones (0, the default, for no limit)\n"
+		"  -ms         Print the memory held by the movies each frame\n"
 		"  -p          Run full speed (no sleep) and log frame rate\n"
+		"  -pf <name>  Profile ActionScript; at exit writes <name>.folded (for\n"
+		"              flamegraph.pl) and <name>.frames (per frame summary)\n"
 		"  -1          Play once; exit when/if movie reaches the last frame\n"
 		"  -r <0|1|2>  0 disables rendering & sound (good for batch tests)\n"
 		"              1 enables rendering & sound (default setting)\n"
@@ -71,7 +81,21 @@ void	print_usage()
 		"  -k          Disables cursor\n"
 		"  -w <w>x<h>  Specify the window size, for example 1024x768\n"
 		"  -f          Force realtime framerate\n"
+		"  -gc <us>    Let the garbage collector take at most <us> microseconds of a\n"
+		"              frame for the long lived objects (default is 1000, 0 means\n"
+		"              no limit)\n"
 		"  -i          Grub bitmaps from swf file\n"
+		"  -j <0|1>    0 runs all ActionScript in the interpreter (default is 1,\n"
+		"              compile hot code when built with __GAMESWF_ENABLE_JIT__)\n"
+		"  -o <0|1>    1 enables the ActionScript optimizer (default is 0)\n"
+		"  -os         At exit, print what the optimizer did to the movie's actions,\n"
+		"              and how many ABC method bodies were ever decoded\n"
+		"  -sf <ms>    Let the ActionScript of a frame run for at most <ms> milliseconds\n"
+		"  -sc <n>     Let a frame script, event handler or callback run at most <n>\n"
+		"              actions\n"
+		"  -sp <a|y|w> What to do with scripts over the -sf/-sc budget: abort them\n"
+		"              (default), abort them and put off timers to the next frame\n"
+		"              (yield), or log a warning\n"
 		"\n"
 		"keys:\n"
 		"  CTRL-Q          Quit/Exit\n"
@@ -309,6 +333,11 @@ int	main(int argc, char *argv[])
 		bool	sdl_cursor = true;
 		float	tex_lod_bias;
 		bool	force_realtime_framerate = false;
+		tu_string	profile_name;
+		bool	print_optimizer_stats = false;
+		bool	print_allocs = false;
+		bool	print_memory = false;
+		gameswf::script_budget	script_budget;
 
 	#ifdef _WIN32
 
@@ -442,8 +471,27 @@ int	main(int argc, char *argv[])
 				}
 				else if (argv[arg][1] == 'p')
 				{
-					// Enable frame-rate/performance logging.
-					s_measure_performance = true;
+					if (argv[arg][2] == 'f')
+					{
+						// Enable the ActionScript profiler.
+						arg++;
+						if (arg < argc)
+						{
+							profile_name = argv[arg];
+							gameswf::set_profiling(true);
+						}
+						else
+						{
+							fprintf(stderr, "-pf must be followed by the name of the profile files\n");
+							print_usage();
+							exit(1);
+						}
+					}
+					else
+					{
+						// Enable frame-rate/performance logging.
+						s_measure_performance = true;
+					}
 				}
 				else if (argv[arg][1] == '1')
 				{
@@ -523,6 +571,28 @@ int	main(int argc, char *argv[])
 						tex_lod_bias = (float) atof(argv[arg]);
 						//printf("Texture LOD Bais is no %f\n", tex_lod_bias);
 					}
+					else if (argv[arg][2] == 'a')
+					{
+						print_allocs = true;
+					}
+					else if (argv[arg][2] == 'b')
+					{
+						arg++;
+						if (arg < argc)
+						{
+							gameswf::set_memory_budget(atoi(argv[arg]));
+						}
+						else
+						{
+							fprintf(stderr, "-mb must be followed by a number of bytes\n");
+							print_usage();
+							exit(1);
+						}
+					}
+					else if (argv[arg][2] == 's')
+					{
+						print_memory = true;
+					}
 					else
 					{
 						fprintf(stderr, "unknown variant of -m arg\n");
@@ -534,11 +604,102 @@ int	main(int argc, char *argv[])
 				{
 					s_allow_http = true;
 				}
+				else if (argv[arg][1] == 'g' && argv[arg][2] == 'c')
+				{
+					// Garbage collector budget.
+					arg++;
+					if (arg < argc)
+					{
+						player->set_gc_budget(atoi(argv[arg]));
+					}
+					else
+					{
+						fprintf(stderr, "-gc must be followed by a number of microseconds\n");
+						print_usage();
+						exit(1);
+					}
+				}
 				else if (argv[arg][1] == 'i')
 				{
 					player->set_separate_thread(false);
 					player->set_log_bitmap_info(true);
 				}
+				else if (argv[arg][1] == 'j')
+				{
+					// Enable/disable the JIT-compiler.
+					arg++;
+					if (arg < argc)
+					{
+						gameswf::set_use_jit(atoi(argv[arg]) != 0);
+					}
+					else
+					{
+						fprintf(stderr, "-j must be followed by 0 or 1 to disable/enable the JIT-compiler\n");
+						print_usage();
+						exit(1);
+					}
+				}
+				else if (argv[arg][1] == 'o')
+				{
+					if (argv[arg][2] == 's')
+					{
+						print_optimizer_stats = true;
+					}
+					else
+					{
+						// Enable/disable the ActionScript optimizer.
+						arg++;
+						if (arg < argc)
+						{
+							gameswf::set_optimize_actions(atoi(argv[arg]) != 0);
+						}
+						else
+						{
+							fprintf(stderr, "-o must be followed by 0 or 1 to disable/enable the ActionScript optimizer\n");
+							print_usage();
+							exit(1);
+						}
+					}
+				}
+				else if (argv[arg][1] == 's')
+				{
+					// Script budget.
+					char	option = argv[arg][2];
+					arg++;
+					if (arg >= argc)
+					{
+						fprintf(stderr, "-s%c must be followed by a value\n", option);
+						print_usage();
+						exit(1);
+					}
+
+					if (option == 'f')
+					{
+						script_budget.m_frame_ms = (float) atof(argv[arg]);
+					}
+					else if (option == 'c')
+					{
+						script_budget.m_call_actions = atoi(argv[arg]);
+					}
+					else if (option == 'p' && argv[arg][0] == 'a')
+					{
+						script_budget.m_policy = gameswf::script_budget::ABORT;
+					}
+					else if (option == 'p' && argv[arg][0] == 'y')
+					{
+						script_budget.m_policy = gameswf::script_budget::YIELD;
+					}
+					else if (option == 'p' && argv[arg][0] == 'w')
+					{
+						script_budget.m_policy = gameswf::script_budget::WARN;
+					}
+					else
+					{
+						fprintf(stderr, "unknown option -s%c %s\n", option, argv[arg]);
+						print_usage();
+						exit(1);
+					}
+				}
 			}
 			else
 			{
@@ -624,6 +785,7 @@ int	main(int argc, char *argv[])
 			{
 				exit(1);
 			}
+			m->set_script_budget(script_budget);
 
 			if (width == 0 || height == 0)
 			{
@@ -898,6 +1060,7 @@ int	main(int argc, char *argv[])
 									{
 										exit(1);
 									}
+									m->set_script_budget(script_budget);
 								}
 								else if (ctrl && (key == SDLK_LEFTBRACKET || key == SDLK_KP_MINUS))
 								{
@@ -1052,10 +1215,26 @@ int	main(int argc, char *argv[])
 
 				m->notify_mouse_state(mouse_x, mouse_y, mouse_buttons);
 
+				tu_memdebug::begin_frame();
+				gameswf::object_pool_stats	pool_start;
+				player->get_pool_stats(&pool_start);
+
 				Uint32 t_advance = tu_timer::get_ticks();
 				m->advance(delta_t * speed_scale);
 				t_advance = tu_timer::get_ticks() - t_advance;
 
+				if (print_allocs)
+				{
+					tu_memdebug::alloc_counts	frame;
+					tu_memdebug::end_frame(&frame);
+					gameswf::object_pool_stats	pool;
+					player->get_pool_stats(&pool);
+					printf("allocs: %d (%d reallocs, %d frees, %d bytes), pool: %d (%d reused, %d frees, %d live)\n",
+						frame.m_allocs, frame.m_reallocs, frame.m_frees, (int) frame.m_bytes,
+						pool.m_allocs - pool_start.m_allocs, pool.m_reused - pool_start.m_reused,
+						pool.m_frees - pool_start.m_frees, pool.m_live);
+				}
+
 				if (do_sound && sound)
 				{
 					sound->advance(delta_t * speed_scale);
@@ -1065,6 +1244,17 @@ int	main(int argc, char *argv[])
 				m->display();
 				t_display = tu_timer::get_ticks() - t_display;
 
+				if (print_memory)
+				{
+					gameswf::memory_stats	mem;
+					player->get_memory_stats(&mem);
+					gameswf::memory_cache_stats	caches;
+					gameswf::memory_cache::get_stats(&caches);
+					printf("memory: %d (bitmaps %d, meshes %d, glyphs %d, sounds %d, heap %d), caches: %d bytes in %d (%d evicted)\n",
+						mem.get_total(), mem.m_bitmaps, mem.m_meshes, mem.m_glyphs, mem.m_sounds, mem.m_heap,
+						caches.m_bytes, caches.m_caches, caches.m_evicted);
+				}
+
 				if (do_render)
 				{
 					Uint32 t_swap = tu_timer::get_ticks();
@@ -1124,6 +1314,33 @@ int	main(int argc, char *argv[])
 
 	done:
 
+			if (profile_name.length() > 0)
+			{
+				gameswf::write_profile((profile_name + ".folded").c_str());
+				gameswf::write_profile_summary((profile_name + ".frames").c_str());
+			}
+
+			if (print_optimizer_stats && m != NULL && m->m_def != NULL)
+			{
+				const gameswf::action_optimizer_stats&	stats = m->m_def->m_optimizer_stats;
+				printf("%s: %d frames/functions optimized, %d left alone (with blocks)\n",
+					infile, stats.m_regions, stats.m_skipped);
+				printf("  %d actions, %d unreachable bytes, max stack depth %d\n",
+					stats.m_actions, stats.m_dead_bytes, stats.m_max_stack_depth);
+				printf("  %d operations on constants folded, %d push_data merged, %d pushed then popped\n",
+					stats.m_folded, stats.m_merged, stats.m_dropped);
+				printf("  %d push_data fused with the next action, %d branches shortened\n",
+					stats.m_fused, stats.m_branches);
+
+				const gameswf::abc_def*	abc = m->m_def->get_abc();
+				if (abc)
+				{
+					gameswf::abc_body_stats	body_stats;
+					abc->get_body_stats(&body_stats);
+					printf("  ABC: %d of %d method bodies decoded (%d of %d bytes), the others were skipped at load\n",
+						body_stats.m_decoded, body_stats.m_bodies, body_stats.m_decoded_bytes, body_stats.m_bytes);
+				}
+			}
 
 			gameswf::set_sound_handler(NULL);
 			delete sound;
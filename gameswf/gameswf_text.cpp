@@ -1055,6 +1055,12 @@ namespace gameswf
 		return false; 
 	} 
 
+	void	edit_text_character::get_hit_bound(rect* bound)
+	{
+		*bound = m_def->m_rect;
+		get_matrix().transform(bound);
+	}
+
 	const tu_string&	edit_text_character::get_var_name() const
 	{
 		return m_def->m_var_name; 
@@ -1149,7 +1155,8 @@ namespace gameswf
 	// We have a "text" member.
 	{
 		// first try text field properties
-		as_standard_member	std_member = get_standard_member(name);
+		int	atom;
+		as_standard_member	std_member = find_standard_member(name, &atom);
 		switch (std_member)
 		{
 			default:
@@ -1219,14 +1226,15 @@ namespace gameswf
 				break;
 		}
 
-		return character::set_member(name, val);
+		return character::set_member_std(atom, name, std_member, val);
 	}
 
 
 	bool	edit_text_character::get_member(const tu_stringi& name, as_value* val)
 	{
 		// first try text field properties
-		as_standard_member	std_member = get_standard_member(name);
+		int	atom;
+		as_standard_member	std_member = find_standard_member(name, &atom);
 		switch (std_member)
 		{
 			default:
@@ -1278,7 +1286,7 @@ namespace gameswf
 
 		}
 
-		return character::get_member(name, val);
+		return character::get_member_std(atom, name, std_member, val);
 	}
 
 	// @@ WIDTH_FUDGE is a total fudge to make it match the Flash player!  Maybe
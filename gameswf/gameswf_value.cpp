@@ -12,10 +12,12 @@
 #include "gameswf/gameswf_character.h"
 #include "gameswf/gameswf_function.h"
 #include "gameswf/gameswf_movie_def.h"
+#include "gameswf/gameswf_pool.h"
 #include "gameswf/gameswf_as_classes/as_number.h"
 #include "gameswf/gameswf_as_classes/as_boolean.h"
 #include "gameswf/gameswf_as_classes/as_string.h"
 #include <float.h>
+#include <new>
 
 namespace gameswf
 {
@@ -50,27 +52,211 @@ namespace gameswf
 		return true;
 	}
 
+	// Shorter results of concat() are copied right away.
+	static const int	ROPE_MIN_LENGTH = 256;
+
+	// The out of line string of a STRING value.
+	//
+	// concat() makes a rope: a node that only refers to its two
+	// halves.  Building a long string piece by piece then costs
+	// one node per piece instead of a copy of everything so far.
+	// The rope is flattened into m_string the first time its
+	// characters are needed.
+	struct as_shared_string : public gc_object
+	{
+		mutable tu_string	m_string;
+		mutable gc_ptr<as_shared_string>	m_left;	// non-NULL while this is a rope
+		mutable gc_ptr<as_shared_string>	m_right;
+		int	m_length;
+
+		// From the object_pool, like as_object.
+		static void*	operator new(size_t size) { return object_pool::allocate(size); }
+		static void	operator delete(void* p) { object_pool::deallocate(p); }
+
+		as_shared_string(const char* str) : m_string(str) { m_length = m_string.length(); }
+		as_shared_string(const tu_string& str) : m_string(str) { m_length = m_string.length(); }
+		as_shared_string(as_shared_string* left, as_shared_string* right) :
+			m_left(left),
+			m_right(right),
+			m_length(left->m_length + right->m_length)
+		{
+		}
+
+		~as_shared_string()
+		{
+			// Take long ropes apart here, else each node
+			// would release the next one from its own
+			// destructor and a rope of a few 10k pieces
+			// would run out of stack.  The outermost
+			// destructor keeps the pieces on its stack and
+			// releases them one by one; the nodes that die
+			// meanwhile on the same thread only hand it
+			// their own pieces.
+			static thread_local array< gc_ptr<as_shared_string> >*	s_pieces = NULL;
+
+			if (m_left == NULL)
+			{
+				return;
+			}
+			if (s_pieces)
+			{
+				s_pieces->push_back(m_left);
+				s_pieces->push_back(m_right);
+				m_left = NULL;
+				m_right = NULL;
+				return;
+			}
+
+			array< gc_ptr<as_shared_string> >	pieces;
+			pieces.push_back(m_left);
+			pieces.push_back(m_right);
+			m_left = NULL;
+			m_right = NULL;
+
+			s_pieces = &pieces;
+			while (pieces.size() > 0)
+			{
+				// Drop the piece outside the array, so it
+				// can take more pieces.
+				gc_ptr<as_shared_string>	piece = pieces.back();
+				pieces.pop_back();
+				piece = NULL;
+			}
+			s_pieces = NULL;
+		}
+
+		const tu_string&	get() const
+		{
+			if (m_left != NULL)
+			{
+				flatten();
+			}
+			return m_string;
+		}
+
+		void	flatten() const
+		// Copy the pieces into m_string, left to right, and
+		// let go of them.
+		{
+			m_string.resize(m_length);
+
+			int	pos = 0;
+			array<const as_shared_string*>	pieces;
+			pieces.push_back(this);
+			while (pieces.size() > 0)
+			{
+				const as_shared_string*	piece = pieces.back();
+				pieces.pop_back();
+				if (piece->m_left == NULL)
+				{
+					memcpy(&m_string[pos], piece->m_string.c_str(), piece->m_length);
+					pos += piece->m_length;
+				}
+				else
+				{
+					pieces.push_back(piece->m_right.get());
+					pieces.push_back(piece->m_left.get());
+				}
+			}
+			assert(pos == m_length);
+
+			m_left = NULL;
+			m_right = NULL;
+		}
+	};
+
+	// A Number whose text was asked for, see as_value::m_boxed.
+	struct as_number_text : public as_shared_string
+	{
+		double	m_number;
+
+		as_number_text(const char* str, double number) :
+			as_shared_string(str),
+			m_number(number)
+		{
+		}
+	};
+
+	static as_shared_string*	concat_strings(as_shared_string* left, as_shared_string* right)
+	{
+		if (left->m_length == 0)
+		{
+			return right;
+		}
+		if (right->m_length == 0)
+		{
+			return left;
+		}
+		if (left->m_length + right->m_length < ROPE_MIN_LENGTH)
+		{
+			// Both are short, so they are not ropes.
+			as_shared_string*	str = new as_shared_string(left->m_string);
+			str->m_string += right->m_string;
+			str->m_length = str->m_string.length();
+			return str;
+		}
+		return new as_shared_string(left, right);
+	}
+
+	static const tu_string	s_undefined_string("undefined");
+	static const tu_string	s_null_string("null");
+	static const tu_string	s_true_string("true");
+	static const tu_string	s_false_string("false");
+
 	as_value::as_value(as_object* obj) :
 		m_type(OBJECT),
-		m_object(obj),
-		m_flags(0)
+		m_flags(0),
+		m_boxed(false),
+		m_atom(-1),
+		m_ref(obj)
 	{
 	}
 
 
 	as_value::as_value(as_s_function* func)	:
 		m_type(UNDEFINED),
-		m_flags(0)
+		m_flags(0),
+		m_boxed(false),
+		m_atom(-1)
 	{
 		set_as_object(func);
 	}
 
 	as_value::as_value(const as_value& getter, const as_value& setter) :
 		m_type(PROPERTY),
-		m_property_target(NULL),
-		m_flags(0)
+		m_flags(0),
+		m_boxed(false),
+		m_atom(-1),
+		m_ref(new as_property(getter, setter))
 	{
-		m_property = new as_property(getter, setter);
+	}
+
+	double	as_value::get_boxed_number() const
+	{
+		assert(m_type == NUMBER && m_boxed);
+		return static_cast<as_number_text*>(m_ref.get())->m_number;
+	}
+
+	as_object*	as_value::get_object() const
+	{
+		assert(m_type == OBJECT);
+		return static_cast<as_object*>(m_ref.get());
+	}
+
+	as_property*	as_value::get_property_ref() const
+	{
+		assert(m_type == PROPERTY);
+		return static_cast<as_property*>(m_ref.get());
+	}
+
+	void	as_value::set_ref(type t, gc_object* ref)
+	// Change to a value of type t that refers to ref.
+	{
+		// ref may be kept alive only by our old value.
+		ref_ptr	hold(ref);
+		drop_refs();
+		new (&m_ref) ref_ptr(std::move(hold));
+		m_type = t;
 	}
 
 	const char*	as_value::to_string() const
@@ -85,7 +271,7 @@ namespace gameswf
 		static char buf[16];
 		if (m_type == OBJECT)
 		{
-			snprintf(buf, 16, "0x%p", m_object.get());
+			snprintf(buf, 16, "0x%p", get_object());
 			return buf;
 		}
 		return to_tu_string().c_str();
@@ -104,13 +290,12 @@ namespace gameswf
 		switch (m_type)
 		{
 			case STRING:
-				// don't need to do anything
-				break;
+				return static_cast<as_shared_string*>(m_ref.get())->get();
 
 			case UNDEFINED:
 			{
 				// gameswf supports Flash9 only
-				m_string = "undefined";
+				return s_undefined_string;
 
 				// Behavior depends on file version.  In
 				// version 7+, it's "undefined", in versions
@@ -123,28 +308,34 @@ namespace gameswf
 //				{
 //					m_string = "undefined";
 //				}
-				break;
 			}
 
 			case BOOLEAN:
-				m_string = m_bool ? "true" : "false";
-				break;
+				return m_bool ? s_true_string : s_false_string;
 
 			case NUMBER:
 				// @@ Moock says if value is a NAN, then result is "NaN"
 				// INF goes to "Infinity"
 				// -INF goes to "-Infinity"
-				if (isnan(m_number))
-				{
-					m_string = "NaN";
-				} 
-				else
+				if (m_boxed == false)
 				{
-					char buffer[50];
-					snprintf(buffer, 50, "%.14g", m_number);
-					m_string = buffer;
+					// Box the number with its text, there
+					// is no room for both.
+					as_number_text*	text;
+					if (isnan(m_number))
+					{
+						text = new as_number_text("NaN", m_number);
+					} 
+					else
+					{
+						char buffer[50];
+						snprintf(buffer, 50, "%.14g", m_number);
+						text = new as_number_text(buffer, m_number);
+					}
+					new (&m_ref) ref_ptr(text);
+					m_boxed = true;
 				}
-				break;
+				return static_cast<as_number_text*>(m_ref.get())->m_string;
 
 			case OBJECT:
 				// Moock says, "the value that results from
@@ -152,28 +343,25 @@ namespace gameswf
 				//
 				// The default toString() returns "[object
 				// Object]" but may be customized.
-				if (m_object == NULL)
+				if (m_ref == NULL)
 				{
-					m_string = "null";
+					return s_null_string;
 				}
-				else
-				{
-					m_string = m_object->to_string();
-				}
-				break;
+				return get_object()->to_tu_string();
 	
 			case PROPERTY:
 			{
 				as_value val;
 				get_property(&val);
-				m_string = val.to_tu_string();
-				break;
+				as_property*	prop = get_property_ref();
+				prop->m_text = val.to_tu_string();
+				return prop->m_text;
 			}
 
 			default:
 				assert(0);
 		}
-		return m_string;
+		return s_undefined_string;
 	}
 
 	double	as_value::to_number() const
@@ -190,7 +378,7 @@ namespace gameswf
 				// Also, "Infinity", "-Infinity", and "NaN"
 				// are recognized.
 				double val;
-				if (! string_to_number(&val, m_string.c_str()))
+				if (! string_to_number(&val, to_tu_string().c_str()))
 				{
 					// Failed conversion to Number.
 					val = 0.0;	// TODO should be NaN
@@ -199,15 +387,15 @@ namespace gameswf
 			}
 
 			case NUMBER:
-				return m_number;
+				return get_number();
 
 			case BOOLEAN:
 				return m_bool ? 1 : 0;
 
 			case OBJECT:
-				if (m_object)
+				if (m_ref != NULL)
 				{
-					return m_object->to_number();
+					return get_object()->to_number();
 				}
 	 			// Evan: from my tests
 				return 0;
@@ -238,7 +426,7 @@ namespace gameswf
 			case STRING:
 
 				// gameswf supports Flash9 only
-				return m_string.size() > 0 ? true : false;
+				return to_tu_string().size() > 0 ? true : false;
 
 				// From Moock
 /*				if (get_root()->get_movie_version() >= 7)
@@ -266,9 +454,9 @@ namespace gameswf
 				}*/
 
 			case OBJECT:
-				if (m_object)
+				if (m_ref != NULL)
 				{
-					return m_object->to_bool();
+					return get_object()->to_bool();
 				}
 				return false;
 
@@ -280,7 +468,7 @@ namespace gameswf
 			}
 
 			case NUMBER:
-				return m_number != 0;
+				return get_number() != 0;
 
 			case BOOLEAN:
 				return m_bool;
@@ -301,7 +489,7 @@ namespace gameswf
 		switch (m_type)
 		{
 			case OBJECT:
-				return m_object;
+				return get_object();
 
 			case PROPERTY:
 			{
@@ -322,7 +510,7 @@ namespace gameswf
 		switch (m_type)
 		{
 			case OBJECT:
-				return cast_to<as_function>(m_object);
+				return cast_to<as_function>(get_object());
 
 			case PROPERTY:
 			{
@@ -339,16 +527,19 @@ namespace gameswf
 
 	void	as_value::set_as_object(as_object* obj)
 	{
-		if (m_type != OBJECT || m_object != obj)
+		if (m_type != OBJECT || m_ref != obj)
 		{
-			drop_refs();
-			m_type = OBJECT;
-			m_object = obj;
+			set_ref(OBJECT, obj);
 		}
 	}
 
 	void	as_value::operator=(const as_value& v)
 	{
+		if (this == &v)
+		{
+			return;
+		}
+
 		switch (v.m_type)
 		{
 			case UNDEFINED:
@@ -356,7 +547,7 @@ namespace gameswf
 				break;
 
 			case NUMBER:
-				set_double(v.m_number);
+				set_double(v.get_number());
 				m_flags = v.m_flags;
 				break;
 
@@ -366,27 +557,26 @@ namespace gameswf
 				break;
 
 			case STRING:
-				set_tu_string(v.m_string);
+				// strings are immutable, share it
+				set_ref(STRING, v.m_ref);
+				m_atom = v.m_atom;
 				m_flags = v.m_flags;
 				break;
 
 			case OBJECT:
-				set_as_object(v.m_object);
+				set_as_object(v.get_object());
 				m_flags = v.m_flags;
 				break;
 
 			case PROPERTY:
-				drop_refs(); 
-				
 				// is binded property ?
-				if (v.m_property_target == NULL)
+				if (v.get_property_ref()->m_target == NULL)
 				{
-					m_type = PROPERTY;
-					m_property = v.m_property;
-					m_property_target = NULL;
+					set_ref(PROPERTY, v.m_ref);
 				}
 				else
 				{
+					drop_refs(); 
 					v.get_property(this);
 				}
 				m_flags = v.m_flags;
@@ -417,16 +607,20 @@ namespace gameswf
 				return v.m_type == UNDEFINED;
 
 			case STRING:
-				return m_string == v.to_tu_string();
+				if (v.m_type == STRING && m_ref == v.m_ref)
+				{
+					return true;
+				}
+				return to_tu_string() == v.to_tu_string();
 
 			case NUMBER:
-				return m_number == v.to_number();
+				return get_number() == v.to_number();
 
 			case BOOLEAN:
 				return m_bool == v.to_bool();
 
 			case OBJECT:
-				return m_object.get() == v.to_object();
+				return get_object() == v.to_object();
 
 			case PROPERTY:
 			{
@@ -451,37 +645,47 @@ namespace gameswf
 	void	as_value::drop_refs()
 	// Drop any ref counts we have; this happens prior to changing our value.
 	{
-		m_object = NULL;
-		m_property = NULL;
-		m_property_target = NULL;
-
+		if (has_ref())
+		{
+			// Let go of the ref once we are undefined, in
+			// case its destructor looks at us.
+			ref_ptr	ref(std::move(m_ref));
+			m_ref.~ref_ptr();
+			m_type = UNDEFINED;
+			m_boxed = false;
+			m_flags = 0;
+			return;
+		}
+		m_type = UNDEFINED;
 		m_flags = 0;
 	}
 
 	void	as_value::set_property(const as_value& val)
 	{
 		assert(is_property());
-		m_property->set(m_property_target, val);
+		as_property*	prop = get_property_ref();
+		prop->set(prop->m_target, val);
 	}
 
 	// get property of primitive value, like Number
 	void as_value::get_property(const as_value& primitive, as_value* val) const
 	{
 		assert(is_property());
-		m_property->get(primitive, val);
+		get_property_ref()->get(primitive, val);
 	}
 
 	void as_value::get_property(as_value* val) const
 	{
 		assert(is_property());
-		m_property->get(m_property_target, val);
+		as_property*	prop = get_property_ref();
+		prop->get(prop->m_target, val);
 	}
 
 	as_property* as_value::to_property() const
 	{
 		if (is_property())
 		{
-			return m_property;
+			return get_property_ref();
 		}
 		return NULL;
 	}
@@ -490,7 +694,7 @@ namespace gameswf
 	{
 		if (is_property())
 		{
-			return m_property_target;
+			return get_property_ref()->m_target.get_ptr();
 		}
 		return NULL;
 	}
@@ -499,27 +703,39 @@ namespace gameswf
 	// Sets the target to the given object.
 	{
 		assert(is_property());
-		m_property_target = target;
+		as_property*	prop = get_property_ref();
+		if (prop->m_target != target)
+		{
+			// The property may be shared by other values, bind
+			// a copy.
+			set_ref(PROPERTY, new as_property(*prop, target));
+		}
 	}
 
 	as_value::as_value(float val) :
 		m_type(UNDEFINED),
-		m_flags(0)
+		m_flags(0),
+		m_boxed(false),
+		m_atom(-1)
 	{
 		set_double(val);
 	}
 
 	as_value::as_value(int val) :
 		m_type(UNDEFINED),
-		m_flags(0)
+		m_flags(0),
+		m_boxed(false),
+		m_atom(-1)
 	{
 		set_double(val);
 	}
 
 	as_value::as_value(double val) :
 		m_type(NUMBER),
-		m_number(val),
-		m_flags(0)
+		m_flags(0),
+		m_boxed(false),
+		m_atom(-1),
+		m_number(val)
 	{
 	}
 
@@ -532,8 +748,10 @@ namespace gameswf
 
 	as_value::as_value(bool val) :
 		m_type(BOOLEAN),
-		m_bool(val),
-		m_flags(0)
+		m_flags(0),
+		m_boxed(false),
+		m_atom(-1),
+		m_bool(val)
 	{
 	}
 
@@ -549,14 +767,16 @@ namespace gameswf
 	{
 		if (m_type == OBJECT)
 		{
-			return cast_to<as_function>(m_object) ? true : false;
+			return cast_to<as_function>(get_object()) ? true : false;
 		}
 		return false;
 	}
 
 	as_value::as_value(as_c_function_ptr func) :
 		m_type(UNDEFINED),
-		m_flags(0)
+		m_flags(0),
+		m_boxed(false),
+		m_atom(-1)
 	{
 		set_as_c_function(func);
 	}
@@ -612,9 +832,9 @@ namespace gameswf
 			}
 
 			case OBJECT:
-				if (m_object)
+				if (m_ref != NULL)
 				{
-					return m_object->is_instance_of(constructor);
+					return get_object()->is_instance_of(constructor);
 				}
 				break;
 
@@ -648,9 +868,9 @@ namespace gameswf
 				return "boolean";
 
 			case OBJECT:
-				if (m_object)
+				if (m_ref != NULL)
 				{
-					return m_object->type_of();
+					return get_object()->type_of();
 				}
 				return "null";
 
@@ -693,9 +913,9 @@ namespace gameswf
 
 			case OBJECT:
 			{
-				if (m_object)
+				if (m_ref != NULL)
 				{
-					return m_object->get_member(name, val);
+					return get_object()->get_member(name, val);
 				}
 			}
 		}
@@ -749,9 +969,9 @@ namespace gameswf
 
 		case OBJECT:
 			{
-				if (m_object)
+				if (m_ref != NULL)
 				{
-					return m_object->find_property(name, val);
+					return get_object()->find_property(name, val);
 				}
 			}
 		}
@@ -760,46 +980,122 @@ namespace gameswf
 
 	void	as_value::set_tu_string(const tu_string& str)
 	{
-		drop_refs();
-		m_type = STRING;
-		m_string = str; 
+		// str may be our own string
+		set_ref(STRING, new as_shared_string(str));
+		m_atom = -1;
 	}
 	
 	void	as_value::set_string(const char* str)
 	{
-		drop_refs();
-		m_type = STRING;
-		m_string = str; 
+		set_ref(STRING, new as_shared_string(str));
+		m_atom = -1;
+	}
+
+	void	as_value::concat(const as_value& v)
+	// Append v to our string value (we're converted to a string
+	// first).  Long results are ropes, see as_shared_string.
+	{
+		// v may be this.
+		gc_ptr<as_shared_string>	left = m_type == STRING ?
+			static_cast<as_shared_string*>(m_ref.get()) : new as_shared_string(to_tu_string());
+		gc_ptr<as_shared_string>	right = v.m_type == STRING ?
+			static_cast<as_shared_string*>(v.m_ref.get()) : new as_shared_string(v.to_tu_string());
+		set_ref(STRING, concat_strings(left.get(), right.get()));
+		m_atom = -1;
 	}
 	
 	as_value::as_value(const char* str) :
 		m_type(STRING),
-		m_string(str),
-		m_flags(0)
+		m_flags(0),
+		m_boxed(false),
+		m_atom(-1),
+		m_ref(new as_shared_string(str))
 	{
 	}
 
 	as_value::as_value(const wchar_t* wstr)	:
-		m_type(STRING),
-		m_flags(0)
+		m_type(UNDEFINED),
+		m_flags(0),
+		m_boxed(false),
+		m_atom(-1)
 	{
 		// Encode the string value as UTF-8.
-		tu_string::encode_utf8_from_wchar(&m_string, wstr);
+		tu_string	str;
+		tu_string::encode_utf8_from_wchar(&str, wstr);
+		set_ref(STRING, new as_shared_string(str));
 	}
 
 	as_value::as_value() :
 		m_type(UNDEFINED),
-		m_flags(0)
+		m_flags(0),
+		m_boxed(false),
+		m_atom(-1)
 	{
+		// A word of type, flags and atom, and a word of payload.
+		compiler_assert(sizeof(as_value) == 16);
 	}
 
 	as_value::as_value(const as_value& v) :
 		m_type(UNDEFINED),
-		m_flags(0)
+		m_flags(0),
+		m_boxed(false),
+		m_atom(-1)
 	{
 		*this = v;
 	}
 
+	as_value::as_value(as_value&& v) :
+		m_type(UNDEFINED),
+		m_flags(0),
+		m_boxed(false),
+		m_atom(-1)
+	{
+		*this = (as_value&&) v;
+	}
+
+	void	as_value::operator=(as_value&& v)
+	// Take v's value and leave v undefined.
+	{
+		if (this == &v)
+		{
+			return;
+		}
+
+		if (v.m_type == PROPERTY && v.get_property_ref()->m_target != NULL)
+		{
+			// binded properties are copied by value
+			*this = (const as_value&) v;
+			return;
+		}
+
+		// v is done with before we drop our refs, which may
+		// free v's owner.
+		Uint8	type = v.m_type;
+		Uint8	flags = v.m_flags;
+		bool	boxed = v.m_boxed;
+		int	atom = v.m_atom;
+		if (v.has_ref())
+		{
+			// Moved, so the ref count isn't touched.
+			ref_ptr	ref(std::move(v.m_ref));
+			v.drop_refs();
+			drop_refs();
+			new (&m_ref) ref_ptr(std::move(ref));
+		}
+		else
+		{
+			double	payload;
+			memcpy(&payload, &v.m_number, sizeof(payload));
+			v.drop_refs();
+			drop_refs();
+			memcpy(&m_number, &payload, sizeof(m_number));
+		}
+		m_type = type;
+		m_flags = flags;
+		m_boxed = boxed;
+		m_atom = atom;
+	}
+
 	bool as_value::abstract_equality_comparison( const as_value & first, const as_value & second )
 	{
 		if (first.type_of() == second.type_of())
@@ -873,6 +1169,13 @@ namespace gameswf
 		m_setter = cast_to<as_function>(setter.to_object());
 	}
 
+	as_property::as_property(const as_property& prop, as_object* target) :
+		m_getter(prop.m_getter),
+		m_setter(prop.m_setter),
+		m_target(target)
+	{
+	}
+
 	as_property::~as_property()
 	{
 	}
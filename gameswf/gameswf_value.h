@@ -31,8 +31,13 @@ namespace gameswf
 	{
 		gc_ptr<as_function>	m_getter;
 		gc_ptr<as_function>	m_setter;
+		gc_ptr<as_object>	m_target;	// NULL unless bound, see as_value::set_property_target()
+
+		// The result of as_value::to_tu_string().
+		tu_string	m_text;
 
 		as_property(const as_value& getter,	const as_value& setter);
+		as_property(const as_property& prop, as_object* target);
 		~as_property();
 	
 		void	set(as_object* target, const as_value& val);
@@ -61,27 +66,50 @@ namespace gameswf
 			OBJECT,
 			PROPERTY
 		};
-		type	m_type;
+		// Values are kept small (two words) since they fill
+		// the vm stack, arrays and member tables.  Strings live
+		// out of line and are shared between copies, so copying
+		// a value is at most a ref count.  The text that
+		// to_tu_string() returns is kept by the object or the
+		// property, and by a box for numbers (see m_boxed).
+		Uint8	m_type;
+
+		// Numeric flags
+		mutable Uint8 m_flags;
+
+		// NUMBER: m_ref holds the number and its text instead
+		// of m_number, once to_tu_string() has been called.
+		mutable bool	m_boxed;
 
-		mutable tu_string	m_string;
+		int m_atom;	// STRING: atom of the player's atom_table, or -1
+
+		typedef gc_ptr<gc_object>	ref_ptr;
 		union
 		{
-			double m_number;
+			double m_number;	// NUMBER, unless m_boxed
 			bool m_bool;
+
+			// STRING: the as_shared_string
+			// OBJECT: the as_object
+			// PROPERTY: the as_property
+			// NUMBER, if m_boxed: the as_number_text
+			//
+			// Constructed only while has_ref().
+			mutable ref_ptr m_ref;
 		};
 
-		gc_ptr<as_object> m_object;
-		gc_ptr<as_object> m_property_target;
-		gc_ptr<as_property> m_property;
-		
-		// Numeric flags
-		mutable int m_flags;
+		inline bool	has_ref() const { return m_type > NUMBER || m_boxed; }
+		double	get_boxed_number() const;
+		as_object*	get_object() const;
+		as_property*	get_property_ref() const;
+		void	set_ref(type t, gc_object* ref);
 
 	public:
 
 		// constructors
 		exported_module as_value();
 		exported_module as_value(const as_value& v);
+		exported_module as_value(as_value&& v);
 		exported_module as_value(const char* str);
 		exported_module as_value(const wchar_t* wstr);
 		exported_module as_value(bool val);
@@ -95,7 +123,12 @@ namespace gameswf
 
 		~as_value() { drop_refs(); }
 
-		// Useful when changing types/values.
+		// Whether array<> can move it by bitwise copy; see
+		// tu_is_relocatable in container.h.
+		enum { is_relocatable = ref_ptr::is_relocatable };
+
+		// Drops our refs and leaves us undefined.  Useful when
+		// changing types/values.
 		exported_module void	drop_refs();
 
 		// for debuging
@@ -117,15 +150,41 @@ namespace gameswf
 		// more likely to get a warning/error if misused.
 		exported_module void	set_tu_string(const tu_string& str);
 		exported_module void	set_string(const char* str);
+		exported_module void	concat(const as_value& v);
 		exported_module void	set_double(double val);
 		exported_module void	set_bool(bool val);
 		exported_module void	set_int(int val) { set_double(val); }
 		exported_module void	set_nan() { set_double(get_nan()); }
+
+		// The value of a Number, see is_numeric().
+		inline double	get_number() const
+		{
+			assert(m_type == NUMBER);
+			return m_boxed ? get_boxed_number() : m_number;
+		}
+
+		// Same as set_double(), but done in place when this is a
+		// Number already (the usual case in numeric code).
+		inline void	set_number(double val)
+		{
+			if (m_type == NUMBER && m_flags == 0 && m_boxed == false)
+			{
+				m_number = val;
+			}
+			else
+			{
+				set_double(val);
+			}
+		}
 		exported_module void	set_as_object(as_object* obj);
 		exported_module void	set_as_c_function(as_c_function_ptr func);
-		exported_module void	set_undefined() { drop_refs(); m_type = UNDEFINED; }
+		exported_module void	set_undefined() { drop_refs(); }
 		exported_module void	set_null() { set_as_object(NULL); }
 
+		// Interned strings, see atom_table.
+		int	get_atom() const { return m_type == STRING ? m_atom : -1; }
+		void	set_atom(int atom) { assert(m_type == STRING); m_atom = atom; }
+
 		void	set_property(const as_value& val);
 		void	get_property(as_value* val) const;
 		void	get_property(const as_value& primitive, as_value* val) const;
@@ -133,6 +192,7 @@ namespace gameswf
 		void	set_property_target(as_object* new_target);
 
 		exported_module void	operator=(const as_value& v);
+		exported_module void	operator=(as_value&& v);
 		exported_module bool	operator==(const as_value& v) const;
 		exported_module bool	operator!=(const as_value& v) const;
 		exported_module bool	operator<(double v) const { return to_number() < v; }
@@ -150,10 +210,11 @@ namespace gameswf
 		bool is_function() const;
 		inline bool is_bool() const { return m_type == BOOLEAN; }
 		inline bool is_string() const { return m_type == STRING; }
-		inline bool is_number() const { return m_type == NUMBER && isnan(m_number) == false; }
+		inline bool is_number() const { return m_type == NUMBER && isnan(get_number()) == false; }
+		inline bool is_numeric() const { return m_type == NUMBER; }	// NaN too
 		inline bool is_object() const { return m_type == OBJECT; }
 		inline bool is_property() const { return m_type == PROPERTY; }
-		inline bool is_null() const { return m_type == OBJECT && m_object == NULL; }
+		inline bool is_null() const { return m_type == OBJECT && m_ref == NULL; }
 		inline bool is_undefined() const { return m_type == UNDEFINED; }
 
 		const char* type_of() const;
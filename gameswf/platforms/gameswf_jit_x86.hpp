@@ -160,6 +160,69 @@ void jit_pushi( jit_function & function, double value )
 }
 
 
+// Helper threading, see gameswf_jit_opcode.h.  The context is kept in esi.
+// The frame keeps esp 16 bytes aligned at the helper calls.
+
+void jit_enter( jit_function & function )
+{
+	jit_push( function, jit_ebp );
+	jit_mov( function, jit_ebp, jit_esp );
+	jit_push( function, jit_esi );
+	jit_load( function, jit_esi, jit_getarg( 0 ) );
+	jit_subi( function, jit_esp, 12 );
+}
+
+void jit_leave( jit_function & function )
+{
+	jit_lea( function, jit_esp, jit_register_offset_address( jit_ebp, -4 ) );
+	jit_pop( function, jit_esi );
+	jit_pop( function, jit_ebp );
+	jit_ret( function );
+}
+
+void jit_call_helper( jit_function & function, jit_helper helper, intptr_t arg )
+{
+	jit_add_bytecode_u8( function, 0x68 );	// push imm32
+	jit_add_bytecode_u32( function, arg );
+	jit_push( function, jit_esi );
+	jit_call( function, helper );
+	jit_add_bytecode_u8( function, 0x83 );	// add esp, 8
+	jit_add_bytecode_u8( function, 0xC4 );
+	jit_add_bytecode_u8( function, 8 );
+}
+
+void jit_load_result( jit_function & function, int value )
+{
+	jit_add_bytecode_u8( function, 0xB8 | jit_result );	// mov eax, imm32
+	jit_add_bytecode_u32( function, value );
+}
+
+void jit_jump( jit_function & function, int label )
+{
+	jit_add_bytecode_u8( function, 0xE9 );	// jmp rel32
+	function.add_label_patch( label );
+}
+
+void jit_jump_if( jit_function & function, jit_condition condition, int label )
+{
+	static const uint8 jcc[] = { 0x84, 0x85, 0x88 };	// jz, jnz, js
+
+	jit_add_bytecode_u8( function, 0x85 );	// test eax, eax
+	jit_add_bytecode_u8( function, 0xC0 );
+	jit_add_bytecode_u8( function, 0x0F );
+	jit_add_bytecode_u8( function, jcc[ condition ] );
+	function.add_label_patch( label );
+}
+
+void jit_jump_if_result( jit_function & function, int value, int label )
+{
+	jit_add_bytecode_u8( function, 0x3D );	// cmp eax, imm32
+	jit_add_bytecode_u32( function, value );
+	jit_add_bytecode_u8( function, 0x0F );	// je rel32
+	jit_add_bytecode_u8( function, 0x84 );
+	function.add_label_patch( label );
+}
+
 #define jit_pushi( _function_, _value_ ) \
 { \
 	if( jit_is_8bit( _value_ ) ) \
@@ -0,0 +1,72 @@
+// gameswf_jit_x86_64.h
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// Jit x86-64, System V calling convention (Win64 where it differs)
+
+#ifndef GAMESWF_JIT_X86_64_H
+#define GAMESWF_JIT_X86_64_H
+
+enum jit_register
+{
+	jit_rax = 0,
+	jit_rcx = 1,
+	jit_rdx = 2,
+	jit_rbx = 3,
+	jit_rsp = 4,
+	jit_rbp = 5,
+	jit_rsi = 6,
+	jit_rdi = 7,
+	jit_r8 = 8,
+	jit_r9 = 9,
+	jit_r10 = 10,
+	jit_r11 = 11,
+	jit_r12 = 12,
+	jit_r13 = 13,
+	jit_r14 = 14,
+	jit_r15 = 15
+};
+
+template<typename T> void* cast_to_voidp( T value )
+{
+	union
+	{
+		T _value;
+		void * _voidp;
+	} cast;
+
+	cast._value = value;
+	return cast._voidp;
+}
+
+#ifdef _WIN32
+#	define jit_arg0 jit_rcx
+#	define jit_arg1 jit_rdx
+#	define jit_shadow_space 32
+#else
+#	define jit_arg0 jit_rdi
+#	define jit_arg1 jit_rsi
+#	define jit_shadow_space 0
+#endif
+
+#define jit_context_register jit_rbx	// callee-saved in both conventions
+#define jit_result jit_rax
+#define jit_stack_pointer jit_rsp
+
+#define jit_add_bytecode_u8( _function_, _value_ ) { _function_.push_byte( static_cast<unsigned char>( _value_ ) ); }
+#define jit_add_bytecode_u32( _function_, _value_ ) { _function_.push_integer( (unsigned int)( _value_ ) ); }
+
+#define jit_ret( _function_ ) jit_add_bytecode_u8( _function_, 0xC3 )
+
+// Implementations
+
+void jit_push( jit_function & function, const jit_register source );
+void jit_pop( jit_function & function, const jit_register destination );
+void jit_mov( jit_function & function, const jit_register destination, const jit_register source );
+void jit_movi( jit_function & function, const jit_register destination, const intptr_t value );
+void jit_addi( jit_function & function, const jit_register destination, const int value );
+void jit_subi( jit_function & function, const jit_register destination, const int value );
+void jit_call_register( jit_function & function, const jit_register address );
+
+#endif
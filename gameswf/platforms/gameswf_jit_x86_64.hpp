@@ -0,0 +1,168 @@
+// gameswf_jit_x86_64.hpp
+
+// This source code has been donated to the Public Domain.  Do
+// whatever you want with it.
+
+// Jit x86-64
+
+static uint8 jit_rex( bool wide, const jit_register reg, const jit_register rm )
+{
+	return 0x40 | ( wide ? 0x08 : 0 ) | ( ( reg >> 3 ) << 2 ) | ( rm >> 3 );
+}
+
+static uint8 jit_modrm_direct( int reg, const jit_register rm )
+{
+	return 0xC0 | ( ( reg & 7 ) << 3 ) | ( rm & 7 );
+}
+
+static void jit_push_integer64( jit_function & function, uint64 value )
+{
+	function.push_integer( (uint32) value );
+	function.push_integer( (uint32) ( value >> 32 ) );
+}
+
+void jit_push( jit_function & function, const jit_register source )
+{
+	if( source >= jit_r8 )
+	{
+		jit_add_bytecode_u8( function, 0x41 );
+	}
+	jit_add_bytecode_u8( function, 0x50 | ( source & 7 ) );
+}
+
+void jit_pop( jit_function & function, const jit_register destination )
+{
+	if( destination >= jit_r8 )
+	{
+		jit_add_bytecode_u8( function, 0x41 );
+	}
+	jit_add_bytecode_u8( function, 0x58 | ( destination & 7 ) );
+}
+
+void jit_mov( jit_function & function, const jit_register destination, const jit_register source )
+{
+	jit_add_bytecode_u8( function, jit_rex( true, source, destination ) );
+	jit_add_bytecode_u8( function, 0x89 );	// mov Ev, Gv
+	jit_add_bytecode_u8( function, jit_modrm_direct( source, destination ) );
+}
+
+void jit_movi( jit_function & function, const jit_register destination, const intptr_t value )
+{
+	if( value == (int32) value )
+	{
+		// mov r64, simm32
+		jit_add_bytecode_u8( function, jit_rex( true, jit_rax, destination ) );
+		jit_add_bytecode_u8( function, 0xC7 );
+		jit_add_bytecode_u8( function, jit_modrm_direct( 0, destination ) );
+		jit_add_bytecode_u32( function, value );
+	}
+	else
+	{
+		// mov r64, imm64
+		jit_add_bytecode_u8( function, jit_rex( true, jit_rax, destination ) );
+		jit_add_bytecode_u8( function, 0xB8 | ( destination & 7 ) );
+		jit_push_integer64( function, (uint64) value );
+	}
+}
+
+static void jit_arithmetic_immediate( jit_function & function, int extension, const jit_register destination, const int value )
+{
+	jit_add_bytecode_u8( function, jit_rex( true, jit_rax, destination ) );
+	if( value <= 127 && value >= -128 )
+	{
+		jit_add_bytecode_u8( function, 0x83 );
+		jit_add_bytecode_u8( function, jit_modrm_direct( extension, destination ) );
+		jit_add_bytecode_u8( function, value );
+	}
+	else
+	{
+		jit_add_bytecode_u8( function, 0x81 );
+		jit_add_bytecode_u8( function, jit_modrm_direct( extension, destination ) );
+		jit_add_bytecode_u32( function, value );
+	}
+}
+
+void jit_addi( jit_function & function, const jit_register destination, const int value )
+{
+	jit_arithmetic_immediate( function, 0, destination, value );
+}
+
+void jit_subi( jit_function & function, const jit_register destination, const int value )
+{
+	jit_arithmetic_immediate( function, 5, destination, value );
+}
+
+void jit_call_register( jit_function & function, const jit_register address )
+{
+	if( address >= jit_r8 )
+	{
+		jit_add_bytecode_u8( function, 0x41 );
+	}
+	jit_add_bytecode_u8( function, 0xFF );	// call Ev
+	jit_add_bytecode_u8( function, jit_modrm_direct( 2, address ) );
+}
+
+// Helper threading, see gameswf_jit_opcode.h.  The context is kept in
+// rbx.  Pushing rbx realigns rsp on 16 bytes for the helper calls.
+
+void jit_enter( jit_function & function )
+{
+	jit_push( function, jit_context_register );
+	jit_mov( function, jit_context_register, jit_arg0 );
+	if( jit_shadow_space )
+	{
+		jit_subi( function, jit_stack_pointer, jit_shadow_space );
+	}
+}
+
+void jit_leave( jit_function & function )
+{
+	if( jit_shadow_space )
+	{
+		jit_addi( function, jit_stack_pointer, jit_shadow_space );
+	}
+	jit_pop( function, jit_context_register );
+	jit_ret( function );
+}
+
+void jit_call_helper( jit_function & function, jit_helper helper, intptr_t arg )
+{
+	// Helpers may live anywhere in the address space, so call
+	// through a register rather than with a 32 bits displacement.
+	jit_mov( function, jit_arg0, jit_context_register );
+	jit_movi( function, jit_arg1, arg );
+	jit_movi( function, jit_rax, (intptr_t) cast_to_voidp( helper ) );
+	jit_call_register( function, jit_rax );
+}
+
+void jit_load_result( jit_function & function, int value )
+{
+	jit_add_bytecode_u8( function, 0xB8 );	// mov eax, imm32
+	jit_add_bytecode_u32( function, value );
+}
+
+void jit_jump( jit_function & function, int label )
+{
+	jit_add_bytecode_u8( function, 0xE9 );	// jmp rel32
+	function.add_label_patch( label );
+}
+
+void jit_jump_if( jit_function & function, jit_condition condition, int label )
+{
+	static const uint8 jcc[] = { 0x84, 0x85, 0x88 };	// jz, jnz, js
+
+	jit_add_bytecode_u8( function, 0x85 );	// test eax, eax
+	jit_add_bytecode_u8( function, 0xC0 );
+	jit_add_bytecode_u8( function, 0x0F );
+	jit_add_bytecode_u8( function, jcc[ condition ] );
+	function.add_label_patch( label );
+}
+
+void jit_jump_if_result( jit_function & function, int value, int label )
+{
+	jit_add_bytecode_u8( function, 0x3D );	// cmp eax, imm32
+	jit_add_bytecode_u32( function, value );
+	jit_add_bytecode_u8( function, 0x0F );	// je rel32
+	jit_add_bytecode_u8( function, 0x84 );
+	function.add_label_patch( label );
+}
@@ -32,6 +32,7 @@ namespace mysql_plugin
 		exported_module ~mytable();
 
 		exported_module virtual bool	get_member(const tu_stringi& name, as_value* val);
+		virtual bool	use_member_cache() const { return false; }
 
 		exported_module int size() const;
 		exported_module bool prev();
@@ -0,0 +1,43 @@
+<? 
+// Microbenchmark for ActionScript string concatenation: builds
+// strings of 10000 pieces, the way text for TextFields and XML
+// usually gets built, and traces how long it took.
+//
+//   gameswf_test_ogl -r 0 -1 bench_string_concat.swf
+
+$scale=20;
+Ming_setScale($scale);
+ming_useswfversion(6);
+
+$movie=new SWFMovie();
+$width=640; $height=480;
+$movie->setDimension($width,$height);
+$movie->setRate(30);
+
+$movie->add(new SWFAction("
+	start = getTimer();
+	for (r = 0; r < 10; r++) {
+		s = '';
+		for (i = 0; i < 10000; i++) {
+			s += i + ',';
+		}
+	}
+	trace('s += i + comma: ' + (getTimer() - start) + ' ms, length ' + s.length);
+
+	start = getTimer();
+	for (r = 0; r < 10; r++) {
+		xml = '<list>';
+		for (i = 0; i < 10000; i++) {
+			xml = xml + '<item id=\"' + i + '\"/>';
+		}
+		xml += '</list>';
+	}
+	trace('xml = xml + item: ' + (getTimer() - start) + ' ms, length ' + xml.length);
+
+	// Reading the characters.
+	trace(xml.substr(0, 40));
+"));
+$movie->nextframe();
+
+$movie->save("bench_string_concat.swf");
+?>
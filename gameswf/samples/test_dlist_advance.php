@@ -0,0 +1,68 @@
+<?
+// Stress test for display_list::advance(): 100 clips whose
+// onEnterFrame replace, add, swap and remove clips of the list being
+// advanced.  Each frame traces the clips advanced in the previous one;
+// the clips that were in the list when the frame began are advanced
+// once each, in their order, even if they have been removed since,
+// and the clips added during the frame wait for the next one.
+//
+//   gameswf_test_ogl test_dlist_advance.swf
+
+$scale=20;
+Ming_setScale($scale);
+ming_useswfversion(6);
+
+$movie=new SWFMovie();
+$width=640; $height=480;
+$movie->setDimension($width,$height);
+$movie->setRate(30);
+
+$movie->add(new SWFAction("
+	log = '';
+	frame = 0;
+
+	function tick() {
+		_root.log = _root.log + this._name + ' ';
+		if (_root.frame > 4) {
+			return;
+		}
+		var id = this.id;
+		if (id < 0) {
+			return;
+		}
+		var r = id % 4;
+		if (r == 0) {
+			// Replaces the next one, advanced or not yet.
+			_root.createEmptyMovieClip('c' + (id + 1), id + 2);
+		} else if (r == 1) {
+			var c = _root.createEmptyMovieClip('n' + _root.frame + '_' + id, 1000 + _root.frame * 200 + id);
+			c.id = -1;
+			c.onEnterFrame = _root.tick;
+		} else if (r == 2) {
+			this.swapDepths(_root['c' + ((id + 10) % 100)]);
+		} else {
+			this.removeMovieClip();
+		}
+	}
+
+	for (i = 0; i < 100; i++) {
+		c = _root.createEmptyMovieClip('c' + i, i + 1);
+		c.id = i;
+		c.onEnterFrame = tick;
+	}
+
+	_root.onEnterFrame = function() {
+		if (!(6 < _root.frame)) {
+			trace(_root.frame + ': ' + _root.log);
+		}
+		_root.log = '';
+		_root.frame = _root.frame + 1;
+	};
+
+	stop();
+"));
+$movie->nextframe();
+$movie->nextframe();
+
+$movie->save("test_dlist_advance.swf");
+?>
@@ -0,0 +1,83 @@
+<?
+// Roll over and roll out events while the mouse stays at (0, 0) and the
+// clips under it move, hide, get or lose handlers, change depth and go
+// away; checks that the hit test is done again when the scene under the
+// mouse changes, and only skips the clips far from it.
+//
+//   gameswf_test_ogl test_mouse_hit.swf
+
+$scale=20;
+Ming_setScale($scale);
+ming_useswfversion(6);
+
+$movie=new SWFMovie();
+$width=640; $height=480;
+$movie->setDimension($width,$height);
+$movie->setRate(12);
+
+$movie->add(new SWFAction("
+	function over() {
+		trace(this._name + ' over');
+	}
+
+	function out() {
+		trace(this._name + ' out');
+	}
+
+	function square(c) {
+		c.beginFill(0xFF0000, 100);
+		c.moveTo(-50, -50);
+		c.lineTo(50, -50);
+		c.lineTo(50, 50);
+		c.lineTo(-50, 50);
+		c.lineTo(-50, -50);
+		c.endFill();
+	}
+
+	// Clips away from the mouse.
+	for (i = 0; i < 20; i++) {
+		c = _root.createEmptyMovieClip('f' + i, 100 + i);
+		square(c);
+		c._x = 200 + i * 10;
+		c._y = 200;
+		c.onRollOver = over;
+	}
+
+	a = _root.createEmptyMovieClip('a', 1);
+	square(a);
+	a.onRollOver = over;
+	a.onRollOut = out;
+
+	p = _root.createEmptyMovieClip('p', 2);
+	p._x = 300;
+	q = p.createEmptyMovieClip('q', 1);
+	square(q);
+
+	frame = 0;
+	_root.onEnterFrame = function() {
+		frame = frame + 1;
+		if (frame == 2) { trace('step 2'); a._x = 300; }
+		if (frame == 4) { trace('step 4'); a._x = 0; }
+		if (frame == 6) { trace('step 6'); a._visible = false; }
+		if (frame == 8) { trace('step 8'); a._visible = true; }
+		if (frame == 10) { trace('step 10'); p._x = 0; }
+		if (frame == 12) { trace('step 12'); q.onRollOver = over; q.onRollOut = out; }
+		if (frame == 14) { trace('step 14'); q.enabled = false; }
+		if (frame == 16) { trace('step 16'); q.enabled = true; }
+		if (frame == 18) { trace('step 18'); p.swapDepths(a); }
+		if (frame == 20) { trace('step 20'); a.removeMovieClip(); }
+		if (frame == 22) { trace('step 22'); p.onRollOver = over; p.onRollOut = out; }
+		if (frame == 24) { trace('step 24'); p._x = 300; }
+		if (frame == 26) { trace('step 26'); p._x = 0; }
+		if (frame == 28) { trace('step 28'); p._xscale = 10; p._x = 20; }
+		if (frame == 30) { trace('step 30'); f0._y = 300; f1.onRollOut = out; }
+		if (frame == 32) { trace('step 32'); trace('done'); }
+	};
+
+	stop();
+"));
+$movie->nextframe();
+$movie->nextframe();
+
+$movie->save("test_mouse_hit.swf");
+?>
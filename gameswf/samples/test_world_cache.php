@@ -0,0 +1,78 @@
+<?
+// Bounds, _width and localToGlobal() of nested clips after their
+// matrices, drawings and display lists change; checks the cached world
+// transforms and bounds of the characters.
+//
+//   gameswf_test_ogl test_world_cache.swf
+
+$scale=20;
+Ming_setScale($scale);
+ming_useswfversion(6);
+
+$movie=new SWFMovie();
+$width=640; $height=480;
+$movie->setDimension($width,$height);
+$movie->setRate(12);
+
+$movie->add(new SWFAction("
+	function report() {
+		trace(_root.a._width + ' ' + _root.a._height + ' ' + _root.a.b._width + ' ' + _root.a.b.c._height);
+		r = _root.a.b.c.getBounds(_root);
+		trace(r.xMin + ' ' + r.xMax + ' ' + r.yMin + ' ' + r.yMax);
+		r = _root.a.getBounds(_root.a.b);
+		trace(r.xMin + ' ' + r.xMax + ' ' + r.yMin + ' ' + r.yMax);
+		p = {x: 10, y: 20};
+		_root.a.b.c.localToGlobal(p);
+		trace(p.x + ' ' + p.y);
+		_root.a.b.c.globalToLocal(p);
+		trace(p.x + ' ' + p.y);
+		trace(_root.a.hitTest(60, 30, 0) + ' ' + _root.a.hitTest(250, 30, 0) + ' ' + _root.a.hitTest(_root.a.b.c));
+	}
+
+	_root.createEmptyMovieClip('a', 1);
+	_root.a.createEmptyMovieClip('b', 1);
+	_root.a.b.createEmptyMovieClip('c', 1);
+	_root.a.b.c.beginFill(0xff0000, 100);
+	_root.a.b.c.moveTo(0, 0);
+	_root.a.b.c.lineTo(100, 0);
+	_root.a.b.c.lineTo(100, 50);
+	_root.a.b.c.lineTo(0, 50);
+	_root.a.b.c.lineTo(0, 0);
+	_root.a.b.c.endFill();
+	report();
+
+	_root.a.b._x = 30;
+	report();
+	_root.a.b.c._rotation = 45;
+	report();
+	_root.a._xscale = 200;
+	report();
+	_root.a._y = 7;
+	report();
+	_root.a.b.c.lineTo(200, 200);
+	report();
+
+	_root.a.b.createEmptyMovieClip('d', 2);
+	_root.a.b.d.beginFill(0xff0000, 100);
+	_root.a.b.d.moveTo(-50, -50);
+	_root.a.b.d.lineTo(-20, -50);
+	_root.a.b.d.lineTo(-20, -20);
+	_root.a.b.d.lineTo(-50, -50);
+	_root.a.b.d.endFill();
+	report();
+	_root.a.b.d._y = 300;
+	report();
+	_root.a.b.d.removeMovieClip();
+	report();
+
+	_root.a.b._rotation = -30;
+	report();
+	_root.a.b._width = 55;
+	report();
+	_root.a.b.c.swapDepths(5);
+	report();
+"));
+$movie->nextframe();
+
+$movie->save("test_world_cache.swf");
+?>